@@ -49,12 +49,16 @@ SOFTWARE.*/
 #include <FEMLib/FEMeshDataGenerator.h>
 #include <FEMLib/FSModel.h>
 #include <sstream>
+#include <algorithm>
+#include <tuple>
+#include <set>
 using namespace FEBio;
 
 // dummy model used for allocating temporary FEBio classes.
 static FEBioModel* febioModel = nullptr;
 
 static std::map<std::string, int> classIndex;
+static std::vector<std::string> classNames;
 
 int baseClassIndex(const char* sz)
 {
@@ -66,12 +70,224 @@ int baseClassIndex(const char* sz)
 	{
 		n = classIndex.size();
 		classIndex[sz] = n;
+		classNames.push_back(sz);
 	}
-	else n = classIndex[sz];
+	else n = it->second;
 
 	return n;
 }
 
+//-----------------------------------------------------------------------------
+// The class catalog indexes the kernel's factory classes by module, super class
+// and base class, so that class searches don't need to scan all the factories.
+// The results of searches are cached as well. The catalog is rebuilt when the
+// number of factory classes changes (e.g. when a plugin is loaded), or when
+// UpdateClassCatalog is called.
+class FEBioClassCatalog
+{
+	typedef std::tuple<int, int, int, unsigned int> SearchKey;
+
+public:
+	FEBioClassCatalog() { m_factories = -1; }
+
+	void Invalidate() { m_factories = -1; }
+
+	void Update()
+	{
+		FECoreKernel& fecore = FECoreKernel::GetInstance();
+		if (m_factories != fecore.FactoryClasses()) Build();
+	}
+
+	void Build();
+
+	const FEBioClassInfo& ClassInfo(int i) const { return m_info[i]; }
+
+	int Classes() const { return (int)m_info.size(); }
+
+	int AllocatorID(int i) const { return m_allocId[i]; }
+
+	const std::vector<FEBioClassInfo>& FindAllClasses(int mod, int superId, int baseClassId, unsigned int flags);
+
+private:
+	const std::vector<int>* Candidates(int mod, int superId, int baseClassId) const;
+
+	template <typename K> static const std::vector<int>* find_list(const std::map<K, std::vector<int> >& m, const K& key)
+	{
+		static const std::vector<int> empty;
+		auto it = m.find(key);
+		return (it != m.end() ? &it->second : &empty);
+	}
+
+private:
+	int	m_factories;	// nr of factory classes when the catalog was built
+
+	std::vector<FEBioClassInfo>	m_info;		// info for all factory classes
+	std::vector<int>			m_modId;	// module ID of each class
+	std::vector<int>			m_allocId;	// allocator ID of each class
+
+	std::map<int, std::vector<int> >	m_byModule;
+	std::map<int, std::vector<int> >	m_bySuper;
+	std::map<int, std::vector<int> >	m_byBase;
+	std::map<std::pair<int, int>, std::vector<int> >	m_byModSuper;
+
+	std::map<int, std::vector<int> >	m_deps;	// module dependencies (incl. FECore)
+
+	std::map<SearchKey, std::vector<FEBioClassInfo> >	m_cache;
+};
+
+void FEBioClassCatalog::Build()
+{
+	m_info.clear();
+	m_modId.clear();
+	m_allocId.clear();
+	m_byModule.clear();
+	m_bySuper.clear();
+	m_byBase.clear();
+	m_byModSuper.clear();
+	m_deps.clear();
+	m_cache.clear();
+
+	FECoreKernel& fecore = FECoreKernel::GetInstance();
+	int N = fecore.FactoryClasses();
+	m_info.reserve(N);
+	m_modId.reserve(N);
+	m_allocId.reserve(N);
+	for (int i = 0; i < N; ++i)
+	{
+		const FECoreFactory* fac = fecore.GetFactoryClass(i);
+		int modId = fac->GetModuleID();
+		int superId = fac->GetSuperClassID();
+		int baseId = baseClassIndex(fac->GetBaseClassName());
+
+		FEBio::FEBioClassInfo febc = {
+			(unsigned int)i,
+			superId,
+			baseId,
+			fac->GetTypeStr(),
+			fac->GetClassName(),
+			fecore.GetModuleName(modId - 1),
+			fac->GetSpecID() };
+		m_info.push_back(febc);
+		m_modId.push_back(modId);
+		m_allocId.push_back(fac->GetAllocatorID());
+
+		m_byModule[modId].push_back(i);
+		m_bySuper[superId].push_back(i);
+		if (baseId >= 0) m_byBase[baseId].push_back(i);
+		m_byModSuper[std::make_pair(modId, superId)].push_back(i);
+	}
+
+	// module dependencies
+	for (int i = 0; i < fecore.Modules(); ++i)
+	{
+		std::vector<int> mods = fecore.GetModuleDependencies(i);
+		mods.push_back(0);
+		std::sort(mods.begin(), mods.end());
+		mods.erase(std::unique(mods.begin(), mods.end()), mods.end());
+		m_deps[i + 1] = mods;
+	}
+
+	m_factories = N;
+}
+
+// Returns the smallest index list that contains all the classes that can match.
+// Returns nullptr if all classes need to be checked. The lists are sorted.
+const std::vector<int>* FEBioClassCatalog::Candidates(int mod, int superId, int baseClassId) const
+{
+	if (baseClassId != -1) return find_list(m_byBase, baseClassId);
+	if ((mod != -1) && (superId != -1)) return find_list(m_byModSuper, std::make_pair(mod, superId));
+	if (mod != -1) return find_list(m_byModule, mod);
+	if (superId != -1) return find_list(m_bySuper, superId);
+	return nullptr;
+}
+
+const std::vector<FEBioClassInfo>& FEBioClassCatalog::FindAllClasses(int mod, int superId, int baseClassId, unsigned int flags)
+{
+	SearchKey key(mod, superId, baseClassId, flags);
+	auto cit = m_cache.find(key);
+	if (cit != m_cache.end()) return cit->second;
+
+	std::vector<FEBioClassInfo>& facs = m_cache[key];
+
+	bool includeModuleDependencies = (flags & ClassSearchFlags::IncludeModuleDependencies);
+	bool includeFECoreClasses = includeModuleDependencies;// (flags & ClassSearchFlags::IncludeFECoreClasses);
+
+#ifdef FEBIO_EXPERIMENTAL
+	bool includeExperimentals = true;
+#else
+	bool includeExperimentals = false;
+#endif
+
+	// First, add all the primary module features that match
+	const std::vector<int>* candidates = Candidates(mod, superId, baseClassId);
+	int N = (candidates ? (int)candidates->size() : Classes());
+	for (int n = 0; n < N; ++n)
+	{
+		int i = (candidates ? (*candidates)[n] : n);
+		const FEBioClassInfo& ci = m_info[i];
+		if (((mod         == -1) || (mod == m_modId[i])) &&
+			((superId     == -1) || (ci.superClassId == superId)) &&
+			((baseClassId == -1) || (ci.baseClassId == baseClassId)) &&
+			((ci.spec != FECORE_EXPERIMENTAL) || includeExperimentals))
+		{
+			facs.push_back(ci);
+		}
+	}
+
+	// Now, add all features from the dependent modules that match
+	if ((mod != -1) && (includeModuleDependencies || includeFECoreClasses))
+	{
+		std::vector<int> mods;
+		if (includeModuleDependencies)
+		{
+			auto it = m_deps.find(mod);
+			if (it != m_deps.end()) mods = it->second;
+		}
+		if (includeFECoreClasses) mods.push_back(0);
+
+		// collect the classes of the dependent modules
+		std::vector<int> dep;
+		for (int m : mods)
+		{
+			if (m == mod) continue;
+			const std::vector<int>* l = Candidates(m, superId, -1);
+			dep.insert(dep.end(), l->begin(), l->end());
+		}
+		std::sort(dep.begin(), dep.end());
+		dep.erase(std::unique(dep.begin(), dep.end()), dep.end());
+
+		// It is possible that features are re-defined in different modules. 
+		// However, we only want to keep the feature in the primary module. 
+		bool checkDuplicates = ((superId != -1) && includeModuleDependencies);
+		std::set<std::string> types;
+		if (checkDuplicates)
+		{
+			for (const FEBioClassInfo& ci : facs) types.insert(ci.sztype);
+		}
+
+		for (int i : dep)
+		{
+			const FEBioClassInfo& ci = m_info[i];
+			if (((superId     == -1) || (ci.superClassId == superId)) &&
+				((baseClassId == -1) || (ci.baseClassId == baseClassId)))
+			{
+				if (checkDuplicates && (types.insert(ci.sztype).second == false)) continue;
+				facs.push_back(ci);
+			}
+		}
+	}
+
+	return facs;
+}
+
+static FEBioClassCatalog classCatalog;
+
+void FEBio::UpdateClassCatalog()
+{
+	classCatalog.Invalidate();
+	classCatalog.Update();
+}
+
 int FEBio::GetBaseClassIndex(const std::string& baseClassName)
 {
 	return baseClassIndex(baseClassName.c_str());
@@ -87,11 +303,8 @@ int FEBio::GetBaseClassIndex(int superId, const std::string& typeStr)
 
 std::string FEBio::GetBaseClassName(int baseClassIndex)
 {
-	for (auto& it : classIndex)
-	{
-		if (it.second == baseClassIndex) return it.first;
-	}
-	return std::string();
+	if ((baseClassIndex < 0) || (baseClassIndex >= (int)classNames.size())) return std::string();
+	return classNames[baseClassIndex];
 }
 
 bool FEBio::HasBaseClass(FSModelComponent* pm, const char* szbase)
@@ -107,15 +320,6 @@ bool FEBio::HasBaseClass(FSModelComponent* pm, const char* szbase)
 	return (n0 == n1);
 }
 
-bool in_vector(const vector<int>& v, int n)
-{
-	for (int j = 0; j < v.size(); ++j)
-	{
-		if (v[j] == n) return true;
-	}
-	return false;
-}
-
 FEBioClassInfo FEBio::GetClassInfo(int classId)
 {
 	FECoreKernel& fecore = FECoreKernel::GetInstance();
@@ -155,123 +359,17 @@ std::vector<std::string> FEBio::GetModuleDependencies(int mod)
 
 std::vector<FEBio::FEBioClassInfo> FEBio::FindAllClasses(int mod, int superId, int baseClassId, unsigned int flags)
 {
-	vector<FEBio::FEBioClassInfo> facs;
-
-	bool includeModuleDependencies = (flags & ClassSearchFlags::IncludeModuleDependencies);
-	bool includeFECoreClasses = includeModuleDependencies;// (flags & ClassSearchFlags::IncludeFECoreClasses);
-
-#ifdef FEBIO_EXPERIMENTAL
-	bool includeExperimentals = true;
-#else
-	bool includeExperimentals = false;
-#endif
-
-	FECoreKernel& fecore = FECoreKernel::GetInstance();
-	vector<int> mods;
-	if ((mod != -1) && includeModuleDependencies)
-	{
-		mods = fecore.GetModuleDependencies(mod - 1);
-	}
-	if ((mod != -1) && includeFECoreClasses) 
-	{
-		mods.push_back(0);
-	}
-
-	// First, add all the primary module features that match
-	for (int i = 0; i < fecore.FactoryClasses(); ++i)
-	{
-		const FECoreFactory* fac = fecore.GetFactoryClass(i);
-		int facmod = fac->GetModuleID();
-		int baseId = baseClassIndex(fac->GetBaseClassName());
-		int spec = fac->GetSpecID();
-
-		if (((mod         == -1) || (mod == facmod)) && 
-			((superId     == -1) || (fac->GetSuperClassID() == superId)) &&
-			((baseClassId == -1) || (baseId == baseClassId)) &&
-			((spec != FECORE_EXPERIMENTAL) || includeExperimentals))
-		{
-			const char* szmod = fecore.GetModuleName(fac->GetModuleID() - 1);
-			FEBio::FEBioClassInfo febc = {
-				(unsigned int)i,
-				fac->GetSuperClassID(),
-				baseClassIndex(fac->GetBaseClassName()),
-				fac->GetTypeStr(),
-				fac->GetClassName(),
-				szmod,
-				fac->GetSpecID() };
-			facs.push_back(febc);
-		}
-	}
-
-	// Now, add all features from the dependent modules that match
-	if (mod != -1)
-	{
-		for (int i = 0; i < fecore.FactoryClasses(); ++i)
-		{
-			const FECoreFactory* fac = fecore.GetFactoryClass(i);
-			int facmod = fac->GetModuleID();
-			int baseId = baseClassIndex(fac->GetBaseClassName());
-
-			if ((mod != facmod) && in_vector(mods, facmod) &&
-				((superId     == -1) || (fac->GetSuperClassID() == superId)) &&
-				((baseClassId == -1) || (baseId == baseClassId)))
-			{
-				// It is possible that features are re-defined in different modules. 
-				// However, we only want to keep the feature in the primary module. 
-				bool badd = true;
-				if ((superId != -1) && (mod != -1) && includeModuleDependencies && (mod != facmod))
-				{
-					for (int j = 0; j < facs.size(); ++j)
-					{
-						if (strcmp(facs[j].sztype, fac->GetTypeStr()) == 0)
-						{
-							badd = false;
-							break;
-						}
-					}
-				}
-
-				if (badd)
-				{
-					const char* szmod = fecore.GetModuleName(fac->GetModuleID() - 1);
-					FEBio::FEBioClassInfo febc = {
-						(unsigned int)i,
-						fac->GetSuperClassID(),
-						baseClassIndex(fac->GetBaseClassName()),
-						fac->GetTypeStr(),
-						fac->GetClassName(),
-						szmod,
-						fac->GetSpecID() };
-					facs.push_back(febc);
-				}
-			}
-		}
-	}
-
-	return facs;
+	classCatalog.Update();
+	return classCatalog.FindAllClasses(mod, superId, baseClassId, flags);
 }
 
 std::vector<FEBio::FEBioClassInfo> FEBio::FindAllPluginClasses(int allocId)
 {
 	vector<FEBio::FEBioClassInfo> facs;
-	FECoreKernel& fecore = FECoreKernel::GetInstance();
-	for (int i = 0; i < fecore.FactoryClasses(); ++i)
+	classCatalog.Update();
+	for (int i = 0; i < classCatalog.Classes(); ++i)
 	{
-		const FECoreFactory* fac = fecore.GetFactoryClass(i);
-		if (fac->GetAllocatorID() == allocId)
-		{
-			const char* szmod = fecore.GetModuleName(fac->GetModuleID() - 1);
-			FEBio::FEBioClassInfo febc = {
-				(unsigned int)i,
-				fac->GetSuperClassID(),
-				baseClassIndex(fac->GetBaseClassName()),
-				fac->GetTypeStr(),
-				fac->GetClassName(),
-				szmod,
-				fac->GetSpecID()
-			};
-			facs.push_back(febc);
-		}
+		if (classCatalog.AllocatorID(i) == allocId) facs.push_back(classCatalog.ClassInfo(i));
 	}
 	return facs;
 }
@@ -116,6 +116,10 @@ namespace FEBio {
 		AllFlags = 0xFF
 	};
 
+	// Rebuild the class catalog that is used by the class searches below.
+	// Call this after the FEBio library is initialized and when plugins are (un)loaded.
+	void UpdateClassCatalog();
+
 	std::vector<FEBioClassInfo> FindAllClasses(int mod, int superId, int baseClassId = -1, unsigned int flags = ClassSearchFlags::AllFlags);
 	std::vector<FEBioClassInfo> FindAllPluginClasses(int allocId);
 	std::vector<FEBioClassInfo> FindAllActiveClasses(int superId, int baseClassId = -1, unsigned int flags = ClassSearchFlags::AllFlags);
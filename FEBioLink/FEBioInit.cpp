@@ -28,6 +28,7 @@ SOFTWARE.*/
 #include <FECore/FEModelUpdate.h>
 #include <FEMLib/FSProject.h>
 #include "FEBioModule.h"
+#include "FEBioClass.h"
 
 class FBSModelUpdate : public FEModelUpdate
 {
@@ -55,6 +56,9 @@ void FEBio::InitFEBioLibrary()
 {
 	febio::InitLibrary();
 
+	// index all the FEBio classes
+	FEBio::UpdateClassCatalog();
+
 	// we will process create events
 	FEBio::BlockCreateEvents(false);
 }
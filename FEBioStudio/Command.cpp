@@ -93,6 +93,13 @@ void CCmdGroup::UnExecute()
 
 int CCmdGroup::GetCount() const { return (int)m_Cmd.size(); }
 
+size_t CCmdGroup::MemoryUsage() const
+{
+	size_t mem = 0;
+	for (CCommand* pcmd : m_Cmd) mem += pcmd->MemoryUsage();
+	return mem;
+}
+
 void CCmdGroup::SetViewState(VIEW_STATE state)
 {
 	CCommand::SetViewState(state);
@@ -31,6 +31,7 @@ SOFTWARE.*/
 #include <GeomLib/GObject.h>
 
 std::string CBasicCmdManager::m_err;
+size_t CBasicCmdManager::m_maxMemory = 0;
 
 CBasicCmdManager::CBasicCmdManager()
 {
@@ -44,11 +45,13 @@ CBasicCmdManager::~CBasicCmdManager()
 void CBasicCmdManager::AddCommand(CCommand* pcmd)
 {
 	// push the command
-	m_Undo.push(pcmd);
+	m_Undo.push_back(pcmd);
 
 	// clear the redo stack
 	int N = (int)m_Redo.size();
-	for (int i = 0; i<N; i++) { delete m_Redo.top(); m_Redo.pop(); }
+	for (int i = 0; i<N; i++) { delete m_Redo.back(); m_Redo.pop_back(); }
+
+	TrimUndoStack();
 }
 
 bool CBasicCmdManager::DoCommand(CCommand* pcmd)
@@ -78,11 +81,13 @@ bool CBasicCmdManager::DoCommand(CCommand* pcmd)
 	}
 
 	// add it to the undo stack
-	m_Undo.push(pcmd);
+	m_Undo.push_back(pcmd);
 
 	// clear the redo stack
 	int N = (int)m_Redo.size();
-	for (int i = 0; i<N; i++) { delete m_Redo.top(); m_Redo.pop(); }
+	for (int i = 0; i<N; i++) { delete m_Redo.back(); m_Redo.pop_back(); }
+
+	TrimUndoStack();
 
 	return true;
 }
@@ -92,13 +97,13 @@ void CBasicCmdManager::UndoCommand()
 	if (m_Undo.empty() == false)
 	{
 		// pop the command from the undo stack
-		CCommand* pcmd = m_Undo.top(); m_Undo.pop();
+		CCommand* pcmd = m_Undo.back(); m_Undo.pop_back();
 
 		// unexecute it
 		pcmd->UnExecute();
 
 		// push it on the redo stack
-		m_Redo.push(pcmd);
+		m_Redo.push_back(pcmd);
 	}
 }
 
@@ -107,13 +112,13 @@ void CBasicCmdManager::RedoCommand()
 	if (m_Redo.empty() == false)
 	{
 		// pop the command from the redo stack
-		CCommand* pcmd = m_Redo.top(); m_Redo.pop();
+		CCommand* pcmd = m_Redo.back(); m_Redo.pop_back();
 
 		// execute it
 		pcmd->Execute();
 
 		// push it on the undo stack
-		m_Undo.push(pcmd);
+		m_Undo.push_back(pcmd);
 	}
 }
 
@@ -121,15 +126,42 @@ void CBasicCmdManager::Clear()
 {
 	// clear undo stack
 	int N = (int)m_Undo.size();
-	for (int i = 0; i<N; i++) { delete m_Undo.top(); m_Undo.pop(); }
+	for (int i = 0; i<N; i++) { delete m_Undo.back(); m_Undo.pop_back(); }
 
 	// clear redo stack
 	N = (int)m_Redo.size();
-	for (int i = 0; i<N; i++) { delete m_Redo.top(); m_Redo.pop(); }
+	for (int i = 0; i<N; i++) { delete m_Redo.back(); m_Redo.pop_back(); }
+}
+
+const char* CBasicCmdManager::GetUndoCmdName() { return (m_Undo.size() ? m_Undo.back()->GetName() : 0); }
+const char* CBasicCmdManager::GetRedoCmdName() { return (m_Redo.size() ? m_Redo.back()->GetName() : 0); }
+
+void CBasicCmdManager::SetMemoryBudget(size_t maxBytes) { m_maxMemory = maxBytes; }
+size_t CBasicCmdManager::GetMemoryBudget() { return m_maxMemory; }
+
+size_t CBasicCmdManager::MemoryUsage() const
+{
+	size_t mem = 0;
+	for (CCommand* pcmd : m_Undo) mem += pcmd->MemoryUsage();
+	for (CCommand* pcmd : m_Redo) mem += pcmd->MemoryUsage();
+	return mem;
 }
 
-const char* CBasicCmdManager::GetUndoCmdName() { return (m_Undo.size() ? m_Undo.top()->GetName() : 0); }
-const char* CBasicCmdManager::GetRedoCmdName() { return (m_Redo.size() ? m_Redo.top()->GetName() : 0); }
+void CBasicCmdManager::TrimUndoStack()
+{
+	if (m_maxMemory == 0) return;
+
+	size_t mem = MemoryUsage();
+
+	// always keep the last command so it can be undone
+	while ((mem > m_maxMemory) && (m_Undo.size() > 1))
+	{
+		CCommand* pcmd = m_Undo.front(); m_Undo.pop_front();
+		size_t cmdMem = pcmd->MemoryUsage();
+		mem = (cmdMem < mem ? mem - cmdMem : 0);
+		delete pcmd;
+	}
+}
 
 //////////////////////////////////////////////////////////////////////
 // CCommandManager
@@ -201,11 +233,13 @@ bool CCommandManager::DoCommand(CCommand* pcmd)
 	}
 		
 	// add it to the undo stack
-	m_Undo.push(pcmd);
+	m_Undo.push_back(pcmd);
 
 	// clear the redo stack
 	int N = (int)m_Redo.size();
-	for (int i=0; i<N; i++) { delete m_Redo.top(); m_Redo.pop(); }
+	for (int i=0; i<N; i++) { delete m_Redo.back(); m_Redo.pop_back(); }
+
+	TrimUndoStack();
 
 	return true;
 }
@@ -213,7 +247,7 @@ bool CCommandManager::DoCommand(CCommand* pcmd)
 void CCommandManager::UndoCommand()
 {
 	// pop the command from the undo stack
-	CCommand* pcmd = m_Undo.top(); m_Undo.pop();
+	CCommand* pcmd = m_Undo.back(); m_Undo.pop_back();
 
 	// reset the view state
     CGLDocument* glDoc = dynamic_cast<CGLDocument*>(m_pDoc);
@@ -226,13 +260,13 @@ void CCommandManager::UndoCommand()
 	pcmd->UnExecute();
 
 	// push it on the redo stack
-	m_Redo.push(pcmd);
+	m_Redo.push_back(pcmd);
 }
 
 void CCommandManager::RedoCommand()
 {
 	// pop the command from the redo stack
-	CCommand* pcmd = m_Redo.top(); m_Redo.pop();
+	CCommand* pcmd = m_Redo.back(); m_Redo.pop_back();
 
 	// reset the view state
 	CGLDocument* glDoc = dynamic_cast<CGLDocument*>(m_pDoc);
@@ -245,5 +279,5 @@ void CCommandManager::RedoCommand()
 	pcmd->Execute();
 
 	// push it on the undo stack
-	m_Undo.push(pcmd);
+	m_Undo.push_back(pcmd);
 }
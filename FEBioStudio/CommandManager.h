@@ -25,13 +25,13 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.*/
 
 #pragma once
-#include <stack>
+#include <deque>
 #include <string>
 
 class CCommand;
 class CUndoDocument;
 
-typedef std::stack<CCommand*> CCmdStack;
+typedef std::deque<CCommand*> CCmdStack;
 
 class CBasicCmdManager
 {
@@ -55,10 +55,24 @@ public:
 	const char* GetUndoCmdName();
 	const char* GetRedoCmdName();
 
+	// approximate memory held by the undo and redo stacks (in bytes)
+	size_t MemoryUsage() const;
+
+	// Set the memory budget (in bytes) of the undo stack. When the budget is 
+	// exceeded the oldest commands are discarded. Zero means no limit.
+	static void SetMemoryBudget(size_t maxBytes);
+	static size_t GetMemoryBudget();
+
+protected:
+	// discard the oldest commands until the memory budget is met
+	void TrimUndoStack();
+
 protected:
 	CCmdStack	m_Undo;	// the undo stack
 	CCmdStack	m_Redo;	// the redo stack
 
+	static size_t	m_maxMemory;	// memory budget for undo stack
+
 public:
 	static const std::string& GetErrorString() { return m_err; }
 	void SetErrorString(const std::string& err) { m_err = err; }
@@ -2150,10 +2150,14 @@ void CCmdDeleteFESelection::Execute()
 	}
 
 	// set the object's mesh
+	m_pnew->Unpack();
 	m_pobj->ReplaceFEMesh(m_pnew, false);
 
 	// swap meshes
 	FSMesh* pm = m_pnew; m_pnew = m_pold; m_pold = pm;
+
+	// the old mesh is only needed for undo
+	m_pnew->Pack();
 }
 
 //-----------------------------------------------------------------------------
@@ -2162,10 +2166,17 @@ void CCmdDeleteFESelection::Execute()
 void CCmdDeleteFESelection::UnExecute()
 {
 	// set the object's mesh
+	m_pnew->Unpack();
 	m_pobj->ReplaceFEMesh(m_pnew);
 
 	// swap meshes
 	FSMesh* pm = m_pnew; m_pnew = m_pold; m_pold = pm;
+	m_pnew->Pack();
+}
+
+size_t CCmdDeleteFESelection::MemoryUsage() const
+{
+	return (m_pnew ? m_pnew->MemoryUsage() : 0);
 }
 
 //=============================================================================
@@ -2196,10 +2207,14 @@ void CCmdDeleteFESurfaceSelection::Execute()
 	}
 
 	// set the object's mesh
+	m_pnew->Unpack();
 	m_pobj->ReplaceSurfaceMesh(m_pnew);
 
 	// swap meshes
 	FSSurfaceMesh* pm = m_pnew; m_pnew = m_pold; m_pold = pm;
+
+	// the old mesh is only needed for undo
+	m_pnew->Pack();
 }
 
 //-----------------------------------------------------------------------------
@@ -2208,10 +2223,19 @@ void CCmdDeleteFESurfaceSelection::Execute()
 void CCmdDeleteFESurfaceSelection::UnExecute()
 {
 	// set the object's mesh
+	m_pnew->Unpack();
 	m_pobj->ReplaceSurfaceMesh(m_pnew);
 
 	// swap meshes
 	FSSurfaceMesh* pm = m_pnew; m_pnew = m_pold; m_pold = pm;
+
+	// the old mesh is only needed for undo
+	m_pnew->Pack();
+}
+
+size_t CCmdDeleteFESurfaceSelection::MemoryUsage() const
+{
+	return (m_pnew ? m_pnew->MemoryUsage() : 0);
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -2760,6 +2784,7 @@ void CCmdApplyFEModifier::Execute()
 		try
 		{
 			// This could throw a GObjecException
+			m_pnew->Unpack();
 			m_pobj->ReplaceFEMesh(m_pnew);
 		}
 		catch (...)
@@ -2774,6 +2799,9 @@ void CCmdApplyFEModifier::Execute()
 		// swap old and new
 		// we do this so that we can always delete m_pnew
 		FSMesh* pm = m_pnew; m_pnew = m_pold; m_pold = pm;
+
+		// the old mesh is only needed for undo
+		m_pnew->Pack();
 	}
 }
 
@@ -2783,14 +2811,21 @@ void CCmdApplyFEModifier::UnExecute()
 	if (m_pnew)
 	{
 		// replace the old mesh with the new
+		m_pnew->Unpack();
 		m_pobj->ReplaceFEMesh(m_pnew);
 
 		// swap old and new
 		// we do this so that we can always delete m_pnew
 		FSMesh* pm = m_pnew; m_pnew = m_pold; m_pold = pm;
+		m_pnew->Pack();
 	}
 }
 
+size_t CCmdApplyFEModifier::MemoryUsage() const
+{
+	return (m_pnew ? m_pnew->MemoryUsage() : 0);
+}
+
 
 //=============================================================================
 // CCmdApplySurfaceModifier
@@ -2840,6 +2875,7 @@ void CCmdApplySurfaceModifier::Execute()
 		try
 		{
 			// This could throw a GObjecException
+			m_pnew->Unpack();
 			m_pobj->ReplaceSurfaceMesh(m_pnew);
 		}
 		catch (...)
@@ -2854,6 +2890,9 @@ void CCmdApplySurfaceModifier::Execute()
 		// swap old and new
 		// we do this so that we can always delete m_pnew
 		FSSurfaceMesh* pm = m_pnew; m_pnew = m_pold; m_pold = pm;
+
+		// the old mesh is only needed for undo
+		if (m_pnew) m_pnew->Pack();
 	}
 }
 
@@ -2863,14 +2902,21 @@ void CCmdApplySurfaceModifier::UnExecute()
 	if (m_pnew)
 	{
 		// replace the old mesh with the new
+		m_pnew->Unpack();
 		m_pobj->ReplaceSurfaceMesh(dynamic_cast<FSSurfaceMesh*>(m_pnew));
 
 		// swap old and new
 		// we do this so that we can always delete m_pnew
 		FSSurfaceMesh* pm = m_pnew; m_pnew = m_pold; m_pold = pm;
+		if (m_pnew) m_pnew->Pack();
 	}
 }
 
+size_t CCmdApplySurfaceModifier::MemoryUsage() const
+{
+	return (m_pnew ? m_pnew->MemoryUsage() : 0);
+}
+
 //=============================================================================
 // CCmdChangeFEMesh
 //-----------------------------------------------------------------------------
@@ -2886,9 +2932,12 @@ CCmdChangeFEMesh::CCmdChangeFEMesh(GObject* po, FSMesh* pm, bool bup) : CCommand
 void CCmdChangeFEMesh::Execute()
 {
 	FSMesh* pm = m_po->GetFEMesh();
+	if (m_pnew) m_pnew->Unpack();
 	m_po->ReplaceFEMesh(m_pnew, m_update);
 
+	// the old mesh is only needed for undo
 	m_pnew = pm;
+	if (m_pnew) m_pnew->Pack();
 }
 
 void CCmdChangeFEMesh::UnExecute()
@@ -2896,6 +2945,11 @@ void CCmdChangeFEMesh::UnExecute()
 	Execute();
 }
 
+size_t CCmdChangeFEMesh::MemoryUsage() const
+{
+	return (m_pnew ? m_pnew->MemoryUsage() : 0);
+}
+
 //=============================================================================
 // CCmdChangeFESurfaceMesh
 //-----------------------------------------------------------------------------
@@ -2918,8 +2972,12 @@ CCmdChangeFESurfaceMesh::~CCmdChangeFESurfaceMesh()
 void CCmdChangeFESurfaceMesh::Execute()
 {
 	FSSurfaceMesh* pm = m_po->GetSurfaceMesh();
+	if (m_pnew) m_pnew->Unpack();
 	m_po->ReplaceSurfaceMesh(m_pnew);
+
+	// the old mesh is only needed for undo
 	m_pnew = pm;
+	if (m_pnew) m_pnew->Pack();
 }
 
 void CCmdChangeFESurfaceMesh::UnExecute()
@@ -2927,6 +2985,11 @@ void CCmdChangeFESurfaceMesh::UnExecute()
 	Execute();
 }
 
+size_t CCmdChangeFESurfaceMesh::MemoryUsage() const
+{
+	return (m_pnew ? m_pnew->MemoryUsage() : 0);
+}
+
 
 ///////////////////////////////////////////////////////////////////////////////
 // CCmdChangeView
@@ -960,6 +960,8 @@ public:
 	void Execute();
 	void UnExecute();
 
+	size_t MemoryUsage() const override;
+
 protected:
 	GMeshObject*	m_pobj;
 	FSMesh*			m_pold;
@@ -978,6 +980,8 @@ public:
 	void Execute();
 	void UnExecute();
 
+	size_t MemoryUsage() const override;
+
 protected:
 	GSurfaceMeshObject*	m_pobj;
 	FSSurfaceMesh*		m_pold;
@@ -1121,6 +1125,8 @@ public:
 	void Execute();
 	void UnExecute();
 
+	size_t MemoryUsage() const override;
+
 protected:
 	GObject*		m_pobj;
 	FSMesh*			m_pold;	// old, unmodified mesh
@@ -1140,6 +1146,8 @@ public:
 	void Execute();
 	void UnExecute();
 
+	size_t MemoryUsage() const override;
+
 protected:
 	GObject*			m_pobj;
 	FSSurfaceMesh*		m_pold;	// old, unmodified mesh
@@ -1159,6 +1167,8 @@ public:
 	void Execute();
 	void UnExecute();
 
+	size_t MemoryUsage() const override;
+
 protected:
 	bool		m_update;
 	GObject*	m_po;
@@ -1175,6 +1185,8 @@ public:
 	void Execute();
 	void UnExecute();
 
+	size_t MemoryUsage() const override;
+
 protected:
 	bool				m_update;
 	GSurfaceMeshObject*	m_po;
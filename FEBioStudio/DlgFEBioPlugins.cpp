@@ -244,6 +244,9 @@ void CDlgFEBioPlugins::LoadPlugin(const QString& fileName)
 	// restore active module
 	fecore.SetActiveModule(modId);
 
+	// the plugin may have added new classes
+	FEBio::UpdateClassCatalog();
+
 	if (bsuccess == false)
 	{
 		QMessageBox::critical(this, "Load Plugin", QString("The plugin failed to load:\n%1").arg(fileName));
@@ -275,6 +278,7 @@ void CDlgFEBioPlugins::onUnloadPlugin()
 		FEBioPluginManager* pm = FEBioPluginManager::GetInstance(); assert(pm);
 		if (pm->UnloadPlugin(name.toStdString()))
 		{
+			FEBio::UpdateClassCatalog();
 			QMessageBox::information(this, "Unload plugin", QString("Plugin %1 unloaded successfully.").arg(name));
 		}
 		else
@@ -31,6 +31,8 @@ SOFTWARE.*/
 #include <QDialogButtonBox>
 #include <QBoxLayout>
 #include <QLabel>
+#include <QCheckBox>
+#include <QSpinBox>
 
 
 // converts a string to a list of numbers. 
@@ -103,6 +105,8 @@ public:
 	QRadioButton* pb3;
 	QRadioButton* pb4;
 	QLineEdit* pitems;
+	QCheckBox* lazy;
+	QSpinBox*  memBudget;
 
 public:
 	void setupUi(QDialog* parent)
@@ -121,6 +125,16 @@ public:
 		pv->addWidget(pitems = new QLineEdit);
 		pv->addWidget(new QLabel("(e.g.:1,2,3:6,10:100:5)"));
 
+		pv->addWidget(lazy = new QCheckBox("Load state data on demand (all states only)"));
+		QHBoxLayout* ph = new QHBoxLayout;
+		ph->addWidget(new QLabel("Memory limit (MB, 0 = no limit):"));
+		ph->addWidget(memBudget = new QSpinBox);
+		memBudget->setRange(0, 1024*1024);
+		memBudget->setSingleStep(256);
+		memBudget->setValue(0);
+		memBudget->setEnabled(false);
+		pv->addLayout(ph);
+
 		QDialogButtonBox* bb = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
 
 		pv->addWidget(bb);
@@ -129,11 +143,16 @@ public:
 		QObject::connect(bb, SIGNAL(accepted()), parent, SLOT(accept()));
 		QObject::connect(bb, SIGNAL(rejected()), parent, SLOT(reject()));
 		QObject::connect(pitems, SIGNAL(textEdited(const QString&)), pb3, SLOT(click()));
+		QObject::connect(lazy, SIGNAL(toggled(bool)), memBudget, SLOT(setEnabled(bool)));
 	}
 };
 
 CDlgImportXPLT::CDlgImportXPLT(QWidget* parent) : QDialog(parent), ui(new Ui::CDlgImportXPLT)
 {
+	m_nop = 0;
+	m_blazy = false;
+	m_memBudget = 0;
+
 	ui->setupUi(this);
 	setWindowTitle("Import XPLT");
 }
@@ -150,5 +169,8 @@ void CDlgImportXPLT::accept()
 	strcpy(buf, s.c_str());
 	string_to_int_list(buf, m_item);
 
+	m_blazy = ui->lazy->isChecked();
+	m_memBudget = ui->memBudget->value();
+
 	QDialog::accept();
 }
@@ -42,6 +42,8 @@ public:
 public:
 	int					m_nop;
 	std::vector<int>	m_item;
+	bool				m_blazy;		// load state data on demand
+	int					m_memBudget;	// max memory for states loaded on demand (in MB, 0 = no limit)
 
 private:
 	Ui::CDlgImportXPLT* ui;
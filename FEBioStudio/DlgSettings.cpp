@@ -154,6 +154,7 @@ public:
 		addEnumProperty(&m_theme, "Theme")->setEnumValues(themes);
 		addProperty("Recent files list", CProperty::Action)->info = QString("Clear");
 		addIntProperty(&m_autoSaveInterval, "AutoSave Interval (s)");
+		addIntProperty(&m_undoMemoryLimit, "Undo memory limit (MB)");
 	}
 
 	void SetPropertyValue(int i, const QVariant& v) override
@@ -175,6 +176,7 @@ public:
 	bool	m_bcmd;
 	int		m_theme;
 	int		m_autoSaveInterval;
+	int		m_undoMemoryLimit;
 };
 
 //-----------------------------------------------------------------------------
@@ -1037,6 +1039,7 @@ void CDlgSettings::UpdateSettings()
 	ui->m_ui->m_bcmd = m_pwnd->clearCommandStackOnSave();
 	ui->m_ui->m_theme = m_pwnd->currentTheme();
 	ui->m_ui->m_autoSaveInterval = m_pwnd->autoSaveInterval();
+	ui->m_ui->m_undoMemoryLimit = m_pwnd->undoMemoryLimit();
 
 	ui->m_select->m_bconnect = view.m_bconn;
 	ui->m_select->m_ntagInfo = view.m_ntagInfo;
@@ -1170,6 +1173,7 @@ void CDlgSettings::apply()
 
 	m_pwnd->setClearCommandStackOnSave(ui->m_ui->m_bcmd);
 	m_pwnd->setAutoSaveInterval(ui->m_ui->m_autoSaveInterval);
+	m_pwnd->setUndoMemoryLimit(ui->m_ui->m_undoMemoryLimit);
 
 	int oldTheme = m_pwnd->currentTheme();
 	if (ui->m_ui->m_theme != oldTheme)
@@ -1575,6 +1575,9 @@ void CModelGraphWindow::Update(bool breset, bool bfit)
 
 		m_dataXPrev = -1;
 		m_dataYPrev = -1;
+
+		// the data may have changed
+		m_history.Clear();
 	}
 
 	// Currently, when the time step changes, Update is called with breset set to false.
@@ -1900,7 +1903,7 @@ void CModelGraphWindow::addObjectData(int n)
 	{
 	case 0: // time values
 	{
-		for (int j = 0; j < nsteps; j++) xdata[j] = fem.GetState(j + m_firstState)->m_time;
+		for (int j = 0; j < nsteps; j++) xdata[j] = fem.GetTimeValue(j + m_firstState);
 	}
 	break;
 	case 1: // step values
@@ -1938,7 +1941,7 @@ void CModelGraphWindow::addProbeData(Post::GLProbe* probe)
 	vector<float> xdata(nsteps);
 	vector<float> ydata(nsteps);
 
-	for (int j = 0; j < nsteps; j++) xdata[j] = fem.GetState(j + m_firstState)->m_time;
+	for (int j = 0; j < nsteps; j++) xdata[j] = fem.GetTimeValue(j + m_firstState);
 
 	for (int j = 0; j < nsteps; ++j)
 	{
@@ -1961,7 +1964,7 @@ void CModelGraphWindow::addRulerData(Post::GLRuler* ruler)
 	vector<float> xdata(nsteps);
 	vector<float> ydata(nsteps);
 
-	for (int j = 0; j < nsteps; j++) xdata[j] = fem.GetState(j + m_firstState)->m_time;
+	for (int j = 0; j < nsteps; j++) xdata[j] = fem.GetTimeValue(j + m_firstState);
 
 	for (int j = 0; j < nsteps; ++j)
 	{
@@ -1984,7 +1987,7 @@ void CModelGraphWindow::addMusclePathData(Post::GLMusclePath* musclePath)
 	vector<float> xdata(nsteps);
 	vector<float> ydata(nsteps);
 
-	for (int j = 0; j < nsteps; j++) xdata[j] = fem.GetState(j + m_firstState)->m_time;
+	for (int j = 0; j < nsteps; j++) xdata[j] = fem.GetTimeValue(j + m_firstState);
 
 	for (int j = 0; j < nsteps; ++j)
 	{
@@ -2009,6 +2012,11 @@ void CModelGraphWindow::addSelectedNodes()
 	vector<float> xdata(nsteps);
 	vector<float> ydata(nsteps);
 
+	// evaluate the history of the selected items
+	vector<int> selItems;
+	for (int i = 0; i < mesh.Nodes(); ++i) if (mesh.Node(i).IsSelected()) selItems.push_back(i);
+	BuildHistory(Post::FEHistoryCache::NODE, selItems);
+
 	// get the selected nodes
 	int NN = mesh.Nodes();
 	switch (m_xtype)
@@ -2020,7 +2028,7 @@ void CModelGraphWindow::addSelectedNodes()
 			FSNode& node = mesh.Node(i);
 			if (node.IsSelected())
 			{
-				for (int j = 0; j<nsteps; j++) xdata[j] = fem.GetState(j + m_firstState)->m_time;
+				for (int j = 0; j<nsteps; j++) xdata[j] = fem.GetTimeValue(j + m_firstState);
 
 				// evaluate y-field
 				TrackNodeHistory(i, &ydata[0], m_dataY, m_firstState, m_lastState);
@@ -2108,7 +2116,7 @@ void CModelGraphWindow::addSelectedNodes()
 			for (int i = state0; i < state0 + nsteps; i += ninc)
 			{
 				CPlotData* plot = nextData();
-				plot->setLabel(QString("%1").arg(fem.GetState(i)->m_time));
+				plot->setLabel(QString("%1").arg(fem.GetTimeValue(i)));
 			}
 
 			for (int i = 0; i < (int)sel.size(); i++)
@@ -2155,6 +2163,11 @@ void CModelGraphWindow::addSelectedEdges()
 	vector<float> xdata(nsteps);
 	vector<float> ydata(nsteps);
 
+	// evaluate the history of the selected items
+	vector<int> selItems;
+	for (int i = 0; i < mesh.Edges(); ++i) if (mesh.Edge(i).IsSelected()) selItems.push_back(i);
+	BuildHistory(Post::FEHistoryCache::EDGE, selItems);
+
 	// get the selected nodes
 	int NL = mesh.Edges();
 	for (int i = 0; i<NL; i++)
@@ -2166,7 +2179,7 @@ void CModelGraphWindow::addSelectedEdges()
 			switch (m_xtype)
 			{
 			case 0:
-				for (int j = 0; j<nsteps; j++) xdata[j] = fem.GetState(j + m_firstState)->m_time;
+				for (int j = 0; j<nsteps; j++) xdata[j] = fem.GetTimeValue(j + m_firstState);
 				break;
 			case 1:
 				for (int j = 0; j<nsteps; j++) xdata[j] = (float)j + 1.f + m_firstState;
@@ -2196,6 +2209,11 @@ void CModelGraphWindow::addSelectedFaces()
 	vector<float> xdata(nsteps);
 	vector<float> ydata(nsteps);
 
+	// evaluate the history of the selected items
+	vector<int> selItems;
+	for (int i = 0; i < mesh.Faces(); ++i) if (mesh.Face(i).IsSelected()) selItems.push_back(i);
+	BuildHistory(Post::FEHistoryCache::FACE, selItems);
+
 	// get the selected faces
 	int NF = mesh.Faces();
 	switch (m_xtype)
@@ -2207,7 +2225,7 @@ void CModelGraphWindow::addSelectedFaces()
 			if (f.IsSelected())
 			{
 				// evaluate x-field
-				for (int j = 0; j < nsteps; j++) xdata[j] = fem.GetState(j + m_firstState)->m_time;
+				for (int j = 0; j < nsteps; j++) xdata[j] = fem.GetTimeValue(j + m_firstState);
 
 				// evaluate y-field
 				TrackFaceHistory(i, &ydata[0], m_dataY, m_firstState, m_lastState);
@@ -2274,7 +2292,7 @@ void CModelGraphWindow::addSelectedFaces()
 			for (int i = m_firstState; i < m_firstState + nsteps; i += ninc)
 			{
 				CPlotData* plot = nextData();
-				plot->setLabel(QString("%1").arg(fem.GetState(i)->m_time));
+				plot->setLabel(QString("%1").arg(fem.GetTimeValue(i)));
 			}
 
 			for (int i = 0; i < (int)sel.size(); i++)
@@ -2323,6 +2341,11 @@ void CModelGraphWindow::addSelectedElems()
 	vector<float> xdata(nsteps);
 	vector<float> ydata(nsteps);
 
+	// evaluate the history of the selected items
+	vector<int> selItems;
+	for (int i = 0; i < mesh.Elements(); ++i) if (mesh.ElementRef(i).IsSelected()) selItems.push_back(i);
+	BuildHistory(Post::FEHistoryCache::ELEM, selItems);
+
 	// get the selected elements
 	int NE = mesh.Elements();
 	switch (m_xtype)
@@ -2334,7 +2357,7 @@ void CModelGraphWindow::addSelectedElems()
 			if (e.IsSelected())
 			{
 				// evaluate x-field
-				for (int j = 0; j < nsteps; j++) xdata[j] = fem.GetState(j + m_firstState)->m_time;
+				for (int j = 0; j < nsteps; j++) xdata[j] = fem.GetTimeValue(j + m_firstState);
 
 				// evaluate y-field
 				TrackElementHistory(i, &ydata[0], m_dataY, m_firstState, m_lastState);
@@ -2401,7 +2424,7 @@ void CModelGraphWindow::addSelectedElems()
 			for (int i = m_firstState; i < m_firstState + nsteps; i += ninc)
 			{
 				CPlotData* plot = nextData();
-				plot->setLabel(QString("%1").arg(fem.GetState(i)->m_time));
+				plot->setLabel(QString("%1").arg(fem.GetTimeValue(i)));
 			}
 
 			for (int i = 0; i < (int)sel.size(); i++)
@@ -2442,30 +2465,22 @@ void CModelGraphWindow::addSelectedElems()
 }
 
 //-----------------------------------------------------------------------------
-// Calculate time history of a node
-void CModelGraphWindow::TrackNodeHistory(int node, float* pval, int nfield, int nmin, int nmax)
+// Evaluate the x and y fields of the items. The history of the items is then
+// read from the cache.
+void CModelGraphWindow::BuildHistory(int itemType, const std::vector<int>& items)
 {
+	if (items.empty()) return;
+
 	CPostDocument* doc = GetPostDoc();
 	Post::FEPostModel& fem = *doc->GetFSModel();
 
-	int nsteps = fem.GetStates();
-	if (nmin <       0) nmin = 0;
-	if (nmax == -1) nmax = nsteps - 1;
-	if (nmax >= nsteps) nmax = nsteps - 1;
-	if (nmax <    nmin) nmax = nmin;
-	int nn = nmax - nmin + 1;
-
-	Post::NODEDATA nd;
-	for (int n = 0; n<nn; n++)
-	{
-		fem.EvaluateNode(node, n + nmin, nfield, nd);
-		pval[n] = nd.m_val;
-	}
+	if (m_xtype >= 2) m_history.Build(fem, itemType, m_dataX, items, m_firstState, m_lastState);
+	m_history.Build(fem, itemType, m_dataY, items, m_firstState, m_lastState);
 }
 
 //-----------------------------------------------------------------------------
-// Calculate time history of a edge
-void CModelGraphWindow::TrackEdgeHistory(int edge, float* pval, int nfield, int nmin, int nmax)
+// Calculate time history of an item
+void CModelGraphWindow::TrackHistory(int itemType, int item, float* pval, int nfield, int nmin, int nmax)
 {
 	CPostDocument* doc = GetPostDoc();
 	Post::FEPostModel& fem = *doc->GetFSModel();
@@ -2475,56 +2490,42 @@ void CModelGraphWindow::TrackEdgeHistory(int edge, float* pval, int nfield, int
 	if (nmax == -1) nmax = nsteps - 1;
 	if (nmax >= nsteps) nmax = nsteps - 1;
 	if (nmax <    nmin) nmax = nmin;
-	int nn = nmax - nmin + 1;
 
-	Post::EDGEDATA nd;
-	for (int n = 0; n<nn; n++)
+	if (m_history.GetHistory(fem, itemType, nfield, item, nmin, nmax, pval) == false)
 	{
-		fem.EvaluateEdge(edge, n + nmin, nfield, nd);
-		pval[n] = nd.m_val;
+		std::vector<int> items(1, item);
+		m_history.Build(fem, itemType, nfield, items, nmin, nmax);
+		if (m_history.GetHistory(fem, itemType, nfield, item, nmin, nmax, pval) == false)
+		{
+			for (int n = 0; n <= nmax - nmin; ++n) pval[n] = 0.f;
+		}
 	}
 }
 
 //-----------------------------------------------------------------------------
-// Calculate time history of a face
-void CModelGraphWindow::TrackFaceHistory(int nface, float* pval, int nfield, int nmin, int nmax)
+// Calculate time history of a node
+void CModelGraphWindow::TrackNodeHistory(int node, float* pval, int nfield, int nmin, int nmax)
 {
-	CPostDocument* doc = GetPostDoc();
-	Post::FEPostModel& fem = *doc->GetFSModel();
+	TrackHistory(Post::FEHistoryCache::NODE, node, pval, nfield, nmin, nmax);
+}
 
-	int nsteps = fem.GetStates();
-	if (nmin <       0) nmin = 0;
-	if (nmax == -1) nmax = nsteps - 1;
-	if (nmax >= nsteps) nmax = nsteps - 1;
-	if (nmax <    nmin) nmax = nmin;
-	int nn = nmax - nmin + 1;
+//-----------------------------------------------------------------------------
+// Calculate time history of a edge
+void CModelGraphWindow::TrackEdgeHistory(int edge, float* pval, int nfield, int nmin, int nmax)
+{
+	TrackHistory(Post::FEHistoryCache::EDGE, edge, pval, nfield, nmin, nmax);
+}
 
-	float data[FSFace::MAX_NODES], val;
-	for (int n = 0; n<nn; n++)
-	{
-		fem.EvaluateFace(nface, n + nmin, nfield, data, val);
-		pval[n] = val;
-	}
+//-----------------------------------------------------------------------------
+// Calculate time history of a face
+void CModelGraphWindow::TrackFaceHistory(int nface, float* pval, int nfield, int nmin, int nmax)
+{
+	TrackHistory(Post::FEHistoryCache::FACE, nface, pval, nfield, nmin, nmax);
 }
 
 //-----------------------------------------------------------------------------
 // Calculate time history of an element
 void CModelGraphWindow::TrackElementHistory(int nelem, float* pval, int nfield, int nmin, int nmax)
 {
-	CPostDocument* doc = GetPostDoc();
-	Post::FEPostModel& fem = *doc->GetFSModel();
-
-	int nsteps = fem.GetStates();
-	if (nmin <       0) nmin = 0;
-	if (nmax == -1) nmax = nsteps - 1;
-	if (nmax >= nsteps) nmax = nsteps - 1;
-	if (nmax <    nmin) nmax = nmin;
-	int nn = nmax - nmin + 1;
-
-	float data[FSElement::MAX_NODES] = { 0.f }, val;
-	for (int n = 0; n<nn; n++)
-	{
-		fem.EvaluateElement(nelem, n + nmin, nfield, data, val);
-		pval[n] = val;
-	}
+	TrackHistory(Post::FEHistoryCache::ELEM, nelem, pval, nfield, nmin, nmax);
 }
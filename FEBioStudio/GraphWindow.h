@@ -28,6 +28,7 @@ SOFTWARE.*/
 #include <QMainWindow>
 #include "PlotWidget.h"
 #include "Document.h"
+#include <PostLib/FEHistoryCache.h>
 
 class CMainWindow;
 class CGraphWidget;
@@ -411,8 +412,12 @@ private:
 	void TrackFaceHistory(int nface, float* pval, int nfield, int nmin = 0, int nmax = -1);
 	void TrackEdgeHistory(int edge, float* pval, int nfield, int nmin = 0, int nmax = -1);
 	void TrackNodeHistory(int node, float* pval, int nfield, int nmin = 0, int nmax = -1);
+	void TrackHistory(int itemType, int item, float* pval, int nfield, int nmin, int nmax);
 	void TrackObjectHistory(int nobj, float* pval, int nfield);
 
+	// evaluate the x and y fields of the selected items in one pass over the states
+	void BuildHistory(int itemType, const std::vector<int>& items);
+
 private:
 	void addSelectedNodes();
 	void addSelectedEdges();
@@ -433,5 +438,7 @@ private: // temporary variables used during update
 	int	m_dataX, m_dataY;				// X and Y data field IDs
 	int	m_dataXPrev, m_dataYPrev;		// Previous X, Y data fields
 	int	m_pltCounter;
+
+	Post::FEHistoryCache	m_history;	// time history of the selected items
 };
 
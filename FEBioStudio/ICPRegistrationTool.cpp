@@ -47,6 +47,8 @@ class ICPRegistrationToolUI : public QWidget
 private:
     QLineEdit* m_tol;
     QLineEdit* m_maxiter;
+    QLineEdit* m_maxPoints;
+    QLineEdit* m_trim;
     CSelectionBox* m_src;
     CSelectionBox* m_trg;
 
@@ -63,12 +65,16 @@ public:
         QFormLayout* f = new QFormLayout;
         f->addRow("Tolerance:", m_tol = new QLineEdit); m_tol->setValidator(new QDoubleValidator());
         f->addRow("Max. iterations:", m_maxiter = new QLineEdit); m_maxiter->setValidator(new QIntValidator(1, 10000));
+        f->addRow("Max. points:", m_maxPoints = new QLineEdit); m_maxPoints->setValidator(new QIntValidator(0, 100000000));
+        f->addRow("Trim fraction:", m_trim = new QLineEdit); m_trim->setValidator(new QDoubleValidator(0.0, 1.0, 3));
         QPushButton* apply = new QPushButton("Apply");
 
         f->setAlignment(Qt::AlignRight);
 
         m_tol->setText(QString::number(0.01));
         m_maxiter->setText(QString::number(100));
+        m_maxPoints->setText(QString::number(0));
+        m_trim->setText(QString::number(1.0));
 
         QGroupBox* pg1 = new QGroupBox("Source");
         QVBoxLayout* l1 = new QVBoxLayout;
@@ -112,6 +118,8 @@ public:
 
     double tolerance() { return m_tol->text().toDouble(); }
     int maxIterations() { return m_maxiter->text().toInt(); }
+    int maxPoints() { return m_maxPoints->text().toInt(); }
+    double trimFraction() { return m_trim->text().toDouble(); }
 
 	bool UpdateSelectionList(FEItemListBuilder*& pl, FEItemListBuilder* items)
 	{
@@ -386,6 +394,8 @@ void CICPRegistrationTool::OnApply()
 	GICPRegistration icp;
 	icp.SetTolerance(ui->tolerance());
 	icp.SetMaxIterations(ui->maxIterations());
+	icp.SetMaxPoints(ui->maxPoints());
+	icp.SetTrimFraction(ui->trimFraction());
 	Transform Q = icp.Register(trgNodes, srcNodes);
 
 	vec3d t = Q.GetPosition();
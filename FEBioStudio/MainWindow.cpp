@@ -70,6 +70,7 @@ SOFTWARE.*/
 #include "Encrypter.h"
 #include "DlgImportXPLT.h"
 #include "Commands.h"
+#include "CommandManager.h"
 #include <XPLTLib/xpltFileReader.h>
 #include <GeomLib/GModel.h>
 #include "DocManager.h"
@@ -989,6 +990,8 @@ void CMainWindow::OpenPostFile(const QString& fileName, CModelDocument* modelDoc
 				{
 					xplt->SetReadStateFlag(dlg.m_nop);
 					xplt->SetReadStatesList(dlg.m_item);
+					xplt->SetLazyStateLoading(dlg.m_blazy);
+					xplt->SetStateMemoryBudget((size_t)dlg.m_memBudget * 1024 * 1024);
 				}
 				else
 				{
@@ -1800,6 +1803,17 @@ int CMainWindow::autoSaveInterval()
 	return ui->m_autoSaveInterval;
 }
 
+void CMainWindow::setUndoMemoryLimit(int megaBytes)
+{
+	if (megaBytes < 0) megaBytes = 0;
+	CBasicCmdManager::SetMemoryBudget((size_t)megaBytes << 20);
+}
+
+int CMainWindow::undoMemoryLimit()
+{
+	return (int)(CBasicCmdManager::GetMemoryBudget() >> 20);
+}
+
 QString CMainWindow::GetServerMessage()
 {
     return ui->m_serverMessage;
@@ -1839,6 +1853,7 @@ void CMainWindow::writeSettings()
 	settings.setValue("state", saveState());
 	settings.setValue("theme", ui->m_theme);
 	settings.setValue("autoSaveInterval", ui->m_autoSaveInterval);
+	settings.setValue("undoMemoryLimit", undoMemoryLimit());
 	settings.setValue("defaultUnits", ui->m_defaultUnits);
 	settings.setValue("bgColor1", (int)vs.m_col1);
 	settings.setValue("bgColor2", (int)vs.m_col2);
@@ -1962,6 +1977,7 @@ void CMainWindow::readSettings()
 	restoreState(settings.value("state").toByteArray());
 	ui->m_theme = settings.value("theme", 0).toInt();
 	ui->m_autoSaveInterval = settings.value("autoSaveInterval", 600).toInt();
+	setUndoMemoryLimit(settings.value("undoMemoryLimit", 2048).toInt());
 	ui->m_defaultUnits = settings.value("defaultUnits", 0).toInt();
 	vs.m_col1 = GLColor(settings.value("bgColor1", (int)vs.m_col1).toInt());
 	vs.m_col2 = GLColor(settings.value("bgColor2", (int)vs.m_col2).toInt());
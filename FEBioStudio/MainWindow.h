@@ -183,6 +183,10 @@ public:
 	void setAutoSaveInterval(int interval);
 	int autoSaveInterval();
 
+	// memory limit of undo stack (in MB, 0 = no limit)
+	void setUndoMemoryLimit(int megaBytes);
+	int undoMemoryLimit();
+
 	// autoUpdate Check
     QString GetServerMessage();
 	bool updaterPresent();
@@ -60,6 +60,9 @@ SOFTWARE.*/
 #include <PostLib/FEDistanceMap.h>
 #include <PostLib/FEAreaCoverage.h>
 #include "DlgAddEquation.h"
+#include "DlgStartThread.h"
+#include <functional>
+#include <atomic>
 
 class CCurvatureProps : public CPropertyList
 {
@@ -191,6 +194,7 @@ public:
 		addProperty("Assign to surface1", CProperty::Action, "");
 		addProperty("Assign to surface2", CProperty::Action, "");
 		addProperty("Signed distance", CProperty::Bool);
+		addProperty("Closest point on surface", CProperty::Bool);
 		addProperty("", CProperty::Action, "Apply");
 	}
 
@@ -210,6 +214,10 @@ public:
 		{
 			return m_map->m_bsigned;
 		}
+		if (i == 3)
+		{
+			return m_map->m_bclosest;
+		}
 		return QVariant();
 	}
 
@@ -231,6 +239,10 @@ public:
 			m_map->m_bsigned = b;
 		}
 		else if (i == 3)
+		{
+			m_map->m_bclosest = v.toBool();
+		}
+		else if (i == 4)
 		{
 			m_map->Apply();
 		}
@@ -1028,6 +1040,43 @@ void CPostDataPanel::on_DeleteButton_clicked()
 	}
 }
 
+//-----------------------------------------------------------------------------
+// Runs a data filter in a worker thread, so that CDlgStartThread can show its
+// progress and cancel it.
+class DataFilterThread : public CustomThread, public Post::DataFilterProgress
+{
+public:
+	DataFilterThread(std::function<bool(Post::DataFilterProgress*)> f) : m_f(f)
+	{
+		m_progress = 0.0;
+		m_stopRequest = false;
+	}
+
+	void run() Q_DECL_OVERRIDE
+	{
+		bool bret = m_f(this);
+		emit resultReady(bret && (m_stopRequest == false));
+	}
+
+public:
+	bool hasProgress() override { return true; }
+
+	double progress() override { return 100.0 * m_progress; }
+
+	const char* currentTask() override { return "applying filter"; }
+
+	void stop() override { m_stopRequest = true; }
+
+	void SetProgress(double f) override { m_progress = f; }
+
+	bool IsCanceled() override { return m_stopRequest; }
+
+private:
+	std::function<bool(Post::DataFilterProgress*)>	m_f;
+	std::atomic<double>	m_progress;
+	std::atomic<bool>	m_stopRequest;
+};
+
 void CPostDataPanel::on_AddFilter_triggered()
 {
 	CMainWindow* wnd = GetMainWindow();
@@ -1072,31 +1121,45 @@ void CPostDataPanel::on_AddFilter_triggered()
 				// get the name for the new field
 				string sname = dlg.getNewName().toStdString();
 
+				// the filter is run in a worker thread, so the fields are created here
 				Post::ModelDataField* newData = 0;
-				bool bret = true;
+				std::function<bool(Post::DataFilterProgress*)> filter;
 				int nfield = pdf->GetFieldID();
 				switch (dlg.m_nflt)
 				{
 				case 0:
 				{
 					newData = fem.CreateCachedCopy(pdf, sname.c_str());
+					int ndst = newData->GetFieldID();
 					if (pdf->Type() == Post::DATA_VEC3F)
-						bret = DataScaleVec3(fem, newData->GetFieldID(), dlg.GetVecScaleFactor());
+					{
+						vec3d scale = dlg.GetVecScaleFactor();
+						filter = [&fem, ndst, scale](Post::DataFilterProgress* progress) { return DataScaleVec3(fem, ndst, scale, progress); };
+					}
 					else
-						bret = DataScale(fem, newData->GetFieldID(), dlg.GetScaleFactor());
+					{
+						double scale = dlg.GetScaleFactor();
+						filter = [&fem, ndst, scale](Post::DataFilterProgress* progress) { return DataScale(fem, ndst, scale, progress); };
+					}
 				}
 				break;
 				case 1:
 				{
 					newData = fem.CreateCachedCopy(pdf, sname.c_str());
-					bret = DataSmooth(fem, newData->GetFieldID(), dlg.m_theta, dlg.m_iters);
+					int ndst = newData->GetFieldID();
+					double theta = dlg.m_theta;
+					int iters = dlg.m_iters;
+					filter = [&fem, ndst, theta, iters](Post::DataFilterProgress* progress) { return DataSmooth(fem, ndst, theta, iters, progress); };
 				}
 				break;
 				case 2:
 				{
 					newData = fem.CreateCachedCopy(pdf, sname.c_str());
+					int ndst = newData->GetFieldID();
 					Post::FEDataFieldPtr p = fem.GetDataManager()->DataField(dataIds[dlg.m_ndata]);
-					bret = DataArithmetic(fem, newData->GetFieldID(), dlg.m_nop, (*p)->GetFieldID());
+					int nsrc = (*p)->GetFieldID();
+					int nop = dlg.m_nop;
+					filter = [&fem, ndst, nop, nsrc](Post::DataFilterProgress* progress) { return DataArithmetic(fem, ndst, nop, nsrc, progress); };
 				}
 				break;
 				case 3:
@@ -1107,14 +1170,18 @@ void CPostDataPanel::on_AddFilter_triggered()
 					fem.AddDataField(newData);
 
 					// now, calculate gradient from scalar field
-					bret = DataGradient(fem, newData->GetFieldID(), nfield);
+					int ndst = newData->GetFieldID();
+					filter = [&fem, ndst, nfield](Post::DataFilterProgress* progress) { return DataGradient(fem, ndst, nfield, progress); };
 				}
 				break;
 				case 4:
 				{
 					// create new field for storing the component
-					newData = DataComponent(fem, pdf, dlg.getArrayComponent(), sname);
-					bret = (newData != nullptr);
+					int ncomp = dlg.getArrayComponent();
+					filter = [&fem, &newData, pdf, ncomp, sname](Post::DataFilterProgress* progress) {
+						newData = DataComponent(fem, pdf, ncomp, sname, progress);
+						return (newData != nullptr);
+					};
 				}
 				break;
 				case 5:
@@ -1124,36 +1191,50 @@ void CPostDataPanel::on_AddFilter_triggered()
 					fem.AddDataField(newData);
 
 					// calculate fractional anisotropy
-					bret = DataFractionalAnsisotropy(fem, newData->GetFieldID(), nfield);
+					int ndst = newData->GetFieldID();
+					filter = [&fem, ndst, nfield](Post::DataFilterProgress* progress) { return DataFractionalAnsisotropy(fem, ndst, nfield, progress); };
 				}
 				break;
 				case 6:
 				{
 					int newformat = dlg.getNewFormat();
-					newData = DataConvert(fem, pdf, newformat, sname);
-					bret = (newData != nullptr);
+					filter = [&fem, &newData, pdf, newformat, sname](Post::DataFilterProgress* progress) {
+						newData = DataConvert(fem, pdf, newformat, sname, progress);
+						return (newData != nullptr);
+					};
 				}
 				break;
 				case 7: // eigen tensor
 				{
-					newData = DataEigenTensor(fem, pdf, sname);
-					bret = (newData != nullptr);
+					filter = [&fem, &newData, pdf, sname](Post::DataFilterProgress* progress) {
+						newData = DataEigenTensor(fem, pdf, sname, progress);
+						return (newData != nullptr);
+					};
 				}
 				break;
 				case 8: // time derivative
 				{
-					newData = DataTimeRate(fem, pdf, sname);
-					bret = (newData != nullptr);
+					filter = [&fem, &newData, pdf, sname](Post::DataFilterProgress* progress) {
+						newData = DataTimeRate(fem, pdf, sname, progress);
+						return (newData != nullptr);
+					};
 				}
 				break;
 				default:
 					QMessageBox::critical(this, "Data Filter", "Don't know this filter.");
 				}
 
-				if (bret == false)
+				if (filter)
 				{
-					if (newData) fem.DeleteDataField(newData);
-					QMessageBox::critical(this, "Data Filter", "Cannot apply this filter.");
+					DataFilterThread* thread = new DataFilterThread(filter);
+					CDlgStartThread dlg2(this, thread);
+					dlg2.setTask("Applying filter");
+					bool bok = (dlg2.exec() != 0);
+					if ((bok == false) || (dlg2.GetReturnCode() == false))
+					{
+						if (newData) fem.DeleteDataField(newData);
+						if (bok) QMessageBox::critical(this, "Data Filter", "Cannot apply this filter.");
+					}
 				}
 
 				wnd->UpdatePostToolbar();
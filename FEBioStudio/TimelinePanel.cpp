@@ -72,7 +72,7 @@ void CTimelinePanel::Update(bool reset)
 				int nstates = fem.GetStates();
 				for (int i = 0; i < nstates; ++i)
 				{
-					data[i].first = fem.GetState(i)->m_time;
+					data[i].first = fem.GetTimeValue(i);
 					data[i].second = fem.GetState(i)->m_status;
 				}
 
@@ -642,6 +642,10 @@ void CMainWindow::onTimer()
 
 	TIMESETTINGS& time = doc->GetTimeSettings();
 
+	// evaluate the next few states in the background while the current one is shown
+	int ndir = (time.m_mode == MODE_REVERSE ? -1 : (time.m_mode == MODE_CYLCE ? time.m_inc : 1));
+	doc->GetGLModel()->SetPrefetchStates(3, ndir, time.m_start, time.m_end, time.m_bloop, (time.m_mode == MODE_CYLCE));
+
 	int N = doc->GetFSModel()->GetStates();
 	int N0 = time.m_start;
 	int N1 = time.m_end;
@@ -793,7 +797,11 @@ void CMainWindow::on_actionPlay_toggled(bool bchecked)
 			ui->m_isAnimating = true;
 			QTimer::singleShot(msec_per_frame, this, SLOT(onTimer()));
 		}
-		else ui->m_isAnimating = false;
+		else
+		{
+			ui->m_isAnimating = false;
+			doc->GetGLModel()->SetPrefetchStates(0);
+		}
 	}
 }
 
@@ -31,6 +31,9 @@ SOFTWARE.*/
 
 using std::stringstream;
 
+// size of the read buffer
+const size_t IARCHIVE_BUFFER_SIZE = 1 << 16;
+
 //=============================================================================
 IOMemBuffer::IOMemBuffer()
 {
@@ -86,6 +89,8 @@ IArchive::IArchive()
 	m_delfp = false;
 	m_nversion = 0;
 	m_fp = 0;
+	m_bufPos = m_bufLen = 0;
+	m_bufOff = 0;
 }
 
 //-----------------------------------------------------------------------------
@@ -107,8 +112,14 @@ void IArchive::Close()
 	while (m_Chunk.empty() == false) CloseChunk();
 
 	// reset pointers
+	// (if we don't own the file, we leave it at the read position)
 	if (m_delfp) fclose(m_fp);
+	else if (m_fp) sync();
 	m_fp = 0;
+	m_buf.clear();
+	m_buf.shrink_to_fit();
+	m_bufPos = m_bufLen = 0;
+	m_bufOff = 0;
 	m_bend = true;
 	m_bswap = false;
 	m_delfp = false;
@@ -134,9 +145,14 @@ bool IArchive::Open(FILE* fp, unsigned int signature)
 	// store the file pointer
 	m_fp = fp;
 
+	// set up the read buffer
+	m_buf.resize(IARCHIVE_BUFFER_SIZE);
+	m_bufPos = m_bufLen = 0;
+	m_bufOff = ftell(m_fp);
+
 	// read the master tag
 	unsigned int ntag;
-	if (fread(&ntag, sizeof(int), 1, m_fp) != 1) 
+	if (bread(&ntag, sizeof(int), 1) != 1) 
 	{
 		Close();
 		return false;
@@ -174,21 +190,21 @@ int IArchive::OpenChunk()
 	}
 
 	// create a new chunk
-	CHUNK* pc = new CHUNK;
+	CHUNK c;
 
 	// read the chunk ID
-	read(pc->id);
+	read(c.id);
 
 	// read the chunk size
-	read(pc->nsize);
+	read(c.nsize);
 
-	if (pc->nsize == 0) m_bend = true;
+	if (c.nsize == 0) m_bend = true;
 
 	// record the position
-	pc->lpos = ftell(m_fp);
+	c.lpos = tell();
 
 	// add it to the stack
-	m_Chunk.push(pc);
+	m_Chunk.push(c);
 
 	return IO_OK;
 }
@@ -196,25 +212,22 @@ int IArchive::OpenChunk()
 void IArchive::CloseChunk()
 {
 	// pop the last chunk
-	CHUNK* pc = m_Chunk.top(); m_Chunk.pop();
+	CHUNK c = m_Chunk.top(); m_Chunk.pop();
 
 	// get the current file position
-	long lpos = ftell(m_fp);
+	long lpos = tell();
 
 	// calculate the offset to the end of the chunk
-	int noff = pc->nsize - (lpos - pc->lpos);
+	int noff = c.nsize - (lpos - c.lpos);
 
 	// skip any remaining part in the chunk
 	// I wonder if this can really happen
 	if (noff != 0)
 	{
-		fseek(m_fp, noff, SEEK_CUR);
-		lpos = ftell(m_fp);
+		skip(noff);
+		lpos = tell();
 	}
 
-	// delete this chunk
-	delete pc;
-
 	// take a peek at the parent
 	if (m_Chunk.empty())
 	{
@@ -223,40 +236,42 @@ void IArchive::CloseChunk()
 	}
 	else
 	{
-		pc = m_Chunk.top();
-		int noff = pc->nsize - (lpos - pc->lpos);
+		const CHUNK& p = m_Chunk.top();
+		int noff = p.nsize - (lpos - p.lpos);
 		if (noff == 0) m_bend = true;
 	}
 }
 
 unsigned int IArchive::GetChunkID()
 {
-	CHUNK* pc = m_Chunk.top();
-	assert(pc);
-	return pc->id;
+	assert(m_Chunk.empty() == false);
+	return m_Chunk.top().id;
 }
 
 IArchive::IOResult IArchive::read(std::vector<int>& v)
 {
-	CHUNK* pc = m_Chunk.top();
+	const CHUNK& c = m_Chunk.top();
 
-	int nsize = pc->nsize / sizeof(int);
+	int nsize = c.nsize / sizeof(int);
 	v.resize(nsize);
-	int nread = (int)fread(&v[0], sizeof(int), nsize, m_fp);
+	if (nsize == 0) return IO_OK;
+	int nread = (int)bread(&v[0], sizeof(int), nsize);
 	if (nread != nsize) return IO_ERROR;
+	if (m_bswap) bswapv(&v[0], nsize);
 	return IO_OK;
 }
 
 IArchive::IOResult IArchive::read(std::vector<double>& v)
 {
-	CHUNK* pc = m_Chunk.top();
+	const CHUNK& c = m_Chunk.top();
 
-	int nsize = pc->nsize / sizeof(double);
+	int nsize = c.nsize / sizeof(double);
 	if (nsize > 0)
 	{
 		v.resize(nsize);
-		int nread = (int)fread(&v[0], sizeof(double), nsize, m_fp);
+		int nread = (int)bread(&v[0], sizeof(double), nsize);
 		if (nread != nsize) return IO_ERROR;
+		if (m_bswap) bswapv(&v[0], nsize);
 	}
 	else v.clear();
 
@@ -265,15 +280,88 @@ IArchive::IOResult IArchive::read(std::vector<double>& v)
 
 IArchive::IOResult IArchive::read(std::vector<vec2d>& v)
 {
-	CHUNK* pc = m_Chunk.top();
+	const CHUNK& c = m_Chunk.top();
 
-	int nsize = pc->nsize / sizeof(vec2d);
+	int nsize = c.nsize / sizeof(vec2d);
 	v.resize(nsize);
-	int nread = (int)fread(&v[0], sizeof(vec2d), nsize, m_fp);
+	if (nsize == 0) return IO_OK;
+	int nread = (int)bread(&v[0], sizeof(vec2d), nsize);
 	if (nread != nsize) return IO_ERROR;
+	if (m_bswap) bswapv((double*)&v[0], 2 * nsize);
 	return IO_OK;
 }
 
+//-----------------------------------------------------------------------------
+// Reads count items of the given size. Small reads are served from the buffer,
+// large reads go directly to the file.
+size_t IArchive::bread(void* pd, size_t size, size_t count)
+{
+	size_t nbytes = size * count;
+	if (nbytes == 0) return 0;
+
+	// see if we can serve this from the buffer
+	char* pc = (char*)pd;
+	size_t avail = m_bufLen - m_bufPos;
+	if (nbytes <= avail)
+	{
+		memcpy(pc, &m_buf[0] + m_bufPos, nbytes);
+		m_bufPos += nbytes;
+		return count;
+	}
+
+	// copy what we have left
+	if (avail > 0) memcpy(pc, &m_buf[0] + m_bufPos, avail);
+	pc += avail;
+	size_t nleft = nbytes - avail;
+	m_bufOff += (long)m_bufLen;
+	m_bufPos = m_bufLen = 0;
+
+	size_t nread = 0;
+	if (nleft >= m_buf.size())
+	{
+		// large read, so bypass the buffer
+		nread = fread(pc, 1, nleft, m_fp);
+		m_bufOff += (long)nread;
+	}
+	else
+	{
+		// refill the buffer
+		m_bufLen = fread(&m_buf[0], 1, m_buf.size(), m_fp);
+		nread = (nleft < m_bufLen ? nleft : m_bufLen);
+		memcpy(pc, &m_buf[0], nread);
+		m_bufPos = nread;
+	}
+
+	return (avail + nread) / size;
+}
+
+//-----------------------------------------------------------------------------
+void IArchive::skip(long noff)
+{
+	long pos = (long)m_bufPos + noff;
+	if ((pos >= 0) && (pos <= (long)m_bufLen))
+	{
+		m_bufPos = (size_t)pos;
+	}
+	else
+	{
+		long lpos = tell() + noff;
+		fseek(m_fp, lpos, SEEK_SET);
+		m_bufOff = lpos;
+		m_bufPos = m_bufLen = 0;
+	}
+}
+
+//-----------------------------------------------------------------------------
+void IArchive::sync()
+{
+	if (m_fp == 0) return;
+	long lpos = tell();
+	fseek(m_fp, lpos, SEEK_SET);
+	m_bufOff = lpos;
+	m_bufPos = m_bufLen = 0;
+}
+
 void IArchive::log(const char* sz, ...)
 {
 	if (sz == 0) return;
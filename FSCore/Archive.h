@@ -34,6 +34,7 @@ SOFTWARE.*/
 #include <stack>
 #include <list>
 #include <string>
+#include <vector>
 #include "memtool.h"
 //using namespace std;
 
@@ -104,25 +105,27 @@ public:
 	virtual void CloseChunk();
 
 	// input functions
-	IOResult read(char&   c) { int nr = (int) fread(&c, sizeof(char  ), 1, m_fp); if (nr != 1) return IO_ERROR; return IO_OK; }
-	IOResult read(int&    n) { int nr = (int) fread(&n, sizeof(int   ), 1, m_fp); if (nr != 1) return IO_ERROR; if (m_bswap) bswap(n); return IO_OK; }
-	IOResult read(bool&   b) { int nr = (int) fread(&b, sizeof(bool  ), 1, m_fp); if (nr != 1) return IO_ERROR; return IO_OK; }
-	IOResult read(float&  f) { int nr = (int) fread(&f, sizeof(float ), 1, m_fp); if (nr != 1) return IO_ERROR; if (m_bswap) bswap(f); return IO_OK; }
-	IOResult read(double& g) { int nr = (int) fread(&g, sizeof(double), 1, m_fp); if (nr != 1) return IO_ERROR; if (m_bswap) bswap(g); return IO_OK; }
+	IOResult read(char&   c) { if (bread(&c, sizeof(char  ), 1) != 1) return IO_ERROR; return IO_OK; }
+	IOResult read(int&    n) { if (bread(&n, sizeof(int   ), 1) != 1) return IO_ERROR; if (m_bswap) bswap(n); return IO_OK; }
+	IOResult read(bool&   b) { if (bread(&b, sizeof(bool  ), 1) != 1) return IO_ERROR; return IO_OK; }
+	IOResult read(float&  f) { if (bread(&f, sizeof(float ), 1) != 1) return IO_ERROR; if (m_bswap) bswap(f); return IO_OK; }
+	IOResult read(double& g) { if (bread(&g, sizeof(double), 1) != 1) return IO_ERROR; if (m_bswap) bswap(g); return IO_OK; }
 
-	IOResult read(unsigned int& n) { size_t nr = fread(&n, sizeof(unsigned int), 1, m_fp); if (nr != 1) return IO_ERROR; if (m_bswap) bswap(n); return IO_OK; }
+	IOResult read(unsigned int& n) { if (bread(&n, sizeof(unsigned int), 1) != 1) return IO_ERROR; if (m_bswap) bswap(n); return IO_OK; }
 
 
-	IOResult read(int*    pi, int n) { int nr = (int) fread(pi, sizeof(int   ), n, m_fp); if (nr != n) return IO_ERROR; if (m_bswap) bswapv(pi, n); return IO_OK; }
-	IOResult read(bool*   pb, int n) { int nr = (int) fread(pb, sizeof(bool  ), n, m_fp); if (nr != n) return IO_ERROR; return IO_OK; }
-	IOResult read(float*  pf, int n) { int nr = (int) fread(pf, sizeof(float ), n, m_fp); if (nr != n) return IO_ERROR; if (m_bswap) bswapv(pf, n); return IO_OK; }
-	IOResult read(double* pg, int n) { int nr = (int) fread(pg, sizeof(double), n, m_fp); if (nr != n) return IO_ERROR; if (m_bswap) bswapv(pg, n); return IO_OK; }
-	IOResult read(vec3d*  pv, int n) { for (int i=0; i<n; ++i) read(pv[i]); return IO_OK; }
+	IOResult read(int*    pi, int n) { if ((int)bread(pi, sizeof(int   ), n) != n) return IO_ERROR; if (m_bswap) bswapv(pi, n); return IO_OK; }
+	IOResult read(bool*   pb, int n) { if ((int)bread(pb, sizeof(bool  ), n) != n) return IO_ERROR; return IO_OK; }
+	IOResult read(float*  pf, int n) { if ((int)bread(pf, sizeof(float ), n) != n) return IO_ERROR; if (m_bswap) bswapv(pf, n); return IO_OK; }
+	IOResult read(double* pg, int n) { if ((int)bread(pg, sizeof(double), n) != n) return IO_ERROR; if (m_bswap) bswapv(pg, n); return IO_OK; }
 
-	IOResult read(vec3d& r) { read(r.x); read(r.y); read(r.z); return IO_OK; }
-	IOResult read(vec2i& r) { read(r.x); read(r.y); return IO_OK; }
-	IOResult read(quatd& q) { read(q.x); read(q.y); read(q.z); read(q.w); return IO_OK; }
-	IOResult read(GLColor& c) { int nr = (int) fread(&c, sizeof(GLColor), 1, m_fp); if (nr != 1) return IO_ERROR; return IO_OK; }
+	// vec3d is stored as three doubles, so arrays can be read in one go
+	IOResult read(vec3d*  pv, int n) { static_assert(sizeof(vec3d) == 3 * sizeof(double), "vec3d must be packed"); if (n <= 0) return IO_OK; return read(&pv[0].x, 3 * n); }
+
+	IOResult read(vec3d& r) { return read(&r, 1); }
+	IOResult read(vec2i& r) { int d[2]; IOResult ret = read(d, 2); r.x = d[0]; r.y = d[1]; return ret; }
+	IOResult read(quatd& q) { double d[4]; IOResult ret = read(d, 4); q.x = d[0]; q.y = d[1]; q.z = d[2]; q.w = d[3]; return ret; }
+	IOResult read(GLColor& c) { if (bread(&c, sizeof(GLColor), 1) != 1) return IO_ERROR; return IO_OK; }
 
 	IOResult read(mat3d& a) 
 	{ 
@@ -145,7 +148,7 @@ public:
 		IOResult ret;
 		int l, nr;
 		ret = read(l); if (ret != IO_OK) return ret;
-		nr = (int) fread(sz, 1, l, m_fp); if (nr != l) return IO_ERROR;
+		nr = (int) bread(sz, 1, l); if (nr != l) return IO_ERROR;
 		sz[l] = 0;
 		return IO_OK;
 	}
@@ -157,11 +160,8 @@ public:
 
 		if (l > 0)
 		{
-			char* tmp = new char[l+1];
-			int nr = (int) fread(tmp, 1, l, m_fp); if (nr != l) return IO_ERROR;
-			tmp[l] = 0;
-			s = tmp;
-			delete [] tmp;
+			s.resize(l);
+			int nr = (int) bread(&s[0], 1, l); if (nr != l) return IO_ERROR;
 		}
 		else s.clear();
 		return IO_OK;
@@ -173,16 +173,18 @@ public:
 
 	template <class T> IOResult read(std::vector<T>& v)
 	{
-		CHUNK* pc = m_Chunk.top();
-		int nsize = pc->nsize / sizeof(T);
+		CHUNK& c = m_Chunk.top();
+		int nsize = c.nsize / sizeof(T);
 		v.resize(nsize);
-		int nread = (int)fread(&v[0], sizeof(T), nsize, m_fp);
+		if (nsize == 0) return IO_OK;
+		int nread = (int)bread(&v[0], sizeof(T), nsize);
 		if (nread != nsize) return IO_ERROR;
 		return IO_OK;
 	}
 
 	// conversion to FILE* 
-	operator FILE* () { return m_fp; }
+	// (this syncs the file position with the read position)
+	operator FILE* () { sync(); return m_fp; }
 
 	void SetVersion(unsigned int n) { m_nversion = n; }
 	unsigned int Version() { return m_nversion; }
@@ -193,6 +195,16 @@ public:
 private:
 	bool Load(const char* szfile) { return false; }
 
+	// buffered read (returns the number of items read, like fread)
+	size_t bread(void* pd, size_t size, size_t count);
+
+	// current read position and skip
+	long tell() const { return m_bufOff + (long)m_bufPos; }
+	void skip(long noff);
+
+	// discard the buffer and move the file pointer to the read position
+	void sync();
+
 protected:
 	bool	m_bswap;	// swap data when reading
 	bool	m_bend;		// chunk end flag
@@ -200,10 +212,16 @@ protected:
 
 	unsigned int	m_nversion;	// stores the version nr of the file being loaded
 
-	stack<CHUNK*>	m_Chunk;
+	stack<CHUNK>	m_Chunk;
 
 	FILE*	m_fp;		// the file pointer
 
+	// read buffer
+	std::vector<char>	m_buf;
+	size_t	m_bufPos;	// read position in buffer
+	size_t	m_bufLen;	// nr of valid bytes in buffer
+	long	m_bufOff;	// file offset of the start of the buffer
+
 protected:
 	std::string		m_log;
 };
@@ -26,6 +26,7 @@ SOFTWARE.*/
 
 #pragma once
 #include <cstddef>
+#include <cstring>
 
 // functions for swapping data (used by some binary file import/export classes)
 void inline bswap(short& s)
@@ -69,5 +70,48 @@ template <typename T> void bswapv(T* pd, int n)
 	for (int i = 0; i<n; ++i) bswap(pd[i]);
 }
 
+// Array versions for 4 and 8 byte types. These use shifts on the raw bits
+// instead of swapping bytes one by one, so the compiler can vectorize the loops.
+inline unsigned int bswap32(unsigned int n)
+{
+	return (n >> 24) | ((n >> 8) & 0x0000FF00u) | ((n << 8) & 0x00FF0000u) | (n << 24);
+}
+
+inline unsigned long long bswap64(unsigned long long n)
+{
+	return ((unsigned long long)bswap32((unsigned int)n) << 32) | bswap32((unsigned int)(n >> 32));
+}
+
+inline void bswapv(unsigned int* pd, int n)
+{
+	for (int i = 0; i<n; ++i) pd[i] = bswap32(pd[i]);
+}
+
+inline void bswapv(int* pd, int n) { bswapv((unsigned int*)pd, n); }
+
+inline void bswapv(float* pd, int n)
+{
+	static_assert(sizeof(float) == sizeof(unsigned int), "unexpected float size");
+	for (int i = 0; i<n; ++i)
+	{
+		unsigned int u;
+		memcpy(&u, pd + i, sizeof(u));
+		u = bswap32(u);
+		memcpy(pd + i, &u, sizeof(u));
+	}
+}
+
+inline void bswapv(double* pd, int n)
+{
+	static_assert(sizeof(double) == sizeof(unsigned long long), "unexpected double size");
+	for (int i = 0; i<n; ++i)
+	{
+		unsigned long long u;
+		memcpy(&u, pd + i, sizeof(u));
+		u = bswap64(u);
+		memcpy(pd + i, &u, sizeof(u));
+	}
+}
+
 // helper function for reading from a memory buffer
 void mread(void* pdest, size_t Size, size_t Cnt, void** psrc);
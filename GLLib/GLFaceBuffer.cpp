@@ -0,0 +1,346 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+#include "stdafx.h"
+#include <GL/glew.h>
+#include "GLFaceBuffer.h"
+#include <MeshLib/FEMeshBase.h>
+
+//-----------------------------------------------------------------------------
+// Triangulation of the faces. This must match the triangles that the glx
+// functions render in immediate mode.
+static const int TRI3[1][3] = { { 0,1,2 } };
+static const int QUAD4[2][3] = { { 0,1,2 },{ 2,3,0 } };
+static const int QUAD8[6][3] = { { 7,0,4 },{ 4,1,5 },{ 5,2,6 },{ 6,3,7 },{ 7,4,5 },{ 7,5,6 } };
+static const int QUAD9[8][3] = { { 0,4,8 },{ 8,7,0 },{ 4,1,5 },{ 5,8,4 },{ 7,8,6 },{ 6,3,7 },{ 8,5,2 },{ 2,6,8 } };
+static const int TRI6[4][3] = { { 0,3,5 },{ 1,4,3 },{ 2,5,4 },{ 3,4,5 } };
+static const int TRI7[6][3] = { { 0,3,6 },{ 1,6,3 },{ 1,4,6 },{ 2,6,4 },{ 2,5,6 },{ 0,6,5 } };
+static const int TRI10[9][3] = { { 0,3,7 },{ 1,5,4 },{ 2,8,6 },{ 9,7,3 },{ 9,3,4 },{ 9,4,5 },{ 9,5,6 },{ 9,6,8 },{ 9,8,7 } };
+
+static int faceTriangles(const FSFace& face, const int(**T)[3])
+{
+	switch (face.m_type)
+	{
+	case FE_FACE_TRI3 : *T = TRI3 ; return 1;
+	case FE_FACE_QUAD4: *T = QUAD4; return 2;
+	case FE_FACE_QUAD8: *T = QUAD8; return 6;
+	case FE_FACE_QUAD9: *T = QUAD9; return 8;
+	case FE_FACE_TRI6 : *T = TRI6 ; return 4;
+	case FE_FACE_TRI7 : *T = TRI7 ; return 6;
+	case FE_FACE_TRI10: *T = TRI10; return 9;
+	}
+	*T = nullptr;
+	return 0;
+}
+
+// Buffer objects can only be used after GLEW is initialized with a GL context
+static bool useBufferObjects()
+{
+	return (glGenBuffers != nullptr);
+}
+
+//-----------------------------------------------------------------------------
+GLFaceBuffer::GLFaceBuffer()
+{
+	m_pm = nullptr;
+	m_rev = -1;
+	m_vbo = 0;
+	m_vboSize = 0;
+	m_ballocate = false;
+	m_bupload = false;
+}
+
+//-----------------------------------------------------------------------------
+GLFaceBuffer::GLFaceBuffer(GLFaceBuffer&& buf) noexcept : GLFaceBuffer()
+{
+	*this = std::move(buf);
+}
+
+//-----------------------------------------------------------------------------
+GLFaceBuffer::~GLFaceBuffer()
+{
+	if (m_vbo) glDeleteBuffers(1, &m_vbo);
+}
+
+//-----------------------------------------------------------------------------
+// The buffer object is moved, so that it is deleted only once
+GLFaceBuffer& GLFaceBuffer::operator = (GLFaceBuffer&& buf) noexcept
+{
+	if (this == &buf) return *this;
+	if (m_vbo) glDeleteBuffers(1, &m_vbo);
+
+	m_pm = buf.m_pm;
+	m_rev = buf.m_rev;
+	m_face.swap(buf.m_face);
+	m_vert0.swap(buf.m_vert0);
+	m_vnode.swap(buf.m_vnode);
+	m_pos.swap(buf.m_pos);
+	m_nrm.swap(buf.m_nrm);
+	m_tex.swap(buf.m_tex);
+	m_col.swap(buf.m_col);
+	m_range.swap(buf.m_range);
+	m_vbo = buf.m_vbo;
+	m_vboSize = buf.m_vboSize;
+	m_ballocate = buf.m_ballocate;
+	m_bupload = buf.m_bupload;
+
+	buf.m_vbo = 0;
+	buf.m_vboSize = 0;
+	buf.Clear();
+	return *this;
+}
+
+//-----------------------------------------------------------------------------
+void GLFaceBuffer::Clear()
+{
+	m_pm = nullptr;
+	m_rev = -1;
+	m_face.clear();
+	m_vert0.clear();
+	m_vnode.clear();
+	m_pos.clear();
+	m_nrm.clear();
+	m_tex.clear();
+	m_col.clear();
+	m_range.clear();
+	m_ballocate = false;
+	m_bupload = false;
+}
+
+//-----------------------------------------------------------------------------
+bool GLFaceBuffer::IsSupported(const FSFace& face)
+{
+	const int(*T)[3] = nullptr;
+	return (faceTriangles(face, &T) > 0);
+}
+
+//-----------------------------------------------------------------------------
+bool GLFaceBuffer::IsValid(FSMeshBase* pm, int faceListRevision) const
+{
+	return (pm == m_pm) && (pm != nullptr) && (faceListRevision == m_rev);
+}
+
+//-----------------------------------------------------------------------------
+bool GLFaceBuffer::Create(FSMeshBase* pm, const std::vector<int>& faceList, int faceListRevision)
+{
+	Clear();
+	if (pm == nullptr) return false;
+
+	// count the vertices
+	int NF = (int)faceList.size();
+	m_vert0.resize(NF + 1);
+	int nverts = 0;
+	for (int i = 0; i < NF; ++i)
+	{
+		const int(*T)[3] = nullptr;
+		int ntri = faceTriangles(pm->Face(faceList[i]), &T);
+		if (ntri == 0) { Clear(); return false; }
+		m_vert0[i] = nverts;
+		nverts += 3 * ntri;
+	}
+	m_vert0[NF] = nverts;
+
+	// store the face-local node of each vertex
+	m_vnode.resize(nverts);
+	for (int i = 0; i < NF; ++i)
+	{
+		const int(*T)[3] = nullptr;
+		int ntri = faceTriangles(pm->Face(faceList[i]), &T);
+		int* vn = &m_vnode[m_vert0[i]];
+		for (int j = 0; j < ntri; ++j)
+		{
+			vn[3 * j    ] = T[j][0];
+			vn[3 * j + 1] = T[j][1];
+			vn[3 * j + 2] = T[j][2];
+		}
+	}
+
+	m_pos.resize(3 * nverts);
+	m_nrm.resize(3 * nverts);
+	m_tex.resize(nverts);
+
+	m_pm = pm;
+	m_rev = faceListRevision;
+	m_face = faceList;
+	m_ballocate = true;
+
+	Update();
+	UpdateTags();
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+void GLFaceBuffer::Update()
+{
+	if (m_pm == nullptr) return;
+	FSMeshBase& mesh = *m_pm;
+
+	int NF = (int)m_face.size();
+#pragma omp parallel for schedule(static)
+	for (int i = 0; i < NF; ++i)
+	{
+		const FSFace& face = mesh.Face(m_face[i]);
+		for (int k = m_vert0[i]; k < m_vert0[i + 1]; ++k)
+		{
+			int j = m_vnode[k];
+			const vec3d& r = mesh.Node(face.n[j]).r;
+			const vec3f& n = face.m_nn[j];
+			float* p = &m_pos[3 * k]; p[0] = (float)r.x; p[1] = (float)r.y; p[2] = (float)r.z;
+			float* q = &m_nrm[3 * k]; q[0] = n.x; q[1] = n.y; q[2] = n.z;
+			m_tex[k] = face.m_tex[j];
+		}
+	}
+	m_bupload = true;
+}
+
+//-----------------------------------------------------------------------------
+void GLFaceBuffer::UpdateTags()
+{
+	m_range.clear();
+	if (m_pm == nullptr) return;
+	FSMeshBase& mesh = *m_pm;
+
+	// merge consecutive faces with the same tag
+	int NF = (int)m_face.size();
+	for (int i = 0; i < NF; ++i)
+	{
+		int ntag = mesh.Face(m_face[i]).m_ntag;
+		int nv = m_vert0[i + 1] - m_vert0[i];
+		if (!m_range.empty() && (m_range.back().ntag == ntag)) m_range.back().count += nv;
+		else m_range.push_back({ ntag, m_vert0[i], nv });
+	}
+}
+
+//-----------------------------------------------------------------------------
+void GLFaceBuffer::SetFaceColors(int i, const GLColor* c)
+{
+	if (m_col.size() != 4 * m_vnode.size()) m_col.assign(4 * m_vnode.size(), 255);
+	for (int k = m_vert0[i]; k < m_vert0[i + 1]; ++k)
+	{
+		const GLColor& ck = c[m_vnode[k]];
+		Byte* p = &m_col[4 * k]; p[0] = ck.r; p[1] = ck.g; p[2] = ck.b; p[3] = ck.a;
+	}
+}
+
+//-----------------------------------------------------------------------------
+void GLFaceBuffer::FaceVertices(const std::vector<int>& faces, std::vector<unsigned int>& vertList) const
+{
+	vertList.clear();
+	for (int i : faces)
+	{
+		for (int k = m_vert0[i]; k < m_vert0[i + 1]; ++k) vertList.push_back(k);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Upload the data if needed. The buffer is only reallocated when the
+// triangulation changed, otherwise the data is replaced in place.
+void GLFaceBuffer::BindVertexData()
+{
+	size_t nv = m_vnode.size();
+	size_t posSize = 3 * nv * sizeof(float);
+	size_t texSize = nv * sizeof(float);
+
+	if (useBufferObjects() == false)
+	{
+		glVertexPointer(3, GL_FLOAT, 0, &m_pos[0]);
+		glNormalPointer(GL_FLOAT, 0, &m_nrm[0]);
+		glTexCoordPointer(1, GL_FLOAT, 0, &m_tex[0]);
+		return;
+	}
+
+	if (m_vbo == 0) glGenBuffers(1, &m_vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+
+	size_t size = 2 * posSize + texSize;
+	if (m_ballocate || (m_vboSize != size))
+	{
+		glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+		m_vboSize = size;
+		m_ballocate = false;
+		m_bupload = true;
+	}
+	if (m_bupload)
+	{
+		glBufferSubData(GL_ARRAY_BUFFER, 0, posSize, &m_pos[0]);
+		glBufferSubData(GL_ARRAY_BUFFER, posSize, posSize, &m_nrm[0]);
+		glBufferSubData(GL_ARRAY_BUFFER, 2 * posSize, texSize, &m_tex[0]);
+		m_bupload = false;
+	}
+
+	glVertexPointer(3, GL_FLOAT, 0, (const void*)0);
+	glNormalPointer(GL_FLOAT, 0, (const void*)posSize);
+	glTexCoordPointer(1, GL_FLOAT, 0, (const void*)(2 * posSize));
+}
+
+//-----------------------------------------------------------------------------
+void GLFaceBuffer::Render(int ntag)
+{
+	if ((m_pm == nullptr) || m_vnode.empty()) return;
+
+	glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_NORMAL_ARRAY);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	BindVertexData();
+
+	for (const DrawRange& r : m_range)
+	{
+		if (r.ntag == ntag) glDrawArrays(GL_TRIANGLES, r.first, r.count);
+	}
+
+	if (m_vbo) glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glPopClientAttrib();
+}
+
+//-----------------------------------------------------------------------------
+// The vertex list changes with the face order (e.g. for z-sorting), so it
+// is passed from client memory. The colors also change each frame.
+void GLFaceBuffer::RenderFaces(const std::vector<int>& faces, bool bcolor)
+{
+	if ((m_pm == nullptr) || m_vnode.empty() || faces.empty()) return;
+	if (bcolor && (m_col.size() != 4 * m_vnode.size())) bcolor = false;
+
+	FaceVertices(faces, m_vlist);
+
+	glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_NORMAL_ARRAY);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	BindVertexData();
+	if (m_vbo) glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	if (bcolor)
+	{
+		glEnableClientState(GL_COLOR_ARRAY);
+		glColorPointer(4, GL_UNSIGNED_BYTE, 0, &m_col[0]);
+	}
+
+	glDrawElements(GL_TRIANGLES, (GLsizei)m_vlist.size(), GL_UNSIGNED_INT, &m_vlist[0]);
+
+	glPopClientAttrib();
+}
@@ -0,0 +1,124 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+#pragma once
+#include <FSCore/color.h>
+#include <vector>
+#include <cstddef>
+
+class FSFace;
+class FSMeshBase;
+
+//-----------------------------------------------------------------------------
+// Vertex buffer for rendering a list of mesh faces with a few draw calls instead
+// of immediate mode. The triangulation is only built when the face list changes
+// (Create), which also reallocates the buffer object. The positions, normals and 
+// texture coordinates are copied from the mesh when they change (Update) and 
+// are then uploaded in place. The faces that are drawn for each tag are
+// collected when the face tags change (UpdateTags).
+// If the GL does not support buffer objects, client-side arrays are used.
+class GLFaceBuffer
+{
+public:
+	// a range of consecutive vertices of faces with the same tag
+	struct DrawRange
+	{
+		int	ntag;	// face tag
+		int	first;	// first vertex
+		int	count;	// number of vertices
+	};
+
+public:
+	GLFaceBuffer();
+	GLFaceBuffer(GLFaceBuffer&& buf) noexcept;
+	~GLFaceBuffer();
+
+	GLFaceBuffer& operator = (GLFaceBuffer&& buf) noexcept;
+
+	// remove the data (the buffer object is kept, so that it can be reused)
+	void Clear();
+
+	// build the triangulation of the faces (indices into the mesh's face list).
+	// The revision identifies the face list (see IsValid).
+	// returns false if some faces cannot be rendered from the buffer
+	bool Create(FSMeshBase* pm, const std::vector<int>& faceList, int faceListRevision);
+
+	// check if the buffer was created for this mesh and face list revision
+	bool IsValid(FSMeshBase* pm, int faceListRevision) const;
+
+	// copy the nodal positions, normals and texture coordinates from the mesh
+	void Update();
+
+	// collect the draw ranges from the face tags (m_ntag)
+	void UpdateTags();
+
+	// render the faces whose tag equals ntag (as of the last call to UpdateTags)
+	void Render(int ntag);
+
+	// Render the faces in the order of the list (indices into the face list of Create).
+	// If bcolor is true, the vertex colors set with SetFaceColors are used.
+	void RenderFaces(const std::vector<int>& faces, bool bcolor = false);
+
+	// set the colors of the vertices of face i from the colors of the face's nodes
+	void SetFaceColors(int i, const GLColor* c);
+
+	// get the vertices of the faces in the list
+	void FaceVertices(const std::vector<int>& faces, std::vector<unsigned int>& vertList) const;
+
+	// returns false if the face cannot be rendered from the buffer
+	static bool IsSupported(const FSFace& face);
+
+public:
+	int Faces() const { return (int)m_face.size(); }
+	int Vertices() const { return (int)m_vnode.size(); }
+	const std::vector<float>& Positions() const { return m_pos; }
+	const std::vector<DrawRange>& DrawRanges() const { return m_range; }
+
+private:
+	// set the vertex pointers to the buffer object (or the arrays)
+	void BindVertexData();
+
+	GLFaceBuffer(const GLFaceBuffer&) = delete;
+	void operator = (const GLFaceBuffer&) = delete;
+
+private:
+	FSMeshBase*			m_pm;		// the mesh the buffer was created for
+	int					m_rev;		// revision of the face list
+	std::vector<int>	m_face;		// face indices
+	std::vector<int>	m_vert0;	// first vertex of each face (size = faces + 1)
+	std::vector<int>	m_vnode;	// face-local node of each vertex
+	std::vector<float>	m_pos;		// vertex positions (3 per vertex)
+	std::vector<float>	m_nrm;		// vertex normals (3 per vertex)
+	std::vector<float>	m_tex;		// vertex texture coordinates
+	std::vector<Byte>	m_col;	// vertex colors (4 per vertex, allocated by SetFaceColors)
+	std::vector<DrawRange>	m_range;	// draw ranges of the face tags
+	std::vector<unsigned int>	m_vlist;	// vertex list of RenderFaces
+
+	unsigned int	m_vbo;		// buffer object (0 = not created)
+	size_t			m_vboSize;	// allocated size of the buffer object
+	bool			m_ballocate;	// the buffer object needs to be reallocated
+	bool			m_bupload;		// the data needs to be uploaded
+};
@@ -0,0 +1,253 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+#include "stdafx.h"
+#include "GLGlyphBuffer.h"
+#include <GLLib/glx.h>
+
+//-----------------------------------------------------------------------------
+GLGlyphBuffer::GLGlyphBuffer()
+{
+	m_shape = -1;
+	m_slices = 0;
+	m_stacks = 0;
+	m_batchSize = 0;
+}
+
+//-----------------------------------------------------------------------------
+void GLGlyphBuffer::SetShape(int shape, int slices, int stacks)
+{
+	if ((shape == m_shape) && (slices == m_slices) && (stacks == m_stacks)) return;
+	m_shape = shape;
+	m_slices = slices;
+	m_stacks = stacks;
+	BuildShape();
+}
+
+//-----------------------------------------------------------------------------
+void GLGlyphBuffer::BuildShape()
+{
+	m_vr.clear();
+	m_vn.clear();
+	m_vi.clear();
+
+	switch (m_shape)
+	{
+	case ARROW:
+		AddCylinder(0.f, 0.9f, 0.05f, 0.05f, 5);
+		AddCylinder(0.81f, 1.01f, 0.15f, 0.f, 10);
+		break;
+	case CONE    : AddCylinder(0.f, 0.9f, 0.15f, 0.f, 10); break;
+	case CYLINDER: AddCylinder(0.f, 0.9f, 0.15f, 0.15f, 10); break;
+	case SPHERE  : AddSphere(m_slices, m_stacks); break;
+	case BOX     : AddBox(); break;
+	case LINE:
+		m_vr.push_back(vec3f(0.f, 0.f, 0.f)); m_vn.push_back(vec3f(0.f, 0.f, 1.f));
+		m_vr.push_back(vec3f(0.f, 0.f, 1.f)); m_vn.push_back(vec3f(0.f, 0.f, 1.f));
+		m_vi.push_back(0); m_vi.push_back(1);
+		break;
+	}
+
+	// process the glyphs in batches of about 64K vertices
+	int nv = (int)m_vr.size();
+	m_batchSize = (nv > 0 ? 65536 / nv + 1 : 0);
+	m_pos.clear();
+	m_nrm.clear();
+	m_col.clear();
+
+	// index array of one batch
+	int ni = (int)m_vi.size();
+	m_ind.resize((size_t)m_batchSize * ni);
+	for (int i = 0; i < m_batchSize; ++i)
+	{
+		unsigned int* pi = &m_ind[(size_t)i * ni];
+		for (int j = 0; j < ni; ++j) pi[j] = i*nv + m_vi[j];
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Open cylinder (or cone) along z, with smooth normals like gluCylinder.
+void GLGlyphBuffer::AddCylinder(float z0, float z1, float r0, float r1, int slices)
+{
+	unsigned int n0 = (unsigned int)m_vr.size();
+
+	float h = z1 - z0;
+	float a = atan2(r0 - r1, h);
+	float cn = cos(a), sn = sin(a);
+	for (int i = 0; i <= slices; ++i)
+	{
+		float w = 2.f*(float)PI*i / slices;
+		float cw = cos(w), sw = sin(w);
+		m_vr.push_back(vec3f(r0*cw, r0*sw, z0)); m_vn.push_back(vec3f(cn*cw, cn*sw, sn));
+		m_vr.push_back(vec3f(r1*cw, r1*sw, z1)); m_vn.push_back(vec3f(cn*cw, cn*sw, sn));
+	}
+
+	for (int i = 0; i < slices; ++i)
+	{
+		unsigned int a0 = n0 + 2 * i, b0 = a0 + 1;
+		unsigned int a1 = a0 + 2, b1 = a1 + 1;
+		m_vi.push_back(a0); m_vi.push_back(a1); m_vi.push_back(b1);
+		m_vi.push_back(b1); m_vi.push_back(b0); m_vi.push_back(a0);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Unit sphere, with smooth normals like gluSphere.
+void GLGlyphBuffer::AddSphere(int slices, int stacks)
+{
+	unsigned int n0 = (unsigned int)m_vr.size();
+	for (int j = 0; j <= stacks; ++j)
+	{
+		float t = (float)PI*j / stacks;
+		float ct = cos(t), st = sin(t);
+		for (int i = 0; i <= slices; ++i)
+		{
+			float w = 2.f*(float)PI*i / slices;
+			vec3f n(st*cos(w), st*sin(w), ct);
+			m_vr.push_back(n);
+			m_vn.push_back(n);
+		}
+	}
+
+	int m = slices + 1;
+	for (int j = 0; j < stacks; ++j)
+		for (int i = 0; i < slices; ++i)
+		{
+			unsigned int a0 = n0 + j*m + i, a1 = a0 + 1;
+			unsigned int b0 = a0 + m, b1 = b0 + 1;
+			m_vi.push_back(a0); m_vi.push_back(b0); m_vi.push_back(b1);
+			m_vi.push_back(b1); m_vi.push_back(a1); m_vi.push_back(a0);
+		}
+}
+
+//-----------------------------------------------------------------------------
+// The box [-1,1]^3, with the same faces as glx::drawBox
+void GLGlyphBuffer::AddBox()
+{
+	const int F[6][4][3] = {
+		{ { 1,-1,-1 },{ 1, 1,-1 },{ 1, 1, 1 },{ 1,-1, 1 } },
+		{ {-1, 1,-1 },{-1,-1,-1 },{-1,-1, 1 },{-1, 1, 1 } },
+		{ { 1, 1,-1 },{-1, 1,-1 },{-1, 1, 1 },{ 1, 1, 1 } },
+		{ {-1,-1,-1 },{ 1,-1,-1 },{ 1,-1, 1 },{-1,-1, 1 } },
+		{ {-1, 1, 1 },{ 1, 1, 1 },{ 1,-1, 1 },{-1,-1, 1 } },
+		{ { 1, 1,-1 },{-1, 1,-1 },{-1,-1,-1 },{ 1,-1,-1 } }
+	};
+	const float N[6][3] = { { 1,0,0 },{ -1,0,0 },{ 0,1,0 },{ 0,-1,0 },{ 0,0,1 },{ 0,0,-1 } };
+
+	for (int i = 0; i < 6; ++i)
+	{
+		unsigned int n0 = (unsigned int)m_vr.size();
+		for (int j = 0; j < 4; ++j)
+		{
+			m_vr.push_back(vec3f((float)F[i][j][0], (float)F[i][j][1], (float)F[i][j][2]));
+			m_vn.push_back(vec3f(N[i][0], N[i][1], N[i][2]));
+		}
+		m_vi.push_back(n0); m_vi.push_back(n0 + 1); m_vi.push_back(n0 + 2);
+		m_vi.push_back(n0 + 2); m_vi.push_back(n0 + 3); m_vi.push_back(n0);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Same rotation that the glyphs used to get from glRotate.
+void GLGlyphBuffer::AlignZ(GLYPH& g, const vec3f& v)
+{
+	vec3d e[3] = { vec3d(1,0,0), vec3d(0,1,0), vec3d(0,0,1) };
+
+	quatd q(vec3d(0, 0, 1), to_vec3d(v));
+	double w = q.GetAngle();
+	if (fabs(w) > 1e-6)
+	{
+		vec3d p = q.GetVector();
+		quatd qr = (p.Length() > 1e-6 ? quatd(w, p) : quatd(w, vec3d(1, 0, 0)));
+		for (int i = 0; i < 3; ++i) qr.RotateVector(e[i]);
+	}
+
+	for (int i = 0; i < 3; ++i) g.e[i] = to_vec3f(e[i]);
+}
+
+//-----------------------------------------------------------------------------
+void GLGlyphBuffer::Render(const std::vector<GLYPH>& glyphs)
+{
+	int NG = (int)glyphs.size();
+	int nv = (int)m_vr.size();
+	int ni = (int)m_vi.size();
+	if ((NG == 0) || (nv == 0)) return;
+
+	bool blines = (m_shape == LINE);
+
+	size_t maxVerts = (size_t)m_batchSize*nv;
+	if (m_pos.size() < 3*maxVerts)
+	{
+		m_pos.resize(3 * maxVerts);
+		m_nrm.resize(3 * maxVerts);
+		m_col.resize(4 * maxVerts);
+	}
+
+	glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+	if (!blines) glEnableClientState(GL_NORMAL_ARRAY);
+	glVertexPointer(3, GL_FLOAT, 0, &m_pos[0]);
+	glColorPointer(4, GL_UNSIGNED_BYTE, 0, &m_col[0]);
+	if (!blines) glNormalPointer(GL_FLOAT, 0, &m_nrm[0]);
+
+	for (int n0 = 0; n0 < NG; n0 += m_batchSize)
+	{
+		int nb = NG - n0;
+		if (nb > m_batchSize) nb = m_batchSize;
+
+#pragma omp parallel for schedule(static)
+		for (int i = 0; i < nb; ++i)
+		{
+			const GLYPH& g = glyphs[n0 + i];
+
+			// inverse scale for transforming the normals
+			vec3f sn((g.s.x != 0.f ? 1.f / g.s.x : 0.f), (g.s.y != 0.f ? 1.f / g.s.y : 0.f), (g.s.z != 0.f ? 1.f / g.s.z : 0.f));
+
+			float* p = &m_pos[3 * (size_t)i*nv];
+			float* q = &m_nrm[3 * (size_t)i*nv];
+			unsigned char* c = &m_col[4 * (size_t)i*nv];
+			for (int j = 0; j < nv; ++j, p += 3, q += 3, c += 4)
+			{
+				const vec3f& v = m_vr[j];
+				vec3f r = g.r + g.e[0] * (v.x*g.s.x) + g.e[1] * (v.y*g.s.y) + g.e[2] * (v.z*g.s.z);
+				p[0] = r.x; p[1] = r.y; p[2] = r.z;
+
+				const vec3f& vn = m_vn[j];
+				vec3f m = g.e[0] * (vn.x*sn.x) + g.e[1] * (vn.y*sn.y) + g.e[2] * (vn.z*sn.z);
+				float L = m.Length();
+				if (L > 0.f) m = m*(1.f / L);
+				q[0] = m.x; q[1] = m.y; q[2] = m.z;
+
+				c[0] = g.c.r; c[1] = g.c.g; c[2] = g.c.b; c[3] = g.c.a;
+			}
+		}
+
+		glDrawElements((blines ? GL_LINES : GL_TRIANGLES), nb*ni, GL_UNSIGNED_INT, &m_ind[0]);
+	}
+
+	glPopClientAttrib();
+}
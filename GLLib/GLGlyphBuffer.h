@@ -0,0 +1,90 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+#pragma once
+#include <FSCore/color.h>
+#include <FSCore/math3d.h>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+// Vertex arrays for rendering many glyphs (arrows, spheres, boxes, ...) of the
+// same shape. The shape is tessellated once. Each glyph is given by a position,
+// local axes, a scale along those axes and a color. The glyphs are transformed
+// in parallel into a vertex array and drawn in batches with glDrawElements.
+class GLGlyphBuffer
+{
+public:
+	enum GlyphShape {
+		ARROW,		// shaft and head along z, length ~1
+		CONE,		// base radius 0.15 at z = 0, tip at z = 0.9
+		CYLINDER,	// radius 0.15, from z = 0 to z = 0.9
+		SPHERE,		// unit sphere
+		BOX,		// box [-1,1]^3
+		LINE		// line from origin to (0,0,1)
+	};
+
+	struct GLYPH
+	{
+		vec3f	r;		// position
+		vec3f	e[3];	// local axes
+		vec3f	s;		// scale factors along local axes
+		GLColor	c;		// color
+	};
+
+public:
+	GLGlyphBuffer();
+
+	// set the glyph shape. The slices and stacks are used for the sphere. 
+	void SetShape(int shape, int slices = 10, int stacks = 5);
+
+	// render the glyphs
+	void Render(const std::vector<GLYPH>& glyphs);
+
+	// set the axes so that the local z-axis points along v
+	static void AlignZ(GLYPH& g, const vec3f& v);
+
+private:
+	void BuildShape();
+	void AddCylinder(float z0, float z1, float r0, float r1, int slices);
+	void AddSphere(int slices, int stacks);
+	void AddBox();
+
+private:
+	int		m_shape;
+	int		m_slices, m_stacks;
+
+	// the glyph shape
+	std::vector<vec3f>	m_vr;	// vertex positions
+	std::vector<vec3f>	m_vn;	// vertex normals
+	std::vector<unsigned int>	m_vi;	// triangle (or line) indices
+
+	// vertex arrays of one batch
+	int							m_batchSize;	// nr of glyphs per batch
+	std::vector<float>			m_pos;
+	std::vector<float>			m_nrm;
+	std::vector<unsigned char>	m_col;
+	std::vector<unsigned int>	m_ind;
+};
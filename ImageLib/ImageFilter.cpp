@@ -331,81 +331,73 @@ void WarpImageFilter::ApplyFilter()
 
 	if (im->Depth() == 1)
 	{
-		for (int j = 0; j < ny; ++j)
+		// locate all the pixels in one go
+		FEFindElement2D fe(*mesh);
+		fe.Init();
+
+		std::vector<int> elem;
+		std::vector<double> q;
+		fe.FindElements(vec2d(r0.x, r0.y), vec2d(r1.x, r1.y), nx, ny, elem, q);
+
+#pragma omp parallel for
+		for (int n = 0; n < nx * ny; ++n)
+		{
+			if (elem[n] >= 0)
+			{
+				// map to reference configuration
+				FSElement& el = mesh->Element(elem[n]);
+				vec3f r[FSElement::MAX_NODES];
+				for (int j = 0; j < el.Nodes(); ++j)
+				{
+					r[j] = ps->m_Node[el.m_node[j]].m_rt;
+				}
+
+				// sample 
+				vec3f s = el.eval(r, q[2 * n], q[2 * n + 1]);
+				dst[n] = mdl->ValueAtGlobalPos(to_vec3d(s));
+			}
+			else dst[n] = 0;
+		}
+	}
+	else
+	{
+		FEFindElement fe(*mesh);
+		fe.Init();
+
+		// 3D case (each row of voxels is done by one thread)
+#pragma omp parallel for schedule(dynamic)
+		for (int l = 0; l < nz * ny; ++l)
 		{
+			int k = l / ny;
+			int j = l % ny;
+			Byte* row = dst + ((size_t)k * ny + j) * nx;
 			for (int i = 0; i < nx; ++i)
 			{
 				// get the spatial coordinates of the voxel
 				double x = r0.x + (r1.x - r0.x) * (i * wx);
 				double y = r0.y + (r1.y - r0.y) * (j * wy);
+				double z = r0.z + (r1.z - r0.z) * (k * wz);
 
 				// find which element this belongs to
 				int elem = -1;
-				double q[2] = { 0 };
-				vec2d p(x, y);
-				if (FindElement2D(p, elem, q, mesh))
+				double q[3] = { 0 };
+				if (fe.FindElement(vec3f(x, y, z), elem, q))
 				{
 					// map to reference configuration
 					FSElement& el = mesh->Element(elem);
-					int ne = el.Nodes();
-					vec3f r[FSElement::MAX_NODES];
-					for (int j = 0; j < el.Nodes(); ++j)
+					vec3f p[FSElement::MAX_NODES];
+					for (int n = 0; n < el.Nodes(); ++n)
 					{
-						r[j] = ps->m_Node[el.m_node[j]].m_rt;
+						p[n] = ps->m_Node[el.m_node[n]].m_rt;
 					}
 
 					// sample 
-					vec3f s = el.eval(r, q[0], q[1]);
-					Byte b = mdl->ValueAtGlobalPos(to_vec3d(s));
-					*dst++ = b;
+					vec3f s = el.eval(p, q[0], q[1], q[2]);
+					row[i] = mdl->ValueAtGlobalPos(to_vec3d(s));
 				}
 				else
 				{
-					*dst++ = 0;
-				}
-			}
-		}
-	}
-	else
-	{
-		FEFindElement fe(*mesh);
-		fe.Init();
-
-		// 3D case
-		for (int k = 0; k < nz; ++k)
-		{
-			for (int j = 0; j < ny; ++j)
-			{
-				for (int i = 0; i < nx; ++i)
-				{
-					// get the spatial coordinates of the voxel
-					double x = r0.x + (r1.x - r0.x) * (i * wx);
-					double y = r0.y + (r1.y - r0.y) * (j * wy);
-					double z = r0.z + (r1.z - r0.z) * (k * wz);
-
-					// find which element this belongs to
-					int elem = -1;
-					double q[3] = { 0 };
-					if (fe.FindElement(vec3f(x, y, z), elem, q))
-					{
-						// map to reference configuration
-						FSElement& el = mesh->Element(elem);
-						int ne = el.Nodes();
-						vec3f p[FSElement::MAX_NODES];
-						for (int j = 0; j < el.Nodes(); ++j)
-						{
-							p[j] = ps->m_Node[el.m_node[j]].m_rt;
-						}
-
-						// sample 
-						vec3f s = el.eval(p, q[0], q[1], q[2]);
-						Byte b = mdl->ValueAtGlobalPos(to_vec3d(s));
-						*dst++ = b;
-					}
-					else
-					{
-						*dst++ = 0;
-					}
+					row[i] = 0;
 				}
 			}
 		}
@@ -78,6 +78,9 @@ public:
 
 	int ItemSize() const;
 
+public:
+	size_t MemoryUsage() const override { return m_data.capacity() * sizeof(double); }
+
 public:
 	void Save(OArchive& ar);
 	void Load(IArchive& ar);
@@ -121,6 +124,9 @@ public:
 	// get the partlist
 	GPartList* GetPartList(FSModel* fem);
 
+public:
+	size_t MemoryUsage() const override { return m_data.capacity() * sizeof(double) + m_part.capacity() * sizeof(int); }
+
 public:
 	void Save(OArchive& ar);
 	void Load(IArchive& ar);
@@ -0,0 +1,304 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+#include "FEElementStore.h"
+#include "FEMesh.h"
+
+//-----------------------------------------------------------------------------
+// number of neighbor (and face) entries that are stored for an element
+static int elementFaceEntries(const FEElement_& el)
+{
+	// shells also use the last two neighbors for the solids they are attached to
+	return (el.IsSolid() ? el.Faces() : 6);
+}
+
+//-----------------------------------------------------------------------------
+static bool isUnit(const mat3d& Q)
+{
+	for (int i = 0; i < 3; ++i)
+		for (int j = 0; j < 3; ++j)
+			if (Q[i][j] != (i == j ? 1.0 : 0.0)) return false;
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+static bool hasFiber(const vec3d& a)
+{
+	return ((a.x != 0.0) || (a.y != 0.0) || (a.z != 0.0));
+}
+
+//-----------------------------------------------------------------------------
+double FSElementStore::View::Thickness(int i) const
+{
+	if (m_el) return (m_el->IsShell() ? m_el->m_h[i] : 0.0);
+	int n = m_store->slot(m_store->m_hslot, m_n);
+	return (n >= 0 ? m_store->m_h[n + i] : 0.0);
+}
+
+//-----------------------------------------------------------------------------
+bool FSElementStore::View::HasFiber() const
+{
+	if (m_el) return hasFiber(m_el->m_fiber);
+	return (m_store->slot(m_store->m_fslot, m_n) >= 0);
+}
+
+//-----------------------------------------------------------------------------
+vec3d FSElementStore::View::Fiber() const
+{
+	if (m_el) return m_el->m_fiber;
+	int n = m_store->slot(m_store->m_fslot, m_n);
+	return (n >= 0 ? m_store->m_fiber[n] : vec3d(0, 0, 0));
+}
+
+//-----------------------------------------------------------------------------
+mat3d FSElementStore::View::Axes() const
+{
+	if (m_el) return m_el->m_Q;
+	int n = m_store->slot(m_store->m_qslot, m_n);
+	if (n >= 0) return m_store->m_Q[n];
+	if (n < -1) return m_store->m_Q[-n - 2];
+	mat3d Q; Q.unit();
+	return Q;
+}
+
+//-----------------------------------------------------------------------------
+double FSElementStore::View::CrossSection() const
+{
+	if (m_el) return m_el->m_a0;
+	int n = m_store->slot(m_store->m_aslot, m_n);
+	return (n >= 0 ? m_store->m_a0[n] : 0.0);
+}
+
+//=============================================================================
+FSElementStore::FSElementStore()
+{
+	m_lidIndex = false;
+}
+
+//-----------------------------------------------------------------------------
+void FSElementStore::Clear()
+{
+	// swap with empty arrays so that the memory is released
+	std::vector<unsigned char>().swap(m_type);
+	std::vector<int>().swap(m_noff);
+	std::vector<int>().swap(m_node);
+	std::vector<int>().swap(m_foff);
+	std::vector<int>().swap(m_nbr);
+	std::vector<int>().swap(m_face);
+	std::vector<int>().swap(m_mat);
+	std::vector<int>().swap(m_gid);
+	std::vector<int>().swap(m_nid);
+	std::vector<unsigned int>().swap(m_state);
+	std::vector<int>().swap(m_hslot);
+	std::vector<double>().swap(m_h);
+	std::vector<int>().swap(m_fslot);
+	std::vector<vec3d>().swap(m_fiber);
+	std::vector<int>().swap(m_qslot);
+	std::vector<mat3d>().swap(m_Q);
+	std::vector<int>().swap(m_aslot);
+	std::vector<double>().swap(m_a0);
+	std::vector<float>().swap(m_tex);
+	std::vector<int>().swap(m_tag);
+	std::vector<int>().swap(m_lid);
+	m_lidIndex = false;
+}
+
+//-----------------------------------------------------------------------------
+void FSElementStore::Build(const FSCoreMesh& mesh)
+{
+	Clear();
+
+	int NE = mesh.Elements();
+	if (NE == 0) return;
+
+	// first pass: figure out the array sizes
+	int nnodes = 0, nfaces = 0;
+	int nh = 0, nfib = 0, nq = 0, na = 0, nt = 0, ntag = 0, nlid0 = 0, nlidi = 0;
+	for (int i = 0; i < NE; ++i)
+	{
+		const FEElement_& el = mesh.ElementRef(i);
+		nnodes += el.Nodes();
+		nfaces += elementFaceEntries(el);
+		if (el.IsShell()) nh += el.Nodes();
+		if (hasFiber(el.m_fiber)) nfib++;
+		if (el.m_Qactive || !isUnit(el.m_Q)) nq++;
+		if (el.m_a0 != 0.0) na++;
+		if (el.m_tex != 0.f) nt++;
+		if (el.m_ntag != 0) ntag++;
+		if (el.m_lid != 0) nlid0++;
+		if (el.m_lid != i) nlidi++;
+	}
+
+	m_type.resize(NE);
+	m_noff.resize(NE + 1);
+	m_node.resize(nnodes);
+	m_foff.resize(NE + 1);
+	m_nbr.resize(nfaces);
+	m_face.resize(nfaces);
+	m_mat.resize(NE);
+	m_gid.resize(NE);
+	m_nid.resize(NE);
+	m_state.resize(NE);
+
+	// the optional data is only allocated when it is used
+	if (nh > 0) { m_hslot.assign(NE, -1); m_h.reserve(nh); }
+	if (nfib > 0) { m_fslot.assign(NE, -1); m_fiber.reserve(nfib); }
+	if (nq > 0) { m_qslot.assign(NE, -1); m_Q.reserve(nq); }
+	if (na > 0) { m_aslot.assign(NE, -1); m_a0.reserve(na); }
+	if (nt > 0) m_tex.resize(NE);
+	if (ntag > 0) m_tag.resize(NE);
+	if ((nlid0 > 0) && (nlidi > 0)) m_lid.resize(NE);
+	m_lidIndex = (nlidi == 0);
+
+	// second pass: copy the data
+	int noff = 0, foff = 0;
+	for (int i = 0; i < NE; ++i)
+	{
+		const FEElement_& el = mesh.ElementRef(i);
+		m_type[i] = (unsigned char)el.Type();
+		m_mat[i] = el.m_MatID;
+		m_gid[i] = el.m_gid;
+		m_nid[i] = el.m_nid;
+		m_state[i] = el.GetFEState();
+
+		int ne = el.Nodes();
+		m_noff[i] = noff;
+		for (int j = 0; j < ne; ++j) m_node[noff + j] = el.m_node[j];
+		noff += ne;
+
+		int nf = elementFaceEntries(el);
+		m_foff[i] = foff;
+		for (int j = 0; j < nf; ++j)
+		{
+			m_nbr[foff + j] = el.m_nbr[j];
+			m_face[foff + j] = el.m_face[j];
+		}
+		foff += nf;
+
+		if (el.IsShell())
+		{
+			m_hslot[i] = (int)m_h.size();
+			for (int j = 0; j < ne; ++j) m_h.push_back(el.m_h[j]);
+		}
+
+		if (!m_fslot.empty() && hasFiber(el.m_fiber))
+		{
+			m_fslot[i] = (int)m_fiber.size();
+			m_fiber.push_back(el.m_fiber);
+		}
+
+		if (!m_qslot.empty() && (el.m_Qactive || !isUnit(el.m_Q)))
+		{
+			m_qslot[i] = (int)m_Q.size();
+			m_Q.push_back(el.m_Q);
+			// the sign of the slot stores the active flag
+			if (el.m_Qactive == false) m_qslot[i] = -m_qslot[i] - 2;
+		}
+
+		if (!m_aslot.empty() && (el.m_a0 != 0.0))
+		{
+			m_aslot[i] = (int)m_a0.size();
+			m_a0.push_back(el.m_a0);
+		}
+
+		if (!m_tex.empty()) m_tex[i] = el.m_tex;
+		if (!m_tag.empty()) m_tag[i] = el.m_ntag;
+		if (!m_lid.empty()) m_lid[i] = el.m_lid;
+	}
+	m_noff[NE] = noff;
+	m_foff[NE] = foff;
+}
+
+//-----------------------------------------------------------------------------
+void FSElementStore::Restore(FSMesh& mesh) const
+{
+	mesh.Expand();
+	Restore(mesh.m_Elem);
+	mesh.m_topoRev++;
+}
+
+//-----------------------------------------------------------------------------
+void FSElementStore::Restore(std::vector<FSElement>& elems) const
+{
+	int NE = Elements();
+	elems.clear();
+	elems.resize(NE);
+	for (int i = 0; i < NE; ++i)
+	{
+		FSElement& el = elems[i];
+		el.SetType(m_type[i]);
+		el.m_MatID = m_mat[i];
+		el.m_gid = m_gid[i];
+		el.m_nid = m_nid[i];
+		el.SetFEState(m_state[i]);
+
+		const int* n = &m_node[m_noff[i]];
+		int ne = m_noff[i + 1] - m_noff[i];
+		for (int j = 0; j < ne; ++j) el.m_node[j] = n[j];
+
+		int nf = m_foff[i + 1] - m_foff[i];
+		for (int j = 0; j < nf; ++j)
+		{
+			el.m_nbr[j] = m_nbr[m_foff[i] + j];
+			el.m_face[j] = m_face[m_foff[i] + j];
+		}
+
+		int hs = slot(m_hslot, i);
+		if (hs >= 0) for (int j = 0; j < ne; ++j) el.m_h[j] = m_h[hs + j];
+
+		int fs = slot(m_fslot, i);
+		if (fs >= 0) el.m_fiber = m_fiber[fs];
+
+		int qs = slot(m_qslot, i);
+		if (qs >= 0) { el.m_Q = m_Q[qs]; el.m_Qactive = true; }
+		else if (qs < -1) { el.m_Q = m_Q[-qs - 2]; el.m_Qactive = false; }
+
+		int as = slot(m_aslot, i);
+		if (as >= 0) el.m_a0 = m_a0[as];
+
+		if (!m_tex.empty()) el.m_tex = m_tex[i];
+		el.m_ntag = (m_tag.empty() ? 0 : m_tag[i]);
+		if (m_lid.empty()) el.m_lid = (m_lidIndex ? i : 0);
+		else el.m_lid = m_lid[i];
+	}
+}
+
+//-----------------------------------------------------------------------------
+size_t FSElementStore::MemoryUsage() const
+{
+	size_t mem = 0;
+	mem += m_type.size() * sizeof(unsigned char);
+	mem += (m_noff.size() + m_node.size() + m_foff.size() + m_nbr.size() + m_face.size()) * sizeof(int);
+	mem += (m_mat.size() + m_gid.size() + m_nid.size()) * sizeof(int);
+	mem += m_state.size() * sizeof(unsigned int);
+	mem += (m_hslot.size() + m_fslot.size() + m_qslot.size() + m_aslot.size()) * sizeof(int);
+	mem += (m_h.size() + m_a0.size()) * sizeof(double);
+	mem += m_fiber.size() * sizeof(vec3d);
+	mem += m_Q.size() * sizeof(mat3d);
+	mem += m_tex.size() * sizeof(float);
+	mem += (m_tag.size() + m_lid.size()) * sizeof(int);
+	return mem;
+}
@@ -0,0 +1,146 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+#pragma once
+#include "FEElement.h"
+#include "FEElementLibrary.h"
+#include <vector>
+
+class FSCoreMesh;
+class FSMesh;
+
+//-----------------------------------------------------------------------------
+// Compact storage for the elements of a mesh. 
+// The connectivity is stored in CSR form, where the number of nodes of each
+// element follows from its type. Neighbors and faces use the same layout.
+// Data that only some elements have (shell thickness, fiber, local axes,
+// cross-sectional area, tags, local IDs that differ from the element index) is
+// kept in side arrays that are only allocated when at least one element uses them.
+// Restore gives back the elements that were passed to Build.
+// An FSElement needs over 400 bytes, even for a linear tet. A linear tet
+// needs about 60 bytes in this store.
+class FSElementStore
+{
+public:
+	// Lightweight read-only view of an element. The view either reads from the
+	// store or from an element of a mesh that is not compacted.
+	class View
+	{
+	public:
+		View(const FSElementStore& store, int n) : m_store(&store), m_el(nullptr), m_n(n) {}
+		View(const FSElement& el) : m_store(nullptr), m_el(&el), m_n(-1) {}
+
+		int Type() const { return (m_el ? m_el->Type() : m_store->m_type[m_n]); }
+		int Nodes() const { return traits()->nodes; }
+		int Faces() const { return traits()->faces; }
+		int Edges() const { return traits()->edges; }
+
+		bool IsSolid() const { return (traits()->nclass == ELEM_SOLID); }
+		bool IsShell() const { return (traits()->nclass == ELEM_SHELL); }
+		bool IsBeam () const { return (traits()->nclass == ELEM_BEAM ); }
+
+		const int* NodeList() const { return (m_el ? m_el->m_node : &m_store->m_node[m_store->m_noff[m_n]]); }
+		int Node(int i) const { return NodeList()[i]; }
+		int Neighbor(int i) const { return (m_el ? m_el->m_nbr[i] : m_store->m_nbr[m_store->m_foff[m_n] + i]); }
+		int Face(int i) const { return (m_el ? m_el->m_face[i] : m_store->m_face[m_store->m_foff[m_n] + i]); }
+
+		int MatID() const { return (m_el ? m_el->m_MatID : m_store->m_mat[m_n]); }
+		int GID() const { return (m_el ? m_el->m_gid : m_store->m_gid[m_n]); }
+		int ID() const { return (m_el ? m_el->m_nid : m_store->m_nid[m_n]); }
+		unsigned int State() const { return (m_el ? m_el->GetFEState() : m_store->m_state[m_n]); }
+
+		bool IsSelected() const { return ((State() & FE_SELECTED) != 0); }
+		bool IsVisible() const { return ((State() & (FE_HIDDEN | FE_INVISIBLE | FE_ERODED)) == 0); }
+
+		bool HasThickness() const { return (m_el ? m_el->IsShell() : m_store->slot(m_store->m_hslot, m_n) >= 0); }
+		double Thickness(int i) const;
+
+		bool HasFiber() const;
+		vec3d Fiber() const;
+
+		bool HasAxes() const { return (m_el ? m_el->m_Qactive : m_store->slot(m_store->m_qslot, m_n) >= 0); }
+		mat3d Axes() const;
+
+		double CrossSection() const;
+
+	private:
+		const FSElemTraits* traits() const { return FSElementLibrary::GetTraits(Type()); }
+
+	private:
+		const FSElementStore*	m_store;
+		const FSElement*		m_el;
+		int						m_n;
+	};
+
+public:
+	FSElementStore();
+
+	void Clear();
+
+	// copy the elements of the mesh into the store
+	void Build(const FSCoreMesh& mesh);
+
+	// recreate the mesh elements from the store
+	void Restore(FSMesh& mesh) const;
+	void Restore(std::vector<FSElement>& elems) const;
+
+	int Elements() const { return (int)m_type.size(); }
+
+	View Element(int n) const { return View(*this, n); }
+
+	// approximate memory used by the store (in bytes)
+	size_t MemoryUsage() const;
+
+private:
+	int slot(const std::vector<int>& s, int n) const { return (s.empty() ? -1 : s[n]); }
+
+private:
+	std::vector<unsigned char>	m_type;		// element types
+	std::vector<int>			m_noff;		// offsets into node array (size = elements + 1)
+	std::vector<int>			m_node;		// nodal connectivity
+	std::vector<int>			m_foff;		// offsets into neighbor and face arrays (size = elements + 1)
+	std::vector<int>			m_nbr;		// element neighbors
+	std::vector<int>			m_face;		// element faces
+	std::vector<int>			m_mat;		// material IDs
+	std::vector<int>			m_gid;		// partition IDs
+	std::vector<int>			m_nid;		// element IDs
+	std::vector<unsigned int>	m_state;	// state flags
+
+	// optional data. The slot arrays are empty if no element has the data,
+	// otherwise they store the index into the data array (or -1).
+	std::vector<int>	m_hslot;	// index of first thickness value in m_h
+	std::vector<double>	m_h;
+	std::vector<int>	m_fslot;
+	std::vector<vec3d>	m_fiber;
+	std::vector<int>	m_qslot;	// negative (-n-2) if the axes are not active
+	std::vector<mat3d>	m_Q;
+	std::vector<int>	m_aslot;
+	std::vector<double>	m_a0;
+	std::vector<float>	m_tex;		// texture coordinates (empty if all zero)
+	std::vector<int>	m_tag;		// element tags (empty if all zero)
+	std::vector<int>	m_lid;		// local IDs (empty if they are all zero or all equal to the element index)
+	bool				m_lidIndex;	// if m_lid is empty, are the local IDs equal to the element index?
+};
@@ -401,3 +401,160 @@ bool FindElement2D(const vec2d& r, int& elem, double q[2], FSMesh* mesh)
 	elem = -1;
 	return false;
 }
+
+//================================================================================================
+FEFindElement2D::FEFindElement2D(FSMesh& mesh) : m_mesh(mesh)
+{
+	m_x0 = m_y0 = 0.0;
+	m_dx = m_dy = 1.0;
+	m_nx = m_ny = 0;
+}
+
+void FEFindElement2D::Init()
+{
+	m_off.clear();
+	m_cell.clear();
+	m_box.clear();
+	m_nx = m_ny = 0;
+
+	int NE = m_mesh.Elements();
+	if (NE == 0) return;
+
+	// calculate the element bounding boxes
+	m_box.assign(4 * NE, 0.0);
+	BOX bound;
+	int nshells = 0;
+	for (int i = 0; i < NE; ++i)
+	{
+		FSElement& el = m_mesh.Element(i);
+		if (el.IsShell())
+		{
+			BOX box;
+			for (int j = 0; j < el.Nodes(); ++j) box += m_mesh.Node(el.m_node[j]).r;
+			double R = box.GetMaxExtent();
+			box.Inflate(R * 1e-5);
+
+			double* b = &m_box[4 * i];
+			b[0] = box.x0; b[1] = box.y0;
+			b[2] = box.x1; b[3] = box.y1;
+
+			bound += box;
+			nshells++;
+		}
+	}
+	if (nshells == 0) return;
+
+	// size the grid so that there is about one element per cell
+	double W = bound.Width();
+	double H = bound.Height();
+	if (W <= 0.0) W = 1.0;
+	if (H <= 0.0) H = 1.0;
+	double h = sqrt(W * H / nshells);
+	m_nx = (int)(W / h); if (m_nx < 1) m_nx = 1; if (m_nx > 4096) m_nx = 4096;
+	m_ny = (int)(H / h); if (m_ny < 1) m_ny = 1; if (m_ny > 4096) m_ny = 4096;
+	m_x0 = bound.x0;
+	m_y0 = bound.y0;
+	m_dx = W / m_nx;
+	m_dy = H / m_ny;
+
+	// count the elements in each cell
+	int ncells = m_nx * m_ny;
+	m_off.assign(ncells + 1, 0);
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		std::vector<int> pos;
+		if (pass == 1)
+		{
+			for (int i = 0; i < ncells; ++i) m_off[i + 1] += m_off[i];
+			m_cell.resize(m_off[ncells]);
+			pos.assign(m_off.begin(), m_off.end() - 1);
+		}
+
+		for (int n = 0; n < NE; ++n)
+		{
+			if (m_mesh.Element(n).IsShell() == false) continue;
+			const double* b = &m_box[4 * n];
+			int i0 = (int)((b[0] - m_x0) / m_dx); if (i0 < 0) i0 = 0;
+			int i1 = (int)((b[2] - m_x0) / m_dx); if (i1 >= m_nx) i1 = m_nx - 1;
+			int j0 = (int)((b[1] - m_y0) / m_dy); if (j0 < 0) j0 = 0;
+			int j1 = (int)((b[3] - m_y0) / m_dy); if (j1 >= m_ny) j1 = m_ny - 1;
+			for (int j = j0; j <= j1; ++j)
+				for (int i = i0; i <= i1; ++i)
+				{
+					int c = j * m_nx + i;
+					if (pass == 0) m_off[c + 1]++;
+					else m_cell[pos[c]++] = n;
+				}
+		}
+	}
+}
+
+bool FEFindElement2D::IsInsideElement(int n, const vec2d& r, double q[2]) const
+{
+	const double* b = &m_box[4 * n];
+	if ((r.x() <= b[0]) || (r.x() >= b[2]) || (r.y() <= b[1]) || (r.y() >= b[3])) return false;
+
+	FSElement& el = m_mesh.Element(n);
+	vec3d x[FSElement::MAX_NODES];
+	for (int j = 0; j < el.Nodes(); ++j) x[j] = m_mesh.Node(el.m_node[j]).r;
+
+	q[0] = q[1] = 0.0;
+	return project_inside_element2d(el, x, r, q);
+}
+
+bool FEFindElement2D::FindElement(const vec2d& r, int& elem, double q[2], int hint) const
+{
+	elem = -1;
+	if ((m_nx == 0) || (m_ny == 0)) return false;
+
+	// neighboring points usually fall in the same element
+	if ((hint >= 0) && (hint < m_mesh.Elements()) && m_mesh.Element(hint).IsShell())
+	{
+		if (IsInsideElement(hint, r, q)) { elem = hint; return true; }
+	}
+
+	int i = (int)floor((r.x() - m_x0) / m_dx);
+	int j = (int)floor((r.y() - m_y0) / m_dy);
+	if ((i < 0) || (i >= m_nx) || (j < 0) || (j >= m_ny)) return false;
+
+	int c = j * m_nx + i;
+	for (int k = m_off[c]; k < m_off[c + 1]; ++k)
+	{
+		int n = m_cell[k];
+		if ((n != hint) && IsInsideElement(n, r, q))
+		{
+			elem = n;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void FEFindElement2D::FindElements(const vec2d& r0, const vec2d& r1, int nx, int ny, std::vector<int>& elem, std::vector<double>& q) const
+{
+	elem.assign(nx * ny, -1);
+	q.assign(2 * nx * ny, 0.0);
+
+	double wx = (nx < 2 ? 0 : 1.0 / (nx - 1.0));
+	double wy = (ny < 2 ? 0 : 1.0 / (ny - 1.0));
+
+#pragma omp parallel for schedule(dynamic)
+	for (int j = 0; j < ny; ++j)
+	{
+		int hint = -1;
+		for (int i = 0; i < nx; ++i)
+		{
+			double x = r0.x() + (r1.x() - r0.x()) * (i * wx);
+			double y = r0.y() + (r1.y() - r0.y()) * (j * wy);
+
+			int n = j * nx + i;
+			int ne = -1;
+			if (FindElement(vec2d(x, y), ne, &q[2 * n], hint))
+			{
+				elem[n] = ne;
+				hint = ne;
+			}
+		}
+	}
+}
@@ -88,3 +88,36 @@ inline bool FEFindElement::FindElement(const vec3f& x, int& nelem, double r[3])
 class FSMesh;
 
 bool FindElement2D(const vec2d& r, int& elem, double q[2], FSMesh* mesh);
+
+//-----------------------------------------------------------------------------
+// Finds the shell element that contains a point in the xy-plane. The shells are
+// binned in a uniform grid so that only a few elements need to be checked per point.
+class FEFindElement2D
+{
+public:
+	FEFindElement2D(FSMesh& mesh);
+
+	// build the search grid from the current nodal positions
+	void Init();
+
+	// Find the element that contains r. If hint is a valid element, it is checked first.
+	bool FindElement(const vec2d& r, int& elem, double q[2], int hint = -1) const;
+
+	// Locate all points of a regular nx x ny grid spanning [r0, r1]. Results are stored
+	// row by row. elem is set to -1 for points outside the mesh. This is done in parallel.
+	void FindElements(const vec2d& r0, const vec2d& r1, int nx, int ny, std::vector<int>& elem, std::vector<double>& q) const;
+
+private:
+	bool IsInsideElement(int n, const vec2d& r, double q[2]) const;
+
+private:
+	FSMesh&	m_mesh;
+
+	double	m_x0, m_y0;		// lower corner of grid
+	double	m_dx, m_dy;		// cell size
+	int		m_nx, m_ny;		// number of cells
+
+	std::vector<int>	m_off;	// offsets into m_cell (size = cells + 1)
+	std::vector<int>	m_cell;	// shell elements overlapping each cell
+	std::vector<double>	m_box;	// element bounding boxes (x0, y0, x1, y1)
+};
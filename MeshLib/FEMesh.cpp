@@ -30,6 +30,7 @@ SOFTWARE.*/
 #include "FESurfaceMesh.h"
 #include "MeshMetrics.h"
 #include "FENodeElementList.h"
+#include "FEElementStore.h"
 #include "FENodeFaceList.h"
 #include "FENodeEdgeList.h"
 #include "FENodeData.h"
@@ -187,12 +188,22 @@ void Mesh_Data::GetValueRange(double& vmin, double& vmax) const
 FSMesh::FSMesh()
 {
 	m_pobj = 0;
+	m_topoRev = 1;
+	m_nelRev = 0;
+	m_elemStore = nullptr;
+	m_compactElems = 0;
 }
 
 //-----------------------------------------------------------------------------
 // copy constructor
 FSMesh::FSMesh(FSMesh& m)
 {
+	m_elemStore = nullptr;
+	m_compactElems = 0;
+
+	// a compacted mesh must be expanded before its elements can be copied
+	m.Unpack();
+
 	// create the nodes
 	m_Node.resize(m.Nodes());
 	for (int i=0; i<Nodes(); ++i) m_Node[i] = m.m_Node[i];
@@ -217,11 +228,18 @@ FSMesh::FSMesh(FSMesh& m)
 
 	// don't copy object (two meshes cannot be owned by the same object)
 	m_pobj = 0;
+	m_topoRev = 1;
+	m_nelRev = 0;
 }
 
 //-----------------------------------------------------------------------------
 FSMesh::FSMesh(FSSurfaceMesh& m)
 {
+	m_topoRev = 1;
+	m_nelRev = 0;
+	m_elemStore = nullptr;
+	m_compactElems = 0;
+
 	int NN = m.Nodes();
 	int NF = m.Faces();
 	int NE = m.Edges();
@@ -278,6 +296,16 @@ void FSMesh::Clear()
 	m_Elem.clear();
 	m_Node.clear();
 
+	m_topoRev++;
+	m_NEL.Clear();
+	m_nelRev = 0;
+
+	delete m_elemStore.exchange(nullptr);
+	m_compactElems = 0;
+	delete m_itemStore;
+	m_itemStore = nullptr;
+	m_packedNFL = false;
+
 	ClearMeshData();
 }
 
@@ -294,11 +322,14 @@ void FSMesh::ClearMeshData()
 // existing groups are deleted.
 void FSMesh::Create(int nodes, int elems, int faces, int edges)
 {
+	Unpack();
+
 	// allocate storage
 	if (nodes > 0) { if (nodes) m_Node.resize(nodes); else m_Node.clear(); }
 	if (elems > 0) { if (elems) m_Elem.resize(elems); else m_Elem.clear(); }
 	if (faces > 0) { if (faces) m_Face.resize(faces); else m_Face.clear(); }
 	if (edges > 0) { if (edges) m_Edge.resize(edges); else m_Edge.clear(); }
+	m_topoRev++;
 
 	// clear mesh data
 	ClearMeshData();
@@ -308,6 +339,7 @@ void FSMesh::Create(int nodes, int elems, int faces, int edges)
 void FSMesh::ResizeNodes(int newSize)
 {
 	m_Node.resize(newSize);
+	m_topoRev++;
 }
 
 //-----------------------------------------------------------------------------
@@ -325,7 +357,9 @@ void FSMesh::ResizeFaces(int newSize)
 //-----------------------------------------------------------------------------
 void FSMesh::ResizeElems(int newSize)
 {
+	Unpack();
 	m_Elem.resize(newSize);
+	m_topoRev++;
 }
 
 //-----------------------------------------------------------------------------
@@ -562,6 +596,7 @@ void FSMesh::RemoveElements(int ntag)
 
 	m_Elem.resize(n);
 	m_data.Clear();
+	m_topoRev++;
 }
 
 //-----------------------------------------------------------------------------
@@ -723,7 +758,7 @@ bool FSMesh::ValidateElements() const
 	int NE = Elements();
 	for (int i = 0; i < NE; ++i)
 	{
-		const FSElement& el = m_Elem[i];
+		const FSElement& el = Element(i);
 
 		// see if all elements have IDs assigned
 		if (el.m_gid < 0) return false;
@@ -787,15 +822,84 @@ bool FSMesh::ValidateEdges() const
 	return true;
 }
 
+//-----------------------------------------------------------------------------
+// Key used for matching element faces and edges. The corner nodes are sorted
+// so that matching faces (or edges) have the same key.
+struct ELEM_FACE_KEY
+{
+	int	n[4];	// sorted corner nodes (padded with -1)
+	int	eid;	// element index
+	int	lid;	// local face (or edge) index (-1 for the shell face)
+};
+
+static void make_face_key(ELEM_FACE_KEY& k, const int* n, int nn, int eid, int lid)
+{
+	k.n[0] = k.n[1] = k.n[2] = k.n[3] = -1;
+	for (int i = 0; i < nn; ++i) k.n[i] = n[i];
+	std::sort(k.n, k.n + nn);
+	k.eid = eid;
+	k.lid = lid;
+}
+
+static bool same_face_key(const ELEM_FACE_KEY& a, const ELEM_FACE_KEY& b)
+{
+	return (a.n[0] == b.n[0]) && (a.n[1] == b.n[1]) && (a.n[2] == b.n[2]) && (a.n[3] == b.n[3]);
+}
+
+// Sorts the keys by bucketing them on their lowest node and then sorting each bucket.
+// On return, the keys of bucket n are in [off[n], off[n+1]).
+static void sort_face_keys(std::vector<ELEM_FACE_KEY>& keys, int NN, std::vector<int>& off)
+{
+	int NK = (int)keys.size();
+	vector<int> cnt(NN, 0);
+#pragma omp parallel for
+	for (int i = 0; i < NK; ++i)
+	{
+#pragma omp atomic
+		cnt[keys[i].n[0]]++;
+	}
+
+	off.resize(NN + 1);
+	off[0] = 0;
+	for (int i = 0; i < NN; ++i) { off[i + 1] = off[i] + cnt[i]; cnt[i] = off[i]; }
+
+	vector<ELEM_FACE_KEY> tmp(NK);
+#pragma omp parallel for
+	for (int i = 0; i < NK; ++i)
+	{
+		int k;
+#pragma omp atomic capture
+		k = cnt[keys[i].n[0]]++;
+		tmp[k] = keys[i];
+	}
+
+#pragma omp parallel for schedule(dynamic, 1024)
+	for (int i = 0; i < NN; ++i)
+	{
+		std::sort(tmp.begin() + off[i], tmp.begin() + off[i + 1], [](const ELEM_FACE_KEY& a, const ELEM_FACE_KEY& b) {
+			for (int j = 0; j < 4; ++j) if (a.n[j] != b.n[j]) return (a.n[j] < b.n[j]);
+			if (a.eid != b.eid) return (a.eid < b.eid);
+			return (a.lid < b.lid);
+		});
+	}
+
+	keys.swap(tmp);
+}
+
 //-----------------------------------------------------------------------------
 // This function finds the element neighbours.
-//
+// The element faces (and shell edges) are collected with a sorted node key and
+// grouped so that only faces (edges) with the same nodes need to be compared.
+// Each group is processed in element order, which gives the same result as 
+// visiting the elements one by one.
 void FSMesh::UpdateElementNeighbors()
 {
 	// get number of elements
 	int elems = Elements();
+	int NN = Nodes();
 
 	// reset all element neighbor and face ptrs
+#pragma omp parallel for
 	for (int i = 0; i < elems; i++)
 	{
 		FEElement_& el = ElementRef(i);
@@ -807,107 +911,165 @@ void FSMesh::UpdateElementNeighbors()
 		}
 	}
 
-	// calculate the node-element table
-	FSNodeElementList NET;
-	NET.Build(this);
+	// calculate the node-element table (needed for the beams)
+	// This is called when the element connectivity has changed, so we bump
+	// the topology revision to make sure the cached table gets rebuilt.
+	m_topoRev++;
+	const FSNodeElementList& NET = NodeElementList();
+	if ((elems == 0) || (NN == 0)) return;
+
+	// count the solid faces, shell faces, and shell edges
+	vector<int> faceOff(elems + 1, 0), edgeOff(elems + 1, 0);
+	for (int i = 0; i < elems; ++i)
+	{
+		const FEElement_& el = ElementRef(i);
+		faceOff[i + 1] = faceOff[i] + (el.IsShell() ? 1 : el.Faces());
+		edgeOff[i + 1] = edgeOff[i] + el.Edges();
+	}
+
+	// create the keys
+	vector<ELEM_FACE_KEY> faceKeys(faceOff[elems]);
+	vector<ELEM_FACE_KEY> edgeKeys(edgeOff[elems]);
+#pragma omp parallel for
+	for (int i = 0; i < elems; ++i)
+	{
+		const FEElement_& el = ElementRef(i);
+		if (el.IsShell())
+		{
+			// the corner nodes of the shell face are the first nodes of the shell
+			make_face_key(faceKeys[faceOff[i]], el.m_node, el.Edges(), i, -1);
 
-	// set up the element's neighbour pointers
-	FSEdge edge;
-	FSFace f1, f2, f3;
+			for (int j = 0; j < el.Edges(); ++j)
+			{
+				FSEdge e = el.GetEdge(j);
+				make_face_key(edgeKeys[edgeOff[i] + j], e.n, 2, i, j);
+			}
+		}
+		else
+		{
+			FSFace f;
+			for (int j = 0; j < el.Faces(); ++j)
+			{
+				el.GetFace(j, f);
+				make_face_key(faceKeys[faceOff[i] + j], f.n, f.Edges(), i, j);
+			}
+		}
+	}
 
-	// loop over all elements
-	for (int i = 0; i < elems; i++)
+	vector<int> off;
+	sort_face_keys(faceKeys, NN, off);
+
+	// set up the solid element's neighbours
+#pragma omp parallel for schedule(dynamic, 1024)
+	for (int n = 0; n < NN; ++n)
 	{
-		FEElement_* pe = ElementPtr(i);
-		// do the solid elements first
-		int n = pe->Faces();
-		for (int j = 0; j < n; j++)
+		FSFace f1, f2;
+		for (int a = off[n]; a < off[n + 1];)
 		{
-			// check if we already have a neighbor assigned
-			if (pe->m_nbr[j] == -1)
+			// find the group of faces with the same key
+			int b = a + 1;
+			while ((b < off[n + 1]) && same_face_key(faceKeys[a], faceKeys[b])) b++;
+
+			for (int p = a; (b - a > 1) && (p < b); ++p)
 			{
+				int i = faceKeys[p].eid;
+				int j = faceKeys[p].lid;
+				if (j < 0) continue;
+
+				// check if we already have a neighbor assigned
+				FEElement_* pe = ElementPtr(i);
+				if (pe->m_nbr[j] != -1) continue;
+
 				// get the corresponding element face
 				pe->GetFace(j, f1);
 
-				// pick a node on the face
-				int inode = f1.n[0];
-				int nval = NET.Valence(inode);
-				bool bfound = false;
-
 				// search for shell neighbors first
 				// This is necessary since a shell can share a face with a solid. 
-				// This requires a bit of special handling, so we need to check for that first
-				for (int k = 0; k < nval; k++)
+				bool bfound = false;
+				for (int q = a; q < b; ++q)
 				{
-					int nbe = NET.ElementIndex(inode, k);
-					FEElement_* pne = NET.Element(inode, k);
-					if ((pne != pe) && pne->IsShell())
+					if (faceKeys[q].lid >= 0) continue;
+					FEElement_* pne = ElementPtr(faceKeys[q].eid);
+					pne->GetShellFace(f2);
+					if (f1 == f2)
 					{
-						// get the shell surface facet
-						pne->GetShellFace(f2);
-						if (f1 == f2)
-						{
-							bfound = true;
-							pe->m_nbr[j] = nbe;
-							break;
-						}
+						bfound = true;
+						pe->m_nbr[j] = faceKeys[q].eid;
+						break;
 					}
 				}
 
-				if (bfound == false)
+				// search for solid neighbors next
+				for (int q = a; (bfound == false) && (q < b); ++q)
 				{
-					// search for solid neighbors next
-					for (int k = 0; k < nval; k++)
+					int nbe = faceKeys[q].eid;
+					if ((nbe == i) || (faceKeys[q].lid < 0)) continue;
+					if ((q > a) && (faceKeys[q - 1].eid == nbe)) continue;
+
+					FEElement_* pne = ElementPtr(nbe);
+					int l = pne->FindFace(f1);
+					if (l != -1)
 					{
-						int nbe = NET.ElementIndex(inode, k);
-						FEElement_* pne = ElementPtr(nbe);
-						if ((pne != pe) && pne->IsSolid())
-						{
-							int l = pne->FindFace(f1);
-							if (l != -1)
-							{
-								bfound = true;
-								pe->m_nbr[j] = nbe;
-								pne->m_nbr[l] = i;
-								break;
-							}
-						}
+						bfound = true;
+						pe->m_nbr[j] = nbe;
+						pne->m_nbr[l] = i;
 					}
 				}
 			}
+
+			a = b;
 		}
+	}
 
-		// do the shell elements next
-		n = pe->Edges();
-		for (int j = 0; j < n; j++)
+	// do the shell elements next
+	sort_face_keys(edgeKeys, NN, off);
+#pragma omp parallel for schedule(dynamic, 1024)
+	for (int n = 0; n < NN; ++n)
+	{
+		for (int a = off[n]; a < off[n + 1];)
 		{
-			if (pe->m_nbr[j] == -1)
+			int b = a + 1;
+			while ((b < off[n + 1]) && same_face_key(edgeKeys[a], edgeKeys[b])) b++;
+
+			for (int p = a; (b - a > 1) && (p < b); ++p)
 			{
-				edge = pe->GetEdge(j);
+				int i = edgeKeys[p].eid;
+				int j = edgeKeys[p].lid;
+				FEElement_* pe = ElementPtr(i);
+				if (pe->m_nbr[j] != -1) continue;
+
+				FSEdge edge = pe->GetEdge(j);
 
 				// find the neighbour element
-				int inode = edge.n[0];
-				int nval = NET.Valence(inode);
-				bool bfound = false;
-				for (int k = 0; k < nval; k++)
+				for (int q = a; q < b; ++q)
 				{
-					FEElement_* pne = NET.Element(inode, k);
-					if ((pne != pe) && (pe->is_equal(*pne) == false) && pne->IsShell())
+					int nbe = edgeKeys[q].eid;
+					if (nbe == i) continue;
+					if ((q > a) && (edgeKeys[q - 1].eid == nbe)) continue;
+
+					FEElement_* pne = ElementPtr(nbe);
+					if (pe->is_equal(*pne) == false)
 					{
 						int l = pne->FindEdge(edge);
 						if (l != -1)
 						{
-							bfound = true;
-							pe->m_nbr[j] = NET.ElementIndex(inode, k);
+							pe->m_nbr[j] = nbe;
 							pne->m_nbr[l] = i;
 							break;
 						}
 					}
 				}
 			}
+
+			a = b;
 		}
+	}
 
-		// do the beam elements
+	// do the beam elements
+#pragma omp parallel for
+	for (int i = 0; i < elems; i++)
+	{
+		FEElement_* pe = ElementPtr(i);
 		if (pe->IsType(FE_BEAM2))
 		{
 			for (int j = 0; j < 2; ++j)
@@ -1039,9 +1201,8 @@ void FSMesh::UpdateFaceElementTable()
 		}
 	}
 
-	// first build the node element table
-	FSNodeElementList NET;
-	NET.Build(this);
+	// get the node element table
+	const FSNodeElementList& NET = NodeElementList();
 
 	// loop over all faces
 	FSFace f2;
@@ -1313,6 +1474,123 @@ vector<int> FSMesh::GetElementsFromSelectedFaces()
 	return selection;
 }
 
+//-----------------------------------------------------------------------------
+const FSMeshBVH& FSMesh::ElementBVH() const
+{
+	if ((m_elemBVH.m_meshRev != m_meshRev) || (m_elemBVH.m_nodeRev != m_nodeRev) || (m_elemBVH.Primitives() != Elements()))
+	{
+		int NE = Elements();
+		std::vector<BOX> boxes(NE);
+		for (int i = 0; i < NE; ++i)
+		{
+			FSElementStore::View el = ElementView(i);
+			const int* en = el.NodeList();
+			const vec3d& r0 = Node(en[0]).r;
+			BOX b(r0, r0);
+			for (int j = 1; j < el.Nodes(); ++j) b += Node(en[j]).r;
+			b.Inflate(b.GetMaxExtent() * 1e-6);
+			boxes[i] = b;
+		}
+		UpdateBVH(m_elemBVH, boxes);
+	}
+	return m_elemBVH;
+}
+
+//-----------------------------------------------------------------------------
+const FSNodeElementList& FSMesh::NodeElementList() const
+{
+	// This can be called from several threads at once, so the list is only
+	// rebuilt by the thread that holds the lock and published via m_nelRev.
+	if ((m_nelRev.load(std::memory_order_acquire) != m_topoRev) || (m_NEL.Nodes() != Nodes()) || (m_NEL.Elements() != Elements()))
+	{
+		std::lock_guard<std::mutex> lock(m_nelMutex);
+		if ((m_nelRev.load(std::memory_order_relaxed) != m_topoRev) || (m_NEL.GetMesh() != this) || (m_NEL.Nodes() != Nodes()) || (m_NEL.Elements() != Elements()))
+		{
+			m_nelRev.store(0, std::memory_order_relaxed);
+			m_NEL.Build(const_cast<FSMesh*>(this));
+			m_nelRev.store(m_topoRev, std::memory_order_release);
+		}
+	}
+	return m_NEL;
+}
+
+//-----------------------------------------------------------------------------
+void FSMesh::Compact()
+{
+	if (IsCompact() || m_Elem.empty()) return;
+
+	FSElementStore* store = new FSElementStore;
+	store->Build(*this);
+	m_compactElems = store->Elements();
+	std::vector<FSElement>().swap(m_Elem);
+	m_elemStore.store(store, std::memory_order_release);
+
+	// the search structures will be rebuilt when needed
+	m_NEL.Clear();
+	m_nelRev = 0;
+	m_elemBVH.Clear();
+	m_faceBVH.Clear();
+}
+
+//-----------------------------------------------------------------------------
+void FSMesh::Expand()
+{
+	FSElementStore* store = m_elemStore.exchange(nullptr);
+	if (store == nullptr) return;
+
+	store->Restore(m_Elem);
+	delete store;
+}
+
+//-----------------------------------------------------------------------------
+// Called by the element accessors of a compacted mesh. This may be called from
+// several threads, so the expansion is done under a lock and the store is only
+// released after the elements are restored.
+void FSMesh::ExpandOnAccess() const
+{
+	std::lock_guard<std::mutex> lock(m_storeMutex);
+	FSElementStore* store = m_elemStore.load(std::memory_order_relaxed);
+	if (store == nullptr) return;
+
+	store->Restore(const_cast<FSMesh*>(this)->m_Elem);
+	m_elemStore.store(nullptr, std::memory_order_release);
+	delete store;
+}
+
+//-----------------------------------------------------------------------------
+FSElementStore::View FSMesh::ElementView(int n) const
+{
+	FSElementStore* store = m_elemStore.load(std::memory_order_acquire);
+	return (store ? store->Element(n) : FSElementStore::View(m_Elem[n]));
+}
+
+//-----------------------------------------------------------------------------
+void FSMesh::Pack()
+{
+	Compact();
+	FSMeshBase::Pack();
+}
+
+//-----------------------------------------------------------------------------
+void FSMesh::Unpack()
+{
+	FSMeshBase::Unpack();
+	Expand();
+}
+
+//-----------------------------------------------------------------------------
+size_t FSMesh::MemoryUsage() const
+{
+	size_t mem = FSCoreMesh::MemoryUsage();
+	mem += m_Elem.capacity() * sizeof(FSElement);
+	FSElementStore* store = m_elemStore.load(std::memory_order_acquire);
+	if (store) mem += store->MemoryUsage();
+	mem += m_NEL.MemoryUsage();
+	mem += m_data.MemoryUsage();
+	for (const FEMeshData* data : m_meshData) mem += sizeof(*data) + data->MemoryUsage();
+	return mem;
+}
+
 //-----------------------------------------------------------------------------
 // Extract faces as a shell mesh
 FSMesh* FSMesh::ExtractFaces(bool selectedOnly)
@@ -1992,10 +2270,13 @@ void FSMesh::Load(IArchive& ar)
 // Create a shallow-copy of the mesh
 void FSMesh::ShallowCopy(FSMesh* pm)
 {
+	Unpack();
+	pm->Unpack();
 	m_Node = pm->m_Node;
 	m_Edge = pm->m_Edge;
 	m_Face = pm->m_Face;
 	m_Elem = pm->m_Elem;
+	m_topoRev++;
 
 	m_data = pm->m_data;
 
@@ -26,11 +26,15 @@ SOFTWARE.*/
 
 #pragma once
 #include "FECoreMesh.h"
+#include "FENodeElementList.h"
+#include "FEElementStore.h"
 #include <GeomLib/FSGroup.h>
 #include <MeshLib/FEMeshData.h>
 #include <vector>
 #include <set>
 #include <string>
+#include <atomic>
+#include <mutex>
 
 //-----------------------------------------------------------------------------
 class FSSurfaceMesh;
@@ -88,6 +92,9 @@ public:
 	// get the value range
 	void GetValueRange(double& vmin, double& vmax) const;
 
+	// approximate memory used by the data (in bytes)
+	size_t MemoryUsage() const { return m_data.capacity() * sizeof(DATA); }
+
 public:
 	std::vector<DATA>		m_data;		//!< element values
 	double	m_min, m_max;				//!< value range of element data
@@ -124,15 +131,18 @@ public:
 public: // from FSCoreMesh
 
 	//! return number of elements
-	int Elements() const override { return (int)m_Elem.size(); }
+	int Elements() const override { return (IsCompact() ? m_compactElems : (int)m_Elem.size()); }
 
-	//! return element
-	FSElement& Element(int n) { return m_Elem[n]; }
-	const FSElement& Element(int n) const { return m_Elem[n]; }
+	//! return element (a compacted mesh is expanded first)
+	FSElement& Element(int n) { if (IsCompact()) ExpandOnAccess(); return m_Elem[n]; }
+	const FSElement& Element(int n) const { if (IsCompact()) ExpandOnAccess(); return m_Elem[n]; }
 
 	//! return reference to element
-	FEElement_& ElementRef(int n) override { return m_Elem[n]; }
-	const FEElement_& ElementRef(int n) const override { return m_Elem[n]; }
+	FEElement_& ElementRef(int n) override { return Element(n); }
+	const FEElement_& ElementRef(int n) const override { return Element(n); }
+
+	//! return a read-only view of an element. This does not expand a compacted mesh.
+	FSElementStore::View ElementView(int n) const;
 
 	void SetUniformShellThickness(double h);
 
@@ -186,6 +196,24 @@ public:
 	// extract faces and return as new mesh
 	FSMesh* ExtractFaces(bool selectedOnly);
 
+public: // --- C O M P A C T   S T O R A G E ---
+	// Move the elements into a compact store. This is meant for meshes that are
+	// mostly read, e.g. meshes that are kept by the undo stack. ElementView reads
+	// from the store, while the element accessors expand the mesh on first use.
+	void Compact();
+
+	// restore the elements from the compact store
+	void Expand();
+
+	bool IsCompact() const { return (m_elemStore.load(std::memory_order_acquire) != nullptr); }
+
+	// Pack compacts the elements and packs the nodes, edges, and faces (see FSMeshBase::Pack).
+	void Pack() override;
+	void Unpack() override;
+
+	// approximate memory used by the mesh (in bytes)
+	size_t MemoryUsage() const override;
+
 public:
 	int MeshDataFields() const;
 	FEMeshData* GetMeshDataField(int i);
@@ -212,6 +240,12 @@ public: // --- M E S H   Q U E R I E S ---
 	// select elements based on face selection
 	std::vector<int> GetElementsFromSelectedFaces();
 
+	// bounding volume hierarchy of the elements (built on demand)
+	const FSMeshBVH& ElementBVH() const;
+
+	// node-element list (built on demand and rebuilt when the topology changes)
+	const FSNodeElementList& NodeElementList() const;
+
 protected:
 	// elements
 	std::vector<FSElement>	m_Elem;	//!< FE elements
@@ -222,7 +256,20 @@ protected:
 	// data fields
 	std::vector<FEMeshData*>		m_meshData;
 
+	mutable FSMeshBVH	m_elemBVH;
+	unsigned int	m_topoRev;	// incremented when the element connectivity changes
+	mutable std::atomic<FSElementStore*>	m_elemStore;	// compact element storage (only used when compacted)
+	int	m_compactElems;	// number of elements in the compact store
+	mutable std::mutex	m_storeMutex;	// guards the expansion on access
+	mutable FSNodeElementList	m_NEL;
+	mutable std::atomic<unsigned int>	m_nelRev;	// topology revision m_NEL was built for (0 = not built)
+	mutable std::mutex	m_nelMutex;	// guards the rebuild of m_NEL
+
+private:
+	void ExpandOnAccess() const;
+
 	friend class FEMeshBuilder;
+	friend class FSElementStore;
 };
 
 double bias(double b, double x);
@@ -0,0 +1,149 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+#include "FEMeshBVH.h"
+#include <algorithm>
+
+// max number of primitives in a leaf
+const int BVH_LEAF_SIZE = 4;
+
+FSMeshBVH::FSMeshBVH()
+{
+	m_meshRev = m_nodeRev = 0;
+}
+
+void FSMeshBVH::Clear()
+{
+	m_node.clear();
+	m_prim.clear();
+}
+
+//-----------------------------------------------------------------------------
+static void bvh_set_box(FSMeshBVH::NODE& n, const BOX& b)
+{
+	n.r0[0] = b.x0; n.r0[1] = b.y0; n.r0[2] = b.z0;
+	n.r1[0] = b.x1; n.r1[1] = b.y1; n.r1[2] = b.z1;
+}
+
+static void bvh_merge_box(FSMeshBVH::NODE& n, const FSMeshBVH::NODE& a, const FSMeshBVH::NODE& b)
+{
+	for (int i = 0; i < 3; ++i)
+	{
+		n.r0[i] = std::min(a.r0[i], b.r0[i]);
+		n.r1[i] = std::max(a.r1[i], b.r1[i]);
+	}
+}
+
+static void bvh_leaf_box(FSMeshBVH::NODE& n, const std::vector<int>& prim, const std::vector<BOX>& boxes)
+{
+	BOX b = boxes[prim[n.first]];
+	for (int i = 1; i < n.count; ++i) b += boxes[prim[n.first + i]];
+	bvh_set_box(n, b);
+}
+
+//-----------------------------------------------------------------------------
+void FSMeshBVH::Build(const std::vector<BOX>& boxes)
+{
+	Clear();
+	int N = (int)boxes.size();
+	if (N == 0) return;
+
+	// box centers
+	std::vector<vec3d> c(N);
+	m_prim.resize(N);
+	for (int i = 0; i < N; ++i)
+	{
+		c[i] = boxes[i].Center();
+		m_prim[i] = i;
+	}
+
+	m_node.reserve(2 * (N / BVH_LEAF_SIZE + 1));
+	NODE root;
+	root.child = -1; root.first = 0; root.count = N;
+	m_node.push_back(root);
+
+	// split the nodes until they are small enough
+	std::vector<int> stack;
+	stack.push_back(0);
+	while (stack.empty() == false)
+	{
+		int nid = stack.back(); stack.pop_back();
+		int first = m_node[nid].first;
+		int count = m_node[nid].count;
+
+		if (count <= BVH_LEAF_SIZE)
+		{
+			bvh_leaf_box(m_node[nid], m_prim, boxes);
+			continue;
+		}
+
+		// split along the largest extent of the centers
+		BOX cb(c[m_prim[first]], c[m_prim[first]]);
+		for (int i = 1; i < count; ++i) cb += c[m_prim[first + i]];
+		int axis = 0;
+		if (cb.Height() > cb.Width()) axis = 1;
+		if (cb.Depth() > (axis == 0 ? cb.Width() : cb.Height())) axis = 2;
+
+		int mid = count / 2;
+		std::nth_element(m_prim.begin() + first, m_prim.begin() + first + mid, m_prim.begin() + first + count,
+			[&](int a, int b) {
+				return (axis == 0 ? c[a].x < c[b].x : (axis == 1 ? c[a].y < c[b].y : c[a].z < c[b].z));
+			});
+
+		NODE a, b;
+		a.child = b.child = -1;
+		a.first = first; a.count = mid;
+		b.first = first + mid; b.count = count - mid;
+
+		int nc = (int)m_node.size();
+		m_node[nid].child = nc;
+		m_node[nid].count = 0;
+		m_node.push_back(a);
+		m_node.push_back(b);
+		stack.push_back(nc);
+		stack.push_back(nc + 1);
+	}
+
+	// the children always come after their parent, so we can fit the boxes backwards
+	for (int i = (int)m_node.size() - 1; i >= 0; --i)
+	{
+		NODE& n = m_node[i];
+		if (n.count == 0) bvh_merge_box(n, m_node[n.child], m_node[n.child + 1]);
+	}
+}
+
+//-----------------------------------------------------------------------------
+void FSMeshBVH::Refit(const std::vector<BOX>& boxes)
+{
+	if ((int)boxes.size() != Primitives()) { Build(boxes); return; }
+
+	for (int i = (int)m_node.size() - 1; i >= 0; --i)
+	{
+		NODE& n = m_node[i];
+		if (n.count > 0) bvh_leaf_box(n, m_prim, boxes);
+		else bvh_merge_box(n, m_node[n.child], m_node[n.child + 1]);
+	}
+}
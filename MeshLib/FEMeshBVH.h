@@ -0,0 +1,193 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+#pragma once
+#include <FSCore/box.h>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+// Bounding volume hierarchy over the primitives (faces, elements) of a mesh.
+// The primitives are only given by their bounding boxes, so the tree can be
+// refitted when the nodes move without changing the mesh topology.
+class FSMeshBVH
+{
+public:
+	struct NODE
+	{
+		double	r0[3], r1[3];	// bounding box
+		int		child;			// index of first child (second is child + 1)
+		int		first;			// first primitive (leaf nodes)
+		int		count;			// number of primitives (0 for internal nodes)
+	};
+
+public:
+	FSMeshBVH();
+
+	void Clear();
+
+	bool IsEmpty() const { return m_node.empty(); }
+
+	int Primitives() const { return (int)m_prim.size(); }
+
+	// build the tree from the primitives' bounding boxes
+	void Build(const std::vector<BOX>& boxes);
+
+	// update the boxes without changing the tree (primitive count must match)
+	void Refit(const std::vector<BOX>& boxes);
+
+	// Visit all primitives whose boxes are hit by the ray between 0 and tmax,
+	// roughly from near to far. The function f(prim, tmax) is called for each
+	// primitive, and can reduce tmax when it finds a hit to prune the search.
+	// The direction does not need to be a unit vector, but tmax is always the
+	// distance along the ray.
+	template <class F> void Intersect(const vec3d& o, const vec3d& d, double tmax, F f) const;
+
+	// Visit all primitives whose boxes are within sqrt(d2max) of x, roughly from near
+	// to far. The function f(prim, d2max) is called for each primitive, and can reduce
+	// d2max when it finds a closer point to prune the search.
+	template <class F> void Closest(const vec3d& x, double d2max, F f) const;
+
+private:
+	double BoxDistance2(const NODE& n, const double x[3]) const;
+
+	bool HitBox(const NODE& n, const double o[3], const double id[3], double tmax, double& t) const;
+
+public:
+	// mesh revisions this tree was built for (managed by the owning mesh)
+	unsigned int	m_meshRev;
+	unsigned int	m_nodeRev;
+
+private:
+	std::vector<NODE>	m_node;
+	std::vector<int>	m_prim;
+};
+
+inline bool FSMeshBVH::HitBox(const NODE& n, const double o[3], const double id[3], double tmax, double& t) const
+{
+	double tmin = 0.0;
+	for (int i = 0; i < 3; ++i)
+	{
+		double t0 = (n.r0[i] - o[i]) * id[i];
+		double t1 = (n.r1[i] - o[i]) * id[i];
+		if (t0 > t1) { double tmp = t0; t0 = t1; t1 = tmp; }
+		if (t0 > tmin) tmin = t0;
+		if (t1 < tmax) tmax = t1;
+		if (tmin > tmax) return false;
+	}
+	t = tmin;
+	return true;
+}
+
+inline double FSMeshBVH::BoxDistance2(const NODE& n, const double x[3]) const
+{
+	double d2 = 0.0;
+	for (int i = 0; i < 3; ++i)
+	{
+		double d = 0.0;
+		if (x[i] < n.r0[i]) d = n.r0[i] - x[i];
+		else if (x[i] > n.r1[i]) d = x[i] - n.r1[i];
+		d2 += d * d;
+	}
+	return d2;
+}
+
+template <class F> void FSMeshBVH::Intersect(const vec3d& o, const vec3d& d, double tmax, F f) const
+{
+	if (m_node.empty()) return;
+
+	// tmax is a distance, so the ray parameter must be too
+	double L = d.Length();
+	if (L == 0.0) return;
+	double ro[3] = { o.x, o.y, o.z };
+	double id[3] = { L / d.x, L / d.y, L / d.z };
+
+	// the tree is balanced, so this is plenty
+	int stack[64];
+	int ns = 0;
+	double t;
+	if (HitBox(m_node[0], ro, id, tmax, t)) stack[ns++] = 0;
+	while (ns > 0)
+	{
+		const NODE& n = m_node[stack[--ns]];
+		if (n.count > 0)
+		{
+			for (int i = 0; i < n.count; ++i) f(m_prim[n.first + i], tmax);
+		}
+		else
+		{
+			// push the far child first so that the near one is visited first
+			double ta, tb;
+			bool ha = HitBox(m_node[n.child    ], ro, id, tmax, ta);
+			bool hb = HitBox(m_node[n.child + 1], ro, id, tmax, tb);
+			if (ha && hb)
+			{
+				if (ta <= tb) { stack[ns++] = n.child + 1; stack[ns++] = n.child; }
+				else { stack[ns++] = n.child; stack[ns++] = n.child + 1; }
+			}
+			else if (ha) stack[ns++] = n.child;
+			else if (hb) stack[ns++] = n.child + 1;
+		}
+	}
+}
+
+template <class F> void FSMeshBVH::Closest(const vec3d& x, double d2max, F f) const
+{
+	if (m_node.empty()) return;
+
+	double rx[3] = { x.x, x.y, x.z };
+
+	int stack[64];
+	double dist[64];
+	int ns = 0;
+	stack[ns] = 0; dist[ns++] = BoxDistance2(m_node[0], rx);
+	while (ns > 0)
+	{
+		--ns;
+		if (dist[ns] > d2max) continue;
+
+		const NODE& n = m_node[stack[ns]];
+		if (n.count > 0)
+		{
+			for (int i = 0; i < n.count; ++i) f(m_prim[n.first + i], d2max);
+		}
+		else
+		{
+			// push the far child first so that the near one is visited first
+			double da = BoxDistance2(m_node[n.child    ], rx);
+			double db = BoxDistance2(m_node[n.child + 1], rx);
+			if (da <= db)
+			{
+				stack[ns] = n.child + 1; dist[ns++] = db;
+				stack[ns] = n.child    ; dist[ns++] = da;
+			}
+			else
+			{
+				stack[ns] = n.child    ; dist[ns++] = da;
+				stack[ns] = n.child + 1; dist[ns++] = db;
+			}
+		}
+	}
+}
@@ -27,17 +27,65 @@ SOFTWARE.*/
 #include"FEMeshBase.h"
 #include <GeomLib/GObject.h>
 #include "FENodeEdgeList.h"
+#include "FEMeshItemStore.h"
 using namespace std;
 
 //-----------------------------------------------------------------------------
 FSMeshBase::FSMeshBase()
 {
+	m_meshRev = 1;
+	m_nodeRev = 1;
+	m_itemStore = nullptr;
+	m_packedNFL = false;
 }
 
 //-----------------------------------------------------------------------------
 FSMeshBase::~FSMeshBase()
 {
 	m_NFL.Clear();
+	delete m_itemStore;
+}
+
+//-----------------------------------------------------------------------------
+size_t FSMeshBase::MemoryUsage() const
+{
+	size_t mem = 0;
+	mem += m_Node.capacity() * sizeof(FSNode);
+	mem += m_Edge.capacity() * sizeof(FSEdge);
+	mem += m_Face.capacity() * sizeof(FSFace);
+	mem += m_NFL.MemoryUsage();
+	if (m_itemStore) mem += m_itemStore->MemoryUsage();
+	return mem;
+}
+
+//-----------------------------------------------------------------------------
+void FSMeshBase::Pack()
+{
+	if (m_itemStore) return;
+
+	m_itemStore = new FSMeshItemStore;
+	m_itemStore->Build(m_Node, m_Edge, m_Face);
+	std::vector<FSNode>().swap(m_Node);
+	std::vector<FSEdge>().swap(m_Edge);
+	std::vector<FSFace>().swap(m_Face);
+
+	// the node-face list points to the faces, so it is rebuilt when the mesh is unpacked
+	m_packedNFL = (m_NFL.IsEmpty() == false);
+	m_NFL.Clear();
+	m_faceBVH.Clear();
+}
+
+//-----------------------------------------------------------------------------
+void FSMeshBase::Unpack()
+{
+	if (m_itemStore == nullptr) return;
+
+	m_itemStore->Restore(m_Node, m_Edge, m_Face);
+	delete m_itemStore;
+	m_itemStore = nullptr;
+
+	if (m_packedNFL) m_NFL.Build(this);
+	m_packedNFL = false;
 }
 
 //-----------------------------------------------------------------------------
@@ -48,6 +96,41 @@ void FSMeshBase::FaceNodeLocalPositions(const FSFace& f, vec3d* r) const
 	for (int i = 0; i<nf; ++i) r[i] = m_Node[f.n[i]].r;
 }
 
+//-----------------------------------------------------------------------------
+const FSMeshBVH& FSMeshBase::FaceBVH() const
+{
+	if ((m_faceBVH.m_meshRev != m_meshRev) || (m_faceBVH.m_nodeRev != m_nodeRev) || (m_faceBVH.Primitives() != Faces()))
+	{
+		int NF = Faces();
+		std::vector<BOX> boxes(NF);
+		vec3d rn[FSFace::MAX_NODES];
+		for (int i = 0; i < NF; ++i)
+		{
+			const FSFace& f = Face(i);
+			FaceNodeLocalPositions(f, rn);
+			BOX b(rn[0], rn[0]);
+			for (int j = 1; j < f.Nodes(); ++j) b += rn[j];
+			b.Inflate(b.GetMaxExtent() * 1e-6);
+			boxes[i] = b;
+		}
+		UpdateBVH(m_faceBVH, boxes);
+	}
+	return m_faceBVH;
+}
+
+//-----------------------------------------------------------------------------
+// Rebuild the tree if the mesh changed, or refit it when only the nodes moved.
+void FSMeshBase::UpdateBVH(FSMeshBVH& bvh, const std::vector<BOX>& boxes) const
+{
+	if ((bvh.m_meshRev != m_meshRev) || (bvh.Primitives() != (int)boxes.size()))
+		bvh.Build(boxes);
+	else
+		bvh.Refit(boxes);
+
+	bvh.m_meshRev = m_meshRev;
+	bvh.m_nodeRev = m_nodeRev;
+}
+
 //-----------------------------------------------------------------------------
 // Tag all faces
 void FSMeshBase::TagAllFaces(int ntag)
@@ -219,6 +302,8 @@ void FSMeshBase::AutoSmooth(double angleDegrees)
 //
 void FSMeshBase::UpdateNormals()
 {
+	m_nodeRev++;
+
 	int NN = Nodes();
 	int NF = Faces();
 
@@ -337,6 +422,7 @@ void FSMeshBase::SmoothByPartition()
 //-----------------------------------------------------------------------------
 void FSMeshBase::UpdateMesh()
 {
+	m_meshRev++;
 	UpdateNormals();
 	UpdateBoundingBox();
 }
@@ -33,6 +33,9 @@ SOFTWARE.*/
 #include "FEFace.h"
 #include "FELineMesh.h"
 #include "FENodeFaceList.h"
+#include "FEMeshBVH.h"
+
+class FSMeshItemStore;
 
 //-------------------------------------------------------------------
 // Base class for mesh classes.
@@ -110,6 +113,28 @@ public:
 
 	const std::vector<NodeFaceRef>& NodeFaceList(int n) const;
 
+	// bounding volume hierarchy of the faces (in local coordinates)
+	// This is built on demand and refitted when the normals are updated.
+	const FSMeshBVH& FaceBVH() const;
+
+	// approximate memory used by the mesh (in bytes)
+	virtual size_t MemoryUsage() const;
+
+public: // --- P A C K E D   S T O R A G E ---
+	// Move the nodes, edges, and faces into a compact store. The mesh has no
+	// nodes, edges, or faces until Unpack is called, so this is only meant for
+	// meshes that are not in use, e.g. meshes that are kept by the undo stack.
+	virtual void Pack();
+
+	// restore the nodes, edges, and faces from the compact store
+	virtual void Unpack();
+
+	bool IsPacked() const { return (m_itemStore != nullptr); }
+
+protected:
+	// update a BVH for the current mesh revisions
+	void UpdateBVH(FSMeshBVH& bvh, const std::vector<BOX>& boxes) const;
+
 protected:
 	void RemoveEdges(int ntag);
 	void RemoveFaces(int ntag);
@@ -118,6 +143,14 @@ protected:
 	std::vector<FSFace>		m_Face;	//!< FE faces
 
 	FSNodeFaceList		m_NFL;
+
+	unsigned int	m_meshRev;	// incremented when the mesh is updated
+	unsigned int	m_nodeRev;	// incremented when the normals (and thus nodes) are updated
+
+	mutable FSMeshBVH	m_faceBVH;
+
+	FSMeshItemStore*	m_itemStore;	// compact item storage (only used when packed)
+	bool				m_packedNFL;	// was the node-face list built when the mesh was packed?
 };
 
 //-------------------------------------------------------------------
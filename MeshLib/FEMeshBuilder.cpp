@@ -28,11 +28,13 @@ SOFTWARE.*/
 #include "FEMesh.h"
 #include <GeomLib/GObject.h>
 #include <MeshLib/FEFaceEdgeList.h>
+#include <unordered_map>
 using namespace std;
 
 FEMeshBuilder::FEMeshBuilder(FSMesh& mesh) : m_mesh(mesh)
 {
-
+	// the builder works on the mesh items directly
+	m_mesh.Unpack();
 }
 
 //-----------------------------------------------------------------------------
@@ -1918,8 +1920,10 @@ void FEMeshBuilder::AutoPartitionNodes()
 void FEMeshBuilder::BuildFaces()
 {
 	// let's count them first
-	int faces = 0;
+	// (the solid faces are stored first, followed by the shell faces)
 	int elems = m_mesh.Elements();
+	vector<int> solidOff(elems + 1, 0), shellOff(elems + 1, 0);
+#pragma omp parallel for
 	for (int i = 0; i<elems; i++)
 	{
 		FSElement& el = m_mesh.Element(i);
@@ -1928,6 +1932,7 @@ void FEMeshBuilder::BuildFaces()
 		// we create a face if an element does not have a neighbor
 		// or if the neighbor has a different gid and is not a shell.
 		// Note that we need to make sure we don't double-count.
+		int faces = 0;
 		int n = el.Faces();
 		for (int j = 0; j<n; ++j)
 		{
@@ -1941,13 +1946,18 @@ void FEMeshBuilder::BuildFaces()
 				}
 			}
 		}
+		solidOff[i + 1] = faces;
 
 		// shell elements always add a face
-		if (el.IsShell())
-		{
-			++faces;
-		}
+		shellOff[i + 1] = (el.IsShell() ? 1 : 0);
 	}
+	for (int i = 0; i < elems; ++i)
+	{
+		solidOff[i + 1] += solidOff[i];
+		shellOff[i + 1] += shellOff[i];
+	}
+	int solidFaces = solidOff[elems];
+	int faces = solidFaces + shellOff[elems];
 
 	// make sure we have faces
 	if (faces == 0)
@@ -1960,14 +1970,13 @@ void FEMeshBuilder::BuildFaces()
 	m_mesh.m_Face.resize(faces);
 
 	// create the faces
-	FSFace* pf = m_mesh.FacePtr();
-	int nf = 0;
-
-	// solid elements
+#pragma omp parallel for
 	for (int i = 0; i<elems; i++)
 	{
 		FSElement& el = m_mesh.Element(i);
 
+		// solid elements
+		int nf = solidOff[i];
 		int n = el.Faces();
 		for (int j = 0; j<n; j++)
 		{
@@ -1976,34 +1985,30 @@ void FEMeshBuilder::BuildFaces()
 			FEElement_* pen = (nbid == -1 ? 0 : m_mesh.ElementPtr(nbid));
 			if (pen == 0)
 			{
-				el.GetFace(j, *pf);
-				pf->SetExterior(true);
-				pf->SetID(nf + 1);
-				++pf; ++nf;
+				FSFace& face = m_mesh.Face(nf);
+				el.GetFace(j, face);
+				face.SetExterior(true);
+				face.SetID(nf + 1);
+				++nf;
 			}
 			else if ((el.m_gid < pen->m_gid) && (pen->IsShell() == false))
 			{
-				*pf = el.GetFace(j);
-				pf->SetExterior(false);
-				pf->SetID(nf + 1);
-				++pf; ++nf;
+				FSFace& face = m_mesh.Face(nf);
+				face = el.GetFace(j);
+				face.SetExterior(false);
+				face.SetID(nf + 1);
+				++nf;
 			}
 		}
-	}
-
-	// shell elements
-	for (int i = 0; i<elems; i++)
-	{
-		FSElement& el = m_mesh.Element(i);
 
 		// shell elements
-		int n = el.Edges();
-		if (n>0)
+		if (el.Edges() > 0)
 		{
-			el.GetShellFace(*pf);
-			pf->SetExterior(true);
-			pf->SetID(nf + 1);
-			++pf; ++nf;
+			nf = solidFaces + shellOff[i];
+			FSFace& face = m_mesh.Face(nf);
+			el.GetShellFace(face);
+			face.SetExterior(true);
+			face.SetID(nf + 1);
 		}
 	}
 
@@ -2020,9 +2025,22 @@ void FEMeshBuilder::BuildEdges()
 	// tag all faces
 	for (int i = 0; i < m_mesh.Faces(); ++i) m_mesh.Face(i).m_ntag = i;
 
-	// keep node-edge table to prevent adding duplicate edges
-	int NN = m_mesh.Nodes();
-	vector<vector<int> > NET(NN);
+	// keep a table of the edges (keyed on their end nodes) to prevent adding duplicate edges
+	std::unordered_multimap<long long, int> ET;
+	auto edgeKey = [](const FSEdge& e) {
+		long long n0 = (e.n[0] < e.n[1] ? e.n[0] : e.n[1]);
+		long long n1 = (e.n[0] < e.n[1] ? e.n[1] : e.n[0]);
+		return (n0 << 32) | n1;
+	};
+	auto findEdge = [&](const FSEdge& e, long long key) {
+		auto range = ET.equal_range(key);
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			if (m_mesh.Edge(it->second) == e) return true;
+		}
+		return false;
+	};
+	ET.reserve(m_mesh.Faces() * 2);
 
 	// loop over all faces
 	int NF = m_mesh.Faces();
@@ -2038,21 +2056,9 @@ void FEMeshBuilder::BuildEdges()
 				FSEdge e = f.GetEdge(j);
 
 				// see if this edge already exists
-				bool bfound = false;
-				vector<int>& net = NET[e.n[0]];
-				for (int l = 0; l < net.size(); ++l)
-				{
-					FSEdge& el = m_mesh.Edge(net[l]);
-					if (el == e)
-					{
-						// the edge already exists, so don't add it
-						bfound = true;
-						break;
-					}
-				}
-
 				// If not, then process and add
-				if (bfound == false)
+				long long key = edgeKey(e);
+				if (findEdge(e, key) == false)
 				{
 					e.m_gid = ((pfn == 0) || (f.m_gid != pfn->m_gid) ? 0 : -1);
 					e.SetID((int)m_mesh.m_Edge.size() + 1);
@@ -2060,8 +2066,7 @@ void FEMeshBuilder::BuildEdges()
 
 					int edgeIndex = m_mesh.Edges();
 					m_mesh.m_Edge.push_back(e);
-					NET[e.n[0]].push_back(edgeIndex);
-					NET[e.n[1]].push_back(edgeIndex);
+					ET.insert(std::make_pair(key, edgeIndex));
 				}
 			}
 		}
@@ -2079,21 +2084,9 @@ void FEMeshBuilder::BuildEdges()
 			e.n[1] = el.m_node[1];
 
 			// see if this edge already exists
-			bool bfound = false;
-			vector<int>& net = NET[e.n[0]];
-			for (int l = 0; l < net.size(); ++l)
-			{
-				FSEdge& el = m_mesh.Edge(net[l]);
-				if (el == e)
-				{
-					// the edge already exists, so don't add it
-					bfound = true;
-					break;
-				}
-			}
-
 			// If not, then process and add
-			if (bfound == false)
+			long long key = edgeKey(e);
+			if (findEdge(e, key) == false)
 			{
 				e.m_gid = 0;
 				e.m_elem = i;
@@ -2102,8 +2095,7 @@ void FEMeshBuilder::BuildEdges()
 
 				int edgeIndex = m_mesh.Edges();
 				m_mesh.m_Edge.push_back(e);
-				NET[e.n[0]].push_back(edgeIndex);
-				NET[e.n[1]].push_back(edgeIndex);
+				ET.insert(std::make_pair(key, edgeIndex));
 			}
 		}
 	}
@@ -69,6 +69,9 @@ public:
 	// return mesh this data field belongs to
 	FSMesh* GetMesh() const;
 
+	// approximate memory used by the data (in bytes)
+	virtual size_t MemoryUsage() const { return 0; }
+
 protected:
 	void SetMesh(FSMesh* mesh);
 	DATA_TYPE		m_dataType;
@@ -0,0 +1,304 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+#include "FEMeshItemStore.h"
+
+//-----------------------------------------------------------------------------
+// number of nodes and edges of the face types (the invalid type has none)
+static const int faceNodes[] = { 0, 3, 4, 6, 7, 8, 9, 10 };
+static const int faceEdges[] = { 0, 3, 4, 3, 3, 4, 4, 3 };
+
+// number of nodes of the edge types
+static const int edgeNodes[] = { 2, 3, 4, 0 };
+
+//=============================================================================
+void FSPackedIntArray::Build(const std::vector<int>& v)
+{
+	Clear();
+	size_t n = v.size();
+	if (n == 0) return;
+
+	m_a = v[0];
+	m_b = (n > 1 ? v[1] - v[0] : 0);
+	for (size_t i = 0; i < n; ++i)
+	{
+		if ((long long)v[i] != (long long)m_a + (long long)m_b * (long long)i)
+		{
+			m_v = v;
+			return;
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+void FSPackedIntArray::Clear()
+{
+	m_a = m_b = 0;
+	std::vector<int>().swap(m_v);
+}
+
+//=============================================================================
+void FSMeshItemStore::ItemData::Build(const std::vector<int>& nid_, const std::vector<int>& gid_, const std::vector<int>& tag_, const std::vector<int>& state_)
+{
+	nid.Build(nid_);
+	gid.Build(gid_);
+	tag.Build(tag_);
+	state.Build(state_);
+}
+
+//-----------------------------------------------------------------------------
+void FSMeshItemStore::ItemData::Restore(MeshItem& item, int i) const
+{
+	item.m_nid = nid[i];
+	item.m_gid = gid[i];
+	item.m_ntag = tag[i];
+	item.SetFEState((unsigned int)state[i]);
+}
+
+//-----------------------------------------------------------------------------
+void FSMeshItemStore::ItemData::Clear()
+{
+	nid.Clear();
+	gid.Clear();
+	tag.Clear();
+	state.Clear();
+}
+
+//-----------------------------------------------------------------------------
+size_t FSMeshItemStore::ItemData::MemoryUsage() const
+{
+	return nid.MemoryUsage() + gid.MemoryUsage() + tag.MemoryUsage() + state.MemoryUsage();
+}
+
+//-----------------------------------------------------------------------------
+// collect the mesh item data of a list of items
+template <class T> static void buildItemData(const std::vector<T>& items, std::vector<int> (&v)[4])
+{
+	size_t n = items.size();
+	for (int k = 0; k < 4; ++k) v[k].resize(n);
+	for (size_t i = 0; i < n; ++i)
+	{
+		const MeshItem& item = items[i];
+		v[0][i] = item.m_nid;
+		v[1][i] = item.m_gid;
+		v[2][i] = item.m_ntag;
+		v[3][i] = (int)item.GetFEState();
+	}
+}
+
+//=============================================================================
+FSMeshItemStore::FSMeshItemStore()
+{
+	m_nodes = m_edges = m_faces = 0;
+}
+
+//-----------------------------------------------------------------------------
+void FSMeshItemStore::Clear()
+{
+	m_nodes = m_edges = m_faces = 0;
+
+	std::vector<vec3d>().swap(m_r);
+	m_nodeData.Clear();
+
+	std::vector<unsigned char>().swap(m_etype);
+	std::vector<int>().swap(m_enode);
+	std::vector<int>().swap(m_eref);
+	m_eelem.Clear();
+	m_edgeData.Clear();
+
+	std::vector<unsigned char>().swap(m_ftype);
+	std::vector<int>().swap(m_fnode);
+	std::vector<int>().swap(m_fref);
+	std::vector<vec3f>().swap(m_fn);
+	std::vector<vec3f>().swap(m_nn);
+	std::vector<float>().swap(m_tex);
+	std::vector<float>().swap(m_texe);
+	m_sid.Clear();
+	for (int k = 0; k < 6; ++k) m_felem[k].Clear();
+	m_faceData.Clear();
+}
+
+//-----------------------------------------------------------------------------
+void FSMeshItemStore::Build(const std::vector<FSNode>& nodes, const std::vector<FSEdge>& edges, const std::vector<FSFace>& faces)
+{
+	Clear();
+	m_nodes = (int)nodes.size();
+	m_edges = (int)edges.size();
+	m_faces = (int)faces.size();
+
+	std::vector<int> v[4];
+
+	// nodes
+	m_r.resize(m_nodes);
+	for (int i = 0; i < m_nodes; ++i) m_r[i] = nodes[i].r;
+	buildItemData(nodes, v);
+	m_nodeData.Build(v[0], v[1], v[2], v[3]);
+
+	// edges
+	int nn = 0;
+	for (const FSEdge& e : edges) nn += edgeNodes[e.m_type];
+	m_etype.resize(m_edges);
+	m_enode.reserve(nn);
+	m_eref.reserve(4 * m_edges);
+	v[0].resize(m_edges);
+	for (int i = 0; i < m_edges; ++i)
+	{
+		const FSEdge& e = edges[i];
+		m_etype[i] = (unsigned char)e.m_type;
+		for (int j = 0; j < edgeNodes[e.m_type]; ++j) m_enode.push_back(e.n[j]);
+		m_eref.push_back(e.m_nbr[0]); m_eref.push_back(e.m_nbr[1]);
+		m_eref.push_back(e.m_face[0]); m_eref.push_back(e.m_face[1]);
+		v[0][i] = e.m_elem;
+	}
+	m_eelem.Build(v[0]);
+	buildItemData(edges, v);
+	m_edgeData.Build(v[0], v[1], v[2], v[3]);
+
+	// faces
+	int ne = 0; nn = 0;
+	bool btex = false, btexe = false;
+	for (const FSFace& f : faces)
+	{
+		int nf = faceNodes[f.m_type];
+		nn += nf;
+		ne += faceEdges[f.m_type];
+		for (int j = 0; j < nf; ++j) if (f.m_tex[j] != 0.f) btex = true;
+		if (f.m_texe != 0.f) btexe = true;
+	}
+	m_ftype.resize(m_faces);
+	m_fnode.reserve(nn);
+	m_fref.reserve(2 * ne);
+	m_fn.resize(m_faces);
+	m_nn.reserve(nn);
+	if (btex) m_tex.reserve(nn);
+	if (btexe) m_texe.resize(m_faces);
+	for (int i = 0; i < m_faces; ++i)
+	{
+		const FSFace& f = faces[i];
+		m_ftype[i] = (unsigned char)f.m_type;
+		m_fn[i] = f.m_fn;
+		for (int j = 0; j < faceNodes[f.m_type]; ++j)
+		{
+			m_fnode.push_back(f.n[j]);
+			m_nn.push_back(f.m_nn[j]);
+			if (btex) m_tex.push_back(f.m_tex[j]);
+		}
+		for (int j = 0; j < faceEdges[f.m_type]; ++j)
+		{
+			m_fref.push_back(f.m_nbr[j]);
+			m_fref.push_back(f.m_edge[j]);
+		}
+		if (btexe) m_texe[i] = f.m_texe;
+	}
+
+	v[0].resize(m_faces);
+	for (int i = 0; i < m_faces; ++i) v[0][i] = faces[i].m_sid;
+	m_sid.Build(v[0]);
+	for (int k = 0; k < 3; ++k)
+	{
+		for (int i = 0; i < m_faces; ++i) v[0][i] = faces[i].m_elem[k].eid;
+		m_felem[2 * k].Build(v[0]);
+		for (int i = 0; i < m_faces; ++i) v[0][i] = faces[i].m_elem[k].lid;
+		m_felem[2 * k + 1].Build(v[0]);
+	}
+	buildItemData(faces, v);
+	m_faceData.Build(v[0], v[1], v[2], v[3]);
+}
+
+//-----------------------------------------------------------------------------
+void FSMeshItemStore::Restore(std::vector<FSNode>& nodes, std::vector<FSEdge>& edges, std::vector<FSFace>& faces) const
+{
+	// nodes
+	nodes.assign(m_nodes, FSNode());
+	for (int i = 0; i < m_nodes; ++i)
+	{
+		FSNode& node = nodes[i];
+		node.r = m_r[i];
+		m_nodeData.Restore(node, i);
+	}
+
+	// edges
+	edges.assign(m_edges, FSEdge());
+	const int* en = m_enode.data();
+	const int* er = m_eref.data();
+	for (int i = 0; i < m_edges; ++i, er += 4)
+	{
+		FSEdge& e = edges[i];
+		e.m_type = m_etype[i];
+		for (int j = 0; j < edgeNodes[e.m_type]; ++j) e.n[j] = *en++;
+		e.m_nbr[0] = er[0]; e.m_nbr[1] = er[1];
+		e.m_face[0] = er[2]; e.m_face[1] = er[3];
+		e.m_elem = m_eelem[i];
+		m_edgeData.Restore(e, i);
+	}
+
+	// faces
+	faces.assign(m_faces, FSFace());
+	const int* fn = m_fnode.data();
+	const int* fr = m_fref.data();
+	const vec3f* nn = m_nn.data();
+	const float* tex = m_tex.data();
+	for (int i = 0; i < m_faces; ++i)
+	{
+		FSFace& f = faces[i];
+		f.m_type = m_ftype[i];
+		f.m_fn = m_fn[i];
+		for (int j = 0; j < faceNodes[f.m_type]; ++j)
+		{
+			f.n[j] = *fn++;
+			f.m_nn[j] = *nn++;
+			f.m_tex[j] = (tex ? *tex++ : 0.f);
+		}
+		for (int j = 0; j < faceEdges[f.m_type]; ++j)
+		{
+			f.m_nbr[j] = *fr++;
+			f.m_edge[j] = *fr++;
+		}
+		f.m_texe = (m_texe.empty() ? 0.f : m_texe[i]);
+		f.m_sid = m_sid[i];
+		for (int k = 0; k < 3; ++k)
+		{
+			f.m_elem[k].eid = m_felem[2 * k][i];
+			f.m_elem[k].lid = m_felem[2 * k + 1][i];
+		}
+		m_faceData.Restore(f, i);
+	}
+}
+
+//-----------------------------------------------------------------------------
+size_t FSMeshItemStore::MemoryUsage() const
+{
+	size_t mem = 0;
+	mem += m_r.capacity() * sizeof(vec3d) + m_nodeData.MemoryUsage();
+	mem += m_etype.capacity() + (m_enode.capacity() + m_eref.capacity()) * sizeof(int);
+	mem += m_eelem.MemoryUsage() + m_edgeData.MemoryUsage();
+	mem += m_ftype.capacity() + (m_fnode.capacity() + m_fref.capacity()) * sizeof(int);
+	mem += (m_fn.capacity() + m_nn.capacity()) * sizeof(vec3f);
+	mem += (m_tex.capacity() + m_texe.capacity()) * sizeof(float);
+	mem += m_sid.MemoryUsage() + m_faceData.MemoryUsage();
+	for (int k = 0; k < 6; ++k) mem += m_felem[k].MemoryUsage();
+	return mem;
+}
@@ -0,0 +1,119 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+#pragma once
+#include "FENode.h"
+#include "FEEdge.h"
+#include "FEFace.h"
+#include <vector>
+
+//-----------------------------------------------------------------------------
+// Integer array that is stored as a linear function of the index (a + b*i)
+// when possible, and as a plain array otherwise. Most item IDs, tags and
+// state flags of a mesh are constant or sequential, so they need no storage.
+class FSPackedIntArray
+{
+public:
+	FSPackedIntArray() : m_a(0), m_b(0) {}
+
+	void Build(const std::vector<int>& v);
+
+	int operator [] (size_t i) const { return (m_v.empty() ? m_a + m_b * (int)i : m_v[i]); }
+
+	void Clear();
+
+	size_t MemoryUsage() const { return m_v.capacity() * sizeof(int); }
+
+private:
+	int					m_a, m_b;
+	std::vector<int>	m_v;	// empty if the values are linear
+};
+
+//-----------------------------------------------------------------------------
+// Compact storage for the nodes, edges, and faces of a mesh.
+// The node and normal lists are stored back to back, since the items are only
+// restored in order. Data that is derived from the item type (e.g. number of
+// nodes) is not stored, and the texture coordinates are only stored when they
+// are used. A linear triangle needs about 110 bytes in this store, compared to
+// the 300 bytes of an FSFace.
+class FSMeshItemStore
+{
+public:
+	FSMeshItemStore();
+
+	void Clear();
+
+	// copy the items into the store
+	void Build(const std::vector<FSNode>& nodes, const std::vector<FSEdge>& edges, const std::vector<FSFace>& faces);
+
+	// recreate the items from the store
+	void Restore(std::vector<FSNode>& nodes, std::vector<FSEdge>& edges, std::vector<FSFace>& faces) const;
+
+	int Nodes() const { return m_nodes; }
+	int Edges() const { return m_edges; }
+	int Faces() const { return m_faces; }
+
+	// approximate memory used by the store (in bytes)
+	size_t MemoryUsage() const;
+
+private:
+	// the mesh item data
+	struct ItemData
+	{
+		FSPackedIntArray	nid, gid, tag, state;
+
+		void Build(const std::vector<int>& nid, const std::vector<int>& gid, const std::vector<int>& tag, const std::vector<int>& state);
+		void Restore(MeshItem& item, int i) const;
+		void Clear();
+		size_t MemoryUsage() const;
+	};
+
+private:
+	int	m_nodes, m_edges, m_faces;
+
+	// nodes
+	std::vector<vec3d>	m_r;
+	ItemData			m_nodeData;
+
+	// edges
+	std::vector<unsigned char>	m_etype;
+	std::vector<int>			m_enode;	// edge nodes
+	std::vector<int>			m_eref;		// neighbors and faces (4 per edge)
+	FSPackedIntArray			m_eelem;
+	ItemData					m_edgeData;
+
+	// faces
+	std::vector<unsigned char>	m_ftype;
+	std::vector<int>			m_fnode;	// face nodes
+	std::vector<int>			m_fref;		// neighbors and edges (2 per face edge)
+	std::vector<vec3f>			m_fn;		// face normals
+	std::vector<vec3f>			m_nn;		// node normals
+	std::vector<float>			m_tex;		// nodal texture coordinates (empty if all zero)
+	std::vector<float>			m_texe;		// face texture coordinates (empty if all zero)
+	FSPackedIntArray			m_sid;
+	FSPackedIntArray			m_felem[6];	// element references (eid and lid)
+	ItemData					m_faceData;
+};
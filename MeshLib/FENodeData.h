@@ -52,6 +52,9 @@ public:
 	// get the item list
 	FEItemListBuilder* GetItemList();
 
+public:
+	size_t MemoryUsage() const override { return m_data.capacity() * sizeof(double); }
+
 public:
 	void Save(OArchive& ar);
 	void Load(IArchive& ar);
@@ -25,10 +25,12 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.*/
 
 #include "FENodeElementList.h"
+#include <algorithm>
 
 FSNodeElementList::FSNodeElementList()
 {
 	m_pm = nullptr;
+	m_NE = 0;
 }
 
 FSNodeElementList::~FSNodeElementList()
@@ -39,41 +41,74 @@ void FSNodeElementList::Build(FSCoreMesh* pm)
 {
 	m_pm = pm;
 	assert(m_pm);
-	m_elem.clear();
+	Clear();
 
 	int NN = m_pm->Nodes();
 	int NE = m_pm->Elements();
 	if ((NE == 0) || (NN == 0)) return;
+	m_NE = NE;
 
-	m_elem.resize(NN);
+	// count the valences
+	std::vector<int> val(NN, 0);
+#pragma omp parallel for
 	for (int i=0; i<NE; ++i)
 	{
 		FEElement_& el = m_pm->ElementRef(i);
 		int ne = el.Nodes();
-		for (int j=0; j<ne; ++j) 
+		for (int j=0; j<ne; ++j)
 		{
-			int n = el.m_node[j];
-
-			std::vector<NodeElemRef>& lj = m_elem[n];
+#pragma omp atomic
+			val[el.m_node[j]]++;
+		}
+	}
 
-			NodeElemRef ref;
-			ref.eid = i;
-			ref.nid = j;
-			ref.pe = &el;
+	// set up the offsets
+	m_off.resize(NN + 1);
+	m_off[0] = 0;
+	for (int i=0; i<NN; ++i) m_off[i + 1] = m_off[i] + val[i];
+	m_ref.resize(m_off[NN]);
 
-			lj.push_back(ref);
+	// fill the lists
+	// (we reuse the valence array as the insertion point)
+	for (int i=0; i<NN; ++i) val[i] = m_off[i];
+#pragma omp parallel for
+	for (int i=0; i<NE; ++i)
+	{
+		FEElement_& el = m_pm->ElementRef(i);
+		int ne = el.Nodes();
+		for (int j=0; j<ne; ++j)
+		{
+			int n = el.m_node[j];
+			int k;
+#pragma omp atomic capture
+			k = val[n]++;
+			m_ref[k].eid = i;
+			m_ref[k].nid = j;
 		}
 	}
+
+	// The fill order depends on the thread scheduling, so we sort each list
+	// to get the same order as a serial build.
+#pragma omp parallel for schedule(dynamic, 1024)
+	for (int i=0; i<NN; ++i)
+	{
+		std::sort(m_ref.begin() + m_off[i], m_ref.begin() + m_off[i + 1], [](const NodeElemRef& a, const NodeElemRef& b) {
+			return (a.eid < b.eid) || ((a.eid == b.eid) && (a.nid < b.nid));
+		});
+	}
 }
 
 void FSNodeElementList::Clear()
 {
-	m_elem.clear();
+	// swap with empty arrays so that the memory is released
+	std::vector<int>().swap(m_off);
+	std::vector<NodeElemRef>().swap(m_ref);
+	m_NE = 0;
 }
 
 bool FSNodeElementList::IsEmpty() const
 {
-	return m_elem.empty();
+	return m_off.empty();
 }
 
 bool FSNodeElementList::HasElement(int node, int iel) const
@@ -87,11 +122,8 @@ bool FSNodeElementList::HasElement(int node, int iel) const
 
 std::vector<int> FSNodeElementList::ElementIndexList(int n) const
 {
-	std::vector<int> l;
 	int nval = Valence(n);
-	for (int i=0; i<nval; ++i)
-	{
-		l.push_back(ElementIndex(n, i));
-	}
+	std::vector<int> l(nval);
+	for (int i=0; i<nval; ++i) l[i] = ElementIndex(n, i);
 	return l;
 }
@@ -33,9 +33,32 @@ SOFTWARE.*/
 struct NodeElemRef {
 	int		eid;	// element index in mesh
 	int		nid;	// local node index of the element
-	FEElement_*	pe;	// pointer to element
 };
 
+//-----------------------------------------------------------------------------
+// A (read-only) view of the elements that share a node
+class NodeElemRange
+{
+public:
+	NodeElemRange(const NodeElemRef* p, int n) : m_p(p), m_n(n) {}
+
+	int size() const { return m_n; }
+	bool empty() const { return (m_n == 0); }
+
+	const NodeElemRef& operator [] (int i) const { return m_p[i]; }
+
+	const NodeElemRef* begin() const { return m_p; }
+	const NodeElemRef* end() const { return m_p + m_n; }
+
+private:
+	const NodeElemRef*	m_p;
+	int					m_n;
+};
+
+//-----------------------------------------------------------------------------
+// This class stores for each node the list of elements that contain it.
+// The lists are stored in compressed row format: the elements of node n are 
+// m_ref[m_off[n]] to m_ref[m_off[n+1]-1], sorted by element index.
 class FSNodeElementList
 {
 public:
@@ -48,16 +71,26 @@ public:
 
 	bool IsEmpty() const;
 
-	int Valence(int n) const { return (int)m_elem[n].size(); }
-	FEElement_* Element(int n, int j) { return m_elem[n][j].pe; }
-	int ElementIndex(int n, int j) const { return m_elem[n][j].eid; }
+	int Valence(int n) const { return m_off[n + 1] - m_off[n]; }
+	FEElement_* Element(int n, int j) const { return &m_pm->ElementRef(m_ref[m_off[n] + j].eid); }
+	int ElementIndex(int n, int j) const { return m_ref[m_off[n] + j].eid; }
 
 	bool HasElement(int node, int iel) const;
 
 	std::vector<int> ElementIndexList(int n) const;
-	const std::vector<NodeElemRef>& ElementList(int n) const { return m_elem[n]; }
+	NodeElemRange ElementList(int n) const { return NodeElemRange(m_ref.data() + m_off[n], Valence(n)); }
+
+	// the mesh and mesh size this list was built for
+	const FSCoreMesh* GetMesh() const { return m_pm; }
+	int Nodes() const { return (m_off.empty() ? 0 : (int)m_off.size() - 1); }
+	int Elements() const { return m_NE; }
+
+	// approximate memory used by the list (in bytes)
+	size_t MemoryUsage() const { return m_off.capacity() * sizeof(int) + m_ref.capacity() * sizeof(NodeElemRef); }
 
 protected:
 	FSCoreMesh*	m_pm;
-	std::vector< std::vector<NodeElemRef> >	m_elem;
+	int			m_NE;
+	std::vector<int>			m_off;	// offsets into m_ref (size = nodes + 1)
+	std::vector<NodeElemRef>	m_ref;	// node-element references
 };
@@ -44,7 +44,7 @@ FSNodeFaceList::~FSNodeFaceList(void)
 //-----------------------------------------------------------------------------
 void FSNodeFaceList::Clear()
 {
-	m_face.clear();
+	std::vector< std::vector<NodeFaceRef> >().swap(m_face);
 }
 
 //-----------------------------------------------------------------------------
@@ -53,6 +53,14 @@ bool FSNodeFaceList::IsEmpty() const
 	return m_face.empty();
 }
 
+//-----------------------------------------------------------------------------
+size_t FSNodeFaceList::MemoryUsage() const
+{
+	size_t mem = m_face.capacity() * sizeof(std::vector<NodeFaceRef>);
+	for (const std::vector<NodeFaceRef>& l : m_face) mem += l.capacity() * sizeof(NodeFaceRef);
+	return mem;
+}
+
 //-----------------------------------------------------------------------------
 // Builds a sorted node-facet list. That is, the facets form a star around the node.
 // Note that for non-manifold topologies this may fail, so make sure to check the return value.
@@ -25,6 +25,7 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.*/
 #pragma once
 #include <vector>
+#include <cstddef>
 
 class FSFace;
 class FSMeshBase;
@@ -60,6 +61,9 @@ public:
 
 	const std::vector<NodeFaceRef>& FaceList(int n) const;
 
+	// approximate memory used by the list (in bytes)
+	size_t MemoryUsage() const;
+
 protected:
 	bool Sort(int node);
 
@@ -49,8 +49,7 @@ void FSNodeNodeList::Build(FSMesh* pm, bool preservePartitions)
 	assert(pm);
 	if (pm == 0) return;
 
-	FSNodeElementList NEL;
-	NEL.Build(pm);
+	const FSNodeElementList& NEL = pm->NodeElementList();
 
 	int NN = pm->Nodes();
 	std::vector<int> tag; tag.assign(NN, -1);
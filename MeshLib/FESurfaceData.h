@@ -44,6 +44,9 @@ public:
 
 	FSSurface* getSurface() {return m_surface;}
 
+public:
+	size_t MemoryUsage() const override { return m_data.capacity() * sizeof(double); }
+
 public:
 	void Save(OArchive& ar);
 	void Load(IArchive& ar);
@@ -164,64 +164,69 @@ bool IntersectQuad(const Ray& ray, const Quad& quad, Intersection& intersect)
 }
 
 //-----------------------------------------------------------------------------
-bool FindFaceIntersection(const Ray& ray, const FSMeshBase& mesh, Intersection& q)
+// intersect a mesh face with a ray
+static bool IntersectFace(const Ray& ray, const FSMeshBase& mesh, const FSFace& face, Intersection& q)
 {
-	vec3d rn[10];
+	vec3d rn[FSFace::MAX_NODES];
+	mesh.FaceNodeLocalPositions(face, rn);
 
-	int faces = mesh.Faces();
-	vec3d r, rmin;
-	double gmin = 1e99;
-	bool b = false;
+	bool bfound = false;
+	switch (face.Type())
+	{
+	case FE_FACE_TRI3:
+	case FE_FACE_TRI6:
+	case FE_FACE_TRI7:
+	case FE_FACE_TRI10:
+	{
+		Triangle tri = {rn[0], rn[1], rn[2]};
+		bfound = IntersectTriangle(ray, tri, q);
+	}
+	break;
+	case FE_FACE_QUAD4:
+	case FE_FACE_QUAD8:
+	case FE_FACE_QUAD9:
+	{
+		Quad quad = { rn[0], rn[1], rn[2], rn[3] };
+		bfound = FastIntersectQuad(ray, quad, q);
+	}
+	break;
+	}
+	return bfound;
+}
 
+//-----------------------------------------------------------------------------
+bool FindFaceIntersection(const Ray& ray0, const FSMeshBase& mesh, Intersection& q)
+{
+	bool b = false;
 	q.m_index = -1;
-	Intersection tmp;
-	for (int i=0; i<faces; ++i)
-	{
+
+	// the distances must be measured with a unit direction to prune the search
+	Ray ray = ray0;
+	ray.direction.Normalize();
+
+	// only faces whose boxes are hit by the ray need to be checked
+	const FSMeshBVH& bvh = mesh.FaceBVH();
+	bvh.Intersect(ray.origin, ray.direction, 1e99, [&](int i, double& gmin) {
 		const FSFace& face = mesh.Face(i);
-		if (face.IsVisible())
-		{
-			mesh.FaceNodeLocalPositions(face, rn);
+		if (face.IsVisible() == false) return;
 
-			bool bfound = false;
-			switch (face.Type())
-			{
-			case FE_FACE_TRI3:
-			case FE_FACE_TRI6:
-			case FE_FACE_TRI7:
-			case FE_FACE_TRI10:
-			{
-				Triangle tri = {rn[0], rn[1], rn[2]};
-				bfound = IntersectTriangle(ray, tri, tmp);
-			}
-			break;
-			case FE_FACE_QUAD4:
-			case FE_FACE_QUAD8:
-			case FE_FACE_QUAD9:
-			{
-				Quad quad = { rn[0], rn[1], rn[2], rn[3] };
-				bfound = FastIntersectQuad(ray, quad, tmp);
-			}
-			break;
-			}
+		Intersection tmp;
+		if (IntersectFace(ray, mesh, face, tmp))
+		{
+			// signed distance
+			double distance = ray.direction*(tmp.point - ray.origin);
 
-			if (bfound)
+			if ((distance > 0.0) && (distance < gmin))
 			{
-				// signed distance
-				float distance = ray.direction*(tmp.point - ray.origin);
-
-				if ((distance > 0.f) && (distance < gmin))
-				{
-					gmin = distance;
-					rmin = q.point;
-					b = true;
-					q.m_index = i;
-					q.point = tmp.point;
-					q.r[0] = tmp.r[0];
-					q.r[1] = tmp.r[1];
-				}
+				gmin = distance;
+				b = true;
+				q.m_index = i;
+				q.point = tmp.point;
+				q.r[0] = tmp.r[0];
+				q.r[1] = tmp.r[1];
 			}
 		}
-	}
+	});
 
 	return b;
 }
@@ -271,121 +276,111 @@ bool FindFaceIntersection(const Ray& ray, const GLMesh& mesh, Intersection& q)
 }
 
 //-----------------------------------------------------------------------------
-bool FindElementIntersection(const Ray& ray, const FSMesh& mesh, Intersection& q, bool selectionState)
+// Intersect the faces of element i with the ray. q is updated if a hit is found
+// that is closer than gmin.
+static bool IntersectElement(const Ray& ray, const FSMesh& mesh, int i, Intersection& q, double& gmin)
 {
 	vec3d rn[10];
-
-	int elems = mesh.Elements();
-	vec3d r, rmin;
-	float gmin = 1e30f;
 	bool b = false;
 
 	FSFace face;
-	q.m_index = -1;
 	Intersection tmp;
-	for (int i = 0; i<elems; ++i)
+	const FSElement& elem = mesh.Element(i);
+
+	// solid elements
+	int NF = elem.Faces();
+	for (int j = 0; j<NF; ++j)
 	{
-		const FSElement& elem = mesh.Element(i);
-		if (elem.IsVisible() && (elem.IsSelected() == selectionState))
+		bool bfound = false;
+		face = elem.GetFace(j);
+		switch (face.Type())
+		{
+		case FE_FACE_QUAD4:
+		case FE_FACE_QUAD8:
+		case FE_FACE_QUAD9:
+		{
+			rn[0] = mesh.Node(face.n[0]).r;
+			rn[1] = mesh.Node(face.n[1]).r;
+			rn[2] = mesh.Node(face.n[2]).r;
+			rn[3] = mesh.Node(face.n[3]).r;
+
+			Quad quad = { rn[0], rn[1], rn[2], rn[3] };
+			bfound = FastIntersectQuad(ray, quad, tmp);
+		}
+		break;
+		case FE_FACE_TRI3:
+		case FE_FACE_TRI6:
+		case FE_FACE_TRI7:
+		case FE_FACE_TRI10:
+		{
+			rn[0] = mesh.Node(face.n[0]).r;
+			rn[1] = mesh.Node(face.n[1]).r;
+			rn[2] = mesh.Node(face.n[2]).r;
+
+			Triangle tri = { rn[0], rn[1], rn[2] };
+			bfound = IntersectTriangle(ray, tri, tmp);
+		}
+		break;
+		default:
+			assert(false);
+		}
+
+		if (bfound)
 		{
-			// solid elements
-			int NF = elem.Faces();
-			for (int j = 0; j<NF; ++j)
+			// signed distance
+			double distance = ray.direction*(tmp.point - ray.origin);
+
+			if ((distance > 0.0) && (distance < gmin))
 			{
-				bool bfound = false;
-				face = elem.GetFace(j);
-				switch (face.Type())
-				{
-				case FE_FACE_QUAD4:
-				case FE_FACE_QUAD8:
-				case FE_FACE_QUAD9:
-				{
-					rn[0] = mesh.Node(face.n[0]).r;
-					rn[1] = mesh.Node(face.n[1]).r;
-					rn[2] = mesh.Node(face.n[2]).r;
-					rn[3] = mesh.Node(face.n[3]).r;
-
-					Quad quad = { rn[0], rn[1], rn[2], rn[3] };
-					bfound = FastIntersectQuad(ray, quad, tmp);
-				}
-				break;
-				case FE_FACE_TRI3:
-				case FE_FACE_TRI6:
-				case FE_FACE_TRI7:
-				case FE_FACE_TRI10:
-				{
-					rn[0] = mesh.Node(face.n[0]).r;
-					rn[1] = mesh.Node(face.n[1]).r;
-					rn[2] = mesh.Node(face.n[2]).r;
-
-					Triangle tri = { rn[0], rn[1], rn[2] };
-					bfound = IntersectTriangle(ray, tri, tmp);
-				}
-				break;
-				default:
-					assert(false);
-				}
-
-				if (bfound)
-				{
-					// signed distance
-					float distance = ray.direction*(tmp.point - ray.origin);
-
-					if ((distance > 0.f) && (distance < gmin))
-					{
-						gmin = distance;
-						rmin = q.point;
-						b = true;
-						q.m_index = i;
-						q.m_faceIndex = elem.m_face[j];
-						q.point = tmp.point;
-						q.r[0] = tmp.r[0];
-						q.r[1] = tmp.r[1];
-					}
-				}
+				gmin = distance;
+				b = true;
+				q.m_index = i;
+				q.m_faceIndex = elem.m_face[j];
+				q.point = tmp.point;
+				q.r[0] = tmp.r[0];
+				q.r[1] = tmp.r[1];
 			}
+		}
+	}
+
+	// shell elements
+	int NE = elem.Edges();
+	if (NE > 0)
+	{
+		bool bfound = false;
+		if (elem.Nodes() == 4)
+		{
+			rn[0] = mesh.Node(elem.m_node[0]).r;
+			rn[1] = mesh.Node(elem.m_node[1]).r;
+			rn[2] = mesh.Node(elem.m_node[2]).r;
+			rn[3] = mesh.Node(elem.m_node[3]).r;
+
+			Quad quad = { rn[0], rn[1], rn[2], rn[3] };
+			bfound = IntersectQuad(ray, quad, tmp);
+		}
+		else
+		{
+			rn[0] = mesh.Node(elem.m_node[0]).r;
+			rn[1] = mesh.Node(elem.m_node[1]).r;
+			rn[2] = mesh.Node(elem.m_node[2]).r;
+
+			Triangle tri = { rn[0], rn[1], rn[2] };
+			bfound = IntersectTriangle(ray, tri, tmp);
+		}
+
+		if (bfound)
+		{
+			// signed distance
+			double distance = ray.direction*(tmp.point - ray.origin);
 
-			// shell elements
-			int NE = elem.Edges();
-			if (NE > 0)
+			if ((distance > 0.0) && (distance <= gmin))
 			{
-				bool bfound = false;
-				if (elem.Nodes() == 4)
-				{
-					rn[0] = mesh.Node(elem.m_node[0]).r;
-					rn[1] = mesh.Node(elem.m_node[1]).r;
-					rn[2] = mesh.Node(elem.m_node[2]).r;
-					rn[3] = mesh.Node(elem.m_node[3]).r;
-
-					Quad quad = { rn[0], rn[1], rn[2], rn[3] };
-					bfound = IntersectQuad(ray, quad, tmp);
-				}
-				else
-				{
-					rn[0] = mesh.Node(elem.m_node[0]).r;
-					rn[1] = mesh.Node(elem.m_node[1]).r;
-					rn[2] = mesh.Node(elem.m_node[2]).r;
-
-					Triangle tri = { rn[0], rn[1], rn[2] };
-					bfound = IntersectTriangle(ray, tri, tmp);
-				}
-
-				if (bfound)
-				{
-					// signed distance
-					float distance = ray.direction*(tmp.point - ray.origin);
-
-					if ((distance > 0.f) && (distance <= gmin))
-					{
-						gmin = distance;
-						rmin = q.point;
-						b = true;
-						q.m_index = i;
-						q.point = tmp.point;
-						q.r[0] = tmp.r[0];
-						q.r[1] = tmp.r[1];
-					}
-				}
+				gmin = distance;
+				b = true;
+				q.m_index = i;
+				q.point = tmp.point;
+				q.r[0] = tmp.r[0];
+				q.r[1] = tmp.r[1];
 			}
 		}
 	}
@@ -393,6 +388,29 @@ bool FindElementIntersection(const Ray& ray, const FSMesh& mesh, Intersection& q
 	return b;
 }
 
+//-----------------------------------------------------------------------------
+bool FindElementIntersection(const Ray& ray0, const FSMesh& mesh, Intersection& q, bool selectionState)
+{
+	bool b = false;
+	q.m_index = -1;
+
+	// the distances must be measured with a unit direction to prune the search
+	Ray ray = ray0;
+	ray.direction.Normalize();
+
+	// only elements whose boxes are hit by the ray need to be checked
+	const FSMeshBVH& bvh = mesh.ElementBVH();
+	bvh.Intersect(ray.origin, ray.direction, 1e30, [&](int i, double& gmin) {
+		const FSElement& elem = mesh.Element(i);
+		if (elem.IsVisible() && (elem.IsSelected() == selectionState))
+		{
+			if (IntersectElement(ray, mesh, i, q, gmin)) b = true;
+		}
+	});
+
+	return b;
+}
+
 //-----------------------------------------------------------------------------
 bool FindFaceIntersection(const Ray& ray, const FSMeshBase& mesh, const FSFace& face, Intersection& q)
 {
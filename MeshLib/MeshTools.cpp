@@ -491,6 +491,34 @@ bool projectToLine(const vec3d& p, const vec3d& r0, const vec3d& r1, vec3d& q)
 	else return false;
 }
 
+// This checks the Voronoi regions of the vertices and edges before projecting to the interior.
+vec3d closestPointOnTriangle(const vec3d& p, const vec3d& a, const vec3d& b, const vec3d& c)
+{
+	vec3d ab = b - a, ac = c - a, ap = p - a;
+	double d1 = ab*ap, d2 = ac*ap;
+	if ((d1 <= 0.0) && (d2 <= 0.0)) return a;
+
+	vec3d bp = p - b;
+	double d3 = ab*bp, d4 = ac*bp;
+	if ((d3 >= 0.0) && (d4 <= d3)) return b;
+
+	double vc = d1*d4 - d3*d2;
+	if ((vc <= 0.0) && (d1 >= 0.0) && (d3 <= 0.0)) return a + ab*(d1 / (d1 - d3));
+
+	vec3d cp = p - c;
+	double d5 = ab*cp, d6 = ac*cp;
+	if ((d6 >= 0.0) && (d5 <= d6)) return c;
+
+	double vb = d5*d2 - d1*d6;
+	if ((vb <= 0.0) && (d2 >= 0.0) && (d6 <= 0.0)) return a + ac*(d2 / (d2 - d6));
+
+	double va = d3*d6 - d5*d4;
+	if ((va <= 0.0) && ((d4 - d3) >= 0.0) && ((d5 - d6) >= 0.0)) return b + (c - b)*((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+
+	double den = 1.0 / (va + vb + vc);
+	return a + ab*(vb*den) + ac*(vc*den);
+}
+
 bool projectToTriangle(const vec3d& p, const vec3d& r0, const vec3d& r1, const vec3d& r2, vec3d& q)
 {
 	vec3d e1 = r1 - r0;
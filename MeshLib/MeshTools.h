@@ -74,6 +74,9 @@ bool projectToTriangle(const vec3d& p, const vec3d& r0, const vec3d& r1, const v
 // project to a quad
 bool projectToQuad(const vec3d& p, const vec3d y[4], vec3d& q);
 
+// closest point on a triangle (including its edges and vertices)
+vec3d closestPointOnTriangle(const vec3d& p, const vec3d& a, const vec3d& b, const vec3d& c);
+
 bool FindIntersection(FSMeshBase& mesh, const vec3d& x, const vec3d& n, vec3d& q, bool snap = false);
 bool FindIntersection(FSMeshBase& mesh, FSFace& f, const vec3d& x, const vec3d& n, vec3d& q, double& g);
 
@@ -26,9 +26,11 @@ SOFTWARE.*/
 
 #include "stdafx.h"
 #include "ICPRegistration.h"
+#include "KdTree.h"
 #include <GeomLib/GObject.h>
 #include <MeshLib/FEMesh.h>
 #include <FECore/matrix.h>
+#include <algorithm>
 using namespace std;
 
 vec3d CenterOfMass(const vector<vec3d>& S)
@@ -96,6 +98,9 @@ GICPRegistration::GICPRegistration()
 {
 	m_maxiter = 100;
 	m_tol = 0.001;
+	m_maxPoints = 0;
+	m_trim = 1.0;
+	m_maxDist = 0.0;
 
 	m_iters = 0;
 	m_err = 0.0;
@@ -127,7 +132,21 @@ Transform GICPRegistration::Register(GObject* ptrg, GObject* psrc)
 
 Transform GICPRegistration::Register(const vector<vec3d>& X, const vector<vec3d>& S)
 {
-	vector<vec3d> P = S;
+	m_iters = 0;
+	m_err = 0.0;
+
+	// there is nothing to register without points
+	if (X.empty() || S.empty()) return Transform();
+
+	// subsample the source points if requested
+	vector<vec3d> P;
+	int NS = (int)S.size();
+	if ((m_maxPoints > 0) && (NS > m_maxPoints))
+	{
+		P.resize(m_maxPoints);
+		for (int i = 0; i < m_maxPoints; ++i) P[i] = S[(int)((double)i * NS / m_maxPoints)];
+	}
+	else P = S;
 
 	int NX = (int)X.size();
 	int NP = (int)P.size();
@@ -163,9 +182,17 @@ Transform GICPRegistration::Register(const vector<vec3d>& X, const vector<vec3d>
 	for (int i=1; i<NP; ++i) box += P[i];
 	double R = box.Radius();
 
-	// reserve space for the Y-vector
-	// (stores the closest points in X to P)
-	vector<vec3d> Y(NP);
+	// the target points don't move, so we only need to build this once
+	KdTree tree;
+	tree.Build(X);
+
+	// closest point in X (and squared distance) of each point in P
+	vector<int> Y(NP);
+	vector<double> D2(NP);
+
+	// the point pairs that are used
+	vector<int> pairs;
+	vector<vec3d> Ps, Ys;
 
 	m_iters = 0;
 	m_err = 0.0;
@@ -176,10 +203,21 @@ Transform GICPRegistration::Register(const vector<vec3d>& X, const vector<vec3d>
 	for (m_iters = 1; m_iters < m_maxiter; m_iters++)
 	{
 		// Compute the closest point set Y
-		ClosestPointSet(X, P, Y);
+		ClosestPointSet(tree, P, Y, D2);
+
+		// reject outliers
+		int np = SelectPairs(D2, pairs);
+		if (np < 3) break;
+		Ps.resize(np);
+		Ys.resize(np);
+		for (int i = 0; i < np; ++i)
+		{
+			Ps[i] = P0[pairs[i]];
+			Ys[i] = X[Y[pairs[i]]];
+		}
 
 		// compute the registration
-		Q = Register(P0, Y, &m_err);
+		Q = Register(Ps, Ys, &m_err);
 
 		// apply the registration
 		ApplyTransform(P0, Q, P);
@@ -194,35 +232,53 @@ Transform GICPRegistration::Register(const vector<vec3d>& X, const vector<vec3d>
 	return Q;
 }
 
-void GICPRegistration::ClosestPointSet(const vector<vec3d>& X, const vector<vec3d>& P, vector<vec3d>& Y)
+void GICPRegistration::ClosestPointSet(const KdTree& X, const vector<vec3d>& P, vector<int>& Y, vector<double>& D2)
 {
-	// get the vector sizes
-	int NX = (int) X.size();
 	int NP = (int) P.size();
 
 	// make sure Y is the right size
 	// (must be same size as P)
 	Y.resize(NP);
+	D2.resize(NP);
+
+	// the tree cannot be empty, or the closest points would be -1
+	assert(X.Points() > 0);
 
-	// Find the closest node int X for each point in P
-	// and store in Y
+	// Find the closest node in X for each point in P
+	#pragma omp parallel for
 	for (int i = 0; i<NP; i++)
 	{
-		double min_dist = 1e99;
-		const vec3d& Pi = P[i];
-		for(int j = 0; j<NX; j++)
-		{
-			const vec3d& Xj = X[j];
-			double dist = (Pi - Xj).Length();
-			if (dist < min_dist)
-			{
-				min_dist = dist;
-				Y[i] = Xj;
-			}
-		}
+		Y[i] = X.FindNearest(P[i], &D2[i]);
 	}
 }
 
+// Select the point pairs that are used for the registration. Pairs that are too far
+// apart are rejected, and only the closest fraction m_trim of the rest is kept.
+int GICPRegistration::SelectPairs(const vector<double>& D2, vector<int>& pairs)
+{
+	int NP = (int)D2.size();
+	pairs.clear();
+	pairs.reserve(NP);
+
+	double dmax2 = m_maxDist * m_maxDist;
+	for (int i = 0; i < NP; ++i)
+	{
+		if ((m_maxDist <= 0.0) || (D2[i] <= dmax2)) pairs.push_back(i);
+	}
+
+	if ((m_trim > 0.0) && (m_trim < 1.0))
+	{
+		int n = (int)(m_trim * pairs.size());
+		if (n < 3) n = (pairs.size() < 3 ? (int)pairs.size() : 3);
+		std::nth_element(pairs.begin(), pairs.begin() + n, pairs.end(), [&](int a, int b) {
+			return D2[a] < D2[b];
+		});
+		pairs.resize(n);
+	}
+
+	return (int)pairs.size();
+}
+
 Transform GICPRegistration::Register(const vector<vec3d>& P, const vector<vec3d>& Y, double* perr)
 {
 	//Find center of mass
@@ -306,6 +362,7 @@ Transform GICPRegistration::Register(const vector<vec3d>& P, const vector<vec3d>
 	if (perr)
 	{
 		double& err = *perr;
+		err = 0.0;
 
 		const vec3d& t = T.GetPosition();
 		const quatd& q = T.GetRotation();
@@ -29,6 +29,7 @@ SOFTWARE.*/
 #include <vector>
 
 class GObject;
+class KdTree;
 
 
 class GICPRegistration
@@ -43,17 +44,30 @@ public:
 	void SetMaxIterations(int n) { m_maxiter = n; }
 	void SetTolerance(double tol) { m_tol = tol; }
 
+	// use at most this many source points (0 = use all)
+	void SetMaxPoints(int n) { m_maxPoints = n; }
+
+	// fraction of the closest point pairs that is used in each iteration (trimmed ICP)
+	void SetTrimFraction(double f) { m_trim = f; }
+
+	// ignore pairs that are further apart than this distance (0 = no limit)
+	void SetMaxDistance(double d) { m_maxDist = d; }
+
 	int Iterations() const { return m_iters; }
 	double RelativeError() const { return m_err; }
 
 private:
-	void ClosestPointSet(const std::vector<vec3d>& X, const std::vector<vec3d>& P, std::vector<vec3d>& Y);
+	void ClosestPointSet(const KdTree& X, const std::vector<vec3d>& P, std::vector<int>& Y, std::vector<double>& D2);
+	int SelectPairs(const std::vector<double>& D2, std::vector<int>& pairs);
 	Transform Register(const std::vector<vec3d>& P0, const std::vector<vec3d>& Y, double* err);
 	void ApplyTransform(const std::vector<vec3d>& P0, const Transform& Q, std::vector<vec3d>& P);
 
 private:
 	double	m_tol;
 	int		m_maxiter;
+	int		m_maxPoints;
+	double	m_trim;
+	double	m_maxDist;
 
 	int		m_iters;
 	double	m_err;
@@ -0,0 +1,134 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+#include "stdafx.h"
+#include "KdTree.h"
+#include <algorithm>
+
+// ranges smaller than this are searched linearly
+const int KDTREE_LEAF_SIZE = 8;
+
+static double coord(const vec3d& r, int axis)
+{
+	return (axis == 0 ? r.x : (axis == 1 ? r.y : r.z));
+}
+
+KdTree::KdTree()
+{
+}
+
+void KdTree::Clear()
+{
+	m_pt.clear();
+	m_id.clear();
+	m_axis.clear();
+}
+
+void KdTree::Build(const std::vector<vec3d>& pts)
+{
+	int N = (int)pts.size();
+	m_pt = pts;	// in original order while building
+	m_id.resize(N);
+	for (int i = 0; i < N; ++i) m_id[i] = i;
+	m_axis.assign(N, 0);
+	Build(0, N);
+
+	// store the points in tree order so the queries access memory sequentially
+	for (int i = 0; i < N; ++i) m_pt[i] = pts[m_id[i]];
+}
+
+// The node of the range [n0, n1) is stored at its midpoint, the children
+// in the ranges on either side.
+void KdTree::Build(int n0, int n1)
+{
+	if (n1 - n0 <= KDTREE_LEAF_SIZE) return;
+
+	// split along the largest extent
+	vec3d rmin = m_pt[m_id[n0]], rmax = rmin;
+	for (int i = n0 + 1; i < n1; ++i)
+	{
+		const vec3d& r = m_pt[m_id[i]];
+		if (r.x < rmin.x) rmin.x = r.x; if (r.x > rmax.x) rmax.x = r.x;
+		if (r.y < rmin.y) rmin.y = r.y; if (r.y > rmax.y) rmax.y = r.y;
+		if (r.z < rmin.z) rmin.z = r.z; if (r.z > rmax.z) rmax.z = r.z;
+	}
+	vec3d d = rmax - rmin;
+	int axis = 0;
+	if (d.y > d.x) axis = 1;
+	if (d.z > coord(d, axis)) axis = 2;
+
+	int nm = (n0 + n1) / 2;
+	std::nth_element(m_id.begin() + n0, m_id.begin() + nm, m_id.begin() + n1, [&](int a, int b) {
+		return coord(m_pt[a], axis) < coord(m_pt[b], axis);
+	});
+
+	m_axis[nm] = (char)axis;
+	Build(n0, nm);
+	Build(nm + 1, n1);
+}
+
+int KdTree::FindNearest(const vec3d& x, double* dist2) const
+{
+	if (m_pt.empty()) return -1;
+
+	int imin = -1;
+	double d2min = 1e99;
+	FindNearest(0, (int)m_pt.size(), x, imin, d2min);
+
+	if (dist2) *dist2 = d2min;
+	return m_id[imin];
+}
+
+void KdTree::FindNearest(int n0, int n1, const vec3d& x, int& imin, double& d2min) const
+{
+	if (n1 - n0 <= KDTREE_LEAF_SIZE)
+	{
+		for (int i = n0; i < n1; ++i)
+		{
+			double d2 = (m_pt[i] - x).SqrLength();
+			if (d2 < d2min) { d2min = d2; imin = i; }
+		}
+		return;
+	}
+
+	int nm = (n0 + n1) / 2;
+	double d2 = (m_pt[nm] - x).SqrLength();
+	if (d2 < d2min) { d2min = d2; imin = nm; }
+
+	// search the side that contains x first
+	int axis = m_axis[nm];
+	double dx = coord(x, axis) - coord(m_pt[nm], axis);
+	if (dx < 0)
+	{
+		FindNearest(n0, nm, x, imin, d2min);
+		if (dx * dx < d2min) FindNearest(nm + 1, n1, x, imin, d2min);
+	}
+	else
+	{
+		FindNearest(nm + 1, n1, x, imin, d2min);
+		if (dx * dx < d2min) FindNearest(n0, nm, x, imin, d2min);
+	}
+}
@@ -0,0 +1,58 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+#pragma once
+#include <FSCore/math3d.h>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+// A kd-tree for closest point queries on a static point set.
+// The queries don't modify the tree, so they can be done from several threads.
+class KdTree
+{
+public:
+	KdTree();
+
+	// build the tree for the points (the points are copied)
+	void Build(const std::vector<vec3d>& pts);
+
+	void Clear();
+
+	int Points() const { return (int)m_pt.size(); }
+
+	// Returns the index of the point closest to x, or -1 if the tree is empty.
+	// The squared distance is returned in dist2 when it's not null.
+	int FindNearest(const vec3d& x, double* dist2 = nullptr) const;
+
+private:
+	void Build(int n0, int n1);
+	void FindNearest(int n0, int n1, const vec3d& x, int& imin, double& d2min) const;
+
+private:
+	std::vector<vec3d>	m_pt;	// points, in tree order
+	std::vector<int>	m_id;	// original index of each point
+	std::vector<char>	m_axis;	// split axis of the node stored at each position
+};
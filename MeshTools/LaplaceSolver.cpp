@@ -160,9 +160,8 @@ bool LaplaceSolver::Solve(FSMesh* pm, vector<double>& val, vector<int>& bn, int
 	// create Node-Node list
 	FSNodeNodeList NNL(pm);
 
-	// create node-element list
-	FSNodeElementList NEL;
-	NEL.Build(pm);
+	// get the node-element list
+	const FSNodeElementList& NEL = pm->NodeElementList();
 
 	// we'll assign values to the edges and the nodes
 	NNL.InitValues(0.0);
@@ -26,7 +26,10 @@ SOFTWARE.*/
 
 #include "stdafx.h"
 #include "SurfaceDistance.h"
+#include "KdTree.h"
 #include <MeshLib/FEMesh.h>
+#include <MeshLib/FEMeshBVH.h>
+#include <MeshLib/MeshTools.h>
 #include <GeomLib/GObject.h>
 
 CSurfaceDistance::CSurfaceDistance()
@@ -81,21 +84,62 @@ bool CSurfaceDistance::Apply(GObject* pso, GObject* pmo)
 	}
 
 	// calculate mean
-	m_mean = 0.0;
-	for (int i=0; i<nodes; ++i) m_mean += dist[i];
-	m_mean /= nodes;
+	double sum = 0.0;
+#pragma omp parallel for reduction(+:sum)
+	for (int i=0; i<nodes; ++i) sum += dist[i];
+	m_mean = sum / nodes;
 
 	// find stdev of thicknesses
-	m_stddev = 0;
+	double mean = m_mean;
+	double var = 0.0;
+#pragma omp parallel for reduction(+:var)
 	for (int i=0; i<nodes; ++i)
 	{
-		m_stddev += (dist[i] - m_mean)*(dist[i] - m_mean);
+		var += (dist[i] - mean)*(dist[i] - mean);
 	}
-	m_stddev = sqrt(m_stddev/nodes);
+	m_stddev = sqrt(var/nodes);
 
 	return true;
 }
 
+//-----------------------------------------------------------------------------
+// Intersect the line through ri with direction ni with the triangle (r0, r1, r2).
+// Returns true if the line hits the triangle and t is the signed distance along -ni.
+static bool ProjectToTriangle(const vec3d& ri, const vec3d& ni, const vec3d& r0, const vec3d& r1, const vec3d& r2, double& t)
+{
+	// get the triangle normal
+	vec3d v = (r1 - r0)^(r2 - r0);
+	v.Normalize();
+
+	// calculate intersection
+	double denom = ni*v;
+	if (denom == 0) return false;
+
+	t = ((ri - r0)*v) / denom;	// this is the (signed) distance to the plane
+
+	// project node onto plane
+	vec3d x = ri - ni*t;
+
+	// now we need to find out if this node is inside the triangle.
+	// in order to do that we calculate the (r,s) isoparametric coordinates 
+	// by projecting the nodes on to the edges (p0,p1) and (p0,p2)
+	// then, if (r>=0 AND s>=0 AND r+s <= 1, the node is in the triangle
+	vec3d e1 = (r1 - r0);
+	vec3d e2 = (r2 - r0);
+
+	double u2 = e1*e1, v2 = e2*e2, uv = e1*e2;
+
+	vec3d r = x - r0;
+
+	double g = u2*v2-uv*uv;
+	if (g == 0) return false;
+
+	double a = (v2*(r*e1) - uv*(r*e2))/g;
+	double b = (u2*(r*e2) - uv*(r*e1))/g;
+	const double eps = 0.001;
+	return ((a>=-eps) && (b>=-eps) && (a+b <= 1+eps));
+}
+
 bool CSurfaceDistance::NormalProject(GObject* pso, GObject* pmo, vector<double>& dist)
 {
 	FSMesh* ps = pso->GetFEMesh();
@@ -125,7 +169,23 @@ bool CSurfaceDistance::NormalProject(GObject* pso, GObject* pmo, vector<double>&
 		nu[i].Normalize();
 	}
 
+	// build a BVH over the reference triangles
+	// The boxes are inflated a little since the inside test has some tolerance.
+	int NE = pm->Elements();
+	vector<BOX> box(NE);
+	for (int j=0; j<NE; ++j)
+	{
+		FSElement& el = pm->Element(j);
+		assert(el.IsType(FE_TRI3));
+		BOX& b = box[j];
+		for (int k=0; k<3; ++k) b += pm->Node(el.m_node[k]).r;
+		b.Inflate(0.01*b.GetMaxExtent());
+	}
+	FSMeshBVH bvh;
+	bvh.Build(box);
+
 	// repeat for all nodes
+#pragma omp parallel for schedule(dynamic, 256)
 	for (int i=0; i<nodes; ++i)
 	{
 		FSNode& nodei = ps->Node(i);
@@ -135,98 +195,28 @@ bool CSurfaceDistance::NormalProject(GObject* pso, GObject* pmo, vector<double>&
 		ri = pmo->GetTransform().GlobalToLocal(ri);
 		vec3d ni = nu[i];
 
-		// create a plane tangent to the ray
-		// we'll use this as a quick way to decide if a triangle can be a candidate for intersection.
-		vec3d g(0,0,1);
-		if (ni*g > 0.999) g = vec3d(1,0,0);
-		vec3d t1 = ni^g;
-		vec3d t2 = ni^t1;
-
-		double t1ri = t1*ri;
-		double t2ri = t2*ri;
-
-		double Dmin, D2min = -1.0;
+		double Dmin = 0.0;
+		bool bfound = false;
 
-		// look for closest node on reference surface
-		int NE = pm->Elements();
-		for (int j=0; j<NE; ++j)
-		{
+		// the projection can lie on either side of the node, so we cast a ray in both directions
+		auto f = [&](int j, double& tmax) {
 			FSElement& el = pm->Element(j);
-			assert(el.IsType(FE_TRI3));
 			vec3d r0 = pm->Node(el.m_node[0]).r;
 			vec3d r1 = pm->Node(el.m_node[1]).r;
 			vec3d r2 = pm->Node(el.m_node[2]).r;
-
-			// in order for this triangle to be a candidate the points cannot all lie on the same side of the test planes.
-			bool bcont = true;
-			double s0 = t1*r0 - t1ri;
-			double s1 = t1*r1 - t1ri;
-			double s2 = t1*r2 - t1ri;
-			const double tol = 1e-5;
-			if      ((s0>-tol)&&(s1>-tol)&&(s2>-tol)) bcont = false;
-			else if ((s0< tol)&&(s1< tol)&&(s2< tol)) bcont = false;
-
-			if (bcont)
-			{
-				s0 = t2*r0 - t2ri;
-				s1 = t2*r1 - t2ri;
-				s2 = t2*r2 - t2ri;
-				if      ((s0>-tol)&&(s1>-tol)&&(s2>-tol)) bcont = false;
-				else if ((s0< tol)&&(s1< tol)&&(s2< tol)) bcont = false;
-			}
-
-			if (bcont)
+			double t;
+			if (ProjectToTriangle(ri, ni, r0, r1, r2, t) && (fabs(t) < tmax))
 			{
-				// get the triangle normal
-				vec3d v = (r1 - r0)^(r2 - r0);
-				v.Normalize();
-
-				// calculate r
-				vec3d r = ri - r0;
-
-				// calculate intersection
-				double denom = nu[i]*v;
-				if (denom != 0)
-				{
-					double t = (r*v) / denom;	// this is the (signed) distance to the plane
-
-					// project node onto plane
-					vec3d x = ri - nu[i]*t;
-
-					// now we need to find out if this node is inside the triangle.
-					// in order to do that we calculate the (r,s) isoparametric coordinates 
-					// by projecting the nodes on to the edges (p0,p1) and (p0,p2)
-					// then, if (r>=0 AND s>=0 AND r+s <= 1, the node is in the triangle
-
-					vec3d u = (r1 - r0);
-					vec3d v = (r2 - r0);
-
-					double u2 = u*u, v2 = v*v, uv = u*v;
-
-					vec3d r = x - r0;
-
-					double g = u2*v2-uv*uv;
-					if ( g != 0)
-					{
-						double a = (v2*(r*u) - uv*(r*v))/g;
-						double b = (u2*(r*v) - uv*(r*u))/g;
-						const double eps = 0.001;
-						if ((a>=-eps) && (b>=-eps) && (a+b <= 1+eps))
-						{
-							// we have a winner !
-							double d2 = t*t;
-							if ((d2 < D2min) || (D2min < 0.0))
-							{
-								Dmin = t;
-								D2min = d2;
-							}
-						}
-					}
-				}
+				// we have a winner !
+				Dmin = t;
+				tmax = fabs(t);
+				bfound = true;
 			}
-		}
+		};
+		bvh.Intersect(ri, -ni, 1e99, f);
+		bvh.Intersect(ri,  ni, (bfound ? fabs(Dmin) : 1e99), f);
 
-		if (D2min < 0)
+		if (bfound == false)
 		{
 			// we did not find a projection
 			// set it to max
@@ -262,37 +252,69 @@ bool CSurfaceDistance::ClosestPoint(GObject* pso, GObject* pmo, vector<double>&
 	// get the number of nodes
 	int nodes = ps->Nodes();
 
-	// repeat for all nodes
-	for (int i=0; i<nodes; ++i)
+	// Split the master surface in triangles (quads are split in two)
+	vector<int> tri;
+	tri.reserve(6 * pm->Faces());
+	for (int j=0; j<pm->Faces(); ++j)
 	{
-		FSNode& nodei = ps->Node(i);
-
-		// get the global nodal coordinates
-		vec3d ri = pso->GetTransform().LocalToGlobal(nodei.r);
-
-		// convert it to the local coordinate in the master object
-		ri = pmo->GetTransform().GlobalToLocal(ri);
-
-		// repeat over all master nodes
-		double Dmin = 0.0;
-		for (int j=0; j<pm->Nodes(); ++j)
+		FSFace& f = pm->Face(j);
+		tri.push_back(f.n[0]); tri.push_back(f.n[1]); tri.push_back(f.n[2]);
+		if (f.Edges() == 4)
 		{
-			// get the position of the master node
-			vec3d& rj = pm->Node(j).r;
-
-			// separation vector
-			vec3d r = rj - ri;
+			tri.push_back(f.n[2]); tri.push_back(f.n[3]); tri.push_back(f.n[0]);
+		}
+	}
+	int NT = (int)tri.size() / 3;
 
-			// square length
-			double d2 = r*r;
+	if (NT > 0)
+	{
+		vector<BOX> box(NT);
+		for (int j=0; j<NT; ++j)
+		{
+			for (int k=0; k<3; ++k) box[j] += pm->Node(tri[3*j + k]).r;
+		}
+		FSMeshBVH bvh;
+		bvh.Build(box);
 
-			if ((d2 < Dmin)||(j==0))
-			{
-				Dmin = d2;
-			}			
+#pragma omp parallel for schedule(dynamic, 256)
+		for (int i=0; i<nodes; ++i)
+		{
+			// get the global nodal coordinates and convert it
+			// to the local coordinate in the master object
+			vec3d ri = pso->GetTransform().LocalToGlobal(ps->Node(i).r);
+			ri = pmo->GetTransform().GlobalToLocal(ri);
+
+			double D2min = 1e99;
+			bvh.Closest(ri, D2min, [&](int j, double& d2max) {
+				const vec3d& a = pm->Node(tri[3*j    ]).r;
+				const vec3d& b = pm->Node(tri[3*j + 1]).r;
+				const vec3d& c = pm->Node(tri[3*j + 2]).r;
+				vec3d q = closestPointOnTriangle(ri, a, b, c);
+				double d2 = (q - ri).SqrLength();
+				if (d2 < d2max) { d2max = d2; D2min = d2; }
+			});
+
+			dist[i] = sqrt(D2min);
 		}
+	}
+	else
+	{
+		// no surface, so we just find the closest master node
+		vector<vec3d> pts(pm->Nodes());
+		for (int j=0; j<pm->Nodes(); ++j) pts[j] = pm->Node(j).r;
+		KdTree tree;
+		tree.Build(pts);
+
+#pragma omp parallel for schedule(dynamic, 256)
+		for (int i=0; i<nodes; ++i)
+		{
+			vec3d ri = pso->GetTransform().LocalToGlobal(ps->Node(i).r);
+			ri = pmo->GetTransform().GlobalToLocal(ri);
 
-		dist[i] = sqrt(Dmin);
+			double d2 = 0.0;
+			tree.FindNearest(ri, &d2);
+			dist[i] = sqrt(d2);
+		}
 	}
 
 	return true;
@@ -27,6 +27,7 @@ SOFTWARE.*/
 #include "stdafx.h"
 #include "TetOverlap.h"
 #include <MeshLib/FEMesh.h>
+#include <algorithm>
 using namespace std;
 
 struct TET
@@ -77,31 +78,129 @@ bool TetOverlap::Apply(FSMesh* mesh, std::vector<pair<int, int> >& tetList)
 
 	// the list that will store the overlapping pairs
 	tetList.clear();
-	tetList.reserve(NE / 2);
+	if (NE < 2) return true;
 
+	// The boxes are inflated the same way as the box in the pair test below, so that
+	// all pairs that can pass that test have overlapping boxes.
+	vector<BOX> box(NE);
+	BOX bound;
+	double hsum = 0.0;
 	for (int i = 0; i < NE; ++i)
 	{
 		TET& a = tet[i];
+		BOX& bi = box[i];
+		for (int k = 0; k < 4; ++k) bi += a.r[k];
+		double R = bi.GetMaxExtent();
+		bi.Inflate(R*0.001);
+		bound += bi;
+		hsum += bi.GetMaxExtent();
+	}
+
+	// Bin the boxes in a uniform grid. The cell size is about the size of a tet, but we
+	// don't want much more cells than tets. The extents are clamped to a fraction of the
+	// largest one, so that a thin slab does not give tiny cells.
+	double emin = 1e-3 * bound.GetMaxExtent();
+	double W = std::max(bound.Width(), emin);
+	double H = std::max(bound.Height(), emin);
+	double D = std::max(bound.Depth(), emin);
+	double h = hsum / NE;
+	double Vmax = 4.0 * NE;
+	if ((h <= 0.0) || ((W / h + 1) * (H / h + 1) * (D / h + 1) > Vmax))
+	{
+		h = pow(W * H * D / Vmax, 1.0 / 3.0);
+	}
+	if (h <= 0.0) h = 1.0;	// all tets are collapsed to one point
+	int nx = (int)(W / h) + 1;
+	int ny = (int)(H / h) + 1;
+	int nz = (int)(D / h) + 1;
 
-		BOX box;
-		for (int k = 0; k < 4; ++k) box += a.r[k];
-		double R = box.GetMaxExtent();
-		box.Inflate(R*0.001);
+	// the rounding can still give too many cells
+	while ((double)nx * ny * nz > Vmax)
+	{
+		h *= 1.1;
+		nx = (int)(W / h) + 1;
+		ny = (int)(H / h) + 1;
+		nz = (int)(D / h) + 1;
+	}
 
-		for (int j = i+1; j < NE; ++j)
+	auto cell = [&](double x, double y, double z, int c[3]) {
+		c[0] = (int)((x - bound.x0) / h); if (c[0] >= nx) c[0] = nx - 1; if (c[0] < 0) c[0] = 0;
+		c[1] = (int)((y - bound.y0) / h); if (c[1] >= ny) c[1] = ny - 1; if (c[1] < 0) c[1] = 0;
+		c[2] = (int)((z - bound.z0) / h); if (c[2] >= nz) c[2] = nz - 1; if (c[2] < 0) c[2] = 0;
+	};
+
+	// count, then fill the cells
+	size_t ncells = (size_t)nx * ny * nz;
+	vector<int> off(ncells + 1, 0), lst;
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		vector<int> pos;
+		if (pass == 1)
 		{
-			TET& b = tet[j];
-			if (box_test(box, b) == false)
-			{
-				if (tet_overlap(a, b))
+			for (size_t i = 0; i < ncells; ++i) off[i + 1] += off[i];
+			lst.resize(off[ncells]);
+			pos.assign(off.begin(), off.end() - 1);
+		}
+
+		for (int n = 0; n < NE; ++n)
+		{
+			int c0[3], c1[3];
+			cell(box[n].x0, box[n].y0, box[n].z0, c0);
+			cell(box[n].x1, box[n].y1, box[n].z1, c1);
+			for (int k = c0[2]; k <= c1[2]; ++k)
+				for (int j = c0[1]; j <= c1[1]; ++j)
+					for (int i = c0[0]; i <= c1[0]; ++i)
+					{
+						size_t c = i + (size_t)nx * (j + (size_t)ny * k);
+						if (pass == 0) off[c + 1]++;
+						else lst[pos[c]++] = n;
+					}
+		}
+	}
+
+	// test the pairs in each cell. A pair is only tested in the cell that contains the
+	// lower corner of the boxes' intersection, so that each pair is tested once.
+	#pragma omp parallel
+	{
+		vector<pair<int, int> > localList;
+
+		#pragma omp for schedule(dynamic, 64)
+		for (int c = 0; c < (int)ncells; ++c)
+		{
+			for (int l0 = off[c]; l0 < off[c + 1]; ++l0)
+				for (int l1 = l0 + 1; l1 < off[c + 1]; ++l1)
 				{
-					pair<int, int> tetPair(i, j);
-					tetList.push_back(tetPair);
+					int i = lst[l0], j = lst[l1];
+					if (i > j) { int tmp = i; i = j; j = tmp; }
+
+					const BOX& bi = box[i];
+					const BOX& bj = box[j];
+					if ((bi.x1 < bj.x0) || (bj.x1 < bi.x0) ||
+						(bi.y1 < bj.y0) || (bj.y1 < bi.y0) ||
+						(bi.z1 < bj.z0) || (bj.z1 < bi.z0)) continue;
+
+					int cc[3];
+					cell(std::max(bi.x0, bj.x0), std::max(bi.y0, bj.y0), std::max(bi.z0, bj.z0), cc);
+					if (cc[0] + (size_t)nx * (cc[1] + (size_t)ny * cc[2]) != (size_t)c) continue;
+
+					// the same tests as the brute-force loop
+					if (box_test(box[i], tet[j]) == false)
+					{
+						if (tet_overlap(tet[i], tet[j]))
+						{
+							localList.push_back(pair<int, int>(i, j));
+						}
+					}
 				}
-			}
 		}
+
+		#pragma omp critical
+		tetList.insert(tetList.end(), localList.begin(), localList.end());
 	}
 
+	// sort to get the same order as a brute-force search
+	std::sort(tetList.begin(), tetList.end());
+
 	return true;
 }
 
@@ -439,6 +439,9 @@ void CGLColorMap::Update(int ntime, float dt, bool breset)
 		}
 	}
 
+	// the texture coordinates have changed
+	po->UpdateRenderBuffers();
+
 	// update element textures
 	for (int i = 0; i<pm->Elements(); ++i)
 	{
@@ -92,6 +92,7 @@ void CGLDisplacementMap::Activate(bool b)
 		FSMeshBase* pm = state->GetFEMesh();
 		for (int i = 0; i<pm->Nodes(); ++i) pm->Node(i).r = to_vec3d(ref.m_Node[i].m_rt);
 		pm->UpdateNormals();
+		po->UpdateRenderBuffers();
 	}
 }
 
@@ -143,7 +144,7 @@ void CGLDisplacementMap::Update(int ntime, float dt, bool breset)
 
 		// update the states
 		UpdateState(n0, breset);
-		UpdateState(n1, breset);
+		UpdateState(n1);
 
 		// calculate weight factor
 		float df = s2.m_time - s1.m_time;
@@ -174,44 +175,12 @@ void CGLDisplacementMap::UpdateState(int ntime, bool breset)
 {
 	CGLModel* po = GetModel();
 	FEPostModel* pfem = po->GetFSModel();
-	if (pfem == nullptr)
-	{
-		m_ntag.clear();
-		return;
-	}
-
-	FSMeshBase* pm = pfem->GetState(ntime)->GetFEMesh();
-	if (pfem == nullptr) {
-		m_ntag.clear(); return;
-	}
-
-	int N = pfem->GetStates();
-
-	// TODO: This does not look right the correct place for this
-	if (breset || (N != m_ntag.size())) m_ntag.assign(N, -1);
-
-	int nfield = pfem->GetDisplacementField();
-
-	if ((nfield >= 0) && (m_ntag[ntime] != nfield))
-	{
-		m_ntag[ntime] = nfield;
+	if (pfem == nullptr) return;
 
-		FEState& s = *pfem->GetState(ntime);
-
-		// get the reference state
-		Post::FERefState& ref = *s.m_ref;
-
-		// set the current nodal positions
-		for (int i = 0; i < pm->Nodes(); ++i)
-		{
-			FSNode& node = pm->Node(i);
-			vec3f dr = pfem->EvaluateNodeVector(i, ntime, nfield);
-
-			// the actual nodal position is stored in the state
-			// this is the field that will be used for strain calculations
-			s.m_NODE[i].m_rt = ref.m_Node[i].m_rt + dr;
-		}
-	}
+	// the nodal positions are stored in the state, which tracks which
+	// displacement field was used to evaluate them.
+	if (breset) pfem->ResetNodePositions();
+	pfem->UpdateNodePositions(ntime);
 }
 
 //-----------------------------------------------------------------------------
@@ -240,4 +209,5 @@ void CGLDisplacementMap::UpdateNodes()
 
 	// update the normals
 	pm->UpdateNormals();
+	po->UpdateRenderBuffers();
 }
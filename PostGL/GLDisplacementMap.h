@@ -56,6 +56,5 @@ public:
 public:
 	vec3d				m_scl;		//!< displacement scale factor
 	std::vector<vec3f>	m_du;		//!< nodal displacements
-	std::vector<int>	m_ntag;
 };
 }
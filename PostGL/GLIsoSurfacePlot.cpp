@@ -31,11 +31,137 @@ SOFTWARE.*/
 #include <GLLib/GLContext.h>
 #include <GLLib/GLCamera.h>
 #include "GLModel.h"
+#include <algorithm>
+#include <omp.h>
 using namespace Post;
 
 extern int LUT[256][15];
 extern int ET_HEX[12][2];
 
+const int HEX_NT[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+const int PEN_NT[8] = {0, 1, 2, 2, 3, 4, 5, 5};
+const int TET_NT[8] = {0, 1, 2, 2, 3, 3, 3, 3};
+const int PYR_NT[8] = {0, 1, 2, 3, 4, 4, 4, 4};
+
+// get the node table that maps an element to a hex
+static const int* elementNodeTable(int elemType)
+{
+	switch (elemType)
+	{
+	case FE_HEX8   : return HEX_NT;
+	case FE_HEX20  : return HEX_NT;
+	case FE_HEX27  : return HEX_NT;
+	case FE_PENTA6 : return PEN_NT;
+	case FE_PENTA15: return PEN_NT;
+	case FE_TET4   : return TET_NT;
+	case FE_TET5   : return TET_NT;
+	case FE_PYRA5  : return PYR_NT;
+	case FE_PYRA13 : return PYR_NT;
+	case FE_TET10  : return TET_NT;
+	case FE_TET15  : return TET_NT;
+	}
+	return nullptr;
+}
+
+//=============================================================================
+void CGLIsoSurfacePlot::ElementIndex::Clear()
+{
+	m_node.clear();
+	m_byMin.clear();
+	m_byMax.clear();
+	m_min.clear();
+	m_max.clear();
+}
+
+void CGLIsoSurfacePlot::ElementIndex::Build(const std::vector<int>& elems, const std::vector<float>& vmin, const std::vector<float>& vmax)
+{
+	Clear();
+	m_min = vmin;
+	m_max = vmax;
+	m_byMin.reserve(elems.size());
+	m_byMax.reserve(elems.size());
+
+	std::vector<int> tmp(elems);
+	build(tmp);
+}
+
+int CGLIsoSurfacePlot::ElementIndex::build(std::vector<int>& elems)
+{
+	int N = (int)elems.size();
+	if (N == 0) return -1;
+
+	// use the median of the interval end points as the center
+	std::vector<float> pts(2 * N);
+	for (int i = 0; i < N; ++i)
+	{
+		pts[2 * i    ] = m_min[elems[i]];
+		pts[2 * i + 1] = m_max[elems[i]];
+	}
+	std::nth_element(pts.begin(), pts.begin() + N, pts.end());
+	float center = pts[N];
+
+	// split the elements
+	std::vector<int> left, right, mid;
+	for (int n : elems)
+	{
+		if (m_max[n] < center) left.push_back(n);
+		else if (m_min[n] > center) right.push_back(n);
+		else mid.push_back(n);
+	}
+	std::vector<int>().swap(elems);
+
+	NODE node;
+	node.center = center;
+	node.start = (int)m_byMin.size();
+	node.count = (int)mid.size();
+
+	std::sort(mid.begin(), mid.end(), [=](int a, int b) { return m_min[a] < m_min[b]; });
+	m_byMin.insert(m_byMin.end(), mid.begin(), mid.end());
+	std::sort(mid.begin(), mid.end(), [=](int a, int b) { return m_max[a] > m_max[b]; });
+	m_byMax.insert(m_byMax.end(), mid.begin(), mid.end());
+
+	int nid = (int)m_node.size();
+	m_node.push_back(node);
+
+	int l = build(left);
+	int r = build(right);
+	m_node[nid].left = l;
+	m_node[nid].right = r;
+
+	return nid;
+}
+
+void CGLIsoSurfacePlot::ElementIndex::Find(float ref, std::vector<int>& elems) const
+{
+	int nid = (m_node.empty() ? -1 : 0);
+	while (nid != -1)
+	{
+		const NODE& node = m_node[nid];
+		if (ref < node.center)
+		{
+			// all elements in this node have max >= center > ref
+			for (int i = node.start; i < node.start + node.count; ++i)
+			{
+				int n = m_byMin[i];
+				if (m_min[n] > ref) break;
+				elems.push_back(n);
+			}
+			nid = node.left;
+		}
+		else
+		{
+			// all elements in this node have min <= center <= ref
+			for (int i = node.start; i < node.start + node.count; ++i)
+			{
+				int n = m_byMax[i];
+				if (m_max[n] <= ref) break;
+				elems.push_back(n);
+			}
+			nid = node.right;
+		}
+	}
+}
+
 //////////////////////////////////////////////////////////////////////
 // Construction/Destruction
 //////////////////////////////////////////////////////////////////////
@@ -78,6 +204,11 @@ CGLIsoSurfacePlot::CGLIsoSurfacePlot()
 	m_Col.SetDivisions(m_nslices);
 	m_Col.SetSmooth(false);
 
+	m_bindexValid = false;
+	m_indexTime = -1;
+	m_indexField = -1;
+	m_indexMesh = nullptr;
+
 	GLLegendBar* bar = new GLLegendBar(&m_Col, 0, 0, 600, 100, GLLegendBar::ORIENT_HORIZONTAL);
 	bar->align(GLW_ALIGN_BOTTOM | GLW_ALIGN_HCENTER);
 	bar->SetType(GLLegendBar::DISCRETE);
@@ -230,6 +361,9 @@ void CGLIsoSurfacePlot::UpdateMesh()
 	float vmax = m_crng.y;
 	float D = vmax - vmin;
 
+	// the index is shared by all the slices
+	if (m_bindexValid == false) BuildElementIndex();
+
 	for (int i = 0; i < m_nslices; ++i)
 	{
 		float ref = vmin + ((float)i + 0.5f)* D / (m_nslices);
@@ -244,115 +378,165 @@ void CGLIsoSurfacePlot::UpdateMesh()
 
 ///////////////////////////////////////////////////////////////////////////////
 
-void CGLIsoSurfacePlot::UpdateSlice(float ref, GLColor col)
+void CGLIsoSurfacePlot::BuildElementIndex()
 {
-	float ev[8];	// element nodal values
-	vec3f ex[8];	// element nodal positions
-	vec3f en[8];	// element nodal gradients
+	FEPostMesh* pm = GetModel()->GetActiveMesh();
+	int NE = pm->Elements();
+
+	// find the value range of all solid elements
+	std::vector<float> vmin(NE, 0.f), vmax(NE, 0.f);
+	std::vector<char> tag(NE, 0);
+#pragma omp parallel for
+	for (int i = 0; i < NE; ++i)
+	{
+		FEElement_& el = pm->ElementRef(i);
+		const int* nt = elementNodeTable(el.Type());
+		if (el.IsSolid() && nt)
+		{
+			float v0 = m_val[el.m_node[nt[0]]], v1 = v0;
+			for (int k = 1; k < 8; ++k)
+			{
+				float v = m_val[el.m_node[nt[k]]];
+				if (v < v0) v0 = v;
+				if (v > v1) v1 = v;
+			}
 
-	const int HEX_NT[8] = {0, 1, 2, 3, 4, 5, 6, 7};
-	const int PEN_NT[8] = {0, 1, 2, 2, 3, 4, 5, 5};
-	const int TET_NT[8] = {0, 1, 2, 2, 3, 3, 3, 3};
-    const int PYR_NT[8] = {0, 1, 2, 3, 4, 4, 4, 4};
+			// elements with a constant value never contain an iso-value
+			if (v0 < v1)
+			{
+				vmin[i] = v0;
+				vmax[i] = v1;
+				tag[i] = 1;
+			}
+		}
+	}
+
+	std::vector<int> elems;
+	for (int i = 0; i < NE; ++i) if (tag[i]) elems.push_back(i);
+
+	m_index.Build(elems, vmin, vmax);
+	m_bindexValid = true;
+}
 
+void CGLIsoSurfacePlot::UpdateSlice(float ref, GLColor col)
+{
 	CGLModel* mdl = GetModel();
 	FEPostModel* ps = mdl->GetFSModel();
 
 	// get the mesh
 	FEPostMesh* pm = mdl->GetActiveMesh();
 
-	const int* nt = nullptr;
+	// find the elements that contain the iso-value
+	std::vector<int> elems;
+	m_index.Find(ref, elems);
+	std::sort(elems.begin(), elems.end());
 
-	// loop over all elements
-	for (int i=0; i<pm->Elements(); ++i)
+	// only keep the elements that are visible and
+	// whose material is enabled
+	int m = 0;
+	for (int n : elems)
 	{
-		// render only if the element is visible and
-		// its material is enabled
-		FEElement_& el = pm->ElementRef(i);
+		FEElement_& el = pm->ElementRef(n);
 		Material* pmat = ps->GetMaterial(el.m_MatID);
-		if (pmat->benable && (el.IsVisible() || m_bcut_hidden) && el.IsSolid())
+		if (pmat->benable && (el.IsVisible() || m_bcut_hidden)) elems[m++] = n;
+	}
+	elems.resize(m);
+
+	struct ISO_FACE
+	{
+		vec3f	r[3];
+		vec3f	vn[3];
+	};
+
+	// generate the faces in parallel
+	int NE = (int)elems.size();
+	std::vector< std::vector<ISO_FACE> > faces(omp_get_max_threads());
+#pragma omp parallel
+	{
+		std::vector<ISO_FACE>& threadFaces = faces[omp_get_thread_num()];
+
+		float ev[8];	// element nodal values
+		vec3f ex[8];	// element nodal positions
+		vec3f en[8];	// element nodal gradients
+
+#pragma omp for schedule(static)
+		for (int i = 0; i < NE; ++i)
 		{
-			switch (el.Type())
-			{
-			case FE_HEX8   : nt = HEX_NT; break;
-			case FE_HEX20  : nt = HEX_NT; break;
-			case FE_HEX27  : nt = HEX_NT; break;
-			case FE_PENTA6 : nt = PEN_NT; break;
-			case FE_PENTA15: nt = PEN_NT; break;
-			case FE_TET4   : nt = TET_NT; break;
-			case FE_TET5   : nt = TET_NT; break;
-			case FE_PYRA5  : nt = PYR_NT; break;
-			case FE_PYRA13 : nt = PYR_NT; break;
-			case FE_TET10  : nt = TET_NT; break;
-			case FE_TET15  : nt = TET_NT; break;
-			default:
-				assert(false);
-			}
+			FEElement_& el = pm->ElementRef(elems[i]);
+			const int* nt = elementNodeTable(el.Type());
 
 			// get the nodal values
-			for (int k=0; k<8; ++k)
+			for (int k = 0; k < 8; ++k)
 			{
 				FSNode& node = pm->Node(el.m_node[nt[k]]);
 
 				ev[k] = m_val[el.m_node[nt[k]]];
 				ex[k] = to_vec3f(node.r);
-				en[k] = m_grd[el.m_node[nt[k]]];
+				if (m_bsmooth) en[k] = m_grd[el.m_node[nt[k]]];
 			}
 
 			// calculate the case of the element
 			int ncase = 0;
-			for (int k=0; k<8; ++k) 
+			for (int k = 0; k < 8; ++k)
 				if (ev[k] <= ref) ncase |= (1 << k);
 
 			// loop over faces
 			int* pf = LUT[ncase];
-			for (int l=0; l<5; l++)
+			for (int l = 0; l < 5; l++)
 			{
 				if (*pf == -1) break;
 
 				// calculate nodal positions
-				vec3f r[3], vn[3];
-				for (int k=0; k<3; k++)
+				ISO_FACE face;
+				vec3f* r = face.r;
+				vec3f* vn = face.vn;
+				for (int k = 0; k < 3; k++)
 				{
 					int n1 = ET_HEX[pf[k]][0];
 					int n2 = ET_HEX[pf[k]][1];
 
 					float w = (ref - ev[n1]) / (ev[n2] - ev[n1]);
 
-					r[k] = ex[n1]*(1-w) + ex[n2]*w;
+					r[k] = ex[n1] * (1 - w) + ex[n2] * w;
 				}
 
 				// calculate normals
 				if (m_bsmooth)
 				{
-					for (int k=0; k<3; k++)
+					for (int k = 0; k < 3; k++)
 					{
 						int n1 = ET_HEX[pf[k]][0];
 						int n2 = ET_HEX[pf[k]][1];
 
 						float w = (ref - ev[n1]) / (ev[n2] - ev[n1]);
 
-						vn[k] = en[n1]*(1-w) + en[n2]*w;
+						vn[k] = en[n1] * (1 - w) + en[n2] * w;
 						vn[k].Normalize();
 					}
 				}
 				else
 				{
-					for (int k=0; k<3; k++)
+					for (int k = 0; k < 3; k++)
 					{
-						int kp1 = (k+1)%3;
-						int km1 = (k+2)%3;
-						vn[k] = (r[kp1] - r[k])^(r[km1] - r[k]);
+						int kp1 = (k + 1) % 3;
+						int km1 = (k + 2) % 3;
+						vn[k] = (r[kp1] - r[k]) ^ (r[km1] - r[k]);
 						vn[k].Normalize();
 					}
 				}
 
-				// Add the face
-				m_mesh.AddFace(r, vn, col);
-				pf+=3;
+				threadFaces.push_back(face);
+				pf += 3;
 			}
 		}
 	}
+
+	// add the faces to the mesh
+	for (int n = 0; n < (int)faces.size(); ++n)
+	{
+		std::vector<ISO_FACE>& threadFaces = faces[n];
+		for (ISO_FACE& face : threadFaces) m_mesh.AddFace(face.r, face.vn, col);
+	}
 }
 
 //-----------------------------------------------------------------------------
@@ -446,6 +630,15 @@ void CGLIsoSurfacePlot::Update(int ntime, float dt, bool breset)
 		m_GMap.SetTag(ntime, m_nfield);
 	}
 
+	// the element index needs to be rebuilt when the nodal values change
+	if (breset || (ntime != m_indexTime) || (m_nfield != m_indexField) || (pm != m_indexMesh))
+	{
+		m_bindexValid = false;
+		m_indexTime = ntime;
+		m_indexField = m_nfield;
+		m_indexMesh = pm;
+	}
+
 	// copy nodal values into current value buffer
 	m_val = m_map.State(ntime);
 	if (m_bsmooth) m_grd = m_GMap.State(ntime);
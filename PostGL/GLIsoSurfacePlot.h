@@ -36,6 +36,38 @@ class CGLIsoSurfacePlot : public CGLLegendPlot
 {
 	enum { DATA_FIELD, COLOR_MAP, TRANSPARENCY, CLIP, HIDDEN, SLICES, LEGEND, SMOOTH, RANGE_TYPE, USER_MAX, USER_MIN };
 
+	// Interval tree of the (min, max) nodal values of the elements. This is 
+	// used to find the elements that contain an iso-value.
+	class ElementIndex
+	{
+	public:
+		ElementIndex() {}
+
+		void Clear();
+
+		// build the tree. vmin, vmax are the value ranges of all the elements,
+		// elems is the list of elements that are added to the tree.
+		void Build(const std::vector<int>& elems, const std::vector<float>& vmin, const std::vector<float>& vmax);
+
+		// find all the elements for which vmin <= ref < vmax
+		void Find(float ref, std::vector<int>& elems) const;
+
+	private:
+		int build(std::vector<int>& elems);
+
+	private:
+		struct NODE
+		{
+			float	center;
+			int		left, right;	// child nodes (or -1)
+			int		start, count;	// elements that contain the center
+		};
+		std::vector<NODE>	m_node;
+		std::vector<int>	m_byMin;	// node elements sorted by increasing min
+		std::vector<int>	m_byMax;	// node elements sorted by decreasing max
+		std::vector<float>	m_min, m_max;
+	};
+
 public:
 	enum RANGE_TYPE {
 		RNG_DYNAMIC,
@@ -82,6 +114,7 @@ public:
 protected:
 	void UpdateMesh();
 	void UpdateSlice(float ref, GLColor col);
+	void BuildElementIndex();
 
 protected:
 	int		m_nslices;		// nr. of iso surface slices
@@ -107,6 +140,11 @@ protected:
 
 	GLMesh	m_mesh;	// the mesh to render
 
+	ElementIndex	m_index;	// element value index for current nodal values
+	bool			m_bindexValid;
+	int				m_indexTime, m_indexField;
+	FEPostMesh*		m_indexMesh;
+
 	int		m_lastTime;
 	float	m_lastdt;
 };
@@ -60,6 +60,16 @@ CGLModel::CGLModel(FEPostModel* ps)
 
 	m_lastMesh = nullptr;
 
+	m_bufferRev = 0;
+	m_tagRev = 0;
+
+	m_nprefetch = 0;
+	m_prefetchDir = 1;
+	m_prefetchMin = 0;
+	m_prefetchMax = -1;
+	m_prefetchLoop = true;
+	m_prefetchBounce = false;
+
 	static int layer = 1;
 	m_layer = layer++;
 
@@ -189,6 +199,9 @@ void CGLModel::ResetAllStates()
 	FEPostModel* fem = GetFSModel();
 	if ((fem == 0) || (fem->GetStates() == 0)) return;
 
+	// the data needs to be evaluated again
+	fem->DataChanged();
+
 	int N = fem->GetStates();
 	for (int i=0; i<N; ++i)
 	{
@@ -231,6 +244,9 @@ bool CGLModel::Update(bool breset)
 	// update the state of the mesh
 	GetFSModel()->UpdateMeshState(ntime);
 
+	// the mesh data will change, so the render buffers need to be updated
+	UpdateRenderBuffers();
+
 	// Calling this will rebuild the internal surfaces
 	// This should only be done when the mesh has changed
 	Post::FEPostMesh* currentMesh = fem.CurrentState()->GetFEMesh();
@@ -238,6 +254,11 @@ bool CGLModel::Update(bool breset)
 	{
 		UpdateInternalSurfaces(false);
 		m_lastMesh = currentMesh;
+
+		// the buffer objects are kept, so that they can be reused
+		for (GLFaceBuffer& buf : m_domBuffer) buf.Clear();
+		m_domBufferRev.assign(m_domBufferRev.size(), -1);
+		m_domTagRev.assign(m_domTagRev.size(), -1);
 	}
 
 	// update displacement map
@@ -257,13 +278,33 @@ bool CGLModel::Update(bool breset)
 		if (pi->IsActive()) pi->Update(ntime, dt, breset);
 	}
 
+	// start evaluating the next states in the background
+	if ((m_nprefetch > 0) && m_pcol && m_pcol->IsActive())
+	{
+		bool bdisp = (m_pdis && m_pdis->IsActive());
+		fem.PrefetchStates(m_pcol->GetEvalField(), ntime, m_nprefetch, m_prefetchDir, m_prefetchMin, m_prefetchMax, m_prefetchLoop, m_prefetchBounce, bdisp);
+	}
+
 	return true;
 }
 
+//-----------------------------------------------------------------------------
+void CGLModel::SetPrefetchStates(int nstates, int ndir, int nmin, int nmax, bool bloop, bool bbounce)
+{
+	m_nprefetch = nstates;
+	m_prefetchDir = (ndir < 0 ? -1 : 1);
+	m_prefetchMin = nmin;
+	m_prefetchMax = nmax;
+	m_prefetchLoop = bloop;
+	m_prefetchBounce = bbounce;
+	if ((nstates <= 0) && m_ps) m_ps->CancelPrefetch();
+}
+
 //-----------------------------------------------------------------------------
 void CGLModel::UpdateDisplacements(int nstate, bool breset)
 {
 	if (m_pdis && m_pdis->IsActive()) m_pdis->Update(nstate, 0.f, breset);
+	UpdateRenderBuffers();
 }
 
 //-----------------------------------------------------------------------------
@@ -308,6 +349,7 @@ void CGLModel::SetSmoothingAngle(double w)
 
 	FSMeshBase* pm = ps->GetFEMesh(0);
 	pm->AutoSmooth(m_stol);
+	UpdateRenderBuffers();
 }
 
 //-----------------------------------------------------------------------------
@@ -368,6 +410,7 @@ void CGLModel::ResetMesh()
 
 	// reevaluate normals
 	mesh.UpdateNormals();
+	UpdateRenderBuffers();
 }
 
 //-----------------------------------------------------------------------------
@@ -1174,6 +1217,11 @@ void CGLModel::RenderTransparentMaterial(CGLContext& rc, FEPostModel* ps, int m)
 
 	int mode = GetSelectionMode();
 
+	// Render the faces from the domain's vertex buffer if possible. The colors
+	// depend on the view, so they are set each frame.
+	GLFaceBuffer* buf = GetDomainBuffer(dom);
+	vector<int> faceList;
+
 	if (m_doZSorting)
 	{
 		glDisable(GL_CULL_FACE);
@@ -1250,8 +1298,10 @@ void CGLModel::RenderTransparentMaterial(CGLContext& rc, FEPostModel* ps, int m)
 
 
 			// okay, we got one, so let's render it
-			m_render.RenderFace(face, pm, c, ndivs);
+			if (buf) { buf->SetFaceColors(zlist[i].first, c); faceList.push_back(zlist[i].first); }
+			else m_render.RenderFace(face, pm, c, ndivs);
 		}
+		if (buf) buf->RenderFaces(faceList, true);
 	}
 	else
 	{
@@ -1284,9 +1334,11 @@ void CGLModel::RenderTransparentMaterial(CGLContext& rc, FEPostModel* ps, int m)
 				}
 
 				// okay, we got one, so let's render it
-				m_render.RenderFace(face, pm, c, ndivs);
+				if (buf) { buf->SetFaceColors(i, c); faceList.push_back(i); }
+				else m_render.RenderFace(face, pm, c, ndivs);
 			}
 		}
+		if (buf) { buf->RenderFaces(faceList, true); faceList.clear(); }
 
 		// and then we draw the front-facing ones.
 		glCullFace(GL_BACK);
@@ -1318,9 +1370,11 @@ void CGLModel::RenderTransparentMaterial(CGLContext& rc, FEPostModel* ps, int m)
 				}
 
 				// okay, we got one, so let's render it
-				m_render.RenderFace(face, pm, c, ndivs);
+				if (buf) { buf->SetFaceColors(i, c); faceList.push_back(i); }
+				else m_render.RenderFace(face, pm, c, ndivs);
 			}
 		}
+		if (buf) buf->RenderFaces(faceList, true);
 	}
 
 	glPopAttrib();
@@ -1436,15 +1490,25 @@ void CGLModel::RenderSolidDomain(CGLContext& rc, MeshDomain& dom, bool btex, boo
 		});
 
 		// render the list
-		glBegin(GL_TRIANGLES);
-		for (int i = 0; i < zlist.size(); ++i)
+		GLFaceBuffer* buf = GetDomainBuffer(dom);
+		if (buf)
 		{
-			FSFace& face = dom.Face(zlist[i].first);
-			m_render.RenderFace(face, pm);
+			vector<int> faceOrder(zlist.size());
+			for (int i = 0; i < zlist.size(); ++i) faceOrder[i] = zlist[i].first;
+			buf->RenderFaces(faceOrder);
+		}
+		else
+		{
+			glBegin(GL_TRIANGLES);
+			for (int i = 0; i < zlist.size(); ++i)
+			{
+				FSFace& face = dom.Face(zlist[i].first);
+				m_render.RenderFace(face, pm);
+			}
+			glEnd();
 		}
-		glEnd();
 	}
-	else
+	else if (RenderDomainBuffer(dom, 1) == false)
 	{
 		glBegin(GL_TRIANGLES);
 		int NF = dom.Faces();
@@ -1493,15 +1557,25 @@ void CGLModel::RenderSolidDomain(CGLContext& rc, MeshDomain& dom, bool btex, boo
 				});
 
 			// render the list
-			glBegin(GL_TRIANGLES);
-			for (int i = 0; i < zlist.size(); ++i)
+			GLFaceBuffer* buf = GetDomainBuffer(dom);
+			if (buf)
 			{
-				FSFace& face = dom.Face(zlist[i].first);
-				m_render.RenderFace(face, pm);
+				vector<int> faceOrder(zlist.size());
+				for (int i = 0; i < zlist.size(); ++i) faceOrder[i] = zlist[i].first;
+				buf->RenderFaces(faceOrder);
+			}
+			else
+			{
+				glBegin(GL_TRIANGLES);
+				for (int i = 0; i < zlist.size(); ++i)
+				{
+					FSFace& face = dom.Face(zlist[i].first);
+					m_render.RenderFace(face, pm);
+				}
+				glEnd();
 			}
-			glEnd();
 		}
-		else
+		else if (RenderDomainBuffer(dom, 2) == false)
 		{
 			glBegin(GL_TRIANGLES);
 			int NF = dom.Faces();
@@ -1520,6 +1594,65 @@ void CGLModel::RenderSolidDomain(CGLContext& rc, MeshDomain& dom, bool btex, boo
 	}
 }
 
+//-----------------------------------------------------------------------------
+// Render the faces of the domain with tag ntag from the domain's vertex buffer.
+// Returns false if the domain cannot be rendered this way, in which case it is
+// rendered in immediate mode.
+bool CGLModel::RenderDomainBuffer(MeshDomain& dom, int ntag)
+{
+	GLFaceBuffer* buf = GetDomainBuffer(dom);
+	if (buf == nullptr) return false;
+	buf->Render(ntag);
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Get the vertex buffer of a domain. The triangulation is only rebuilt when the 
+// domain's faces change, and the data is updated when the mesh data has changed.
+// Returns null if the domain cannot be rendered from a buffer.
+GLFaceBuffer* CGLModel::GetDomainBuffer(MeshDomain& dom)
+{
+	// smooth faces and thick shells are not supported
+	if ((GetSubDivisions() > 1) || m_render.ShowShell2Hex()) return nullptr;
+
+	FEPostMesh* pm = GetActiveMesh();
+	int m = dom.GetMatID();
+	if ((pm == nullptr) || (m < 0)) return nullptr;
+	if (m >= (int)m_domBuffer.size())
+	{
+		m_domBuffer.resize(pm->Domains());
+		m_domBufferRev.resize(pm->Domains(), -1);
+		m_domTagRev.resize(pm->Domains(), -1);
+		if (m >= (int)m_domBuffer.size()) return nullptr;
+	}
+
+	GLFaceBuffer& buf = m_domBuffer[m];
+	int faceListRev = dom.FaceListRevision();
+	if (buf.IsValid(pm, faceListRev) == false)
+	{
+		if (buf.Create(pm, dom.FaceList(), faceListRev) == false) return nullptr;
+		m_domBufferRev[m] = m_bufferRev;
+		m_domTagRev[m] = m_tagRev;
+	}
+	else
+	{
+		if (m_domBufferRev[m] != m_bufferRev)
+		{
+			buf.Update();
+			m_domBufferRev[m] = m_bufferRev;
+		}
+
+		// the face tags are set once per frame, but the domain can be rendered in several passes
+		if (m_domTagRev[m] != m_tagRev)
+		{
+			buf.UpdateTags();
+			m_domTagRev[m] = m_tagRev;
+		}
+	}
+
+	return &buf;
+}
+
 //-----------------------------------------------------------------------------
 void CGLModel::RenderSolidPart(FEPostModel* ps, CGLContext& rc, int mat)
 {
@@ -1707,6 +1840,9 @@ void CGLModel::RenderSolidMaterial(CGLContext& rc, FEPostModel* ps, int m, bool
 		}
 	}
 
+	// the domain's face tags have changed
+	m_tagRev++;
+
 	if ((activeOnly == false) || (numActiveFaces > 0))
 	{
 
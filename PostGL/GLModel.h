@@ -33,6 +33,7 @@ SOFTWARE.*/
 #include "GLPlot.h"
 #include <FSCore/FSObjectList.h>
 #include <GLLib/GLMeshRender.h>
+#include <GLLib/GLFaceBuffer.h>
 #include <MeshLib/Intersect.h>
 #include <vector>
 
@@ -117,6 +118,14 @@ public:
 	bool Update(bool breset) override;
 	void UpdateDisplacements(int nstate, bool breset = false);
 
+	//! evaluate the next nstates states (in direction ndir) in the background after each update (0 = off)
+	//! The states are taken from the playback range [nmin, nmax] (see FEPostModel::PrefetchStates).
+	void SetPrefetchStates(int nstates, int ndir = 1, int nmin = 0, int nmax = -1, bool bloop = true, bool bbounce = false);
+
+	//! Call this when the nodal positions, normals or texture coordinates of the mesh
+	//! have changed, so that the render buffers are updated before the next render.
+	void UpdateRenderBuffers() { m_bufferRev++; }
+
 	bool AddDisplacementMap(const char* szvectorField = 0);
 
 	void RemoveDisplacementMap();
@@ -228,6 +237,8 @@ protected:
 	void RenderSolidMaterial(CGLContext& rc, FEPostModel* ps, int m, bool activeOnly);
 	void RenderTransparentMaterial(CGLContext& rc, FEPostModel* ps, int m);
 	void RenderSolidDomain(CGLContext& rc, MeshDomain& dom, bool btex, bool benable, bool zsort, bool activeOnly);
+	bool RenderDomainBuffer(MeshDomain& dom, int ntag);
+	GLFaceBuffer* GetDomainBuffer(MeshDomain& dom);
 
 	void RenderInnerSurface(int m, bool btex = true);
 	void RenderInnerSurfaceOutline(int m, int ndivs);
@@ -399,6 +410,19 @@ protected:
 
 	Post::FEPostMesh*	m_lastMesh;	// mesh of last evaluated state
 
+	std::vector<GLFaceBuffer>	m_domBuffer;	// vertex buffers of the domain surfaces
+	std::vector<int>			m_domBufferRev;	// revision of the data in the vertex buffers
+	int							m_bufferRev;	// current revision of the mesh data
+	std::vector<int>			m_domTagRev;	// revision of the face tags of the vertex buffers
+	int							m_tagRev;		// current revision of the face tags
+
+	int		m_nprefetch;	// number of states to prefetch
+	int		m_prefetchDir;	// direction in which states are prefetched (1 or -1)
+	int		m_prefetchMin;	// playback range
+	int		m_prefetchMax;
+	bool	m_prefetchLoop;		// does the playback wrap around?
+	bool	m_prefetchBounce;	// does the playback reverse at the end of the range?
+
 	// selected items
 	vector<FSNode*>		m_nodeSelection;
 	vector<FSEdge*>		m_edgeSelection;
@@ -403,8 +403,8 @@ void CGLParticleFlowPlot::AdvanceParticles(int n0, int n1)
 
 	for (int ntime=n0; ntime<n1; ++ntime)
 	{
-		float t0 = fem.GetState(ntime    )->m_time;
-		float t1 = fem.GetState(ntime + 1)->m_time;
+		float t0 = fem.GetTimeValue(ntime    );
+		float t1 = fem.GetTimeValue(ntime + 1);
 		if (t1 < t0) t1 = t0;
 
 		int NP = (int)m_particles.size();
@@ -30,6 +30,8 @@ SOFTWARE.*/
 #include <GLLib/GLCamera.h>
 #include "GLModel.h"
 #include <MeshLib/hex.h>
+#include <algorithm>
+#include <omp.h>
 using namespace Post;
 
 extern int LUT[256][15];
@@ -44,6 +46,27 @@ const int PYR_NT[8] = {0, 1, 2, 3, 4, 4, 4, 4};
 const int QUAD_NT[4] = { 0, 1, 2, 3 };
 const int TRI_NT[4]  = { 0, 1, 2, 2 };
 
+// get the node table that maps an element to a hex
+static const int* elementNodeTable(int elemType)
+{
+	switch (elemType)
+	{
+	case FE_HEX8   : return HEX_NT;
+	case FE_HEX20  : return HEX_NT;
+	case FE_HEX27  : return HEX_NT;
+	case FE_PENTA6 : return PEN_NT;
+	case FE_PENTA15: return PEN_NT;
+	case FE_TET4   : return TET_NT;
+	case FE_TET5   : return TET_NT;
+	case FE_TET10  : return TET_NT;
+	case FE_TET15  : return TET_NT;
+	case FE_TET20  : return TET_NT;
+	case FE_PYRA5  : return PYR_NT;
+	case FE_PYRA13 : return PYR_NT;
+	}
+	return nullptr;
+}
+
 //////////////////////////////////////////////////////////////////////
 // Construction/Destruction
 //////////////////////////////////////////////////////////////////////
@@ -86,6 +109,10 @@ CGLPlaneCutPlot::CGLPlaneCutPlot()
 
 	m_meshColor = GLColor(0, 0, 0);
 
+	m_maxSpan = 0.0;
+	m_indexMesh = nullptr;
+	m_bindexValid = false;
+
 	m_nclip = GetFreePlane();
 	if (m_nclip >= 0) m_pcp[m_nclip] = this;
 
@@ -185,6 +212,8 @@ void CGLPlaneCutPlot::InitClipPlanes()
 
 void CGLPlaneCutPlot::Update(int ntime, float dt, bool breset)
 {
+	// the nodal positions may have changed
+	m_bindexValid = false;
 	UpdateSlice();
 }
 
@@ -429,11 +458,11 @@ void CGLPlaneCutPlot::RenderMesh()
 
 	Post::FEState& state = *ps->CurrentState();
 
-	// repeat over all elements
-	for (i=0; i<pm->Elements(); ++i)
+	// repeat over all the elements that are cut
+	for (i=0; i<(int)m_cutElem.size(); ++i)
 	{
 		// render only when visible
-		FEElement_& el = pm->ElementRef(i);
+		FEElement_& el = pm->ElementRef(m_cutElem[i]);
 		Material* pmat = ps->GetMaterial(el.m_MatID);
 		if ((el.m_ntag > 0) && el.IsSolid() && (pmat->bmesh) && (pmat->bvisible || m_bcut_hidden) && (pmat->bclip))
 		{
@@ -616,10 +645,20 @@ void CGLPlaneCutPlot::UpdateSlice()
 	FEPostMesh* pm = mdl->GetActiveMesh();
 
 	m_slice.Clear();
+	m_cutElem.clear();
 
-	Post::FEState& state = *ps->CurrentState();
+	// make sure the element index is up to date
+	if ((m_bindexValid == false) || (pm != m_indexMesh) || ((norm == m_indexNorm) == false))
+	{
+		BuildElementIndex(pm, norm);
+	}
+
+	// find the elements that are cut by the plane
+	std::vector<const ELEM_RANGE*> cut;
+	FindCutElements(ref, cut);
 
-	// loop over all domains
+	// only keep the elements of the domains that can be cut
+	std::vector<bool> cutDomain(pm->Domains(), false);
 	for (int n = 0; n < pm->Domains(); ++n)
 	{
 		MeshDomain& dom = pm->Domain(n);
@@ -627,220 +666,298 @@ void CGLPlaneCutPlot::UpdateSlice()
 		if ((matId >= 0) && (matId < ps->Materials()))
 		{
 			Material* pmat = ps->GetMaterial(matId);
-			if ((pmat->bvisible || m_bcut_hidden) && pmat->bclip)
+			cutDomain[n] = ((pmat->bvisible || m_bcut_hidden) && pmat->bclip);
+		}
+	}
+
+	std::vector<const ELEM_RANGE*> elems;
+	elems.reserve(cut.size());
+	for (const ELEM_RANGE* er : cut)
+	{
+		if (cutDomain[er->ndom])
+		{
+			FEElement_& el = pm->ElementRef(er->nel);
+			if (el.IsVisible() || m_bcut_hidden)
 			{
-				AddDomain(pm, n);
+				elems.push_back(er);
+				m_cutElem.push_back(er->nel);
 			}
 		}
 	}
 
+	// build the slice in parallel
+	int ndivs = mdl->GetSubDivisions();
+	int NC = (int)elems.size();
+	std::vector< std::vector<GLSlice::FACE> > faces(omp_get_max_threads());
+#pragma omp parallel
+	{
+		std::vector<GLSlice::FACE>& threadFaces = faces[omp_get_thread_num()];
+#pragma omp for schedule(static)
+		for (int i = 0; i < NC; ++i)
+		{
+			const ELEM_RANGE& er = *elems[i];
+			AddElement(pm, er.ndom, pm->ElementRef(er.nel), norm, ref, ndivs, threadFaces);
+		}
+	}
+	for (int i = 0; i < (int)faces.size(); ++i) m_slice.AddFaces(faces[i]);
+
 	AddFaces(pm);
 }
 
-void CGLPlaneCutPlot::AddDomain(FEPostMesh* pm, int n)
+//-----------------------------------------------------------------------------
+// Build the element index for the given plane normal.
+void CGLPlaneCutPlot::BuildElementIndex(FEPostMesh* pm, const vec3d& norm)
+{
+	m_elemRange.clear();
+	m_largeElem.clear();
+	m_maxSpan = 0.0;
+	m_indexMesh = pm;
+	m_indexNorm = norm;
+	m_bindexValid = true;
+
+	// collect the solid elements of all domains
+	std::vector<ELEM_RANGE> elems;
+	for (int n = 0; n < pm->Domains(); ++n)
+	{
+		const std::vector<int>& elemList = pm->Domain(n).ElementList();
+		for (int nel : elemList)
+		{
+			if (pm->ElementRef(nel).IsSolid()) elems.push_back({ n, nel, 0.0, 0.0 });
+		}
+	}
+	int NE = (int)elems.size();
+	if (NE == 0) return;
+
+	// calculate the projection range of each element
+	std::vector<double> span(NE);
+#pragma omp parallel for
+	for (int i = 0; i < NE; ++i)
+	{
+		ELEM_RANGE& er = elems[i];
+		FEElement_& el = pm->ElementRef(er.nel);
+		const int* nt = elementNodeTable(el.Type());
+		double dmin = 0.0, dmax = 0.0;
+		for (int k = 0; k < 8; ++k)
+		{
+			double d = norm * pm->Node(el.m_node[nt[k]]).r;
+			if ((k == 0) || (d < dmin)) dmin = d;
+			if ((k == 0) || (d > dmax)) dmax = d;
+		}
+		er.dmin = dmin;
+		er.dmax = dmax;
+		span[i] = dmax - dmin;
+	}
+
+	// Elements that are much larger than the typical element are stored separately,
+	// since they would increase the search range of the regular elements.
+	std::vector<double> tmp(span);
+	std::nth_element(tmp.begin(), tmp.begin() + NE / 2, tmp.end());
+	double maxSpan = 4.0 * tmp[NE / 2];
+
+	m_elemRange.reserve(NE);
+	for (int i = 0; i < NE; ++i)
+	{
+		if ((maxSpan > 0.0) && (span[i] > maxSpan)) m_largeElem.push_back(elems[i]);
+		else
+		{
+			m_elemRange.push_back(elems[i]);
+			if (span[i] > m_maxSpan) m_maxSpan = span[i];
+		}
+	}
+
+	std::sort(m_elemRange.begin(), m_elemRange.end(), [](const ELEM_RANGE& a, const ELEM_RANGE& b) {
+		return (a.dmin < b.dmin);
+	});
+}
+
+//-----------------------------------------------------------------------------
+// Find the elements that are cut by the plane with offset ref.
+void CGLPlaneCutPlot::FindCutElements(double ref, std::vector<const ELEM_RANGE*>& elems)
+{
+	// An element is cut when dmin < ref <= dmax. Since dmax - dmin <= m_maxSpan,
+	// we only need to look at the elements with ref - m_maxSpan <= dmin < ref.
+	double r0 = ref - m_maxSpan - 1e-9*fabs(m_maxSpan);
+	auto cmp = [](const ELEM_RANGE& a, double d) { return (a.dmin < d); };
+	auto it0 = std::lower_bound(m_elemRange.begin(), m_elemRange.end(), r0, cmp);
+	auto it1 = std::lower_bound(it0, m_elemRange.end(), ref, cmp);
+	for (auto it = it0; it != it1; ++it)
+	{
+		if (it->dmax >= ref) elems.push_back(&(*it));
+	}
+
+	for (const ELEM_RANGE& er : m_largeElem)
+	{
+		if ((er.dmin < ref) && (er.dmax >= ref)) elems.push_back(&er);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Add the slice faces of an element
+void CGLPlaneCutPlot::AddElement(FEPostMesh* pm, int n, FEElement_& el, const vec3d& norm, double ref, int ndivs, std::vector<GLSlice::FACE>& faces)
 {
 	float ev[8];
 	vec3d ex[8];
 	int	nf[8];
-	EDGE edge[15];
 	int en[8];
 	int	rf[3];
 
-	MeshDomain& dom = pm->Domain(n);
-
-	// get the plane equations
-	GLdouble a[4];
-	GetNormalizedEquations(a);
+	FEPostModel* ps = GetModel()->GetFSModel();
+	Post::FEState& state = *ps->CurrentState();
 
-	// set the plane normal
-	vec3d norm((float)a[0], (float)a[1], (float)a[2]);
+	const int* nt = elementNodeTable(el.Type());
 
-	double ref = -a[3];
+	// get the nodal values
+	for (int k = 0; k < 8; ++k)
+	{
+		FSNode& node = pm->Node(el.m_node[nt[k]]);
+		nf[k] = (node.IsExterior() ? 1 : 0);
+		ex[k] = node.r;
+		en[k] = el.m_node[nt[k]];
+		ev[k] = state.m_NODE[el.m_node[nt[k]]].m_val;
+	}
 
-	CGLModel* mdl = GetModel();
-	int ndivs = mdl->GetSubDivisions();
+	// calculate the case of the element
+	int ncase = 0;
+	for (int k = 0; k < 8; ++k)
+		if (norm*ex[k] >= ref) ncase |= (1 << k);
 
-	FEPostModel* ps = mdl->GetFSModel();
-	Post::FEState& state = *ps->CurrentState();
+	el.m_ntag = ncase;
 
-	// repeat over all elements
-	for (int i = 0; i < dom.Elements(); ++i)
+	if ((ndivs <= 1) || (el.Shape() != ELEM_HEX))
 	{
-		// render only when visible
-		FEElement_& el = dom.Element(i);
-		if ((el.IsVisible() || m_bcut_hidden) && el.IsSolid())
+		// loop over faces
+		int* pf = LUT[ncase];
+		int ne = 0;
+		for (int l = 0; l < 5; l++)
 		{
-			const int *nt = nullptr;
-			switch (el.Type())
-			{
-			case FE_HEX8: nt = HEX_NT; break;
-			case FE_HEX20: nt = HEX_NT; break;
-			case FE_HEX27: nt = HEX_NT; break;
-			case FE_PENTA6: nt = PEN_NT; break;
-			case FE_PENTA15: nt = PEN_NT; break;
-			case FE_TET4: nt = TET_NT; break;
-			case FE_TET5: nt = TET_NT; break;
-			case FE_TET10: nt = TET_NT; break;
-			case FE_TET15: nt = TET_NT; break;
-			case FE_TET20: nt = TET_NT; break;
-			case FE_PYRA5: nt = PYR_NT; break;
-            case FE_PYRA13: nt = PYR_NT; break;
-			}
+			if (*pf == -1) break;
 
-			// get the nodal values
-			for (int k = 0; k < 8; ++k)
+			// calculate nodal positions
+			vec3d r[3];
+			float tex[3], w1, w2, w;
+			for (int k = 0; k < 3; k++)
 			{
-				FSNode& node = pm->Node(el.m_node[nt[k]]);
-				nf[k] = (node.IsExterior() ? 1 : 0);
-				ex[k] = node.r;
-				en[k] = el.m_node[nt[k]];
-				ev[k] = state.m_NODE[el.m_node[nt[k]]].m_val;
+				int n1 = ET_HEX[pf[k]][0];
+				int n2 = ET_HEX[pf[k]][1];
+
+				w1 = norm * ex[n1];
+				w2 = norm * ex[n2];
+
+				if (w2 != w1)
+					w = (ref - w1) / (w2 - w1);
+				else
+					w = 0.f;
+
+				float v = ev[n1] * (1 - w) + ev[n2] * w;
+
+				r[k] = ex[n1] * (1 - w) + ex[n2] * w;
+				tex[k] = v;
+				rf[k] = ((nf[n1] == 1) && (nf[n2] == 1) ? 1 : 0);
 			}
 
-			// calculate the case of the element
-			int ncase = 0;
-			for (int k = 0; k < 8; ++k)
-				if (norm*ex[k] >= ref) ncase |= (1 << k);
+			GLSlice::FACE face;
+			face.mat = n;
+			face.norm = norm;
+			face.r[0] = r[0];
+			face.r[1] = r[1];
+			face.r[2] = r[2];
+			face.tex[0] = tex[0];
+			face.tex[1] = tex[1];
+			face.tex[2] = tex[2];
+			face.bactive = el.IsActive();
 
-			el.m_ntag = ncase;
+			faces.push_back(face);
 
-			if ((ndivs <= 1) || (el.Shape() != ELEM_HEX))
+			pf += 3;
+		}
+	}
+	else
+	{
+		for (int ix = 0; ix < ndivs; ++ix)
+		{
+			double wr0 = -1.0 + 2.0*ix / ndivs;
+			double wr1 = -1.0 + 2.0*(ix + 1) / ndivs;
+			for (int iy = 0; iy < ndivs; ++iy)
 			{
-				// loop over faces
-				int* pf = LUT[ncase];
-				int ne = 0;
-				for (int l = 0; l < 5; l++)
+				double ws0 = -1.0 + 2.0*iy / ndivs;
+				double ws1 = -1.0 + 2.0*(iy + 1) / ndivs;
+				for (int iz = 0; iz < ndivs; ++iz)
 				{
-					if (*pf == -1) break;
-
-					// calculate nodal positions
-					vec3d r[3];
-					float tex[3], w1, w2, w;
-					for (int k = 0; k < 3; k++)
+					double wt0 = -1.0 + 2.0*iz / ndivs;
+					double wt1 = -1.0 + 2.0*(iz + 1) / ndivs;
+
+					double H[8][8];
+					HEX8::shape(H[0], wr0, ws0, wt0);
+					HEX8::shape(H[1], wr1, ws0, wt0);
+					HEX8::shape(H[2], wr1, ws1, wt0);
+					HEX8::shape(H[3], wr0, ws1, wt0);
+					HEX8::shape(H[4], wr0, ws0, wt1);
+					HEX8::shape(H[5], wr1, ws0, wt1);
+					HEX8::shape(H[6], wr1, ws1, wt1);
+					HEX8::shape(H[7], wr0, ws1, wt1);
+
+					vec3d x[8];
+					float v[8];
+					for (int kk = 0; kk < 8; ++kk)
 					{
-						int n1 = ET_HEX[pf[k]][0];
-						int n2 = ET_HEX[pf[k]][1];
+						double* h = H[kk];
+						x[kk] = vec3d(0, 0, 0);
+						v[kk] = 0.0;
+						for (int jj = 0; jj < 8; ++jj)
+						{
+							x[kk] += ex[jj] * h[jj];
+							v[kk] += ev[jj] * h[jj];
+						}
+					}																					
 
-						w1 = norm * ex[n1];
-						w2 = norm * ex[n2];
+					// calculate the case of the element
+					int ncase = 0;
+					for (int k = 0; k < 8; ++k)
+						if (norm*x[k] >= ref) ncase |= (1 << k);
 
-						if (w2 != w1)
-							w = (ref - w1) / (w2 - w1);
-						else
-							w = 0.f;
+					// loop over faces
+					int* pf = LUT[ncase];
+					int ne = 0;
+					for (int l = 0; l < 5; l++)
+					{
+						if (*pf == -1) break;
 
-						float v = ev[n1] * (1 - w) + ev[n2] * w;
+						// calculate nodal positions
+						vec3d r[3];
+						float tex[3], w1, w2, w;
+						for (int k = 0; k < 3; k++)
+						{
+							int n1 = ET_HEX[pf[k]][0];
+							int n2 = ET_HEX[pf[k]][1];
 
-						r[k] = ex[n1] * (1 - w) + ex[n2] * w;
-						tex[k] = v;
-						rf[k] = ((nf[n1] == 1) && (nf[n2] == 1) ? 1 : 0);
-					}
+							w1 = norm * x[n1];
+							w2 = norm * x[n2];
 
-					GLSlice::FACE face;
-					face.mat = n;
-					face.norm = norm;
-					face.r[0] = r[0];
-					face.r[1] = r[1];
-					face.r[2] = r[2];
-					face.tex[0] = tex[0];
-					face.tex[1] = tex[1];
-					face.tex[2] = tex[2];
-					face.bactive = el.IsActive();
+							if (w2 != w1)
+								w = (ref - w1) / (w2 - w1);
+							else
+								w = 0.f;
 
-					m_slice.AddFace(face);
+							float f = v[n1] * (1 - w) + v[n2] * w;
 
-					pf += 3;
-				}
-			}
-			else
-			{
-				for (int ix = 0; ix < ndivs; ++ix)
-				{
-					double wr0 = -1.0 + 2.0*ix / ndivs;
-					double wr1 = -1.0 + 2.0*(ix + 1) / ndivs;
-					for (int iy = 0; iy < ndivs; ++iy)
-					{
-						double ws0 = -1.0 + 2.0*iy / ndivs;
-						double ws1 = -1.0 + 2.0*(iy + 1) / ndivs;
-						for (int iz = 0; iz < ndivs; ++iz)
-						{
-							double wt0 = -1.0 + 2.0*iz / ndivs;
-							double wt1 = -1.0 + 2.0*(iz + 1) / ndivs;
-
-							double H[8][8];
-							HEX8::shape(H[0], wr0, ws0, wt0);
-							HEX8::shape(H[1], wr1, ws0, wt0);
-							HEX8::shape(H[2], wr1, ws1, wt0);
-							HEX8::shape(H[3], wr0, ws1, wt0);
-							HEX8::shape(H[4], wr0, ws0, wt1);
-							HEX8::shape(H[5], wr1, ws0, wt1);
-							HEX8::shape(H[6], wr1, ws1, wt1);
-							HEX8::shape(H[7], wr0, ws1, wt1);
-
-							vec3d x[8];
-							float v[8];
-							for (int kk = 0; kk < 8; ++kk)
-							{
-								double* h = H[kk];
-								x[kk] = vec3d(0, 0, 0);
-								v[kk] = 0.0;
-								for (int jj = 0; jj < 8; ++jj)
-								{
-									x[kk] += ex[jj] * h[jj];
-									v[kk] += ev[jj] * h[jj];
-								}
-							}																					
-
-							// calculate the case of the element
-							int ncase = 0;
-							for (int k = 0; k < 8; ++k)
-								if (norm*x[k] >= ref) ncase |= (1 << k);
-
-							// loop over faces
-							int* pf = LUT[ncase];
-							int ne = 0;
-							for (int l = 0; l < 5; l++)
-							{
-								if (*pf == -1) break;
-
-								// calculate nodal positions
-								vec3d r[3];
-								float tex[3], w1, w2, w;
-								for (int k = 0; k < 3; k++)
-								{
-									int n1 = ET_HEX[pf[k]][0];
-									int n2 = ET_HEX[pf[k]][1];
-
-									w1 = norm * x[n1];
-									w2 = norm * x[n2];
-
-									if (w2 != w1)
-										w = (ref - w1) / (w2 - w1);
-									else
-										w = 0.f;
-
-									float f = v[n1] * (1 - w) + v[n2] * w;
-
-									r[k] = x[n1] * (1 - w) + x[n2] * w;
-									tex[k] = f;
-								}
-
-								GLSlice::FACE face;
-								face.mat = n;
-								face.norm = norm;
-								face.r[0] = r[0];
-								face.r[1] = r[1];
-								face.r[2] = r[2];
-								face.tex[0] = tex[0];
-								face.tex[1] = tex[1];
-								face.tex[2] = tex[2];
-								face.bactive = el.IsActive();
-
-								m_slice.AddFace(face);
-
-								pf += 3;
-							}
+							r[k] = x[n1] * (1 - w) + x[n2] * w;
+							tex[k] = f;
 						}
+
+						GLSlice::FACE face;
+						face.mat = n;
+						face.norm = norm;
+						face.r[0] = r[0];
+						face.r[1] = r[1];
+						face.r[2] = r[2];
+						face.tex[0] = tex[0];
+						face.tex[1] = tex[1];
+						face.tex[2] = tex[2];
+						face.bactive = el.IsActive();
+
+						faces.push_back(face);
+
+						pf += 3;
 					}
 				}
 			}
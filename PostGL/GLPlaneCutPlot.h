@@ -61,6 +61,7 @@ class CGLPlaneCutPlot : public CGLPlot
 		FACE& Face(int i) { return m_Face[i]; }
 
 		void AddFace(FACE& f) { m_Face.push_back(f); }
+		void AddFaces(const std::vector<FACE>& f) { m_Face.insert(m_Face.end(), f.begin(), f.end()); }
 
 		int Edges() const { return (int) m_Edge.size(); }
 		EDGE& Edge(int i) { return m_Edge[i]; }
@@ -73,6 +74,17 @@ class CGLPlaneCutPlot : public CGLPlot
 		std::vector<EDGE>	m_Edge;
 	};
 
+	// The element index stores the range of the projection of the solid elements
+	// onto the plane normal. It is used to find the elements that are cut by the
+	// plane without visiting all the elements.
+	struct ELEM_RANGE
+	{
+		int		ndom;	// domain index
+		int		nel;	// element index
+		double	dmin;	// min projection of element nodes
+		double	dmax;	// max projection of element nodes
+	};
+
 public:
 	CGLPlaneCutPlot();
 	virtual ~CGLPlaneCutPlot();
@@ -111,9 +123,12 @@ protected:
 	static int GetFreePlane();
 	void UpdateSlice();
 
-	void AddDomain(FEPostMesh* pm, int n);
+	void AddElement(FEPostMesh* pm, int ndom, FEElement_& el, const vec3d& norm, double ref, int ndivs, std::vector<GLSlice::FACE>& faces);
 	void AddFaces(FEPostMesh* pm);
 
+	void BuildElementIndex(FEPostMesh* pm, const vec3d& norm);
+	void FindCutElements(double ref, std::vector<const ELEM_RANGE*>& elems);
+
 public:
 	static int ClipPlanes();
 	static CGLPlaneCutPlot* GetClipPlane(int i);
@@ -144,6 +159,15 @@ protected:
 
 	GLSlice	m_slice;
 
+	// element index (see ELEM_RANGE)
+	std::vector<ELEM_RANGE>	m_elemRange;	// regular elements (sorted by dmin)
+	std::vector<ELEM_RANGE>	m_largeElem;	// elements with a large range
+	double		m_maxSpan;		// max range of elements in m_elemRange
+	vec3d		m_indexNorm;	// plane normal used to build the index
+	FEPostMesh*	m_indexMesh;	// mesh used to build the index
+	bool		m_bindexValid;
+	std::vector<int>	m_cutElem;	// cut elements (indices into the mesh's element list)
+
 	int		m_nclip;								// clip plane number
 	static	std::vector<int>				m_clip;	// avaialabe clip planes
 	static	std::vector<CGLPlaneCutPlot*>	m_pcp;
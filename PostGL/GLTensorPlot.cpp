@@ -443,11 +443,6 @@ void GLTensorPlot::Render(CGLContext& rc)
 	// store attributes
 	glPushAttrib(GL_LIGHTING_BIT);
 
-	// create the cylinder object
-	glEnable(GL_LIGHTING);
-	GLUquadricObj* pglyph = gluNewQuadric();
-	gluQuadricNormals(pglyph, GLU_SMOOTH);
-
 	CGLModel* mdl = GetModel();
 	FEPostModel* ps = mdl->GetFSModel();
 
@@ -458,13 +453,18 @@ void GLTensorPlot::Render(CGLContext& rc)
 
 	float scale = 0.02f*m_scale*pfem->GetBoundingBox().Radius();
 
+	// the selected tensors, their positions and colors
+	vector<int> tens;
+	vector<vec3f> pos;
+	vector<GLColor> col;
+	float auto_scale = 1.f;
+
 	if (m_nglyph == Glyph_Line) glDisable(GL_LIGHTING);
 	else
 	{
 		glEnable(GL_LIGHTING);
 		glEnable(GL_COLOR_MATERIAL);
 		glColorMaterial(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE);
-		glColor3ub(m_gcl.r, m_gcl.g, m_gcl.b);
 
 		GLfloat dif[] = { 1.f, 1.f, 1.f, 1.f };
 		GLfloat amb[] = { 0.1f, 0.1f, 0.1f, 1.f };
@@ -496,7 +496,6 @@ void GLTensorPlot::Render(CGLContext& rc)
 			}
 		}
 
-		float auto_scale = 1.f;
 		if (m_bautoscale)
 		{
 			float Lmax = 0.f;
@@ -529,20 +528,18 @@ void GLTensorPlot::Render(CGLContext& rc)
 			FEElement_& elem = pm->ElementRef(i);
 			if ((frand() <= m_dens) && elem.m_ntag)
 			{
-				vec3d r = pm->ElementCenter(elem);
-
 				TENSOR& t = m_val[i];
 
+				GLColor c = m_gcl;
 				if (m_ncol != Glyph_Col_Solid)
 				{
 					float w = (t.f - fmin) / (fmax - fmin);
-					GLColor c = map.map(w);
-					glColor3ub(c.r, c.g, c.b);
+					c = map.map(w);
 				}
 
-				glTranslatef(r.x, r.y, r.z);
-				RenderGlyphs(t, scale*auto_scale, pglyph);
-				glTranslatef(-r.x, -r.y, -r.z);
+				tens.push_back(i);
+				pos.push_back(to_vec3f(pm->ElementCenter(elem)));
+				col.push_back(c);
 			}
 		}
 	}
@@ -570,7 +567,6 @@ void GLTensorPlot::Render(CGLContext& rc)
 			}
 		}
 
-		float auto_scale = 1.f;
 		if (m_bautoscale)
 		{
 			float Lmax = 0.f;
@@ -597,34 +593,55 @@ void GLTensorPlot::Render(CGLContext& rc)
 
 		if (fmax == fmin) fmax++;
 
-		if (m_nglyph == Glyph_Line) glDisable(GL_LIGHTING);
-
-		glx::glcolor(m_gcl);
-
 		for (int i = 0; i < pm->Nodes(); ++i)
 		{
 			FSNode& node = pm->Node(i);
 			if ((frand() <= m_dens) && node.m_ntag)
 			{
-				vec3d r = node.r;
-
 				TENSOR& t = m_val[i];
 
+				GLColor c = m_gcl;
 				if (m_ncol != Glyph_Col_Solid)
 				{
 					float w = (t.f  - fmin)/ (fmax - fmin);
-					GLColor c = map.map(w);
-					glx::glcolor(c);
+					c = map.map(w);
 				}
 
-				glx::translate(r);
-				RenderGlyphs(t, scale*auto_scale, pglyph);
-				glx::translate(-r);
+				tens.push_back(i);
+				pos.push_back(to_vec3f(node.r));
+				col.push_back(c);
 			}
 		}
 	}
 
-	gluDeleteQuadric(pglyph);
+	// setup the glyphs
+	int maxGlyphs = ((m_nglyph == Glyph_Arrow) || (m_nglyph == Glyph_Line) ? 3 : 1);
+	int NT = (int)tens.size();
+	m_glyph.resize((size_t)NT*maxGlyphs);
+	vector<int> glyphs(NT);
+#pragma omp parallel for schedule(static)
+	for (int i = 0; i < NT; ++i)
+	{
+		glyphs[i] = AddGlyphs(m_val[tens[i]], pos[i], scale*auto_scale, col[i], &m_glyph[(size_t)i*maxGlyphs]);
+	}
+
+	// remove the unused slots
+	int ng = 0;
+	for (int i = 0; i < NT; ++i)
+	{
+		for (int j = 0; j < glyphs[i]; ++j) m_glyph[ng++] = m_glyph[(size_t)i*maxGlyphs + j];
+	}
+	m_glyph.resize(ng);
+
+	// render the glyphs
+	switch (m_nglyph)
+	{
+	case Glyph_Arrow : m_glyphs.SetShape(GLGlyphBuffer::ARROW); break;
+	case Glyph_Line  : m_glyphs.SetShape(GLGlyphBuffer::LINE); break;
+	case Glyph_Sphere: m_glyphs.SetShape(GLGlyphBuffer::SPHERE, 16, 16); break;
+	case Glyph_Box   : m_glyphs.SetShape(GLGlyphBuffer::BOX); break;
+	}
+	m_glyphs.Render(m_glyph);
 
 	// restore attributes
 	glPopAttrib();
@@ -632,18 +649,20 @@ void GLTensorPlot::Render(CGLContext& rc)
 	glColorMaterial(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE);
 }
 
-void GLTensorPlot::RenderGlyphs(TENSOR& t, float scale, GLUquadricObj* glyph)
+int GLTensorPlot::AddGlyphs(const TENSOR& t, const vec3f& r, float scale, GLColor c, GLGlyphBuffer::GLYPH* g)
 {
 	switch (m_nglyph)
 	{
-	case Glyph_Arrow : RenderArrows(t, scale, glyph); break;
-	case Glyph_Line  : RenderLines (t, scale, glyph); break;
-	case Glyph_Sphere: RenderSphere(t, scale, glyph); break;
-	case Glyph_Box   : RenderBox   (t, scale, glyph); break;
+	case Glyph_Arrow :
+	case Glyph_Line  : return AddArrows(t, r, scale, g);
+	case Glyph_Sphere:
+	case Glyph_Box   : return AddEllipsoid(t, r, scale, c, g);
 	}
+	return 0;
 }
 
-void GLTensorPlot::RenderArrows(GLTensorPlot::TENSOR& t, float scale, GLUquadricObj* pglyph)
+// Arrows (or lines) along the principal directions
+int GLTensorPlot::AddArrows(const TENSOR& t, const vec3f& r, float scale, GLGlyphBuffer::GLYPH* g)
 {
 	GLColor c[3];
 	c[0] = GLColor(255, 0, 0);
@@ -652,115 +671,43 @@ void GLTensorPlot::RenderArrows(GLTensorPlot::TENSOR& t, float scale, GLUquadric
 
 	for (int i = 0; i<3; ++i)
 	{
-		glPushMatrix();
-
 		float L = (m_bnormalize ? scale : scale*t.l[i]);
-		float l0 = L*.9;
-		float l1 = L*.2;
-		float r0 = L*0.05;
-		float r1 = L*0.15;
-
-		vec3f v = t.r[i];
-		quatd q = quatd(vec3d(0,0,1), to_vec3d(v));
-		float w = q.GetAngle();
-		if (fabs(w) > 1e-6)
-		{
-			vec3d p = q.GetVector();
-			if (p.Length() > 1e-6) glRotated(w * 180 / PI, p.x, p.y, p.z);
-		}
-
-		glColor3ub(c[i].r, c[i].g, c[i].b);
-		gluCylinder(pglyph, r0, r0, l0, 5, 1);
-		glTranslatef(0.f, 0.f, (float)l0*0.9f);
-		gluCylinder(pglyph, r1, 0, l1, 10, 1);
 
-		glPopMatrix();
+		g[i].r = r;
+		g[i].c = c[i];
+		GLGlyphBuffer::AlignZ(g[i], t.r[i]);
+		g[i].s = vec3f(L, L, L);
 	}
+	return 3;
 }
 
-void GLTensorPlot::RenderLines(GLTensorPlot::TENSOR& t, float scale, GLUquadricObj* pglyph)
+// Sphere (or box) scaled along the principal directions
+int GLTensorPlot::AddEllipsoid(const TENSOR& t, const vec3f& r, float scale, GLColor c, GLGlyphBuffer::GLYPH* g)
 {
-	GLColor c[3];
-	c[0] = GLColor(255, 0, 0);
-	c[1] = GLColor(0, 255, 0);
-	c[2] = GLColor(0, 0, 255);
-
-	for (int i = 0; i<3; ++i)
-	{
-		glPushMatrix();
-
-		float L = (m_bnormalize ? scale : scale*t.l[i]);
-
-		vec3f v = t.r[i];
-		quatd q = quatd(vec3d(0, 0, 1), to_vec3d(v));
-		float w = q.GetAngle();
-		if (fabs(w) > 1e-6)
-		{
-			vec3d p = q.GetVector();
-			if (p.Length() > 1e-6) glRotatef(w * 180 / PI, p.x, p.y, p.z);
-		}
-
-		glx::glcolor(c[i]);
-		glx::drawLine(0, 0, 0, 0, 0, L);
-
-		glPopMatrix();
-	}
-}
-
-void GLTensorPlot::RenderSphere(TENSOR& t, float scale, GLUquadricObj* glyph)
-{
-	if (scale <= 0.f) return;
+	if (scale <= 0.f) return 0;
 
 	float smax = 0.f;
 	float sx = fabs(t.l[0]); if (sx > smax) smax = sx;
 	float sy = fabs(t.l[1]); if (sy > smax) smax = sy;
 	float sz = fabs(t.l[2]); if (sz > smax) smax = sz;
-	if (smax < 1e-7f) return;
+	if (smax < 1e-7f) return 0;
 
 	if (sx < 0.1*smax) sx = 0.1f*smax;
 	if (sy < 0.1*smax) sy = 0.1f*smax;
 	if (sz < 0.1*smax) sz = 0.1f*smax;
 
-	glPushMatrix();
-	vec3f* e = t.r;
-	vec3f n = e[0] ^ e[1];
-	if (n*e[2] < 0) e[2] = -e[2];
-	GLfloat m[4][4] = {0};
-	m[3][3] = 1.f;
-	m[0][0] = e[0].x; m[0][1] = e[0].y; m[0][2] = e[0].z;
-	m[1][0] = e[1].x; m[1][1] = e[1].y; m[1][2] = e[1].z;
-	m[2][0] = e[2].x; m[2][1] = e[2].y; m[2][2] = e[2].z;
-	glMultMatrixf(&m[0][0]);
-
-	glScalef(scale*sx, scale*sy, scale*sz);
-	gluSphere(glyph, 1.f, 16, 16);
-	glPopMatrix();
-}
-
-void GLTensorPlot::RenderBox(TENSOR& t, float scale, GLUquadricObj* glyph)
-{
-	if (scale <= 0.f) return;
-
-	float smax = 0.f;
-	float sx = fabs(t.l[0]); if (sx > smax) smax = sx;
-	float sy = fabs(t.l[1]); if (sy > smax) smax = sy;
-	float sz = fabs(t.l[2]); if (sz > smax) smax = sz;
-	if (smax < 1e-7f) return;
-
-	if (sx < 0.1*smax) sx = 0.1f*smax;
-	if (sy < 0.1*smax) sy = 0.1f*smax;
-	if (sz < 0.1*smax) sz = 0.1f*smax;
+	g->r = r;
+	g->c = c;
+	g->e[0] = t.r[0];
+	g->e[1] = t.r[1];
+	g->e[2] = t.r[2];
+	if (m_nglyph == Glyph_Sphere)
+	{
+		vec3f n = g->e[0] ^ g->e[1];
+		if (n*g->e[2] < 0) g->e[2] = -g->e[2];
+		g->s = vec3f(scale*sx, scale*sy, scale*sz);
+	}
+	else g->s = vec3f(0.5f*scale*sx, 0.5f*scale*sy, 0.5f*scale*sz);
 
-	glPushMatrix();
-	vec3f* e = t.r;
-	GLfloat m[4][4] = { 0 };
-	m[3][3] = 1.f;
-	m[0][0] = e[0].x; m[0][1] = e[0].y; m[0][2] = e[0].z;
-	m[1][0] = e[1].x; m[1][1] = e[1].y; m[1][2] = e[1].z;
-	m[2][0] = e[2].x; m[2][1] = e[2].y; m[2][2] = e[2].z;
-	glMultMatrixf(&m[0][0]);
-
-	glScalef(scale*sx, scale*sy, scale*sz);
-	glx::drawBox(0.5, 0.5, 0.5);
-	glPopMatrix();
+	return 1;
 }
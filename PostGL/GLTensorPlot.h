@@ -27,11 +27,7 @@ SOFTWARE.*/
 #pragma once
 #include "GLPlot.h"
 #include <GLWLib/GLWidget.h>
-#ifdef __APPLE__
-    #include <OpenGL/GLU.h>
-#else
-    #include <GL/glu.h>
-#endif
+#include <GLLib/GLGlyphBuffer.h>
 
 namespace Post {
 
@@ -109,11 +105,10 @@ public:
 	void SetNormalize(bool b) { m_bnormalize = b; }
 
 protected:
-	void RenderGlyphs(TENSOR& t, float scale, GLUquadricObj* glyph);
-	void RenderArrows(TENSOR& t, float scale, GLUquadricObj* glyph);
-	void RenderLines(TENSOR& t, float scale, GLUquadricObj* glyph);
-	void RenderSphere(TENSOR& t, float scale, GLUquadricObj* glyph);
-	void RenderBox(TENSOR& t, float scale, GLUquadricObj* glyph);
+	// setup the glyphs of a tensor at position r. Returns the nr of glyphs.
+	int AddGlyphs(const TENSOR& t, const vec3f& r, float scale, GLColor c, GLGlyphBuffer::GLYPH* g);
+	int AddArrows(const TENSOR& t, const vec3f& r, float scale, GLGlyphBuffer::GLYPH* g);
+	int AddEllipsoid(const TENSOR& t, const vec3f& r, float scale, GLColor c, GLGlyphBuffer::GLYPH* g);
 
 	void Update() override;
 
@@ -144,5 +139,8 @@ protected:
 	int		m_lastTime;
 	float	m_lastDt;
 	int		m_lastCol;
+
+	GLGlyphBuffer	m_glyphs;	// for rendering the glyphs
+	vector<GLGlyphBuffer::GLYPH>	m_glyph;	// the glyphs of the last render
 };
 }
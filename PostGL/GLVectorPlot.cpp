@@ -178,16 +178,14 @@ void CGLVectorPlot::Render(CGLContext& rc)
 	// store attributes
 	glPushAttrib(GL_ENABLE_BIT | GL_LIGHTING_BIT);
 
-	// create the cylinder object
-	glEnable(GL_LIGHTING);
-	GLUquadricObj* pglyph = gluNewQuadric();
-	gluQuadricNormals(pglyph, GLU_SMOOTH);
-
 	CGLModel* mdl = GetModel();
 	FEPostModel* ps = mdl->GetFSModel();
 
 	srand(m_seed);
 
+	// positions and values of the vectors that will be drawn
+	vector<vec3f> pos, val;
+
 	FEPostModel* pfem = mdl->GetFSModel();
 	FEPostMesh* pm = mdl->GetActiveMesh();
 
@@ -249,11 +247,10 @@ void CGLVectorPlot::Render(CGLContext& rc)
 		for (int i = 0; i < pm->Elements(); ++i)
 		{
 			FEElement_& elem = pm->ElementRef(i);
-			if ((frand() <= m_dens) && elem.m_ntag)
+			if ((frand() <= m_dens) && elem.m_ntag && (m_val[i].Length() > 0.f))
 			{
-				vec3f r = to_vec3f(pm->ElementCenter(elem));
-				vec3f v = m_val[i];
-				RenderVector(r, v, pglyph);
+				pos.push_back(to_vec3f(pm->ElementCenter(elem)));
+				val.push_back(m_val[i]);
 			}
 		}
 	}
@@ -284,18 +281,31 @@ void CGLVectorPlot::Render(CGLContext& rc)
 		for (int i = 0; i < pm->Nodes(); ++i)
 		{
 			FSNode& node = pm->Node(i);
-			if ((frand() <= m_dens) && node.m_ntag)
+			if ((frand() <= m_dens) && node.m_ntag && (m_val[i].Length() > 0.f))
 			{
-				vec3f r = to_vec3f(node.r);
-
-				vec3f v = m_val[i];
-
-				RenderVector(r, v, pglyph);
+				pos.push_back(to_vec3f(node.r));
+				val.push_back(m_val[i]);
 			}
 		}
 	}
 
-	gluDeleteQuadric(pglyph);
+	// setup the glyphs
+	int NG = (int)pos.size();
+	m_glyph.resize(NG);
+#pragma omp parallel for schedule(static)
+	for (int i = 0; i < NG; ++i) AddGlyph(pos[i], val[i], m_glyph[i]);
+
+	// render the glyphs
+	switch (m_nglyph)
+	{
+	case GLYPH_ARROW   : m_glyphs.SetShape(GLGlyphBuffer::ARROW); break;
+	case GLYPH_CONE    : m_glyphs.SetShape(GLGlyphBuffer::CONE); break;
+	case GLYPH_CYLINDER: m_glyphs.SetShape(GLGlyphBuffer::CYLINDER); break;
+	case GLYPH_SPHERE  : m_glyphs.SetShape(GLGlyphBuffer::SPHERE, 10, 5); break;
+	case GLYPH_BOX     : m_glyphs.SetShape(GLGlyphBuffer::BOX); break;
+	case GLYPH_LINE    : m_glyphs.SetShape(GLGlyphBuffer::LINE); break;
+	}
+	m_glyphs.Render(m_glyph);
 
 	// restore attributes
 	glPopAttrib();
@@ -303,10 +313,9 @@ void CGLVectorPlot::Render(CGLContext& rc)
 	glColorMaterial(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE);
 }
 
-void CGLVectorPlot::RenderVector(const vec3f& r, vec3f v, GLUquadric* pglyph)
+void CGLVectorPlot::AddGlyph(const vec3f& r, const vec3f& v, GLGlyphBuffer::GLYPH& g)
 {
 	float L = v.Length();
-	if (L == 0.f) return;
 
 	CColorMap& map = ColorMapManager::GetColorMap(m_Col.GetColorMap());
 
@@ -314,71 +323,38 @@ void CGLVectorPlot::RenderVector(const vec3f& r, vec3f v, GLUquadric* pglyph)
 	float fmax = m_crng.y;
 
 	float f = (L - fmin) / (fmax - fmin);
-	GLColor col = map.map(f);
-	v.Normalize();
+	vec3f n = v; n.Normalize();
 
 	switch (m_ncol)
 	{
 	case GLYPH_COL_LENGTH:
-		glColor3ub(col.r, col.g, col.b);
+		g.c = map.map(f);
 		break;
 	case GLYPH_COL_ORIENT:
-	{
-		GLdouble r = fabs(v.x);
-		GLdouble g = fabs(v.y);
-		GLdouble b = fabs(v.z);
-		glColor3d(r, g, b);
-	}
-	break;
+		g.c = GLColor((Byte)(255 * fabs(n.x)), (Byte)(255 * fabs(n.y)), (Byte)(255 * fabs(n.z)));
+		break;
 	case GLYPH_COL_SOLID:
 	default:
-		glColor3ub(m_gcl.r, m_gcl.g, m_gcl.b);
+		g.c = GLColor(m_gcl.r, m_gcl.g, m_gcl.b);
 	}
 
 	if (m_bnorm) L = 1;
 
 	L *= m_fscale;
-	float l0 = L*.9;
-	float l1 = L*.2;
-	float r0 = L*0.05*m_ar;
-	float r1 = L*0.15*m_ar;
+	float r0 = L*0.05f*m_ar;
+	float r1 = L*0.15f*m_ar;
 
-	glPushMatrix();
-
-	glTranslatef(r.x, r.y, r.z);
-	quatd q(vec3d(0,0,1), to_vec3d(v));
-	float w = q.GetAngle();
-	if (fabs(w) > 1e-6)
-	{
-		vec3d p = q.GetVector();
-		if (p.Length() > 1e-6) glRotated(w * 180 / PI, p.x, p.y, p.z);
-		else glRotated(w * 180 / PI, 1, 0, 0);
-	}
+	g.r = r;
+	GLGlyphBuffer::AlignZ(g, n);
 
 	switch (m_nglyph)
 	{
-	case GLYPH_ARROW:
-		gluCylinder(pglyph, r0, r0, l0, 5, 1);
-		glTranslatef(0.f, 0.f, (float)l0*0.9f);
-		gluCylinder(pglyph, r1, 0, l1, 10, 1);
-		break;
-	case GLYPH_CONE:
-		gluCylinder(pglyph, r1, 0, l0, 10, 1);
-		break;
-	case GLYPH_CYLINDER:
-		gluCylinder(pglyph, r1, r1, l0, 10, 1);
-		break;
-	case GLYPH_SPHERE:
-		gluSphere(pglyph, r1, 10, 5);
-		break;
-	case GLYPH_BOX:
-		glx::drawBox(r0, r0, r0);
-		break;
-	case GLYPH_LINE:
-		glx::drawLine(0, 0, 0, 0, 0, L);
+	case GLYPH_SPHERE: g.s = vec3f(r1, r1, r1); break;
+	case GLYPH_BOX   : g.s = vec3f(r0, r0, r0); break;
+	case GLYPH_LINE  : g.s = vec3f(L, L, L); break;
+	default:
+		g.s = vec3f(L*m_ar, L*m_ar, L);
 	}
-
-	glPopMatrix();
 }
 
 void CGLVectorPlot::SetVectorField(int ntype) 
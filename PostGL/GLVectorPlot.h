@@ -26,8 +26,7 @@ SOFTWARE.*/
 
 #pragma once
 #include "GLPlot.h"
-
-class GLUquadric;
+#include <GLLib/GLGlyphBuffer.h>
 
 namespace Post {
 
@@ -114,8 +113,8 @@ public:
 	void Activate(bool b) override;
 
 private:
-	// render a vector n at position r
-	void RenderVector(const vec3f& r, vec3f v, GLUquadric* pglyph);
+	// setup the glyph for a vector v at position r
+	void AddGlyph(const vec3f& r, const vec3f& v, GLGlyphBuffer::GLYPH& g);
 
 	void UpdateState(int nstate);
 
@@ -152,5 +151,8 @@ protected:
 	vec2f			m_staticRange;
 
 	float			m_fscale;	// total scale factor for rendering
+
+	GLGlyphBuffer	m_glyphs;	// for rendering the glyphs
+	vector<GLGlyphBuffer::GLYPH>	m_glyph;	// the glyphs of the last render
 };
 }
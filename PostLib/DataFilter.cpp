@@ -30,18 +30,103 @@ SOFTWARE.*/
 #include "constants.h"
 #include "FEMeshData_T.h"
 #include "evaluate.h"
+#include <atomic>
+#include <omp.h>
 using namespace Post;
 using namespace std;
 
-bool Post::DataScale(FEPostModel& fem, int nfield, double scale)
+//-----------------------------------------------------------------------------
+// checks if the data of a field can be read by multiple threads in all states
+static bool isThreadSafe(FEPostModel& fem, int nfield)
+{
+	// don't load the states here, they are processed one by one anyway
+	if (fem.GetStateLoader() != nullptr) return false;
+	for (int n = 0; n < fem.GetStates(); ++n)
+	{
+		if (fem.IsThreadSafeField(nfield, n) == false) return false;
+	}
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Calls f(n) for all states n. Each state is processed by one thread, so the
+// results are the same as when the states are processed in order. If the
+// states cannot be processed in parallel (e.g. when bparallel is false or when
+// there is only one state), the parallel loops inside f use the threads instead.
+// Returns false if f fails for a state, or when the filter was canceled.
+template <class F> static bool forEachState(FEPostModel& fem, bool bparallel, DataFilterProgress* progress, F f)
+{
+	// the prefetcher should not touch the states while we modify them
+	fem.CancelPrefetch();
+
+	// states that are loaded on demand must be loaded one at a time
+	int NS = fem.GetStates();
+	if ((NS < 2) || (fem.GetStateLoader() != nullptr)) bparallel = false;
+
+	std::atomic<bool> bok(true);
+	int ndone = 0;
+#pragma omp parallel for schedule(dynamic) if (bparallel)
+	for (int n = 0; n < NS; ++n)
+	{
+		if (bok == false) continue;
+
+		// exceptions cannot leave the parallel region
+		try {
+			if (f(n) == false) bok = false;
+		}
+		catch (...)
+		{
+			bok = false;
+		}
+
+#pragma omp critical (DataFilterProgress)
+		{
+			ndone++;
+			if (progress)
+			{
+				progress->SetProgress((double)ndone / NS);
+				if (progress->IsCanceled()) bok = false;
+			}
+		}
+	}
+
+	return bok;
+}
+
+//-----------------------------------------------------------------------------
+// Same as forEachState, for filters that modify the field nfield in place. When
+// the filter fails or is canceled, the field is restored in all states. The
+// data of a state is copied just before the state is modified, and only when the
+// filter can be canceled. States that are loaded on demand may be released while
+// the filter runs, so they are not restored.
+template <class F> static bool forEachStateInPlace(FEPostModel& fem, int nfield, bool bparallel, DataFilterProgress* progress, F f)
+{
+	int ndata = FIELD_CODE(nfield);
+	vector<FEMeshDataBackup*> backup;
+	if (progress && (fem.GetStateLoader() == nullptr)) backup.assign(fem.GetStates(), nullptr);
+
+	bool bok = forEachState(fem, bparallel, progress, [&](int n) {
+		if (!backup.empty()) backup[n] = fem.GetState(n)->m_Data[ndata].Backup();
+		return f(n);
+	});
+
+	for (FEMeshDataBackup* b : backup)
+	{
+		if (b && (bok == false)) b->Restore();
+		delete b;
+	}
+
+	return bok;
+}
+
+bool Post::DataScale(FEPostModel& fem, int nfield, double scale, DataFilterProgress* progress)
 {
 	Post::FEPostMesh& mesh = *fem.GetFEMesh(0);
 	float fscale = (float) scale;
 	// loop over all states
 	int NN = mesh.Nodes();
 	int ndata = FIELD_CODE(nfield);
-	for (int i = 0; i<fem.GetStates(); ++i)
-	{
+	return forEachStateInPlace(fem, nfield, true, progress, [&](int i) {
 		FEState& s = *fem.GetState(i);
 		FEMeshData& d = s.m_Data[ndata];
 		Data_Type type = d.GetType();
@@ -53,30 +138,35 @@ bool Post::DataScale(FEPostModel& fem, int nfield, double scale)
 			case DATA_FLOAT:
 			{
 				FENodeData<float>* pf = dynamic_cast< FENodeData<float>* >(&d);
+				if (pf == nullptr) return false;
 				for (int n = 0; n<NN; ++n) { float& v = (*pf)[n]; v *= fscale; }
 			}
 			break;
 			case DATA_VEC3F:
 			{
 				FENodeData<vec3f>* pv = dynamic_cast< FENodeData<vec3f>* >(&d);
+				if (pv == nullptr) return false;
 				for (int n = 0; n<NN; ++n) { vec3f& v = (*pv)[n]; v *= fscale; }
 			}
 			break;
 			case DATA_MAT3FS:
 			{
 				FENodeData<mat3fs>* pv = dynamic_cast< FENodeData<mat3fs>* >(&d);
+				if (pv == nullptr) return false;
 				for (int n = 0; n<NN; ++n) { mat3fs& v = (*pv)[n]; v *= fscale; }
 			}
 			break;
 			case DATA_MAT3D:
 			{
 				FENodeData<mat3d>* pv = dynamic_cast< FENodeData<mat3d>* >(&d);
+				if (pv == nullptr) return false;
 				for (int n = 0; n<NN; ++n) { mat3d& v = (*pv)[n]; v *= fscale; }
 			}
 			break;
 			case DATA_MAT3F:
 			{
 				FENodeData<mat3f>* pv = dynamic_cast< FENodeData<mat3f>* >(&d);
+				if (pv == nullptr) return false;
 				for (int n = 0; n<NN; ++n) { mat3f& v = (*pv)[n]; v *= fscale; }
 			}
 			break;
@@ -93,24 +183,28 @@ bool Post::DataScale(FEPostModel& fem, int nfield, double scale)
 				if (fmt == DATA_NODE)
 				{
 					FEElementData<float, DATA_NODE>* pf = dynamic_cast<FEElementData<float, DATA_NODE>*>(&d);
+					if (pf == nullptr) return false;
 					int N = pf->size();
 					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
 				}
 				else if (fmt == DATA_ITEM)
 				{
 					FEElementData<float, DATA_ITEM>* pf = dynamic_cast<FEElementData<float, DATA_ITEM>*>(&d);
+					if (pf == nullptr) return false;
 					int N = pf->size();
 					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
 				}
 				else if (fmt == DATA_COMP)
 				{
 					FEElementData<float, DATA_COMP>* pf = dynamic_cast<FEElementData<float, DATA_COMP>*>(&d);
+					if (pf == nullptr) return false;
 					int N = pf->size();
 					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
 				}
 				else if (fmt == DATA_REGION)
 				{
 					FEElementData<float, DATA_REGION>* pf = dynamic_cast<FEElementData<float, DATA_REGION>*>(&d);
+					if (pf == nullptr) return false;
 					int N = pf->size();
 					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
 				}
@@ -121,24 +215,28 @@ bool Post::DataScale(FEPostModel& fem, int nfield, double scale)
 				if (fmt == DATA_NODE)
 				{
 					FEElementData<vec3f, DATA_NODE>* pf = dynamic_cast<FEElementData<vec3f, DATA_NODE>*>(&d);
+					if (pf == nullptr) return false;
 					int N = pf->size();
 					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
 				}
 				else if (fmt == DATA_ITEM)
 				{
 					FEElementData<vec3f, DATA_ITEM>* pf = dynamic_cast<FEElementData<vec3f, DATA_ITEM>*>(&d);
+					if (pf == nullptr) return false;
 					int N = pf->size();
 					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
 				}
 				else if (fmt == DATA_COMP)
 				{
 					FEElementData<vec3f, DATA_COMP>* pf = dynamic_cast<FEElementData<vec3f, DATA_COMP>*>(&d);
+					if (pf == nullptr) return false;
 					int N = pf->size();
 					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
 				}
 				else if (fmt == DATA_REGION)
 				{
 					FEElementData<vec3f, DATA_REGION>* pf = dynamic_cast<FEElementData<vec3f, DATA_REGION>*>(&d);
+					if (pf == nullptr) return false;
 					int N = pf->size();
 					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
 				}
@@ -149,24 +247,28 @@ bool Post::DataScale(FEPostModel& fem, int nfield, double scale)
 				if (fmt == DATA_NODE)
 				{
 					FEElementData<mat3fs, DATA_NODE>* pf = dynamic_cast<FEElementData<mat3fs, DATA_NODE>*>(&d);
+					if (pf == nullptr) return false;
 					int N = pf->size();
 					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
 				}
 				else if (fmt == DATA_ITEM)
 				{
 					FEElementData<mat3fs, DATA_ITEM>* pf = dynamic_cast<FEElementData<mat3fs, DATA_ITEM>*>(&d);
+					if (pf == nullptr) return false;
 					int N = pf->size();
 					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
 				}
 				else if (fmt == DATA_COMP)
 				{
 					FEElementData<mat3fs, DATA_COMP>* pf = dynamic_cast<FEElementData<mat3fs, DATA_COMP>*>(&d);
+					if (pf == nullptr) return false;
 					int N = pf->size();
 					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
 				}
 				else if (fmt == DATA_REGION)
 				{
 					FEElementData<mat3fs, DATA_REGION>* pf = dynamic_cast<FEElementData<mat3fs, DATA_REGION>*>(&d);
+					if (pf == nullptr) return false;
 					int N = pf->size();
 					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
 				}
@@ -177,24 +279,28 @@ bool Post::DataScale(FEPostModel& fem, int nfield, double scale)
 				if (fmt == DATA_NODE)
 				{
 					FEElementData<mat3d, DATA_NODE>* pf = dynamic_cast<FEElementData<mat3d, DATA_NODE>*>(&d);
+					if (pf == nullptr) return false;
 					int N = pf->size();
 					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
 				}
 				else if (fmt == DATA_ITEM)
 				{
 					FEElementData<mat3d, DATA_ITEM>* pf = dynamic_cast<FEElementData<mat3d, DATA_ITEM>*>(&d);
+					if (pf == nullptr) return false;
 					int N = pf->size();
 					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
 				}
 				else if (fmt == DATA_COMP)
 				{
 					FEElementData<mat3d, DATA_COMP>* pf = dynamic_cast<FEElementData<mat3d, DATA_COMP>*>(&d);
+					if (pf == nullptr) return false;
 					int N = pf->size();
 					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
 				}
 				else if (fmt == DATA_REGION)
 				{
 					FEElementData<mat3d, DATA_REGION>* pf = dynamic_cast<FEElementData<mat3d, DATA_REGION>*>(&d);
+					if (pf == nullptr) return false;
 					int N = pf->size();
 					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
 				}
@@ -205,24 +311,28 @@ bool Post::DataScale(FEPostModel& fem, int nfield, double scale)
 				if (fmt == DATA_NODE)
 				{
 					FEElementData<mat3f, DATA_NODE>* pf = dynamic_cast<FEElementData<mat3f, DATA_NODE>*>(&d);
+					if (pf == nullptr) return false;
 					int N = pf->size();
 					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
 				}
 				else if (fmt == DATA_ITEM)
 				{
 					FEElementData<mat3f, DATA_ITEM>* pf = dynamic_cast<FEElementData<mat3f, DATA_ITEM>*>(&d);
+					if (pf == nullptr) return false;
 					int N = pf->size();
 					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
 				}
 				else if (fmt == DATA_COMP)
 				{
 					FEElementData<mat3f, DATA_COMP>* pf = dynamic_cast<FEElementData<mat3f, DATA_COMP>*>(&d);
+					if (pf == nullptr) return false;
 					int N = pf->size();
 					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
 				}
 				else if (fmt == DATA_REGION)
 				{
 					FEElementData<mat3f, DATA_REGION>* pf = dynamic_cast<FEElementData<mat3f, DATA_REGION>*>(&d);
+					if (pf == nullptr) return false;
 					int N = pf->size();
 					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
 				}
@@ -242,24 +352,28 @@ bool Post::DataScale(FEPostModel& fem, int nfield, double scale)
 				if (fmt == DATA_NODE)
 				{
 					FEFaceData<float, DATA_NODE>* pf = dynamic_cast<FEFaceData<float, DATA_NODE>*>(&d);
+					if (pf == nullptr) return false;
 					int N = pf->size();
 					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
 				}
 				else if (fmt == DATA_ITEM)
 				{
 					FEFaceData<float, DATA_ITEM>* pf = dynamic_cast<FEFaceData<float, DATA_ITEM>*>(&d);
+					if (pf == nullptr) return false;
 					int N = pf->size();
 					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
 				}
 				else if (fmt == DATA_COMP)
 				{
 					FEFaceData<float, DATA_COMP>* pf = dynamic_cast<FEFaceData<float, DATA_COMP>*>(&d);
+					if (pf == nullptr) return false;
 					int N = pf->size();
 					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
 				}
 				else if (fmt == DATA_REGION)
 				{
 					FEFaceData<float, DATA_REGION>* pf = dynamic_cast<FEFaceData<float, DATA_REGION>*>(&d);
+					if (pf == nullptr) return false;
 					int N = pf->size();
 					for (int n=0; n<N; ++n) (*pf)[n] *= fscale;
 				}
@@ -270,24 +384,28 @@ bool Post::DataScale(FEPostModel& fem, int nfield, double scale)
 				if (fmt == DATA_NODE)
 				{
 					FEFaceData<vec3f, DATA_NODE>* pf = dynamic_cast<FEFaceData<vec3f, DATA_NODE>*>(&d);
+					if (pf == nullptr) return false;
 					int N = pf->size();
 					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
 				}
 				else if (fmt == DATA_ITEM)
 				{
 					FEFaceData<vec3f, DATA_ITEM>* pf = dynamic_cast<FEFaceData<vec3f, DATA_ITEM>*>(&d);
+					if (pf == nullptr) return false;
 					int N = pf->size();
 					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
 				}
 				else if (fmt == DATA_COMP)
 				{
 					FEFaceData<vec3f, DATA_COMP>* pf = dynamic_cast<FEFaceData<vec3f, DATA_COMP>*>(&d);
+					if (pf == nullptr) return false;
 					int N = pf->size();
 					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
 				}
 				else if (fmt == DATA_REGION)
 				{
 					FEFaceData<vec3f, DATA_REGION>* pf = dynamic_cast<FEFaceData<vec3f, DATA_REGION>*>(&d);
+					if (pf == nullptr) return false;
 					int N = pf->size();
 					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
 				}
@@ -298,24 +416,28 @@ bool Post::DataScale(FEPostModel& fem, int nfield, double scale)
 				if (fmt == DATA_NODE)
 				{
 					FEFaceData<mat3fs, DATA_NODE>* pf = dynamic_cast<FEFaceData<mat3fs, DATA_NODE>*>(&d);
+					if (pf == nullptr) return false;
 					int N = pf->size();
 					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
 				}
 				else if (fmt == DATA_ITEM)
 				{
 					FEFaceData<mat3fs, DATA_ITEM>* pf = dynamic_cast<FEFaceData<mat3fs, DATA_ITEM>*>(&d);
+					if (pf == nullptr) return false;
 					int N = pf->size();
 					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
 				}
 				else if (fmt == DATA_COMP)
 				{
 					FEFaceData<mat3fs, DATA_COMP>* pf = dynamic_cast<FEFaceData<mat3fs, DATA_COMP>*>(&d);
+					if (pf == nullptr) return false;
 					int N = pf->size();
 					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
 				}
 				else if (fmt == DATA_REGION)
 				{
 					FEFaceData<mat3fs, DATA_REGION>* pf = dynamic_cast<FEFaceData<mat3fs, DATA_REGION>*>(&d);
+					if (pf == nullptr) return false;
 					int N = pf->size();
 					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
 				}
@@ -326,24 +448,28 @@ bool Post::DataScale(FEPostModel& fem, int nfield, double scale)
 				if (fmt == DATA_NODE)
 				{
 					FEFaceData<mat3d, DATA_NODE>* pf = dynamic_cast<FEFaceData<mat3d, DATA_NODE>*>(&d);
+					if (pf == nullptr) return false;
 					int N = pf->size();
 					for (int n = 0; n<N; ++n) (*pf)[n] *= scale;
 				}
 				else if (fmt == DATA_ITEM)
 				{
 					FEFaceData<mat3d, DATA_ITEM>* pf = dynamic_cast<FEFaceData<mat3d, DATA_ITEM>*>(&d);
+					if (pf == nullptr) return false;
 					int N = pf->size();
 					for (int n = 0; n<N; ++n) (*pf)[n] *= scale;
 				}
 				else if (fmt == DATA_COMP)
 				{
 					FEFaceData<mat3d, DATA_COMP>* pf = dynamic_cast<FEFaceData<mat3d, DATA_COMP>*>(&d);
+					if (pf == nullptr) return false;
 					int N = pf->size();
 					for (int n = 0; n<N; ++n) (*pf)[n] *= scale;
 				}
 				else if (fmt == DATA_REGION)
 				{
 					FEFaceData<mat3d, DATA_REGION>* pf = dynamic_cast<FEFaceData<mat3d, DATA_REGION>*>(&d);
+					if (pf == nullptr) return false;
 					int N = pf->size();
 					for (int n = 0; n<N; ++n) (*pf)[n] *= scale;
 				}
@@ -354,24 +480,28 @@ bool Post::DataScale(FEPostModel& fem, int nfield, double scale)
 				if (fmt == DATA_NODE)
 				{
 					FEFaceData<mat3f, DATA_NODE>* pf = dynamic_cast<FEFaceData<mat3f, DATA_NODE>*>(&d);
+					if (pf == nullptr) return false;
 					int N = pf->size();
 					for (int n = 0; n<N; ++n) (*pf)[n] *= (float) scale;
 				}
 				else if (fmt == DATA_ITEM)
 				{
 					FEFaceData<mat3f, DATA_ITEM>* pf = dynamic_cast<FEFaceData<mat3f, DATA_ITEM>*>(&d);
+					if (pf == nullptr) return false;
 					int N = pf->size();
 					for (int n = 0; n<N; ++n) (*pf)[n] *= (float) scale;
 				}
 				else if (fmt == DATA_COMP)
 				{
 					FEFaceData<mat3f, DATA_COMP>* pf = dynamic_cast<FEFaceData<mat3f, DATA_COMP>*>(&d);
+					if (pf == nullptr) return false;
 					int N = pf->size();
 					for (int n = 0; n<N; ++n) (*pf)[n] *= (float) scale;
 				}
 				else if (fmt == DATA_REGION)
 				{
 					FEFaceData<mat3f, DATA_REGION>* pf = dynamic_cast<FEFaceData<mat3f, DATA_REGION>*>(&d);
+					if (pf == nullptr) return false;
 					int N = pf->size();
 					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
 				}
@@ -382,17 +512,12 @@ bool Post::DataScale(FEPostModel& fem, int nfield, double scale)
 				break;
 			}
 		}
-		else 
-		{
-			break; 
-		}
-	}
-
-	return true;
+		return true;
+	});
 }
 
 //-----------------------------------------------------------------------------
-bool Post::DataScaleVec3(FEPostModel& fem, int nfield, vec3d scale)
+bool Post::DataScaleVec3(FEPostModel& fem, int nfield, vec3d scale, DataFilterProgress* progress)
 {
 	Post::FEPostMesh& mesh = *fem.GetFEMesh(0);
 
@@ -401,8 +526,7 @@ bool Post::DataScaleVec3(FEPostModel& fem, int nfield, vec3d scale)
 	// loop over all states
 	int NN = mesh.Nodes();
 	int ndata = FIELD_CODE(nfield);
-	for (int i = 0; i < fem.GetStates(); ++i)
-	{
+	return forEachStateInPlace(fem, nfield, true, progress, [&](int i) {
 		FEState& s = *fem.GetState(i);
 		FEMeshData& d = s.m_Data[ndata];
 		Data_Type type = d.GetType();
@@ -414,6 +538,7 @@ bool Post::DataScaleVec3(FEPostModel& fem, int nfield, vec3d scale)
 			case DATA_VEC3F:
 			{
 				FENodeData<vec3f>* pv = dynamic_cast<FENodeData<vec3f>*>(&d);
+				if (pv == nullptr) return false;
 				for (int n = 0; n < NN; ++n) 
 				{ 
 					vec3f& v = (*pv)[n]; 
@@ -436,6 +561,7 @@ bool Post::DataScaleVec3(FEPostModel& fem, int nfield, vec3d scale)
 				if (fmt == DATA_NODE)
 				{
 					FEElementData<vec3f, DATA_NODE>* pf = dynamic_cast<FEElementData<vec3f, DATA_NODE>*>(&d);
+					if (pf == nullptr) return false;
 					int N = pf->size();
 					for (int n = 0; n < N; ++n)
 					{
@@ -448,6 +574,7 @@ bool Post::DataScaleVec3(FEPostModel& fem, int nfield, vec3d scale)
 				else if (fmt == DATA_ITEM)
 				{
 					FEElementData<vec3f, DATA_ITEM>* pf = dynamic_cast<FEElementData<vec3f, DATA_ITEM>*>(&d);
+					if (pf == nullptr) return false;
 					int N = pf->size();
 					for (int n = 0; n < N; ++n)
 					{
@@ -460,6 +587,7 @@ bool Post::DataScaleVec3(FEPostModel& fem, int nfield, vec3d scale)
 				else if (fmt == DATA_COMP)
 				{
 					FEElementData<vec3f, DATA_COMP>* pf = dynamic_cast<FEElementData<vec3f, DATA_COMP>*>(&d);
+					if (pf == nullptr) return false;
 					int N = pf->size();
 					for (int n = 0; n < N; ++n)
 					{
@@ -472,6 +600,7 @@ bool Post::DataScaleVec3(FEPostModel& fem, int nfield, vec3d scale)
 				else if (fmt == DATA_REGION)
 				{
 					FEElementData<vec3f, DATA_REGION>* pf = dynamic_cast<FEElementData<vec3f, DATA_REGION>*>(&d);
+					if (pf == nullptr) return false;
 					int N = pf->size();
 					for (int n = 0; n < N; ++n)
 					{
@@ -497,6 +626,7 @@ bool Post::DataScaleVec3(FEPostModel& fem, int nfield, vec3d scale)
 				if (fmt == DATA_NODE)
 				{
 					FEFaceData<vec3f, DATA_NODE>* pf = dynamic_cast<FEFaceData<vec3f, DATA_NODE>*>(&d);
+					if (pf == nullptr) return false;
 					int N = pf->size();
 					for (int n = 0; n < N; ++n)
 					{
@@ -509,6 +639,7 @@ bool Post::DataScaleVec3(FEPostModel& fem, int nfield, vec3d scale)
 				else if (fmt == DATA_ITEM)
 				{
 					FEFaceData<vec3f, DATA_ITEM>* pf = dynamic_cast<FEFaceData<vec3f, DATA_ITEM>*>(&d);
+					if (pf == nullptr) return false;
 					int N = pf->size();
 					for (int n = 0; n < N; ++n)
 					{
@@ -521,6 +652,7 @@ bool Post::DataScaleVec3(FEPostModel& fem, int nfield, vec3d scale)
 				else if (fmt == DATA_COMP)
 				{
 					FEFaceData<vec3f, DATA_COMP>* pf = dynamic_cast<FEFaceData<vec3f, DATA_COMP>*>(&d);
+					if (pf == nullptr) return false;
 					int N = pf->size();
 					for (int n = 0; n < N; ++n)
 					{
@@ -533,6 +665,7 @@ bool Post::DataScaleVec3(FEPostModel& fem, int nfield, vec3d scale)
 				else if (fmt == DATA_REGION)
 				{
 					FEFaceData<vec3f, DATA_REGION>* pf = dynamic_cast<FEFaceData<vec3f, DATA_REGION>*>(&d);
+					if (pf == nullptr) return false;
 					int N = pf->size();
 					for (int n = 0; n < N; ++n)
 					{
@@ -549,143 +682,152 @@ bool Post::DataScaleVec3(FEPostModel& fem, int nfield, vec3d scale)
 				break;
 			}
 		}
-		else
-		{
-			break;
-		}
-	}
-
-	return true;
+		return true;
+	});
 }
 
 //-----------------------------------------------------------------------------
-// Apply a smoothing step operation on data
-bool DataSmoothStep(FEPostModel& fem, int nfield, double theta)
+// scratch buffers of the smoothing filter
+struct SmoothBuffer
+{
+	vector<float>	Df;
+	vector<vec3f>	Dv;
+	vector<int>		tag;
+};
+
+//-----------------------------------------------------------------------------
+// Apply a smoothing step operation on the data of a state
+static bool DataSmoothStep(FEState& s, int nfield, double theta, SmoothBuffer& buf)
 {
-	// loop over all states
 	int ndata = FIELD_CODE(nfield);
-	for (int n = 0; n<fem.GetStates(); ++n)
+	Post::FEPostMesh& mesh = *s.GetFEMesh();
+	if (IS_NODE_FIELD(nfield))
 	{
-		FEState& s = *fem.GetState(n);
-		Post::FEPostMesh& mesh = *s.GetFEMesh();
-		if (IS_NODE_FIELD(nfield))
+		int NN = mesh.Nodes();
+		Post::FEMeshData& d = s.m_Data[ndata];
+		
+		switch (d.GetType())
 		{
-			int NN = mesh.Nodes();
-			Post::FEMeshData& d = s.m_Data[ndata];
-			
-			switch (d.GetType())
-			{
-			case DATA_FLOAT:
+		case DATA_FLOAT:
+		{
+			vector<float>& D = buf.Df; D.assign(NN, 0.f);
+			vector<int>& tag = buf.tag; tag.assign(NN, 0);
+			Post::FENodeData<float>* pdata = dynamic_cast<Post::FENodeData<float>*>(&d);
+			if (pdata == nullptr) return false;
+			Post::FENodeData<float>& data = *pdata;
+
+			// evaluate the average value of the neighbors
+			int NE = mesh.Elements();
+			for (int i=0; i<NE; ++i)
 			{
-				vector<float> D; D.assign(NN, 0.f);
-				vector<int> tag; tag.assign(NN, 0);
-				Post::FENodeData<float>& data = dynamic_cast< Post::FENodeData<float>& >(d);
-
-				// evaluate the average value of the neighbors
-				int NE = mesh.Elements();
-				for (int i=0; i<NE; ++i)
+				FEElement_& el = mesh.ElementRef(i);
+				int ne = el.Nodes();
+				for (int j=0; j<ne; ++j)
 				{
-					FEElement_& el = mesh.ElementRef(i);
-					int ne = el.Nodes();
-					for (int j=0; j<ne; ++j)
+					float f = data[el.m_node[j]];
+					for (int k = 0; k<ne; ++k)
+					if (k != j)
 					{
-						float f = data[el.m_node[j]];
-						for (int k = 0; k<ne; ++k)
-						if (k != j)
-						{
-							int nk = el.m_node[k];
-							D[nk] += f;
-							tag[nk]++;
-						}
+						int nk = el.m_node[k];
+						D[nk] += f;
+						tag[nk]++;
 					}
 				}
+			}
 
-				// normalize 
-				for (int i=0; i<NN; ++i) if (tag[i]>0) D[i] /= (float) tag[i];
-
-				// assign to data field
-				for (int i = 0; i<NN; ++i) { data[i] = (1.0 - theta)*data[i] + theta*D[i];  }
+			// normalize and assign to data field
+#pragma omp parallel for
+			for (int i = 0; i<NN; ++i)
+			{
+				if (tag[i]>0) D[i] /= (float) tag[i];
+				data[i] = (1.0 - theta)*data[i] + theta*D[i];
 			}
-			break;
-			case DATA_VEC3F:
+		}
+		break;
+		case DATA_VEC3F:
+		{
+			vector<vec3f>& D = buf.Dv; D.assign(NN, vec3f(0.f, 0.f, 0.f));
+			vector<int>& tag = buf.tag; tag.assign(NN, 0);
+			Post::FENodeData<vec3f>* pdata = dynamic_cast<Post::FENodeData<vec3f>*>(&d);
+			if (pdata == nullptr) return false;
+			Post::FENodeData<vec3f>& data = *pdata;
+
+			// evaluate the average value of the neighbors
+			int NE = mesh.Elements();
+			for (int i = 0; i<NE; ++i)
 			{
-				vector<vec3f> D; D.assign(NN, vec3f(0.f, 0.f, 0.f));
-				vector<int> tag; tag.assign(NN, 0);
-				Post::FENodeData<vec3f>& data = dynamic_cast< Post::FENodeData<vec3f>& >(d);
-
-				// evaluate the average value of the neighbors
-				int NE = mesh.Elements();
-				for (int i = 0; i<NE; ++i)
+				FEElement_& el = mesh.ElementRef(i);
+				int ne = el.Nodes();
+				for (int j = 0; j<ne; ++j)
 				{
-					FEElement_& el = mesh.ElementRef(i);
-					int ne = el.Nodes();
-					for (int j = 0; j<ne; ++j)
+					vec3f v = data[el.m_node[j]];
+					for (int k = 0; k<ne; ++k)
+					if (k != j)
 					{
-						vec3f v = data[el.m_node[j]];
-						for (int k = 0; k<ne; ++k)
-						if (k != j)
-						{
-							int nk = el.m_node[k];
-							D[nk] += v;
-							tag[nk]++;
-						}
+						int nk = el.m_node[k];
+						D[nk] += v;
+						tag[nk]++;
 					}
 				}
-
-				// normalize 
-				for (int i = 0; i<NN; ++i) if (tag[i]>0) D[i] /= (float)tag[i];
-
-				// assign to data field
-				for (int i = 0; i<NN; ++i) { data[i] = data[i] * (1.0 - theta) + D[i]*theta; }
 			}
-			break;
-			default:
-				return false;
+
+			// normalize and assign to data field
+#pragma omp parallel for
+			for (int i = 0; i<NN; ++i)
+			{
+				if (tag[i]>0) D[i] /= (float)tag[i];
+				data[i] = data[i] * (1.0 - theta) + D[i]*theta;
 			}
 		}
-		else if (IS_ELEM_FIELD(nfield))
+		break;
+		default:
+			return false;
+		}
+	}
+	else if (IS_ELEM_FIELD(nfield))
+	{
+		Post::FEMeshData& d = s.m_Data[ndata];
+		if ((d.GetFormat() == DATA_ITEM)&&(d.GetType() == DATA_FLOAT))
 		{
-			Post::FEMeshData& d = s.m_Data[ndata];
-			if ((d.GetFormat() == DATA_ITEM)&&(d.GetType() == DATA_FLOAT))
-			{
-				int NE = mesh.Elements();
-
-				vector<float> D; D.assign(NE, 0.f);
-				vector<int> tag; tag.assign(NE, 0);
-				Post::FEElementData<float, DATA_ITEM>& data = dynamic_cast< Post::FEElementData<float, DATA_ITEM>& >(d);
+			int NE = mesh.Elements();
 
-				for (int i=0; i<NE; ++i) mesh.ElementRef(i).m_ntag = i;
+			vector<float>& D = buf.Df; D.assign(NE, 0.f);
+			vector<int>& tag = buf.tag; tag.assign(NE, 0);
+			Post::FEElementData<float, DATA_ITEM>* pdata = dynamic_cast<Post::FEElementData<float, DATA_ITEM>*>(&d);
+			if (pdata == nullptr) return false;
+			Post::FEElementData<float, DATA_ITEM>& data = *pdata;
 
-				// evaluate the average value of the neighbors
-				for (int i=0; i<NE; ++i)
+			// evaluate the average value of the neighbors
+#pragma omp parallel for
+			for (int i=0; i<NE; ++i)
+			{
+				FEElement_& el = mesh.ElementRef(i);
+				int nf = el.Faces();
+				for (int j=0; j<nf; ++j)
 				{
-					FEElement_& el = mesh.ElementRef(i);
-					int nf = el.Faces();
-					for (int j=0; j<nf; ++j)
+					int nj = el.m_nbr[j];
+					if (mesh.ElementPtr(nj) && (data.active(nj)))
 					{
-						FEElement_* pj = mesh.ElementPtr(el.m_nbr[j]);
-						if (pj && (data.active(pj->m_ntag)))
-						{
-							float f;
-							data.eval(pj->m_ntag, &f);
-							D[i] += f;
-							tag[i]++;
-						}
+						float f;
+						data.eval(nj, &f);
+						D[i] += f;
+						tag[i]++;
 					}
 				}
+			}
 
-				// normalize 
-				for (int i=0; i<NE; ++i) if (tag[i]>0) D[i] /= (float) tag[i];
-
-				// assign to data field
-				for (int i = 0; i<NE; ++i) 
-					if (data.active(i))
-					{
-						float f;
-						data.eval(i, &f);
-						D[i] = (1.0 - theta)*f + theta*D[i];
-						data.set(i, D[i]);
-					}
+			// normalize and assign to data field
+#pragma omp parallel for
+			for (int i = 0; i<NE; ++i) 
+			{
+				if (tag[i]>0) D[i] /= (float) tag[i];
+				if (data.active(i))
+				{
+					float f;
+					data.eval(i, &f);
+					D[i] = (1.0 - theta)*f + theta*D[i];
+					data.set(i, D[i]);
+				}
 			}
 		}
 	}
@@ -695,14 +837,19 @@ bool DataSmoothStep(FEPostModel& fem, int nfield, double theta)
 
 //-----------------------------------------------------------------------------
 // Apply a smoothing operation on data
-bool Post::DataSmooth(FEPostModel& fem, int nfield, double theta, int niters)
+bool Post::DataSmooth(FEPostModel& fem, int nfield, double theta, int niters, DataFilterProgress* progress)
 {
-	for (int n = 0; n<niters; ++n) 
-	{
-		if (DataSmoothStep(fem, nfield, theta) == false) return false;
-	}
-
-	return true;
+	// The states are smoothed independently, so each state does all iterations.
+	vector<SmoothBuffer> buf(omp_get_max_threads());
+	return forEachStateInPlace(fem, nfield, true, progress, [&](int n) {
+		FEState& s = *fem.GetState(n);
+		SmoothBuffer& threadBuf = buf[omp_get_thread_num()];
+		for (int i = 0; i<niters; ++i)
+		{
+			if (DataSmoothStep(s, nfield, theta, threadBuf) == false) return false;
+		}
+		return true;
+	});
 }
 
 //-----------------------------------------------------------------------------
@@ -714,7 +861,7 @@ double flt_div(double d, double s) { return d/s; }
 double flt_err(double d, double s) { return fabs(d - s); }
 
 //-----------------------------------------------------------------------------
-bool Post::DataArithmetic(FEPostModel& fem, int nfield, int nop, int noperand)
+bool Post::DataArithmetic(FEPostModel& fem, int nfield, int nop, int noperand, DataFilterProgress* progress)
 {
 	int ndst = FIELD_CODE(nfield);
 	int nsrc = FIELD_CODE(noperand);
@@ -722,8 +869,7 @@ bool Post::DataArithmetic(FEPostModel& fem, int nfield, int nop, int noperand)
 	Post::FEPostMesh& mesh = *fem.GetFEMesh(0);
 
 	// loop over all states
-	for (int n = 0; n<fem.GetStates(); ++n)
-	{
+	return forEachStateInPlace(fem, nfield, isThreadSafe(fem, noperand), progress, [&](int n) {
 		FEState& state = *fem.GetState(n);
 		FEMeshData& d = state.m_Data[ndst];
 		FEMeshData& s = state.m_Data[nsrc];
@@ -749,6 +895,7 @@ bool Post::DataArithmetic(FEPostModel& fem, int nfield, int nop, int noperand)
 
 				FENodeData<float>*   pd = dynamic_cast<FENodeData  <float>*>(&d);
 				FENodeData_T<float>* ps = dynamic_cast<FENodeData_T<float>*>(&s);
+				if ((pd == nullptr) || (ps == nullptr)) return false;
 				int N = pd->size();
 				for (int i = 0; i<N; ++i) { float v; ps->eval(i, &v); (*pd)[i] = (float)f((*pd)[i], v); }
 			}
@@ -758,6 +905,7 @@ bool Post::DataArithmetic(FEPostModel& fem, int nfield, int nop, int noperand)
 				{
 					FENodeData<vec3f>* pd = dynamic_cast<FENodeData<vec3f>*>(&d);
 					FENodeData_T<vec3f>* ps = dynamic_cast<FENodeData_T<vec3f>*>(&s);
+					if ((pd == nullptr) || (ps == nullptr)) return false;
 					int N = pd->size();
 					switch (nop)
 					{
@@ -769,6 +917,7 @@ bool Post::DataArithmetic(FEPostModel& fem, int nfield, int nop, int noperand)
 				{
 					FENodeData<vec3f>* pd = dynamic_cast<FENodeData<vec3f>*>(&d);
 					FENodeData_T<float>* ps = dynamic_cast<FENodeData_T<float>*>(&s);
+					if ((pd == nullptr) || (ps == nullptr)) return false;
 					int N = pd->size();
 					switch (nop)
 					{
@@ -798,6 +947,7 @@ bool Post::DataArithmetic(FEPostModel& fem, int nfield, int nop, int noperand)
 				{
 					FEElementData<float, DATA_ITEM>* pd = dynamic_cast<FEElementData<float, DATA_ITEM>*>(&d);
 					FEElemData_T<float, DATA_ITEM>* ps = dynamic_cast<FEElemData_T<float, DATA_ITEM>*>(&s);
+					if ((pd == nullptr) || (ps == nullptr)) return false;
 					if (pd && ps)
 					{
 						int N = mesh.Elements();
@@ -819,6 +969,7 @@ bool Post::DataArithmetic(FEPostModel& fem, int nfield, int nop, int noperand)
 				{
 					FEElementData<float, DATA_NODE>* pd = dynamic_cast<FEElementData<float, DATA_NODE>*>(&d);
 					FEElemData_T<float, DATA_NODE>* ps = dynamic_cast<FEElemData_T<float, DATA_NODE>*>(&s);
+					if ((pd == nullptr) || (ps == nullptr)) return false;
 					if (pd && ps)
 					{
 						int N = mesh.Elements();
@@ -853,6 +1004,7 @@ bool Post::DataArithmetic(FEPostModel& fem, int nfield, int nop, int noperand)
 					{
 						FEElementData<mat3fs, DATA_ITEM>* pd = dynamic_cast<FEElementData<mat3fs, DATA_ITEM>*>(&d);
 						FEElemData_T<mat3fs, DATA_ITEM>* ps = dynamic_cast<FEElemData_T<mat3fs, DATA_ITEM>*>(&s);
+						if ((pd == nullptr) || (ps == nullptr)) return false;
 						if (pd && ps)
 						{
 							int N = mesh.Elements();
@@ -875,6 +1027,7 @@ bool Post::DataArithmetic(FEPostModel& fem, int nfield, int nop, int noperand)
 					{
 						FEElementData<mat3fs, DATA_ITEM>* pd = dynamic_cast<FEElementData<mat3fs, DATA_ITEM>*>(&d);
 						FEElemData_T<float, DATA_ITEM>* ps = dynamic_cast<FEElemData_T<float, DATA_ITEM>*>(&s);
+						if ((pd == nullptr) || (ps == nullptr)) return false;
 						if (pd && ps)
 						{
 							mat3fs I(1.f, 1.f, 1.f, 0.f, 0.f, 0.f);
@@ -905,28 +1058,42 @@ bool Post::DataArithmetic(FEPostModel& fem, int nfield, int nop, int noperand)
 		{
 			return false;
 		}
-	}
 
-	return true;
+		return true;
+	});
 }
 
 //-----------------------------------------------------------------------------
-bool Post::DataGradient(FEPostModel& fem, int vecField, int sclField)
+bool Post::DataGradient(FEPostModel& fem, int vecField, int sclField, DataFilterProgress* progress)
 {
 	int nvec = FIELD_CODE(vecField);
 	int nscl = FIELD_CODE(sclField);
 
-	// loop over all the states
-	for (int n=0; n<fem.GetStates(); ++n)
+	// The gradient needs the scalar field and the nodal positions
+	int ndisp = fem.GetDisplacementField();
+	bool bparallel = isThreadSafe(fem, sclField) && ((ndisp == 0) || isThreadSafe(fem, ndisp));
+
+	// scratch buffers
+	struct GradBuffer
 	{
+		vector<double>	d;
+		vector<vec3f>	G;
+		vector<int>		tag;
+	};
+	vector<GradBuffer> buf(omp_get_max_threads());
+
+	// loop over all the states
+	return forEachState(fem, bparallel, progress, [&](int n) {
 		FEState& state = *fem.GetState(n);
 		FEMeshData& v = state.m_Data[nvec];
 		FEMeshData& s = state.m_Data[nscl];
+		GradBuffer& threadBuf = buf[omp_get_thread_num()];
 
 		// zero the vector field
 		if (IS_NODE_FIELD(vecField) && (v.GetType() == DATA_VEC3F))
 		{
 			FENodeData<vec3f>* pv = dynamic_cast<FENodeData<vec3f>*>(&v);
+			if (pv == nullptr) return false;
 			int N = pv->size();
 			for (int i = 0; i<N; ++i) (*pv)[i] = vec3f(0,0,0);
 		}
@@ -937,13 +1104,14 @@ bool Post::DataGradient(FEPostModel& fem, int vecField, int sclField)
 
 		// evaluate the field over all the nodes
 		const int NN = mesh->Nodes();
-		vector<double> d(NN, 0.f);
+		vector<double>& d = threadBuf.d; d.assign(NN, 0.f);
 
 		if (s.GetType() == DATA_FLOAT)
 		{
 			if (IS_NODE_FIELD(sclField))
 			{
-				FENodeData_T<float>* ps = dynamic_cast<FENodeData_T<float>*>(&s); assert(ps);
+				FENodeData_T<float>* ps = dynamic_cast<FENodeData_T<float>*>(&s);
+				if (ps == nullptr) return false;
 				for (int i=0; i<NN; ++i) 
 				{	
 					float f;	
@@ -955,8 +1123,9 @@ bool Post::DataGradient(FEPostModel& fem, int vecField, int sclField)
 			{
 				if (s.GetFormat() == DATA_NODE)
 				{
-					vector<int> tag(NN, 0);
+					vector<int>& tag = threadBuf.tag; tag.assign(NN, 0);
 					FEElemData_T<float, DATA_NODE>* ps = dynamic_cast<FEElemData_T<float, DATA_NODE>*>(&s);
+					if (ps == nullptr) return false;
 
 					float ed[FSElement::MAX_NODES] = {0.f};
 					for (int i=0; i<mesh->Elements(); ++i)
@@ -977,8 +1146,9 @@ bool Post::DataGradient(FEPostModel& fem, int vecField, int sclField)
 				}
 				else if (s.GetFormat() == DATA_ITEM)
 				{
-					vector<int> tag(NN, 0);
+					vector<int>& tag = threadBuf.tag; tag.assign(NN, 0);
 					FEElemData_T<float, DATA_ITEM>* ps = dynamic_cast<FEElemData_T<float, DATA_ITEM>*>(&s);
+					if (ps == nullptr) return false;
 
 					float ed =  0.f;
 					for (int i = 0; i<mesh->Elements(); ++i)
@@ -999,8 +1169,9 @@ bool Post::DataGradient(FEPostModel& fem, int vecField, int sclField)
 				}
 				else if (s.GetFormat() == DATA_COMP)
 				{
-					vector<int> tag(NN, 0);
+					vector<int>& tag = threadBuf.tag; tag.assign(NN, 0);
 					FEElemData_T<float, DATA_COMP>* ps = dynamic_cast<FEElemData_T<float, DATA_COMP>*>(&s);
+					if (ps == nullptr) return false;
 
 					float ed[FSElement::MAX_NODES] = { 0.f };
 					for (int i = 0; i<mesh->Elements(); ++i)
@@ -1023,10 +1194,10 @@ bool Post::DataGradient(FEPostModel& fem, int vecField, int sclField)
 		}
 
 		// now, calculate the gradient for each element
-		vector<vec3f> G(NN, vec3f(0.f, 0.f, 0.f));
+		vector<vec3f>& G = threadBuf.G; G.assign(NN, vec3f(0.f, 0.f, 0.f));
 		vec3f eg[FSElement::MAX_NODES];
 		float ed[FSElement::MAX_NODES];
-		vector<int> tag(NN, 0);
+		vector<int>& tag = threadBuf.tag; tag.assign(NN, 0);
 		for (int i=0; i<mesh->Elements(); ++i)
 		{
 			FEElement_& el = mesh->ElementRef(i);
@@ -1051,21 +1222,26 @@ bool Post::DataGradient(FEPostModel& fem, int vecField, int sclField)
 		}
 
 		FENodeData<vec3f>* pv = dynamic_cast<FENodeData<vec3f>*>(&v);
+		if (pv == nullptr) return false;
+#pragma omp parallel for
 		for (int i = 0; i<NN; ++i)
 		{
 			if (tag[i] > 0) G[i] /= (float) tag[i];
 			(*pv)[i] = G[i];
 		}
-	}
 
-	return true;
+		return true;
+	});
 }
 
 //-----------------------------------------------------------------------------
-template <typename T> void extractNodeDataComponent_T(Post::FEMeshData& dst, Post::FEMeshData& src, int ncomp, Post::FEPostMesh& mesh)
+template <typename T> bool extractNodeDataComponent_T(Post::FEMeshData& dst, Post::FEMeshData& src, int ncomp, Post::FEPostMesh& mesh)
 {
-	FENodeData_T<T>& vec = dynamic_cast<FENodeData_T<T>&>(src);
-	Post::FENodeData<float>& scl = dynamic_cast<Post::FENodeData<float>&>(dst);
+	FENodeData_T<T>* pvec = dynamic_cast<FENodeData_T<T>*>(&src);
+	Post::FENodeData<float>* pscl = dynamic_cast<Post::FENodeData<float>*>(&dst);
+	if ((pvec == nullptr) || (pscl == nullptr)) return false;
+	FENodeData_T<T>& vec = *pvec;
+	Post::FENodeData<float>& scl = *pscl;
 
 	int NN = mesh.Nodes();
 	for (int i = 0; i<NN; ++i)
@@ -1073,25 +1249,31 @@ template <typename T> void extractNodeDataComponent_T(Post::FEMeshData& dst, Pos
 		T v; vec.eval(i, &v);
 		scl[i] = component(v, ncomp);
 	}
+
+	return true;
 }
 
-void extractNodeDataComponent(Data_Type ntype, Post::FEMeshData& dst, Post::FEMeshData& src, int ncomp, Post::FEPostMesh& mesh)
+bool extractNodeDataComponent(Data_Type ntype, Post::FEMeshData& dst, Post::FEMeshData& src, int ncomp, Post::FEPostMesh& mesh)
 {
 	switch (ntype)
 	{
-	case DATA_VEC3F  : extractNodeDataComponent_T<vec3f  >(dst, src, ncomp, mesh); break;
-	case DATA_MAT3FS : extractNodeDataComponent_T<mat3fs >(dst, src, ncomp, mesh); break;
-	case DATA_MAT3FD : extractNodeDataComponent_T<mat3fs >(dst, src, ncomp, mesh); break;
-	case DATA_TENS4FS: extractNodeDataComponent_T<tens4fs>(dst, src, ncomp, mesh); break;
-	case DATA_MAT3D  : extractNodeDataComponent_T<mat3d  >(dst, src, ncomp, mesh); break;
-	case DATA_MAT3F  : extractNodeDataComponent_T<mat3f  >(dst, src, ncomp, mesh); break;
+	case DATA_VEC3F  : return extractNodeDataComponent_T<vec3f  >(dst, src, ncomp, mesh);
+	case DATA_MAT3FS : return extractNodeDataComponent_T<mat3fs >(dst, src, ncomp, mesh);
+	case DATA_MAT3FD : return extractNodeDataComponent_T<mat3fs >(dst, src, ncomp, mesh);
+	case DATA_TENS4FS: return extractNodeDataComponent_T<tens4fs>(dst, src, ncomp, mesh);
+	case DATA_MAT3D  : return extractNodeDataComponent_T<mat3d  >(dst, src, ncomp, mesh);
+	case DATA_MAT3F  : return extractNodeDataComponent_T<mat3f  >(dst, src, ncomp, mesh);
 	}
+	return true;
 }
 
-template <typename T> void extractElemDataComponentITEM_T(Post::FEMeshData& dst, Post::FEMeshData& src, int ncomp, Post::FEPostMesh& mesh)
+template <typename T> bool extractElemDataComponentITEM_T(Post::FEMeshData& dst, Post::FEMeshData& src, int ncomp, Post::FEPostMesh& mesh)
 {
-	FEElemData_T<T, DATA_ITEM>& vec = dynamic_cast<FEElemData_T<T, DATA_ITEM>&>(src);
-	Post::FEElementData<float, DATA_ITEM>& scl = dynamic_cast<Post::FEElementData<float, DATA_ITEM>&>(dst);
+	FEElemData_T<T, DATA_ITEM>* pvec = dynamic_cast<FEElemData_T<T, DATA_ITEM>*>(&src);
+	Post::FEElementData<float, DATA_ITEM>* pscl = dynamic_cast<Post::FEElementData<float, DATA_ITEM>*>(&dst);
+	if ((pvec == nullptr) || (pscl == nullptr)) return false;
+	FEElemData_T<T, DATA_ITEM>& vec = *pvec;
+	Post::FEElementData<float, DATA_ITEM>& scl = *pscl;
 
 	int NE = mesh.Elements();
 	for (int i = 0; i<NE; ++i)
@@ -1102,12 +1284,17 @@ template <typename T> void extractElemDataComponentITEM_T(Post::FEMeshData& dst,
 			scl.add(i, component(v, ncomp));
 		}
 	}
+
+	return true;
 }
 
-void extractElemDataComponentITEM_ARRAY(Post::FEMeshData& dst, Post::FEMeshData& src, int ncomp, Post::FEPostMesh& mesh)
+bool extractElemDataComponentITEM_ARRAY(Post::FEMeshData& dst, Post::FEMeshData& src, int ncomp, Post::FEPostMesh& mesh)
 {
-	FEElemArrayDataItem& vec = dynamic_cast<FEElemArrayDataItem&>(src);
-	Post::FEElementData<float, DATA_ITEM>& scl = dynamic_cast<Post::FEElementData<float, DATA_ITEM>&>(dst);
+	FEElemArrayDataItem* pvec = dynamic_cast<FEElemArrayDataItem*>(&src);
+	Post::FEElementData<float, DATA_ITEM>* pscl = dynamic_cast<Post::FEElementData<float, DATA_ITEM>*>(&dst);
+	if ((pvec == nullptr) || (pscl == nullptr)) return false;
+	FEElemArrayDataItem& vec = *pvec;
+	Post::FEElementData<float, DATA_ITEM>& scl = *pscl;
 
 	int NE = mesh.Elements();
 	vector<float> data;
@@ -1123,12 +1310,17 @@ void extractElemDataComponentITEM_ARRAY(Post::FEMeshData& dst, Post::FEMeshData&
 			scl.add(i, f);
 		}
 	}
+
+	return true;
 }
 
-void extractElemDataComponentITEM_ARRAY_VEC3F(Post::FEMeshData& dst, Post::FEMeshData& src, int ncomp, Post::FEPostMesh& mesh)
+bool extractElemDataComponentITEM_ARRAY_VEC3F(Post::FEMeshData& dst, Post::FEMeshData& src, int ncomp, Post::FEPostMesh& mesh)
 {
-	FEElemArrayVec3Data& vec = dynamic_cast<FEElemArrayVec3Data&>(src);
-	Post::FEElementData<float, DATA_ITEM>& scl = dynamic_cast<Post::FEElementData<float, DATA_ITEM>&>(dst);
+	FEElemArrayVec3Data* pvec = dynamic_cast<FEElemArrayVec3Data*>(&src);
+	Post::FEElementData<float, DATA_ITEM>* pscl = dynamic_cast<Post::FEElementData<float, DATA_ITEM>*>(&dst);
+	if ((pvec == nullptr) || (pscl == nullptr)) return false;
+	FEElemArrayVec3Data& vec = *pvec;
+	Post::FEElementData<float, DATA_ITEM>& scl = *pscl;
 
 	int index = ncomp / 4;
 	int veccomp = ncomp % 4;
@@ -1148,27 +1340,33 @@ void extractElemDataComponentITEM_ARRAY_VEC3F(Post::FEMeshData& dst, Post::FEMes
 			scl.add(i, f);
 		}
 	}
+
+	return true;
 }
 
-void extractElemDataComponentITEM(Data_Type ntype, Post::FEMeshData& dst, Post::FEMeshData& src, int ncomp, Post::FEPostMesh& mesh)
+bool extractElemDataComponentITEM(Data_Type ntype, Post::FEMeshData& dst, Post::FEMeshData& src, int ncomp, Post::FEPostMesh& mesh)
 {
 	switch(ntype)
 	{
-	case DATA_VEC3F  : extractElemDataComponentITEM_T<vec3f  >(dst, src, ncomp, mesh); break;
-	case DATA_MAT3FS : extractElemDataComponentITEM_T<mat3fs >(dst, src, ncomp, mesh); break;
-	case DATA_MAT3FD : extractElemDataComponentITEM_T<mat3fs >(dst, src, ncomp, mesh); break;
-	case DATA_TENS4FS: extractElemDataComponentITEM_T<tens4fs>(dst, src, ncomp, mesh); break;
-	case DATA_MAT3D  : extractElemDataComponentITEM_T<mat3d  >(dst, src, ncomp, mesh); break;
-	case DATA_MAT3F  : extractElemDataComponentITEM_T<mat3f  >(dst, src, ncomp, mesh); break;
-	case DATA_ARRAY      : extractElemDataComponentITEM_ARRAY(dst, src, ncomp, mesh); break;
-	case DATA_ARRAY_VEC3F: extractElemDataComponentITEM_ARRAY_VEC3F(dst, src, ncomp, mesh); break;
+	case DATA_VEC3F  : return extractElemDataComponentITEM_T<vec3f  >(dst, src, ncomp, mesh);
+	case DATA_MAT3FS : return extractElemDataComponentITEM_T<mat3fs >(dst, src, ncomp, mesh);
+	case DATA_MAT3FD : return extractElemDataComponentITEM_T<mat3fs >(dst, src, ncomp, mesh);
+	case DATA_TENS4FS: return extractElemDataComponentITEM_T<tens4fs>(dst, src, ncomp, mesh);
+	case DATA_MAT3D  : return extractElemDataComponentITEM_T<mat3d  >(dst, src, ncomp, mesh);
+	case DATA_MAT3F  : return extractElemDataComponentITEM_T<mat3f  >(dst, src, ncomp, mesh);
+	case DATA_ARRAY      : return extractElemDataComponentITEM_ARRAY(dst, src, ncomp, mesh);
+	case DATA_ARRAY_VEC3F: return extractElemDataComponentITEM_ARRAY_VEC3F(dst, src, ncomp, mesh);
 	}
+	return true;
 }
 
-template <typename T> void extractElemDataComponentNODE_T(Post::FEMeshData& dst, Post::FEMeshData& src, int ncomp, Post::FEPostMesh& mesh)
+template <typename T> bool extractElemDataComponentNODE_T(Post::FEMeshData& dst, Post::FEMeshData& src, int ncomp, Post::FEPostMesh& mesh)
 {
-	FEElemData_T<T, DATA_NODE>& vec = dynamic_cast<FEElemData_T<T, DATA_NODE>&>(src);
-	Post::FEElementData<float, DATA_NODE>& scl = dynamic_cast<Post::FEElementData<float, DATA_NODE>&>(dst);
+	FEElemData_T<T, DATA_NODE>* pvec = dynamic_cast<FEElemData_T<T, DATA_NODE>*>(&src);
+	Post::FEElementData<float, DATA_NODE>* pscl = dynamic_cast<Post::FEElementData<float, DATA_NODE>*>(&dst);
+	if ((pvec == nullptr) || (pscl == nullptr)) return false;
+	FEElemData_T<T, DATA_NODE>& vec = *pvec;
+	Post::FEElementData<float, DATA_NODE>& scl = *pscl;
 
 	int NE = mesh.Elements();
 	T val[FSElement::MAX_NODES];
@@ -1194,12 +1392,17 @@ template <typename T> void extractElemDataComponentNODE_T(Post::FEMeshData& dst,
 			scl.add(data, elem, l, ne);
 		}
 	}
+
+	return true;
 }
 
-void extractElemDataComponentNODE_ARRAY(Post::FEMeshData& dst, Post::FEMeshData& src, int ncomp, Post::FEPostMesh& mesh)
+bool extractElemDataComponentNODE_ARRAY(Post::FEMeshData& dst, Post::FEMeshData& src, int ncomp, Post::FEPostMesh& mesh)
 {
-	FEElemArrayDataNode& vec = dynamic_cast<FEElemArrayDataNode&>(src);
-	Post::FEElementData<float, DATA_NODE>& scl = dynamic_cast<Post::FEElementData<float, DATA_NODE>&>(dst);
+	FEElemArrayDataNode* pvec = dynamic_cast<FEElemArrayDataNode*>(&src);
+	Post::FEElementData<float, DATA_NODE>* pscl = dynamic_cast<Post::FEElementData<float, DATA_NODE>*>(&dst);
+	if ((pvec == nullptr) || (pscl == nullptr)) return false;
+	FEElemArrayDataNode& vec = *pvec;
+	Post::FEElementData<float, DATA_NODE>& scl = *pscl;
 
 	int NE = mesh.Elements();
 	float val[FSElement::MAX_NODES];
@@ -1225,23 +1428,26 @@ void extractElemDataComponentNODE_ARRAY(Post::FEMeshData& dst, Post::FEMeshData&
 			scl.add(data, elem, l, ne);
 		}
 	}
+
+	return true;
 }
 
-void extractElemDataComponentNODE(Data_Type ntype, Post::FEMeshData& dst, Post::FEMeshData& src, int ncomp, Post::FEPostMesh& mesh)
+bool extractElemDataComponentNODE(Data_Type ntype, Post::FEMeshData& dst, Post::FEMeshData& src, int ncomp, Post::FEPostMesh& mesh)
 {
 	switch(ntype)
 	{
-	case DATA_VEC3F  : extractElemDataComponentNODE_T<vec3f  >(dst, src, ncomp, mesh); break;
-	case DATA_MAT3FS : extractElemDataComponentNODE_T<mat3fs >(dst, src, ncomp, mesh); break;
-	case DATA_MAT3FD : extractElemDataComponentNODE_T<mat3fs >(dst, src, ncomp, mesh); break;
-	case DATA_TENS4FS: extractElemDataComponentNODE_T<tens4fs>(dst, src, ncomp, mesh); break;
-	case DATA_MAT3D  : extractElemDataComponentNODE_T<mat3d  >(dst, src, ncomp, mesh); break;
-	case DATA_MAT3F  : extractElemDataComponentNODE_T<mat3f  >(dst, src, ncomp, mesh); break;
-	case DATA_ARRAY  : extractElemDataComponentNODE_ARRAY(dst, src, ncomp, mesh); break;
+	case DATA_VEC3F  : return extractElemDataComponentNODE_T<vec3f  >(dst, src, ncomp, mesh);
+	case DATA_MAT3FS : return extractElemDataComponentNODE_T<mat3fs >(dst, src, ncomp, mesh);
+	case DATA_MAT3FD : return extractElemDataComponentNODE_T<mat3fs >(dst, src, ncomp, mesh);
+	case DATA_TENS4FS: return extractElemDataComponentNODE_T<tens4fs>(dst, src, ncomp, mesh);
+	case DATA_MAT3D  : return extractElemDataComponentNODE_T<mat3d  >(dst, src, ncomp, mesh);
+	case DATA_MAT3F  : return extractElemDataComponentNODE_T<mat3f  >(dst, src, ncomp, mesh);
+	case DATA_ARRAY  : return extractElemDataComponentNODE_ARRAY(dst, src, ncomp, mesh);
 	}
+	return true;
 }
 
-ModelDataField* Post::DataComponent(FEPostModel& fem, ModelDataField* pdf, int ncomp, const std::string& sname)
+ModelDataField* Post::DataComponent(FEPostModel& fem, ModelDataField* pdf, int ncomp, const std::string& sname, DataFilterProgress* progress)
 {
 	if (pdf == 0) return 0;
 
@@ -1251,6 +1457,9 @@ ModelDataField* Post::DataComponent(FEPostModel& fem, ModelDataField* pdf, int n
 
 	Post::FEPostMesh& mesh = *fem.GetFEMesh(0);
 
+	bool bparallel = isThreadSafe(fem, pdf->GetFieldID());
+	bool bok = true;
+
 	ModelDataField* newField = 0;
 	if (nclass == CLASS_NODE)
 	{
@@ -1260,11 +1469,10 @@ ModelDataField* Post::DataComponent(FEPostModel& fem, ModelDataField* pdf, int n
 		int nvec = pdf->GetFieldID(); nvec = FIELD_CODE(nvec);
 		int nscl = newField->GetFieldID(); nscl = FIELD_CODE(nscl);
 
-		for (int n=0; n<fem.GetStates(); ++n)
-		{
+		bok = forEachState(fem, bparallel, progress, [&](int n) {
 			FEState* state = fem.GetState(n);
-			extractNodeDataComponent(ntype, state->m_Data[nscl], state->m_Data[nvec], ncomp, mesh);
-		}
+			return extractNodeDataComponent(ntype, state->m_Data[nscl], state->m_Data[nvec], ncomp, mesh);
+		});
 	}
 	else if (nclass == CLASS_FACE)
 	{
@@ -1280,11 +1488,10 @@ ModelDataField* Post::DataComponent(FEPostModel& fem, ModelDataField* pdf, int n
 			int nvec = pdf->GetFieldID(); nvec = FIELD_CODE(nvec);
 			int nscl = newField->GetFieldID(); nscl = FIELD_CODE(nscl);
 
-			for (int n = 0; n<fem.GetStates(); ++n)
-			{
+			bok = forEachState(fem, bparallel, progress, [&](int n) {
 				FEState* state = fem.GetState(n);
-				extractElemDataComponentITEM(ntype, state->m_Data[nscl], state->m_Data[nvec], ncomp, mesh);
-			}
+				return extractElemDataComponentITEM(ntype, state->m_Data[nscl], state->m_Data[nvec], ncomp, mesh);
+			});
 		}
 		else if (nfmt == DATA_NODE)
 		{
@@ -1294,27 +1501,31 @@ ModelDataField* Post::DataComponent(FEPostModel& fem, ModelDataField* pdf, int n
 			int nvec = pdf->GetFieldID(); nvec = FIELD_CODE(nvec);
 			int nscl = newField->GetFieldID(); nscl = FIELD_CODE(nscl);
 
-			for (int n = 0; n<fem.GetStates(); ++n)
-			{
+			bok = forEachState(fem, bparallel, progress, [&](int n) {
 				FEState* state = fem.GetState(n);
-				extractElemDataComponentNODE(ntype, state->m_Data[nscl], state->m_Data[nvec], ncomp, mesh);
-			}
+				return extractElemDataComponentNODE(ntype, state->m_Data[nscl], state->m_Data[nvec], ncomp, mesh);
+			});
 		}
 	}
 
+	if (newField && (bok == false))
+	{
+		fem.DeleteDataField(newField);
+		return nullptr;
+	}
+
 	return newField;
 }
 
 //-----------------------------------------------------------------------------
 // Calculate the fractional anisotropy of a tensor field
-bool Post::DataFractionalAnsisotropy(FEPostModel& fem, int scalarField, int tensorField)
+bool Post::DataFractionalAnsisotropy(FEPostModel& fem, int scalarField, int tensorField, DataFilterProgress* progress)
 {
 	int ntns = FIELD_CODE(tensorField);
 	int nscl = FIELD_CODE(scalarField);
 
 	// loop over all the states
-	for (int n = 0; n<fem.GetStates(); ++n)
-	{
+	return forEachState(fem, isThreadSafe(fem, tensorField), progress, [&](int n) {
 		FEState& state = *fem.GetState(n);
 		FEMeshData& v = state.m_Data[ntns];
 		FEMeshData& s = state.m_Data[nscl];
@@ -1324,6 +1535,7 @@ bool Post::DataFractionalAnsisotropy(FEPostModel& fem, int scalarField, int tens
 		if (IS_ELEM_FIELD(scalarField) && (s.GetType() == DATA_FLOAT))
 		{
 			ps = dynamic_cast<Post::FEElementData<float, DATA_ITEM>*>(&s);
+			if (ps == nullptr) return false;
 			int N = ps->size();
 			for (int i = 0; i < N; ++i) (*ps)[i] = 0.f;
 		}
@@ -1338,6 +1550,7 @@ bool Post::DataFractionalAnsisotropy(FEPostModel& fem, int scalarField, int tens
 			if (IS_ELEM_FIELD(tensorField) && (v.GetFormat() == DATA_ITEM))
 			{
 				FEElemData_T<mat3fs, DATA_ITEM>* pv = dynamic_cast<FEElemData_T<mat3fs, DATA_ITEM>*>(&v);
+				if (pv == nullptr) return false;
 
 				mat3fs ev;
 				for (int i = 0; i<mesh->Elements(); ++i)
@@ -1352,14 +1565,14 @@ bool Post::DataFractionalAnsisotropy(FEPostModel& fem, int scalarField, int tens
 				}
 			}
 		}
-	}
 
-	return true;
+		return true;
+	});
 }
 
 //-----------------------------------------------------------------------------
 // convert between formats
-ModelDataField* Post::DataConvert(FEPostModel& fem, ModelDataField* dataField, int newFormat, const std::string& name)
+ModelDataField* Post::DataConvert(FEPostModel& fem, ModelDataField* dataField, int newFormat, const std::string& name, DataFilterProgress* progress)
 {
 	if (dataField == nullptr) return nullptr;
 
@@ -1372,6 +1585,17 @@ ModelDataField* Post::DataConvert(FEPostModel& fem, ModelDataField* dataField, i
 
 	Post::FEPostMesh& mesh = *fem.GetFEMesh(0);
 
+	bool bparallel = isThreadSafe(fem, dataField->GetFieldID());
+	bool bok = true;
+
+	// scratch buffers
+	struct ConvertBuffer
+	{
+		vector<float>	data;
+		vector<int>		tag;
+	};
+	vector<ConvertBuffer> buf(omp_get_max_threads());
+
 	ModelDataField* newField = nullptr;
 	if (nclass == CLASS_ELEM)
 	{
@@ -1388,15 +1612,15 @@ ModelDataField* Post::DataConvert(FEPostModel& fem, ModelDataField* dataField, i
 				int NN = mesh.Nodes();
 				int NE = mesh.Elements();
 
-				for (int n = 0; n < fem.GetStates(); ++n)
-				{
+				bok = forEachState(fem, bparallel, progress, [&](int n) {
 					FEState* state = fem.GetState(n);
 
-					vector<float> data(NN, 0.f);
-					vector<int> tag(NN, 0);
+					vector<float>& data = buf[omp_get_thread_num()].data; data.assign(NN, 0.f);
+					vector<int>& tag = buf[omp_get_thread_num()].tag; tag.assign(NN, 0);
 
 					FEElemData_T<float, DATA_ITEM>* pold = dynamic_cast<FEElemData_T<float, DATA_ITEM>*>(&state->m_Data[nold]);
 					FEElementData<float, DATA_NODE>* pnew = dynamic_cast<FEElementData<float, DATA_NODE>*>(&state->m_Data[nnew]);
+					if ((pold == nullptr) || (pnew == nullptr)) return false;
 
 					for (int i = 0; i < NE; ++i)
 					{
@@ -1433,7 +1657,8 @@ ModelDataField* Post::DataConvert(FEPostModel& fem, ModelDataField* dataField, i
 						}
 						pnew->add(d, e, l, el.Nodes());
 					}
-				}
+					return true;
+				});
 			}
 		}
 		else if (nfmt == DATA_NODE)
@@ -1449,12 +1674,12 @@ ModelDataField* Post::DataConvert(FEPostModel& fem, ModelDataField* dataField, i
 				int NN = mesh.Nodes();
 				int NE = mesh.Elements();
 
-				for (int n = 0; n < fem.GetStates(); ++n)
-				{
+				bok = forEachState(fem, bparallel, progress, [&](int n) {
 					FEState* state = fem.GetState(n);
 
 					FEElemData_T<float, DATA_NODE>* pold = dynamic_cast<FEElemData_T<float, DATA_NODE>*>(&state->m_Data[nold]);
 					FEElementData<float, DATA_ITEM>* pnew = dynamic_cast<FEElementData<float, DATA_ITEM>*>(&state->m_Data[nnew]);
+					if ((pold == nullptr) || (pnew == nullptr)) return false;
 
 					for (int i = 0; i < NE; ++i)
 					{
@@ -1473,15 +1698,22 @@ ModelDataField* Post::DataConvert(FEPostModel& fem, ModelDataField* dataField, i
 							pnew->add(i, avg);
 						}
 					}
-				}
+					return true;
+				});
 			}
 		}
 	}
 
+	if (newField && (bok == false))
+	{
+		fem.DeleteDataField(newField);
+		return nullptr;
+	}
+
 	return newField;
 }
 
-ModelDataField* Post::DataEigenTensor(FEPostModel& fem, ModelDataField* dataField, const std::string& name)
+ModelDataField* Post::DataEigenTensor(FEPostModel& fem, ModelDataField* dataField, const std::string& name, DataFilterProgress* progress)
 {
 	int dataType = dataField->Type();
 	int nfmt = dataField->Format();
@@ -1500,12 +1732,12 @@ ModelDataField* Post::DataEigenTensor(FEPostModel& fem, ModelDataField* dataFiel
 	Post::FEPostMesh& mesh = *fem.GetFEMesh(0);
 	int NE = mesh.Elements();
 
-	for (int n = 0; n < fem.GetStates(); ++n)
-	{
+	bool bok = forEachState(fem, isThreadSafe(fem, dataField->GetFieldID()), progress, [&](int n) {
 		FEState* state = fem.GetState(n);
 
 		FEElemData_T<mat3fs, DATA_ITEM>* pold = dynamic_cast<FEElemData_T<mat3fs, DATA_ITEM>*>(&state->m_Data[nold]);
 		Post::FEElementData<mat3f, DATA_ITEM>* pnew = dynamic_cast<FEElementData<mat3f, DATA_ITEM>*>(&state->m_Data[nnew]);
+		if ((pold == nullptr) || (pnew == nullptr)) return false;
 
 		for (int i = 0; i < NE; ++i)
 		{
@@ -1525,12 +1757,19 @@ ModelDataField* Post::DataEigenTensor(FEPostModel& fem, ModelDataField* dataFiel
 				pnew->add(i, a);
 			}
 		}
+		return true;
+	});
+
+	if (bok == false)
+	{
+		fem.DeleteDataField(newField);
+		return nullptr;
 	}
 
 	return newField;
 }
 
-ModelDataField* Post::DataTimeRate(FEPostModel& fem, ModelDataField* dataField, const std::string& name)
+ModelDataField* Post::DataTimeRate(FEPostModel& fem, ModelDataField* dataField, const std::string& name, DataFilterProgress* progress)
 {
 	if (dataField == nullptr) return nullptr;
 
@@ -1539,6 +1778,11 @@ ModelDataField* Post::DataTimeRate(FEPostModel& fem, ModelDataField* dataField,
 	int nfmt = dataField->Format();
 
 	Post::FEPostMesh& mesh = *fem.GetFEMesh(0);
+	int NN = mesh.Nodes();
+
+	// each state only reads the data of the previous state
+	bool bparallel = isThreadSafe(fem, dataField->GetFieldID());
+	bool bok = true;
 
 	ModelDataField* newField = 0;
 	if (nclass == CLASS_NODE)
@@ -1551,12 +1795,13 @@ ModelDataField* Post::DataTimeRate(FEPostModel& fem, ModelDataField* dataField,
 			int nold = dataField->GetFieldID(); nold = FIELD_CODE(nold);
 			int nnew = newField->GetFieldID(); nnew = FIELD_CODE(nnew);
 
-			for (int n = 0; n < fem.GetStates(); ++n)
-			{
-				Post::FENodeData<float>& vt = dynamic_cast<FENodeData<float>&>(fem.GetState(n)->m_Data[nnew]);
+			bok = forEachState(fem, bparallel, progress, [&](int n) {
+				Post::FENodeData<float>* pvt = dynamic_cast<FENodeData<float>*>(&fem.GetState(n)->m_Data[nnew]);
+				if (pvt == nullptr) return false;
+				Post::FENodeData<float>& vt = *pvt;
 				if (n == 0)
 				{
-					for (int i = 0; i < mesh.Nodes(); ++i)
+					for (int i = 0; i < NN; ++i)
 					{
 						vt[i] = 0.f;
 					}
@@ -1568,11 +1813,15 @@ ModelDataField* Post::DataTimeRate(FEPostModel& fem, ModelDataField* dataField,
 
 					double dt = state1->m_time - state0->m_time;
 
-					Post::FENodeData_T<float>& d0 = dynamic_cast<FENodeData_T<float>&>(state0->m_Data[nold]);
-					Post::FENodeData_T<float>& d1 = dynamic_cast<FENodeData_T<float>&>(state1->m_Data[nold]);
+					Post::FENodeData_T<float>* pd0 = dynamic_cast<FENodeData_T<float>*>(&state0->m_Data[nold]);
+					Post::FENodeData_T<float>* pd1 = dynamic_cast<FENodeData_T<float>*>(&state1->m_Data[nold]);
+					if ((pd0 == nullptr) || (pd1 == nullptr)) return false;
+					Post::FENodeData_T<float>& d0 = *pd0;
+					Post::FENodeData_T<float>& d1 = *pd1;
 
 
-					for (int i = 0; i < mesh.Nodes(); ++i)
+#pragma omp parallel for if (bparallel)
+					for (int i = 0; i < NN; ++i)
 					{
 						float v0, v1;
 						d0.eval(i, &v0);
@@ -1583,7 +1832,8 @@ ModelDataField* Post::DataTimeRate(FEPostModel& fem, ModelDataField* dataField,
 						vt[i] = dvdt;
 					}
 				}
-			}
+				return true;
+			});
 		}
 		else if (ntype == DATA_VEC3F)
 		{
@@ -1593,12 +1843,13 @@ ModelDataField* Post::DataTimeRate(FEPostModel& fem, ModelDataField* dataField,
 			int nold = dataField->GetFieldID(); nold = FIELD_CODE(nold);
 			int nnew = newField->GetFieldID(); nnew = FIELD_CODE(nnew);
 
-			for (int n = 0; n < fem.GetStates(); ++n)
-			{
-				Post::FENodeData<vec3f>& vt = dynamic_cast<FENodeData<vec3f>&>(fem.GetState(n)->m_Data[nnew]);
+			bok = forEachState(fem, bparallel, progress, [&](int n) {
+				Post::FENodeData<vec3f>* pvt = dynamic_cast<FENodeData<vec3f>*>(&fem.GetState(n)->m_Data[nnew]);
+				if (pvt == nullptr) return false;
+				Post::FENodeData<vec3f>& vt = *pvt;
 				if (n == 0)
 				{
-					for (int i = 0; i < mesh.Nodes(); ++i)
+					for (int i = 0; i < NN; ++i)
 					{
 						vt[i] = vec3f(0.f, 0.f, 0.f);
 					}
@@ -1610,11 +1861,15 @@ ModelDataField* Post::DataTimeRate(FEPostModel& fem, ModelDataField* dataField,
 
 					double dt = state1->m_time - state0->m_time;
 
-					Post::FENodeData_T<vec3f>& d0 = dynamic_cast<FENodeData_T<vec3f>&>(state0->m_Data[nold]);
-					Post::FENodeData_T<vec3f>& d1 = dynamic_cast<FENodeData_T<vec3f>&>(state1->m_Data[nold]);
+					Post::FENodeData_T<vec3f>* pd0 = dynamic_cast<FENodeData_T<vec3f>*>(&state0->m_Data[nold]);
+					Post::FENodeData_T<vec3f>* pd1 = dynamic_cast<FENodeData_T<vec3f>*>(&state1->m_Data[nold]);
+					if ((pd0 == nullptr) || (pd1 == nullptr)) return false;
+					Post::FENodeData_T<vec3f>& d0 = *pd0;
+					Post::FENodeData_T<vec3f>& d1 = *pd1;
 
 
-					for (int i = 0; i < mesh.Nodes(); ++i)
+#pragma omp parallel for if (bparallel)
+					for (int i = 0; i < NN; ++i)
 					{
 						vec3f v0, v1;
 						d0.eval(i, &v0);
@@ -1625,9 +1880,16 @@ ModelDataField* Post::DataTimeRate(FEPostModel& fem, ModelDataField* dataField,
 						vt[i] = dvdt;
 					}
 				}
-			}
+				return true;
+			});
 		}
 	}
 
+	if (newField && (bok == false))
+	{
+		fem.DeleteDataField(newField);
+		return nullptr;
+	}
+
 	return newField;
 }
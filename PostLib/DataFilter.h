@@ -36,38 +36,55 @@ class ModelDataField;
 // Forward declaration of FEPostModel class
 class FEPostModel;
 
+//-----------------------------------------------------------------------------
+// Progress and cancel object that is passed to the data filters. The filters
+// process the states in parallel, but the object is only called by one thread
+// at a time. When a filter that modifies a field in place is canceled, the
+// field is restored to its original values.
+class DataFilterProgress
+{
+public:
+	virtual ~DataFilterProgress() {}
+
+	// called after each state with the fraction of the states that are done
+	virtual void SetProgress(double f) {}
+
+	// return true to stop the filter
+	virtual bool IsCanceled() { return false; }
+};
+
 //-----------------------------------------------------------------------------
 // Scale data by facor
-bool DataScale(FEPostModel& fem, int nfield, double scale);
-bool DataScaleVec3(FEPostModel& fem, int nfield, vec3d scale);
+bool DataScale(FEPostModel& fem, int nfield, double scale, DataFilterProgress* progress = nullptr);
+bool DataScaleVec3(FEPostModel& fem, int nfield, vec3d scale, DataFilterProgress* progress = nullptr);
 
 //-----------------------------------------------------------------------------
 // Apply a smoothing operation on data
-bool DataSmooth(FEPostModel& fem, int nfield, double theta, int niters);
+bool DataSmooth(FEPostModel& fem, int nfield, double theta, int niters, DataFilterProgress* progress = nullptr);
 
 //-----------------------------------------------------------------------------
 // Apply a smoothing operation on data
-bool DataArithmetic(FEPostModel& fem, int nfield, int nop, int noperand);
+bool DataArithmetic(FEPostModel& fem, int nfield, int nop, int noperand, DataFilterProgress* progress = nullptr);
 
 //-----------------------------------------------------------------------------
 // Calculate the gradient of a scale field
-bool DataGradient(FEPostModel& fem, int vecField, int sclField);
+bool DataGradient(FEPostModel& fem, int vecField, int sclField, DataFilterProgress* progress = nullptr);
 
 //-----------------------------------------------------------------------------
 // Calculate the fractional anisotropy of a tensor field
-bool DataFractionalAnsisotropy(FEPostModel& fem, int scalarField, int tensorField);
+bool DataFractionalAnsisotropy(FEPostModel& fem, int scalarField, int tensorField, DataFilterProgress* progress = nullptr);
 
 //-----------------------------------------------------------------------------
 // Extract a component from a data field
-ModelDataField* DataComponent(FEPostModel& fem, ModelDataField* dataField, int ncomp, const std::string& sname);
+ModelDataField* DataComponent(FEPostModel& fem, ModelDataField* dataField, int ncomp, const std::string& sname, DataFilterProgress* progress = nullptr);
 
 //-----------------------------------------------------------------------------
 // convert between formats
-ModelDataField* DataConvert(FEPostModel& fem, ModelDataField* dataField, int newFormat, const std::string& name);
+ModelDataField* DataConvert(FEPostModel& fem, ModelDataField* dataField, int newFormat, const std::string& name, DataFilterProgress* progress = nullptr);
 
 //-----------------------------------------------------------------------------
-ModelDataField* DataEigenTensor(FEPostModel& fem, ModelDataField* dataField, const std::string& name);
+ModelDataField* DataEigenTensor(FEPostModel& fem, ModelDataField* dataField, const std::string& name, DataFilterProgress* progress = nullptr);
 
 //-----------------------------------------------------------------------------
-ModelDataField* DataTimeRate(FEPostModel& fem, ModelDataField* dataField, const std::string& name);
+ModelDataField* DataTimeRate(FEPostModel& fem, ModelDataField* dataField, const std::string& name, DataFilterProgress* progress = nullptr);
 }
@@ -31,6 +31,7 @@ SOFTWARE.*/
 #include <stdio.h>
 #include "tools.h"
 #include "constants.h"
+#include <MeshLib/MeshTools.h>
 using namespace std;
 
 //-----------------------------------------------------------------------------
@@ -38,6 +39,7 @@ Post::FEDistanceMap::FEDistanceMap(Post::FEPostModel* fem, int flags) : Post::Mo
 { 
 	m_tol = 0.01; 
 	m_bsigned = false; 
+	m_bclosest = false;
 }
 
 //-----------------------------------------------------------------------------
@@ -49,6 +51,7 @@ Post::ModelDataField* Post::FEDistanceMap::Clone() const
 	pd->m_surf2 = m_surf2;
 	pd->m_tol = m_tol;
 	pd->m_bsigned = m_bsigned;
+	pd->m_bclosest = m_bclosest;
 	return pd;
 }
 
@@ -107,7 +110,7 @@ void Post::FEDistanceMap::Surface::BuildNodeList(Post::FEPostMesh& mesh)
 	}
 
 	// create the node-facet look-up table
-	m_NLT.resize(Nodes());
+	m_NLT.assign(Nodes(), vector<int>());
 	for (int i=0; i<Faces(); ++i)
 	{
 		FSFace& f = mesh.Face(m_face[i]);
@@ -115,9 +118,14 @@ void Post::FEDistanceMap::Surface::BuildNodeList(Post::FEPostMesh& mesh)
 		for (int j=0; j<nf; ++j)
 		{
 			int inode = m_lnode[MN*i+j];
-			m_NLT[inode].push_back(m_face[i]);
+			m_NLT[inode].push_back(i);
 		}
 	}
+
+	// the search trees need to be rebuilt
+	m_pos.assign(Nodes(), vec3f(0.f, 0.f, 0.f));
+	m_nodeTree.Clear();
+	m_faceTree.Clear();
 }
 
 //-----------------------------------------------------------------------------
@@ -179,14 +187,17 @@ void Post::FEDistanceMap::Apply()
 		FEState* ps = fem.GetState(n);
 		Post::FEFaceData<float, DATA_NODE>* df = dynamic_cast<Post::FEFaceData<float, DATA_NODE>*>(&ps->m_Data[nfield]);
 
+		// get the current positions
+		UpdateSurface(m_surf1, n);
+		UpdateSurface(m_surf2, n);
+
 		// loop over all nodes of surface 1
 		vector<float> a(m_surf1.Nodes());
+#pragma omp parallel for schedule(dynamic, 256)
 		for (int i = 0; i < m_surf1.Nodes(); ++i)
 		{
-			int inode = m_surf1.m_node[i];
-			FSNode& node = mesh.Node(inode);
-			vec3f r = fem.NodePosition(inode, n);
-			vec3f q = project(m_surf2, r, n);
+			vec3f r = m_surf1.m_pos[i];
+			vec3f q = (m_bclosest ? closestPoint(m_surf2, r) : project(m_surf2, r));
 			a[i] = (q - r).Length();
 			if (m_bsigned)
 			{
@@ -200,12 +211,11 @@ void Post::FEDistanceMap::Apply()
 
 		// loop over all nodes of surface 2
 		vector<float> b(m_surf2.Nodes());
+#pragma omp parallel for schedule(dynamic, 256)
 		for (int i = 0; i < m_surf2.Nodes(); ++i)
 		{
-			int inode = m_surf2.m_node[i];
-			FSNode& node = mesh.Node(inode);
-			vec3f r = fem.NodePosition(inode, n);
-			vec3f q = project(m_surf1, r, n);
+			vec3f r = m_surf2.m_pos[i];
+			vec3f q = (m_bclosest ? closestPoint(m_surf1, r) : project(m_surf1, r));
 			b[i] = (q - r).Length();
 			if (m_bsigned)
 			{
@@ -220,37 +230,65 @@ void Post::FEDistanceMap::Apply()
 }
 
 //-----------------------------------------------------------------------------
-vec3f Post::FEDistanceMap::project(Post::FEDistanceMap::Surface& surf, vec3f& r, int ntime)
+void Post::FEDistanceMap::UpdateSurface(Post::FEDistanceMap::Surface& s, int ntime)
 {
 	Post::FEPostModel& fem = *GetModel();
 	Post::FEPostMesh& mesh = *fem.GetFEMesh(0);
 
+	// this may load the state, so it's done serially
+	int NN = s.Nodes();
+	for (int i = 0; i < NN; ++i) s.m_pos[i] = fem.NodePosition(s.m_node[i], ntime);
+
+	// The trees are built for the first state and refitted for the next ones, since
+	// the surface topology doesn't change.
+	vector<BOX> box(NN);
+	for (int i = 0; i < NN; ++i) { vec3d r = to_vec3d(s.m_pos[i]); box[i] = BOX(r, r); }
+	if (s.m_nodeTree.IsEmpty()) s.m_nodeTree.Build(box); else s.m_nodeTree.Refit(box);
+
+	if (m_bclosest)
+	{
+		const int MN = FSFace::MAX_NODES;
+		int NF = s.Faces();
+		box.resize(NF);
+		for (int i = 0; i < NF; ++i)
+		{
+			int nf = mesh.Face(s.m_face[i]).Nodes();
+			vec3d r0 = to_vec3d(s.m_pos[s.m_lnode[MN * i]]);
+			BOX b(r0, r0);
+			for (int j = 1; j < nf; ++j) b += to_vec3d(s.m_pos[s.m_lnode[MN * i + j]]);
+			box[i] = b;
+		}
+		if (s.m_faceTree.IsEmpty()) s.m_faceTree.Build(box); else s.m_faceTree.Refit(box);
+	}
+}
+
+//-----------------------------------------------------------------------------
+vec3f Post::FEDistanceMap::project(Post::FEDistanceMap::Surface& surf, vec3f& r)
+{
 	// find the closest surface node
-	vec3f q = fem.NodePosition(surf.m_node[0], ntime);
+	// (ties go to the lowest index, like a linear search would)
+	vec3f q = surf.m_pos[0];
 	float Dmin = (q - r)*(q - r);
 	int imin = 0;
-	for (int i=1; i<surf.Nodes(); ++i)
-	{
-		vec3f p = fem.NodePosition(surf.m_node[i], ntime);
+	surf.m_nodeTree.Closest(to_vec3d(r), Dmin * (1.0 + 1e-5), [&](int i, double& d2max) {
+		vec3f p = surf.m_pos[i];
 		float D = (p - r)*(p - r);
-		if (D < Dmin)
+		if ((D < Dmin) || ((D == Dmin) && (i < imin)))
 		{
 			q = p;
 			Dmin = D;
 			imin = i;
+			d2max = Dmin * (1.0 + 1e-5);
 		}
-	}
+	});
 
 	// loop over all facets connected to this node
 	vector<int>& FT = surf.m_NLT[imin];
 	for (int i=0; i<(int) FT.size(); ++i)
 	{
-		// get the i-th facet
-		FSFace& face = mesh.Face(FT[i]);
-
 		// project r onto the the facet
 		vec3f p;
-		if (ProjectToFacet(face, r, ntime, p))
+		if (ProjectToFacet(surf, FT[i], r, p))
 		{
 			// return the closest projection
 			float D = (p - r)*(p - r);
@@ -266,19 +304,52 @@ vec3f Post::FEDistanceMap::project(Post::FEDistanceMap::Surface& surf, vec3f& r,
 }
 
 //-----------------------------------------------------------------------------
-bool Post::FEDistanceMap::ProjectToFacet(FSFace& f, vec3f& x, int ntime, vec3f& q)
+// Find the closest point on the surface. Quads are split in two triangles.
+vec3f Post::FEDistanceMap::closestPoint(Post::FEDistanceMap::Surface& surf, const vec3f& r)
+{
+	Post::FEPostMesh& mesh = *GetModel()->GetFEMesh(0);
+	const int MN = FSFace::MAX_NODES;
+
+	vec3f q = surf.m_pos[0];
+	double Dmin = (q - r)*(q - r);
+	surf.m_faceTree.Closest(to_vec3d(r), Dmin, [&](int i, double& d2max) {
+		FSFace& face = mesh.Face(surf.m_face[i]);
+		const int* ln = &surf.m_lnode[MN * i];
+		int ntype = face.Type();
+		bool btri = ((ntype == FE_FACE_TRI3) || (ntype == FE_FACE_TRI6) || (ntype == FE_FACE_TRI7) || (ntype == FE_FACE_TRI10));
+		int ntri = (btri ? 1 : 2);
+		for (int k = 0; k < ntri; ++k)
+		{
+			const vec3f& a = surf.m_pos[ln[0]];
+			const vec3f& b = surf.m_pos[ln[k == 0 ? 1 : 2]];
+			const vec3f& c = surf.m_pos[ln[k == 0 ? 2 : 3]];
+			vec3f p = to_vec3f(closestPointOnTriangle(to_vec3d(r), to_vec3d(a), to_vec3d(b), to_vec3d(c)));
+			double D = (p - r)*(p - r);
+			if (D < Dmin)
+			{
+				q = p;
+				Dmin = D;
+				d2max = D;
+			}
+		}
+	});
+
+	return q;
+}
+
+//-----------------------------------------------------------------------------
+bool Post::FEDistanceMap::ProjectToFacet(Post::FEDistanceMap::Surface& surf, int nface, vec3f& x, vec3f& q)
 {
 	Post::FEPostModel& fem = *GetModel();
 
 	// get the mesh to which this surface belongs
 	Post::FEPostMesh& mesh = *fem.GetFEMesh(0);
-	
-	// number of element nodes
-	int nf = f.Nodes();
+	FSFace& f = mesh.Face(surf.m_face[nface]);
 	
 	// get the elements nodal positions
 	const int MN = FSFace::MAX_NODES;
 	vec3f y[MN];
+	const int* ln = &surf.m_lnode[MN * nface];
 	
 	// calculate normal projection of x onto element
 	switch (f.Type())
@@ -288,7 +359,7 @@ bool Post::FEDistanceMap::ProjectToFacet(FSFace& f, vec3f& x, int ntime, vec3f&
 	case FE_FACE_TRI7:
 	case FE_FACE_TRI10:
 		{
-			for (int i = 0; i<3; ++i) y[i] = fem.NodePosition(f.n[i], ntime);
+			for (int i = 0; i<3; ++i) y[i] = surf.m_pos[ln[i]];
 			return ProjectToTriangle(y, x, q, m_tol);
 		}
 		break;
@@ -296,7 +367,7 @@ bool Post::FEDistanceMap::ProjectToFacet(FSFace& f, vec3f& x, int ntime, vec3f&
 	case FE_FACE_QUAD8:
 	case FE_FACE_QUAD9:
 		{
-			for (int i = 0; i<4; ++i) y[i] = fem.NodePosition(f.n[i], ntime);
+			for (int i = 0; i<4; ++i) y[i] = surf.m_pos[ln[i]];
 			return ProjectToQuad(y, x, q, m_tol);
 		}
 		break;
@@ -26,6 +26,7 @@ SOFTWARE.*/
 
 #pragma once
 #include "FEDataField.h"
+#include <MeshLib/FEMeshBVH.h>
 
 namespace Post {
 
@@ -50,8 +51,12 @@ private:
 		std::vector<int>	m_node;		// node list
 		std::vector<int>	m_lnode;	// local node list
 		std::vector<vec3f> m_norm;	// node normals
+		std::vector<vec3f> m_pos;	// node positions at the current state
 
-		std::vector< std::vector<int> >	m_NLT;	// node-facet look-up table
+		std::vector< std::vector<int> >	m_NLT;	// node-facet look-up table (local facet indices)
+
+		FSMeshBVH	m_nodeTree;	// search tree for the nodes
+		FSMeshBVH	m_faceTree;	// search tree for the facets
 	};
 
 public:
@@ -77,11 +82,17 @@ protected:
 	// build node normal list
 	void BuildNormalList(FEDistanceMap::Surface& s);
 
+	// update the node positions and search trees of the surface
+	void UpdateSurface(Surface& s, int ntime);
+
 	// project r onto the surface
-	vec3f project(Surface& surf, vec3f& r, int ntime);
+	vec3f project(Surface& surf, vec3f& r);
+
+	// find the closest point on the surface
+	vec3f closestPoint(Surface& surf, const vec3f& r);
 
 	// project r onto a facet
-	bool ProjectToFacet(FSFace& face, vec3f& r, int ntime, vec3f& q);
+	bool ProjectToFacet(Surface& surf, int nface, vec3f& r, vec3f& q);
 
 protected:
 	Surface			m_surf1;
@@ -90,5 +101,6 @@ protected:
 public:
 	double	m_tol;			//!< projection tolerance
 	bool	m_bsigned;		//!< signed or non-signed distance
+	bool	m_bclosest;		//!< use closest point on surface instead of projecting from closest node
 };
 }
@@ -36,6 +36,7 @@ Post::MeshDomain::MeshDomain(Post::FEPostMesh *pm)
 {
 	m_pm = pm;
 	m_nmat = -1;
+	m_faceRev = 0;
 }
 
 //-----------------------------------------------------------------------------
@@ -51,6 +52,15 @@ void Post::MeshDomain::SetMatID(int matid)
 	m_nmat = matid;
 }
 
+//-----------------------------------------------------------------------------
+// The revisions are unique over all domains of the mesh, so that a revision 
+// cannot match the face list of a domain that was deleted.
+int Post::MeshDomain::FaceListRevision() const
+{
+	if (m_faceRev == 0) m_faceRev = m_pm->NewFaceListRevision();
+	return m_faceRev;
+}
+
 //-----------------------------------------------------------------------------
 FSFace& Post::MeshDomain::Face(int n)
 { 
@@ -70,14 +70,19 @@ public:
 
 	int Faces() { return (int) m_Face.size(); }
 	FSFace& Face(int n);
+	const std::vector<int>& FaceList() const { return m_Face; }
+
+	// identifies the face list. This changes each time the face list changes.
+	int FaceListRevision() const;
 
 	int Elements() { return (int) m_Elem.size(); }
 	FEElement_& Element(int n);
+	const std::vector<int>& ElementList() const { return m_Elem; }
 
 	void Reserve(int nelems, int nfaces);
 
 	void AddElement(int n) { m_Elem.push_back(n); }
-	void AddFace   (int n) { m_Face.push_back(n); }
+	void AddFace   (int n) { m_Face.push_back(n); m_faceRev = 0; }
 
 protected:
 	FEPostMesh*	m_pm;
@@ -85,6 +90,7 @@ protected:
 	int			m_ntype;
 	std::vector<int>	m_Face;	// face indices 
 	std::vector<int>	m_Elem;	// element indices
+	mutable int			m_faceRev;	// face list revision (0 = not assigned yet)
 };
 
 //-----------------------------------------------------------------------------
@@ -0,0 +1,229 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+#include "stdafx.h"
+#include "FEHistoryCache.h"
+#include "FEPostModel.h"
+#include "constants.h"
+using namespace Post;
+
+//-----------------------------------------------------------------------------
+// evaluate field nfield of an item at a state
+static float evalItem(FEPostModel& fem, int itemType, int item, int ntime, int nfield)
+{
+	switch (itemType)
+	{
+	case FEHistoryCache::NODE:
+	{
+		NODEDATA nd;
+		fem.EvaluateNode(item, ntime, nfield, nd);
+		return nd.m_val;
+	}
+	case FEHistoryCache::EDGE:
+	{
+		EDGEDATA ed;
+		fem.EvaluateEdge(item, ntime, nfield, ed);
+		return ed.m_val;
+	}
+	case FEHistoryCache::FACE:
+	{
+		float data[FSFace::MAX_NODES], val;
+		fem.EvaluateFace(item, ntime, nfield, data, val);
+		return val;
+	}
+	case FEHistoryCache::ELEM:
+	{
+		float data[FSElement::MAX_NODES] = { 0.f }, val;
+		fem.EvaluateElement(item, ntime, nfield, data, val);
+		return val;
+	}
+	}
+	return 0.f;
+}
+
+//-----------------------------------------------------------------------------
+// Only fields that are defined on the item type itself are evaluated without
+// touching the mesh's adjacency lists.
+static bool isItemField(int itemType, int nfield)
+{
+	switch (itemType)
+	{
+	case FEHistoryCache::NODE: return IS_NODE_FIELD(nfield);
+	case FEHistoryCache::EDGE: return IS_EDGE_FIELD(nfield);
+	case FEHistoryCache::FACE: return IS_FACE_FIELD(nfield);
+	case FEHistoryCache::ELEM: return IS_ELEM_FIELD(nfield);
+	}
+	return false;
+}
+
+//-----------------------------------------------------------------------------
+FEHistoryCache::FEHistoryCache()
+{
+	m_fem = nullptr;
+	m_states = 0;
+	m_ndisp = 0;
+	m_dataRev = 0;
+}
+
+//-----------------------------------------------------------------------------
+void FEHistoryCache::Clear()
+{
+	m_fem = nullptr;
+	m_states = 0;
+	m_ndisp = 0;
+	m_dataRev = 0;
+	m_entry.clear();
+}
+
+//-----------------------------------------------------------------------------
+// The values depend on the states, the displacement field (e.g. for strains and
+// positions) and on the data fields, which can be added, removed or edited.
+bool FEHistoryCache::IsValid(FEPostModel& fem) const
+{
+	return (m_fem == &fem) && (m_states == fem.GetStates()) && (m_ndisp == fem.GetDisplacementField()) && (m_dataRev == fem.DataRevision());
+}
+
+//-----------------------------------------------------------------------------
+FEHistoryCache::Entry* FEHistoryCache::FindEntry(int itemType, int nfield)
+{
+	for (Entry& e : m_entry)
+	{
+		if ((e.itemType == itemType) && (e.nfield == nfield)) return &e;
+	}
+	return nullptr;
+}
+
+//-----------------------------------------------------------------------------
+const FEHistoryCache::Entry* FEHistoryCache::FindEntry(int itemType, int nfield) const
+{
+	for (const Entry& e : m_entry)
+	{
+		if ((e.itemType == itemType) && (e.nfield == nfield)) return &e;
+	}
+	return nullptr;
+}
+
+//-----------------------------------------------------------------------------
+void FEHistoryCache::Build(FEPostModel& fem, int itemType, int nfield, const std::vector<int>& items, int nmin, int nmax)
+{
+	// the cache is no longer valid when the model or its data change
+	if (IsValid(fem) == false) Clear();
+	m_fem = &fem;
+	m_states = fem.GetStates();
+	m_ndisp = fem.GetDisplacementField();
+	m_dataRev = fem.DataRevision();
+
+	if (nmin < 0) nmin = 0;
+	if (nmax >= m_states) nmax = m_states - 1;
+	if (nmax < nmin) return;
+
+	// find the entry for this field. If it does not cover the state range, we start over.
+	Entry* pe = FindEntry(itemType, nfield);
+	if (pe && ((nmin < pe->nmin) || (nmax > pe->nmax)))
+	{
+		pe->row.clear();
+		pe->val.clear();
+		pe->nmin = nmin;
+		pe->nmax = nmax;
+	}
+	if (pe == nullptr)
+	{
+		Entry e;
+		e.itemType = itemType;
+		e.nfield = nfield;
+		e.nmin = nmin;
+		e.nmax = nmax;
+		m_entry.push_back(e);
+		pe = &m_entry.back();
+	}
+	Entry& e = *pe;
+
+	// find the items that are not evaluated yet
+	int ns = e.nmax - e.nmin + 1;
+	size_t row0 = e.val.size() / ns;
+	std::vector<int> newItems;
+	for (int item : items)
+	{
+		if (e.row.find(item) == e.row.end())
+		{
+			e.row[item] = (int)(row0 + newItems.size());
+			newItems.push_back(item);
+		}
+	}
+	if (newItems.empty()) return;
+
+	int ni = (int)newItems.size();
+	e.val.resize(e.val.size() + (size_t)ni*ns, 0.f);
+	float* pv = &e.val[row0*ns];
+
+	// the prefetcher should not touch the states while we evaluate
+	fem.CancelPrefetch();
+
+	// The states can be evaluated in parallel if they are all in memory and the
+	// data of each state can be read by multiple threads.
+	bool bparallel = (fem.GetStateLoader() == nullptr) && isItemField(itemType, nfield);
+	for (int n = e.nmin; bparallel && (n <= e.nmax); ++n)
+	{
+		if (fem.IsThreadSafeField(nfield, n) == false) bparallel = false;
+	}
+
+	if (bparallel)
+	{
+#pragma omp parallel for schedule(dynamic)
+		for (int n = 0; n < ns; ++n)
+		{
+			for (int i = 0; i < ni; ++i) pv[(size_t)i*ns + n] = evalItem(fem, itemType, newItems[i], n + e.nmin, nfield);
+		}
+	}
+	else
+	{
+		for (int n = 0; n < ns; ++n)
+		{
+			// keep the state loaded while its items are evaluated
+			FEStatePin pin(fem.StatePtr(n + e.nmin));
+			if (fem.GetState(n + e.nmin)->IsLoaded() == false) continue;
+			for (int i = 0; i < ni; ++i) pv[(size_t)i*ns + n] = evalItem(fem, itemType, newItems[i], n + e.nmin, nfield);
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+bool FEHistoryCache::GetHistory(FEPostModel& fem, int itemType, int nfield, int item, int nmin, int nmax, float* pval) const
+{
+	if (IsValid(fem) == false) return false;
+
+	const Entry* pe = FindEntry(itemType, nfield);
+	if (pe == nullptr) return false;
+	if ((nmin < pe->nmin) || (nmax > pe->nmax)) return false;
+
+	auto it = pe->row.find(item);
+	if (it == pe->row.end()) return false;
+
+	int ns = pe->nmax - pe->nmin + 1;
+	const float* pv = &pe->val[(size_t)it->second*ns + (nmin - pe->nmin)];
+	for (int n = 0; n <= nmax - nmin; ++n) pval[n] = pv[n];
+	return true;
+}
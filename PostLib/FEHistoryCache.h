@@ -0,0 +1,82 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+#pragma once
+#include <vector>
+#include <unordered_map>
+
+namespace Post {
+
+class FEPostModel;
+
+//-----------------------------------------------------------------------------
+// Stores the time history of a data field for a list of mesh items. The values
+// are stored item-major, so that the history of an item is a contiguous array.
+// The history is evaluated in one pass over the states, for all items at once.
+class FEHistoryCache
+{
+public:
+	enum ItemType { NODE, EDGE, FACE, ELEM };
+
+public:
+	FEHistoryCache();
+
+	// remove all data
+	void Clear();
+
+	// Evaluate the history of field nfield for the items over the states [nmin, nmax].
+	// Items that are already in the cache are not evaluated again.
+	void Build(FEPostModel& fem, int itemType, int nfield, const std::vector<int>& items, int nmin, int nmax);
+
+	// Copy the history of an item over the states [nmin, nmax] into pval.
+	// Returns false if the item is not in the cache or the cache is out of date.
+	bool GetHistory(FEPostModel& fem, int itemType, int nfield, int item, int nmin, int nmax, float* pval) const;
+
+private:
+	struct Entry
+	{
+		int		itemType;
+		int		nfield;
+		int		nmin, nmax;		// state range
+		std::unordered_map<int, int>	row;	// row of each item
+		std::vector<float>	val;	// values (nr of items x nr of states)
+	};
+
+	// see if the cache was evaluated for the current data of the model
+	bool IsValid(FEPostModel& fem) const;
+
+	Entry* FindEntry(int itemType, int nfield);
+	const Entry* FindEntry(int itemType, int nfield) const;
+
+private:
+	FEPostModel*		m_fem;		// the model that the history was evaluated for
+	int					m_states;	// nr of states of the model
+	int					m_ndisp;	// displacement field of the model
+	unsigned int		m_dataRev;	// data revision of the model
+	std::vector<Entry>	m_entry;
+};
+
+}
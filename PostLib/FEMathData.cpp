@@ -31,115 +31,191 @@ SOFTWARE.*/
 
 using namespace Post;
 
-FEMathData::FEMathData(FEState* state, FEMathDataField* pdf) : FENodeData_T<float>(state, pdf)
+//-----------------------------------------------------------------------------
+FEMathProgram::FEMathProgram(int neq)
 {
-	m_pdf = pdf;
+	m_eq.resize(neq);
+	m_math.resize(neq);
+	m_bvalid.assign(neq, false);
+	m_rev = 0;
+	m_ncompiled = -1;
 }
 
-// evaluate all the nodal data for this state
-void FEMathData::eval(int n, float* pv)
+//-----------------------------------------------------------------------------
+FEMathProgram::FEMathProgram(const FEMathProgram& prg)
 {
-	FEPostModel& fem = *GetFSModel();
-
+	int neq = prg.Equations();
+	m_eq = prg.m_eq;
+	m_math.resize(neq);
+	m_bvalid.assign(neq, false);
+	m_rev = 0;
+	m_ncompiled = -1;
+}
 
-	double time = m_state->m_time;
+//-----------------------------------------------------------------------------
+void FEMathProgram::SetEquation(int n, const std::string& eq)
+{
+	m_eq[n] = eq;
+	m_rev++;
+}
 
-	FEPostMesh& mesh = *m_state->GetFEMesh();
+//-----------------------------------------------------------------------------
+void FEMathProgram::Compile()
+{
+	if (m_ncompiled.load(std::memory_order_acquire) == m_rev) return;
 
-	MSimpleExpression math;
-	math.AddVariable("t", time);
+#pragma omp critical (FEMathProgram_Compile)
+	if (m_ncompiled != m_rev)
+	{
+		for (int i = 0; i < Equations(); ++i)
+		{
+			// the order of the variables must match the order in Evaluate
+			MSimpleExpression& m = m_math[i];
+			m.Clear();
+			m.AddVariable("x");
+			m.AddVariable("y");
+			m.AddVariable("z");
+			m.AddVariable("t");
+			m_bvalid[i] = (m_eq[i].empty() == false) && m.Create(m_eq[i]);
+		}
+		m_ncompiled.store(m_rev, std::memory_order_release);
+	}
+}
 
-	int ierr;
-	FSNode& node = mesh.Node(n);
+//-----------------------------------------------------------------------------
+// Note that this only reads the compiled expressions, so it can be called from
+// multiple threads.
+void FEMathProgram::Evaluate(const vec3f& r, double t, double* v, std::vector<double>& var) const
+{
+	var.resize(4);
+	var[0] = (double)r.x; var[1] = (double)r.y; var[2] = (double)r.z; var[3] = t;
+	for (int i = 0; i < Equations(); ++i)
+	{
+		v[i] = (m_bvalid[i] ? m_math[i].value_s(var) : 0.0);
+	}
+}
 
-	vec3f r = fem.NodePosition(n, m_state->GetID());
-	math.AddVariable("x", (double)r.x);
-	math.AddVariable("y", (double)r.y);
-	math.AddVariable("z", (double)r.z);
+//-----------------------------------------------------------------------------
+// Evaluates the equations of a program at all the nodes of a state. The equations
+// are parsed once, and then evaluated in parallel. 
+template <typename T> void EvaluateMathProgram(FEMathProgram& prg, FEState& state, std::vector<T>& val, void (*assign)(T&, const double*))
+{
+	FEPostModel& fem = *state.GetFSModel();
+	FEPostMesh& mesh = *state.GetFEMesh();
+	int ntime = state.GetID();
+	double time = (double)state.m_time;
 
-	const std::string& eq = m_pdf->EquationString();
-	math.Create(eq);
+	prg.Compile();
 
-	double v = math.value();
+	// get the nodal positions
+	int NN = mesh.Nodes();
+	std::vector<vec3f> r(NN);
+	for (int i = 0; i < NN; ++i) r[i] = fem.NodePosition(i, ntime);
 
-	if (pv) *pv = (float) v;
+	val.resize(NN);
+#pragma omp parallel
+	{
+		std::vector<double> var(4);
+#pragma omp for
+		for (int i = 0; i < NN; ++i)
+		{
+			double v[9];
+			prg.Evaluate(r[i], time, v, var);
+			assign(val[i], v);
+		}
+	}
 }
 
-
-FEMathVec3Data::FEMathVec3Data(FEState* state, FEMathVec3DataField* pdf) : FENodeData_T<vec3f>(state, pdf)
+//-----------------------------------------------------------------------------
+// The key identifies the equations and displacement field the values were evaluated with.
+static long long mathDataKey(int rev, int ndisp)
 {
-	m_pdf = pdf;
+	return ((long long)rev << 32) | (unsigned int)ndisp;
 }
 
-// evaluate all the nodal data for this state
-void FEMathVec3Data::eval(int n, vec3f* pv)
+//-----------------------------------------------------------------------------
+// Reevaluates the values when the equations or the displacement field changed. This
+// can be called by multiple threads. Only one thread evaluates the equations, and the
+// others wait until the values are published.
+template <typename T> void UpdateMathData(FEMathProgram& prg, FEState& state, std::vector<T>& val, std::atomic<long long>& key, std::mutex& mtx, void (*assign)(T&, const double*))
 {
-	FEPostModel& fem = *GetFSModel();
-
-	FEState& state = *m_state;
-	int ntime = state.GetID();
-	double time = (double)state.m_time;
+	int ndisp = state.GetFSModel()->GetDisplacementField();
+	long long newKey = mathDataKey(prg.Revision(), ndisp);
+	if (key.load(std::memory_order_acquire) == newKey) return;
+
+	std::lock_guard<std::mutex> lock(mtx);
+	if (key.load(std::memory_order_relaxed) == newKey) return;
+	EvaluateMathProgram(prg, state, val, assign);
+	key.store(newKey, std::memory_order_release);
+}
 
-	FEPostMesh& mesh = *state.GetFEMesh();
+static void assign_float(float& a, const double* v) { a = (float)v[0]; }
+static void assign_vec3f(vec3f& a, const double* v) { a = vec3f((float)v[0], (float)v[1], (float)v[2]); }
+static void assign_mat3f(mat3f& a, const double* v) 
+{ 
+	a = mat3f(
+		(float)v[0], (float)v[1], (float)v[2], 
+		(float)v[3], (float)v[4], (float)v[5], 
+		(float)v[6], (float)v[7], (float)v[8]);
+}
 
-	MSimpleExpression math;
-	math.AddVariable("t", time);
+//-----------------------------------------------------------------------------
+FEMathData::FEMathData(FEState* state, FEMathDataField* pdf) : FENodeData_T<float>(state, pdf)
+{
+	m_pdf = pdf;
+	m_key = -1;
+}
 
-	int ierr;
-	FSNode& node = mesh.Node(n);
+// evaluate the equation at all nodes
+void FEMathData::Update()
+{
+	UpdateMathData(m_pdf->Program(), *m_state, m_val, m_key, m_mutex, assign_float);
+}
 
-	vec3f r = fem.NodePosition(n, ntime);
-	math.AddVariable("x", (double)r.x);
-	math.AddVariable("y", (double)r.y);
-	math.AddVariable("z", (double)r.z);
+// evaluate the nodal data for this state
+void FEMathData::eval(int n, float* pv)
+{
+	Update();
+	if (pv) *pv = m_val[n];
+}
 
-	const std::string& x = m_pdf->EquationString(0);
-	const std::string& y = m_pdf->EquationString(1);
-	const std::string& z = m_pdf->EquationString(2);
+//-----------------------------------------------------------------------------
+FEMathVec3Data::FEMathVec3Data(FEState* state, FEMathVec3DataField* pdf) : FENodeData_T<vec3f>(state, pdf)
+{
+	m_pdf = pdf;
+	m_key = -1;
+}
 
-	vec3f v;
-	v.x = (float)math.value(x);
-	v.y = (float)math.value(y);
-	v.z = (float)math.value(z);
+// evaluate the equations at all nodes
+void FEMathVec3Data::Update()
+{
+	UpdateMathData(m_pdf->Program(), *m_state, m_val, m_key, m_mutex, assign_vec3f);
+}
 
-	if (pv) *pv = v;
+// evaluate the nodal data for this state
+void FEMathVec3Data::eval(int n, vec3f* pv)
+{
+	Update();
+	if (pv) *pv = m_val[n];
 }
 
+//-----------------------------------------------------------------------------
 FEMathMat3Data::FEMathMat3Data(FEState* state, FEMathMat3DataField* pdf) : FENodeData_T<mat3f>(state, pdf)
 {
 	m_pdf = pdf;
+	m_key = -1;
+}
+
+// evaluate the equations at all nodes
+void FEMathMat3Data::Update()
+{
+	UpdateMathData(m_pdf->Program(), *m_state, m_val, m_key, m_mutex, assign_mat3f);
 }
 
 // evaluate the nodal data for this state
 void FEMathMat3Data::eval(int n, mat3f* pv)
 {
 	if (pv == nullptr) return;
-
-	FEPostModel& fem = *GetFSModel();
-
-	FEState& state = *m_state;
-	int ntime = state.GetID();
-	double time = (double)state.m_time;
-
-	FEPostMesh& mesh = *state.GetFEMesh();
-
-	MSimpleExpression math;
-	math.AddVariable("t", time);
-
-	int ierr;
-	FSNode& node = mesh.Node(n);
-
-	vec3f r = fem.NodePosition(n, ntime);
-	math.AddVariable("x", (double)r.x);
-	math.AddVariable("y", (double)r.y);
-	math.AddVariable("z", (double)r.z);
-
-	float m[9] = { 0.f };
-	for (int i = 0; i < 9; ++i)
-	{
-		const std::string& eq = m_pdf->EquationString(i);
-		m[i] = (float) math.value(eq);
-	}
-
-	*pv = mat3f(m[0], m[1], m[2], m[3], m[4], m[5], m[6], m[7], m[8]);
+	Update();
+	*pv = m_val[n];
 }
@@ -26,9 +26,47 @@ SOFTWARE.*/
 
 #pragma once
 #include "FEMeshData_T.h"
+#include <FECore/MathObject.h>
+#include <atomic>
+#include <mutex>
 
 namespace Post {
 
+//-----------------------------------------------------------------------------
+// A list of equations in x, y, z, and t. The equations are only parsed when
+// they have changed. Once compiled, they can be evaluated by multiple threads.
+class FEMathProgram
+{
+public:
+	FEMathProgram(int neq);
+	FEMathProgram(const FEMathProgram& prg);
+
+	int Equations() const { return (int)m_eq.size(); }
+
+	void SetEquation(int n, const std::string& eq);
+	const std::string& Equation(int n) const { return m_eq[n]; }
+
+	// this is incremented each time an equation changes
+	int Revision() const { return m_rev; }
+
+	// parse the equations (if they were changed)
+	void Compile();
+
+	// evaluate all equations at position r and time t. The array var is used
+	// to pass the variables to the equations, so it can be reused between calls.
+	void Evaluate(const vec3f& r, double t, double* v, std::vector<double>& var) const;
+
+private:
+	void operator = (const FEMathProgram&) {}
+
+private:
+	std::vector<std::string>		m_eq;
+	std::vector<MSimpleExpression>	m_math;
+	std::vector<bool>				m_bvalid;
+	std::atomic<int>	m_rev;
+	std::atomic<int>	m_ncompiled;	// revision that was compiled
+};
+
 class FEMathDataField;
 class FEMathVec3DataField;
 class FEMathMat3DataField;
@@ -41,8 +79,19 @@ public:
 	// evaluate the nodal data for this state
 	void eval(int n, float* pv) override;
 
+	// the values are evaluated once for all nodes (in Prepare)
+	bool IsThreadSafe() override { return true; }
+	void Prepare() override { Update(); }
+
+private:
+	// evaluate the equations at all nodes
+	void Update();
+
 private:
 	FEMathDataField*	m_pdf;
+	std::vector<float>	m_val;	// values at nodes
+	std::atomic<long long>	m_key;	// revision of the equations and displacement field that were evaluated
+	std::mutex	m_mutex;	// makes sure only one thread evaluates the equations
 };
 
 class FEMathVec3Data : public FENodeData_T<vec3f>
@@ -53,8 +102,19 @@ public:
 	// evaluate the nodal data for this state
 	void eval(int n, vec3f* pv) override;
 
+	// the values are evaluated once for all nodes (in Prepare)
+	bool IsThreadSafe() override { return true; }
+	void Prepare() override { Update(); }
+
+private:
+	// evaluate the equations at all nodes
+	void Update();
+
 private:
 	FEMathVec3DataField*	m_pdf;
+	std::vector<vec3f>	m_val;	// values at nodes
+	std::atomic<long long>	m_key;	// revision of the equations and displacement field that were evaluated
+	std::mutex	m_mutex;	// makes sure only one thread evaluates the equations
 };
 
 class FEMathMat3Data : public FENodeData_T<mat3f>
@@ -65,23 +125,33 @@ public:
 	// evaluate the nodal data for this state
 	void eval(int n, mat3f* pv) override;
 
+	// the values are evaluated once for all nodes (in Prepare)
+	bool IsThreadSafe() override { return true; }
+	void Prepare() override { Update(); }
+
+private:
+	// evaluate the equations at all nodes
+	void Update();
+
 private:
 	FEMathMat3DataField*	m_pdf;
+	std::vector<mat3f>	m_val;	// values at nodes
+	std::atomic<long long>	m_key;	// revision of the equations and displacement field that were evaluated
+	std::mutex	m_mutex;	// makes sure only one thread evaluates the equations
 };
 
 class FEMathDataField : public ModelDataField
 {
 public:
-	FEMathDataField(Post::FEPostModel* fem, unsigned int flag = 0) : ModelDataField(fem, DATA_FLOAT, DATA_NODE, CLASS_NODE, flag)
+	FEMathDataField(Post::FEPostModel* fem, unsigned int flag = 0) : ModelDataField(fem, DATA_FLOAT, DATA_NODE, CLASS_NODE, flag), m_prg(1)
 	{
-		m_eq = "";
 	}
 
 	//! Create a copy
 	ModelDataField* Clone() const override
 	{
 		FEMathDataField* pd = new FEMathDataField(m_fem);
-		pd->m_eq = m_eq;
+		pd->m_prg.SetEquation(0, m_prg.Equation(0));
 		return pd;
 	}
 
@@ -91,31 +161,28 @@ public:
 		return new FEMathData(pstate, this);
 	}
 
-	void SetEquationString(const std::string& eq) { m_eq = eq; }
+	void SetEquationString(const std::string& eq) { m_prg.SetEquation(0, eq); }
 
-	const std::string& EquationString() const { return m_eq; }
+	const std::string& EquationString() const { return m_prg.Equation(0); }
+
+	FEMathProgram& Program() { return m_prg; }
 
 private:
-	std::string	m_eq;		//!< equation string
+	FEMathProgram	m_prg;		//!< equation
 };
 
 class FEMathVec3DataField : public ModelDataField
 {
 public:
-	FEMathVec3DataField(Post::FEPostModel* fem, unsigned int flag = 0) : ModelDataField(fem, DATA_VEC3F, DATA_NODE, CLASS_NODE, flag)
+	FEMathVec3DataField(Post::FEPostModel* fem, unsigned int flag = 0) : ModelDataField(fem, DATA_VEC3F, DATA_NODE, CLASS_NODE, flag), m_prg(3)
 	{
-		m_eq[0] = "";
-		m_eq[1] = "";
-		m_eq[2] = "";
 	}
 
 	//! Create a copy
 	ModelDataField* Clone() const override
 	{
 		FEMathVec3DataField* pd = new FEMathVec3DataField(m_fem);
-		pd->m_eq[0] = m_eq[0];
-		pd->m_eq[1] = m_eq[1];
-		pd->m_eq[2] = m_eq[2];
+		for (int i = 0; i < 3; ++i) pd->m_prg.SetEquation(i, m_prg.Equation(i));
 		return pd;
 	}
 
@@ -127,23 +194,25 @@ public:
 
 	void SetEquationStrings(const std::string& x, const std::string& y, const std::string& z)
 	{
-		m_eq[0] = x; 
-		m_eq[1] = y;
-		m_eq[2] = z;
+		m_prg.SetEquation(0, x);
+		m_prg.SetEquation(1, y);
+		m_prg.SetEquation(2, z);
 	}
 
-	void SetEquationString(int n, const std::string& eq) { m_eq[n] = eq; }
+	void SetEquationString(int n, const std::string& eq) { m_prg.SetEquation(n, eq); }
+
+	const std::string& EquationString(int n) const { return m_prg.Equation(n); }
 
-	const std::string& EquationString(int n) const { return m_eq[n]; }
+	FEMathProgram& Program() { return m_prg; }
 
 private:
-	std::string	m_eq[3];		//!< equation string
+	FEMathProgram	m_prg;		//!< equations
 };
 
 class FEMathMat3DataField : public ModelDataField
 {
 public:
-	FEMathMat3DataField(Post::FEPostModel* fem, unsigned int flag = 0) : ModelDataField(fem, DATA_MAT3F, DATA_NODE, CLASS_NODE, flag)
+	FEMathMat3DataField(Post::FEPostModel* fem, unsigned int flag = 0) : ModelDataField(fem, DATA_MAT3F, DATA_NODE, CLASS_NODE, flag), m_prg(9)
 	{
 	}
 
@@ -151,7 +220,7 @@ public:
 	ModelDataField* Clone() const override
 	{
 		FEMathMat3DataField* pd = new FEMathMat3DataField(m_fem);
-		for (int i = 0; i < 9; ++i) pd->m_eq[i] = m_eq[i];
+		for (int i = 0; i < 9; ++i) pd->m_prg.SetEquation(i, m_prg.Equation(i));
 		return pd;
 	}
 
@@ -166,16 +235,18 @@ public:
 		const std::string& m10, const std::string& m11, const std::string& m12,
 		const std::string& m20, const std::string& m21, const std::string& m22)
 	{
-		m_eq[0] = m00; m_eq[1] = m01; m_eq[2] = m02;
-		m_eq[3] = m10; m_eq[4] = m11; m_eq[5] = m12;
-		m_eq[6] = m20; m_eq[7] = m21; m_eq[8] = m22;
+		m_prg.SetEquation(0, m00); m_prg.SetEquation(1, m01); m_prg.SetEquation(2, m02);
+		m_prg.SetEquation(3, m10); m_prg.SetEquation(4, m11); m_prg.SetEquation(5, m12);
+		m_prg.SetEquation(6, m20); m_prg.SetEquation(7, m21); m_prg.SetEquation(8, m22);
 	}
 
-	void SetEquationString(int n, const std::string& eq) { m_eq[n] = eq; }
+	void SetEquationString(int n, const std::string& eq) { m_prg.SetEquation(n, eq); }
+
+	const std::string& EquationString(int n) const { return m_prg.Equation(n); }
 
-	const std::string& EquationString(int n) const { return m_eq[n]; }
+	FEMathProgram& Program() { return m_prg; }
 
 private:
-	std::string	m_eq[9];		//!< equation string
+	FEMathProgram	m_prg;		//!< equations
 };
 }
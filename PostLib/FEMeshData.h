@@ -86,6 +86,29 @@ enum Data_Tensor_Type {
 	DATA_TENSOR2,
 };
 
+//-----------------------------------------------------------------------------
+// Copy of the values of a data field, which is used to undo changes to the field.
+class FEMeshDataBackup
+{
+public:
+	virtual ~FEMeshDataBackup() {}
+
+	// copy the values back into the field
+	virtual void Restore() = 0;
+};
+
+template <class T> class FEValueBackup : public FEMeshDataBackup
+{
+public:
+	FEValueBackup(std::vector<T>& data) : m_data(data), m_copy(data) {}
+
+	void Restore() override { m_data = m_copy; }
+
+private:
+	std::vector<T>&	m_data;
+	std::vector<T>	m_copy;
+};
+
 //-----------------------------------------------------------------------------
 //! Base class for mesh data classes
 //!
@@ -104,6 +127,17 @@ public:
 
 	FEPostModel* GetFSModel();
 
+	// returns true if the data can be evaluated by several threads at the same time
+	virtual bool IsThreadSafe() { return false; }
+
+	// This is called once before the data is evaluated by several threads. Data that
+	// is evaluated for all items at once should do that here.
+	virtual void Prepare() {}
+
+	// Returns a copy of the data values that can be restored later, or null if
+	// the data does not support this. The caller owns the copy.
+	virtual FEMeshDataBackup* Backup() { return nullptr; }
+
 protected:
 	FEState*	m_state;
 	Data_Type	m_ntype;
@@ -72,10 +72,13 @@ public:
 	FENodeData(FEState* state, ModelDataField* pdf) : FENodeData_T<T>(state, pdf) { m_data.resize(state->GetFEMesh()->Nodes()); }
 	void eval(int n, T* pv) { (*pv) = m_data[n]; }
 	void copy(FENodeData<T>& d) { m_data = d.m_data; }
+	bool IsThreadSafe() { return true; }
 
 	int size() const { return (int) m_data.size(); }
 	T& operator [] (int n) { return m_data[n]; }
 
+	FEMeshDataBackup* Backup() override { return new FEValueBackup<T>(m_data); }
+
 protected:
 	std::vector<T>	m_data;
 };
@@ -92,6 +95,7 @@ public:
 	}
 
 	float eval(int n, int comp) { return m_data[n*m_stride + comp]; }
+	bool IsThreadSafe() { return true; }
 	void setData(std::vector<float>& data)
 	{
 		assert(data.size() == m_data.size());
@@ -146,6 +150,7 @@ public:
 	}
 	void eval(int n, T* pv) { (*pv) = m_data[m_face[n]]; }
 	bool active(int n) { return (m_face[n] >= 0); }
+	bool IsThreadSafe() { return true; }
 	void copy(FEFaceData<T,DATA_ITEM>& d) { m_data = d.m_data; }
 	bool add(int n, const T& d)
 	{ 
@@ -163,6 +168,8 @@ public:
 	int size() const { return (int) m_data.size(); }
 	T& operator [] (int n) { return m_data[n]; }
 
+	FEMeshDataBackup* Backup() override { return new FEValueBackup<T>(m_data); }
+
 protected:
 	std::vector<T>		m_data;
 	std::vector<int>		m_face;
@@ -179,6 +186,7 @@ public:
 	}
 	void eval(int n, T* pv) { (*pv) = m_data[m_face[n]]; }
 	bool active(int n) { return (m_face[n] >= 0); }
+	bool IsThreadSafe() { return true; }
 	void copy(FEFaceData<T,DATA_ITEM>& d) { m_data = d.m_data; }
 	bool add(std::vector<int>& item, const T& v)
 	{ 
@@ -200,6 +208,8 @@ public:
 	int size() const { return (int)m_data.size(); }
 	T& operator [] (int n) { return m_data[n]; }
 
+	FEMeshDataBackup* Backup() override { return new FEValueBackup<T>(m_data); }
+
 protected:
 	std::vector<T>		m_data;
 	std::vector<int>		m_face;
@@ -221,6 +231,7 @@ public:
 		for (int i=0; i<m; ++i) pv[i] = m_data[m_face[n] + i];
 	}
 	bool active(int n) { return (m_face[n] >= 0); }
+	bool IsThreadSafe() { return true; }
 	void copy(FEFaceData<T,DATA_COMP>& d) { m_data = d.m_data; m_face = d.m_face; }
 	bool add(int n, T* d, int m) 
 	{ 
@@ -237,6 +248,8 @@ public:
 	int size() const { return (int)m_data.size(); }
 	T& operator [] (int n) { return m_data[n]; }
 
+	FEMeshDataBackup* Backup() override { return new FEValueBackup<T>(m_data); }
+
 protected:
 	std::vector<T>		m_data;
 	std::vector<int>		m_face;
@@ -263,6 +276,7 @@ public:
 		for (int i=0; i<m; ++i) pv[i] = m_data[m_indx[n + i] ]; 
 	}
 	bool active(int n) { return (m_face[2*n] >= 0); }
+	bool IsThreadSafe() { return true; }
 	void copy(FEFaceData<T,DATA_NODE>& d) { m_data = d.m_data; m_indx = d.m_indx; }
 	void add(std::vector<T>& data, std::vector<int>& face, std::vector<int>& index, std::vector<int>& nf)
 	{
@@ -280,6 +294,8 @@ public:
 	int size() const { return (int)m_data.size(); }
 	T& operator [] (int n) { return m_data[n]; }
 
+	FEMeshDataBackup* Backup() override { return new FEValueBackup<T>(m_data); }
+
 protected:
 	std::vector<T>		m_data;
 	std::vector<int>		m_face;
@@ -313,6 +329,7 @@ public:
 	}
 
 	bool active(int n) { return (m_elem.empty() == false) && (m_elem[n] >= 0); }
+	bool IsThreadSafe() { return true; }
 
 	float eval(int n, int comp) 
 	{ 
@@ -363,6 +380,7 @@ public:
 		for (int j = 0; j<m; ++j) pv[j] = m_data[m_indx[n + j] + comp];
 	}
 	bool active(int n) { return (m_elem.empty() == false) && (m_elem[2 * n] >= 0); }
+	bool IsThreadSafe() { return true; }
 	void add(std::vector<float>& d, std::vector<int>& e, std::vector<int>& l, int ne)
 	{
 		int n0 = (int)m_data.size();
@@ -396,6 +414,7 @@ public:
 	}
 
 	bool active(int n) { return (m_elem.empty() == false) && (m_elem[n] >= 0); }
+	bool IsThreadSafe() { return true; }
 
 	// evaluate the field for an element
 	// n = element index
@@ -459,6 +478,7 @@ public:
 	void set(int n, const T& v) { assert(m_elem[n] >= 0); m_data[m_elem[n]] = v; }
 	void copy(FEElementData<T, DATA_ITEM>& d) { m_data = d.m_data; }
 	bool active(int n) { return (m_elem.empty() == false) && (m_elem[n] >= 0); }
+	bool IsThreadSafe() { return true; }
 	void add(int n, const T& v)
 	{ 
 		int m = m_elem[n]; 
@@ -472,6 +492,8 @@ public:
 	int size() { return (int) m_data.size(); }
 	T& operator [] (int i) { return m_data[i]; }
 
+	FEMeshDataBackup* Backup() override { return new FEValueBackup<T>(m_data); }
+
 protected:
 	std::vector<T>		m_data;
 	std::vector<int>	m_elem;
@@ -489,6 +511,7 @@ public:
 	void eval(int n, T* pv) { assert(m_elem[n] >= 0); (*pv) = m_data[m_elem[n]]; }
 	void copy(FEElementData<T, DATA_REGION>& d) { m_data = d.m_data; }
 	bool active(int n) { return (m_elem.empty() == false) && (m_elem[n] >= 0); }
+	bool IsThreadSafe() { return true; }
 	void add(std::vector<int>& item, const T& v)
 	{ 
 		int m = (int) m_data.size(); 
@@ -517,6 +540,8 @@ public:
 	int size() const { return (int) m_data.size(); }
 	T& operator [] (int n) { return m_data[n]; }
 
+	FEMeshDataBackup* Backup() override { return new FEValueBackup<T>(m_data); }
+
 protected:
 	std::vector<T>		m_data;
 	std::vector<int>	m_elem;
@@ -542,6 +567,7 @@ public:
 		for (int j=0; j<m; ++j) pv[j] = m_data[n + j];
 	}
 	bool active(int n) { return (m_elem.empty() == false) && (m_elem[2 * n + 1] > 0); }
+	bool IsThreadSafe() { return true; }
 	void copy(FEElementData<T,DATA_COMP>& d) { m_data = d.m_data; }
 	void add(int n, int m, T* d) 
 	{ 
@@ -555,6 +581,8 @@ public:
 	int size() { return (int) m_data.size(); }
 	T& operator [] (int i) { return m_data[i]; }
 
+	FEMeshDataBackup* Backup() override { return new FEValueBackup<T>(m_data); }
+
 protected:
 	std::vector<T>		m_data;
 	std::vector<int>	m_elem;
@@ -586,6 +614,7 @@ public:
 		m_data[m_indx[n + j]] = v;
 	}
 	bool active(int n) { return (m_elem.empty() == false) && (m_elem[2 * n] >= 0); }
+	bool IsThreadSafe() { return true; }
 	void copy(FEElementData<T,DATA_NODE>& d) { m_data = d.m_data; m_indx = d.m_indx; }
 	void add(std::vector<T>& d, std::vector<int>& e, std::vector<int>& l, int ne)
 	{ 
@@ -601,6 +630,8 @@ public:
 	int size() { return (int) m_data.size(); }
 	T& operator [] (int i) { return m_data[i]; }
 
+	FEMeshDataBackup* Backup() override { return new FEValueBackup<T>(m_data); }
+
 protected:
 	std::vector<T>			m_data;
 	std::vector<int>		m_elem;
@@ -617,6 +648,7 @@ class NodePosition : public FENodeData_T<vec3f>
 public:
 	NodePosition(FEState* state, ModelDataField* pdf) : FENodeData_T<vec3f>(state, pdf){}
 	void eval(int n, vec3f* pv);
+	bool IsThreadSafe() { return true; }
 };
 
 //-----------------------------------------------------------------------------
@@ -42,6 +42,7 @@ using namespace std;
 // Constructor
 Post::FEPostMesh::FEPostMesh()
 {
+	m_faceListRev = 0;
 }
 
 //-----------------------------------------------------------------------------
@@ -56,6 +57,7 @@ Post::FEPostMesh::~FEPostMesh()
 void Post::FEPostMesh::CleanUp()
 {
 	m_NEL.Clear();
+	m_nelRev = 0;
 	m_NFL.Clear();
 
 	ClearDomains();
@@ -209,7 +211,7 @@ void Post::FEPostMesh::BuildMesh()
 	FSMesh::RebuildMesh(60.0);
 
 	// Build the node-element list
-	m_NEL.Build(this);
+	NodeElementList();
 
 	// build the node-face list
 	m_NFL.Build(this);
@@ -58,7 +58,7 @@ public:
 	//! clean mesh and all data
 	void ClearAll();
 
-	const std::vector<NodeElemRef>& NodeElemList(int n) const { return m_NEL.ElementList(n); }
+	NodeElemRange NodeElemList(int n) const { return NodeElementList().ElementList(n); }
 
 public:
 	// --- G E O M E T R Y ---
@@ -69,6 +69,9 @@ public:
 	//! return a domain
 	MeshDomain& Domain(int i) { return *m_Dom[i]; }
 
+	//! get a new revision number for a domain's face list (see MeshDomain::FaceListRevision)
+	int NewFaceListRevision() { return ++m_faceListRev; }
+
 	//! nr of parts
 	int Parts() const { return (int) m_Part.size(); }
 
@@ -112,13 +115,12 @@ protected:
 protected:
 	// --- G E O M E T R Y ---
 	std::vector<MeshDomain*>	m_Dom;	// domains
+	int		m_faceListRev;	// last face list revision of the domains
 
 	// user-defined partitions
 	std::vector<FSPart*>		m_Part;	// parts
 	std::vector<FSSurface*>	m_Surf;	// surfaces
 	std::vector<FSNodeSet*>	m_NSet;	// node sets
-
-	FSNodeElementList	m_NEL;
 };
 
 // find the element and the iso-parametric coordinates of a point inside the mesh
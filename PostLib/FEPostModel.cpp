@@ -33,7 +33,10 @@ SOFTWARE.*/
 #include "FEDataManager.h"
 #include "constants.h"
 #include "FEMeshData_T.h"
+#include "FEStatePrefetcher.h"
 #include <stdio.h>
+#include <algorithm>
+#include <omp.h>
 using namespace std;
 
 extern int ET_HEX[12][2];
@@ -65,11 +68,19 @@ void FEPostModel::PlotObject::SetColor(const GLColor& c)
 FEPostModel::FEPostModel()
 {
 	m_ndisp = 0;
+	m_dataRev = 0;
 	m_pDM = new FEDataManager(this);
 
 	m_nTime = 0;
 	m_fTime = 0.f;
 
+	m_loader = nullptr;
+	m_memBudget = 0;
+	m_stateMem = 0;
+	m_nload = 0;
+
+	m_prefetch = new FEStatePrefetcher(this);
+
 	m_pThis = this;
 }
 
@@ -77,6 +88,10 @@ FEPostModel::FEPostModel()
 // desctructor
 FEPostModel::~FEPostModel()
 {
+	// stop the prefetcher before anything is deleted
+	delete m_prefetch;
+	m_prefetch = nullptr;
+
 	Clear();
 	delete m_pDM;
 	if (m_pThis == this) m_pThis = 0;
@@ -109,7 +124,7 @@ FEPostModel* FEPostModel::GetInstance()
 //-----------------------------------------------------------------------------
 FEState* FEPostModel::CurrentState()
 {
-	return m_State[m_nTime];
+	return GetState(m_nTime);
 }
 
 //-----------------------------------------------------------------------------
@@ -131,15 +146,16 @@ void FEPostModel::SetTimeValue(float ftime)
 //
 int FEPostModel::GetClosestTime(double t)
 {
-	FEState& s0 = *GetState(0);
+	// Note that we don't call GetState here since that would load the states.
+	FEState& s0 = *m_State[0];
 	if (s0.m_time >= t) return 0;
 
-	FEState& s1 = *GetState(GetStates() - 1);
+	FEState& s1 = *m_State[GetStates() - 1];
 	if (s1.m_time <= t) return GetStates() - 1;
 
 	for (int i = 1; i<GetStates(); ++i)
 	{
-		FEState& s = *GetState(i);
+		FEState& s = *m_State[i];
 		if (s.m_time >= t) return i - 1;
 	}
 	return GetStates() - 1;
@@ -149,7 +165,8 @@ int FEPostModel::GetClosestTime(double t)
 //-----------------------------------------------------------------------------
 float FEPostModel::GetTimeValue(int ntime)
 {
-	return GetState(ntime)->m_time;
+	// the time value is always available, so there is no need to load the state
+	return m_State[ntime]->m_time;
 }
 
 //-----------------------------------------------------------------------------
@@ -186,6 +203,7 @@ FEPostMesh* FEPostModel::GetFEMesh(int n)
 // Clear the data of the model
 void FEPostModel::Clear()
 {
+	CancelPrefetch();
 	ClearObjects();
 	DeleteMeshes();
 
@@ -241,14 +259,205 @@ void FEPostModel::AddMaterial(Material& mat)
 // clear the FE-states
 void FEPostModel::ClearStates()
 {
+	CancelPrefetch();
 	for (int i=0; i<(int) m_State.size(); i++) delete m_State[i];
 	m_State.clear();
 	m_nTime = 0;
+
+	// the loader is no longer needed
+	delete m_loader;
+	m_loader = nullptr;
+	m_loadedStates.clear();
+	m_stateMem = 0;
+}
+
+//-----------------------------------------------------------------------------
+void FEPostModel::SetStateLoader(FEStateLoader* loader)
+{
+	if (m_loader == loader) return;
+	delete m_loader;
+	m_loader = loader;
+	m_loadedStates.clear();
+	m_stateMem = 0;
+}
+
+//-----------------------------------------------------------------------------
+void FEPostModel::SetStateMemoryBudget(size_t bytes)
+{
+	m_memBudget = bytes;
+	if (m_nTime < GetStates()) ReleaseStates(m_State[m_nTime]);
+}
+
+//-----------------------------------------------------------------------------
+// Load the data of a state that was not loaded yet, or that was released earlier.
+// States can be loaded while data is evaluated by multiple threads, so this is serialized.
+bool FEPostModel::LoadState(int n)
+{
+	std::lock_guard<std::mutex> lock(m_loadMutex);
+
+	FEState* ps = m_State[n];
+	if (ps->IsLoaded()) return true;
+
+	// allocate the state's data, even if we don't have a loader,
+	// so that the state can always be used.
+	ps->AllocData();
+	if (m_loader == nullptr)
+	{
+		ps->m_bloaded.store(true, std::memory_order_release);
+		return false;
+	}
+
+	// Other threads can only use the state after its data is read. If that 
+	// fails, the state stays unloaded, so we can try again later.
+	if (m_loader->LoadState(ps) == false)
+	{
+		ps->FreeData();
+		return false;
+	}
+	ps->m_nuse = ++m_nload;
+	ps->m_bloaded.store(true, std::memory_order_release);
+
+	// keep track of the memory
+	m_stateMem += StateMemory(ps);
+	m_loadedStates.push_back(ps);
+
+	// make sure we stay within budget
+	ReleaseStates(ps);
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+void FEPostModel::PrefetchStates(int nfield, int ntime, int nstates, int ninc, int nmin, int nmax, bool bloop, bool bbounce, bool bdisp)
+{
+	if (m_prefetch == nullptr) return;
+
+	// states that are loaded on demand cannot be loaded on another thread
+	std::vector<int> states;
+	int N = GetStates();
+	if ((m_loader == nullptr) && (N > 1) && (nstates > 0) && (ninc != 0) && (nfield >= 0) && (ntime >= 0) && (ntime < N))
+	{
+		if ((nmax < 0) || (nmax >= N)) nmax = N - 1;
+		if (nmin < 0) nmin = 0;
+		if (nmin > nmax) nmin = nmax;
+
+		// collect the states that follow ntime, in the same way as the animation steps through them
+		int n = ntime;
+		for (int i = 0; i < nstates; ++i)
+		{
+			n += ninc;
+			if ((n > nmax) || (n < nmin))
+			{
+				if (bloop == false) break;
+				if (bbounce) { ninc = -ninc; n = (n > nmax ? nmax : nmin); }
+				else n = (n > nmax ? nmin : nmax);
+			}
+
+			FEState* ps = m_State[n];
+			if ((n != ntime) && ps->IsLoaded() && (ps->m_nField != nfield) &&
+				(std::find(states.begin(), states.end(), n) == states.end())) states.push_back(n);
+		}
+	}
+
+	// this replaces the states that are still queued, but does not wait for the worker
+	m_prefetch->Start(states, nfield, bdisp);
+}
+
+//-----------------------------------------------------------------------------
+void FEPostModel::CancelPrefetch(int nstate)
+{
+	if (m_prefetch) m_prefetch->Cancel(nstate);
+}
+
+//-----------------------------------------------------------------------------
+// approximate memory used by a state
+size_t FEPostModel::StateMemory(FEState* ps)
+{
+	size_t mem = 0;
+	mem += ps->m_NODE.size() * sizeof(NODEDATA);
+	mem += ps->m_EDGE.size() * sizeof(EDGEDATA);
+	mem += ps->m_FACE.size() * sizeof(FACEDATA);
+	mem += ps->m_ELEM.size() * sizeof(ELEMDATA);
+	if (m_loader) mem += m_loader->StateSize(ps);
+	return mem;
+}
+
+//-----------------------------------------------------------------------------
+// Release the least recently used states until the memory is within budget. 
+// The current state, the state pkeep and pinned states are never released. 
+void FEPostModel::ReleaseStates(FEState* pkeep)
+{
+	// a few states are always kept, so that we don't keep reloading 
+	// states when the budget is smaller than a couple of states.
+	const size_t MIN_LOADED_STATES = 4;
+	if ((m_memBudget == 0) || (m_loader == nullptr)) return;
+	if (m_stateMem <= m_memBudget) return;
+
+	// The OpenMP loops don't pin the states they read, so states that were loaded
+	// during a parallel evaluation are released the next time a state is loaded.
+	// Other threads (e.g. the prefetcher) pin the states they use.
+	if (omp_in_parallel()) return;
+
+	// order the states from least to most recently used
+	m_loadedStates.sort([](FEState* a, FEState* b) { return (a->m_nuse < b->m_nuse); });
+
+	FEState* pcur = (m_nTime < GetStates() ? m_State[m_nTime] : nullptr);
+
+	std::list<FEState*>::iterator it = m_loadedStates.begin();
+	while ((m_stateMem > m_memBudget) && (m_loadedStates.size() > MIN_LOADED_STATES) && (it != m_loadedStates.end()))
+	{
+		FEState* ps = *it;
+		if ((ps == pkeep) || (ps == pcur)) { ++it; continue; }
+
+		// A thread pins a state before it checks if it is loaded, so we first mark 
+		// the state as unloaded and then check the pins. A thread that sees the
+		// state unloaded in the meantime waits for the lock in LoadState.
+		ps->m_bloaded.store(false);
+		if (ps->IsPinned())
+		{
+			ps->m_bloaded.store(true);
+			++it;
+		}
+		else
+		{
+			size_t mem = StateMemory(ps);
+			m_stateMem = (mem < m_stateMem ? m_stateMem - mem : 0);
+			ps->FreeData();
+			it = m_loadedStates.erase(it);
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Load all the states. This must be done before the data of the states 
+// is modified (e.g. when data fields are added), since the loader can only
+// restore the data that was read from file. 
+void FEPostModel::LoadAllStates()
+{
+	if (m_loader == nullptr) return;
+
+	for (int i = 0; i < GetStates(); ++i)
+	{
+		FEState* ps = m_State[i];
+		if (!ps->IsLoaded())
+		{
+			// the loader is deleted below, so the data is kept even if it can't be read
+			ps->AllocData();
+			m_loader->LoadState(ps);
+			ps->m_bloaded.store(true, std::memory_order_release);
+		}
+	}
+
+	delete m_loader;
+	m_loader = nullptr;
+	m_loadedStates.clear();
+	m_stateMem = 0;
 }
 
 //-----------------------------------------------------------------------------
 void FEPostModel::AddState(FEState* pFEState)
 {
+	CancelPrefetch();
 	pFEState->SetID((int) m_State.size());
 	pFEState->m_ref = m_RefState[m_RefState.size() - 1];
 	m_State.push_back(pFEState); 
@@ -258,6 +467,7 @@ void FEPostModel::AddState(FEState* pFEState)
 // add a state
 void FEPostModel::AddState(float ftime)
 {
+	CancelPrefetch();
 	vector<FEState*>::iterator it = m_State.begin();
 	for (it = m_State.begin(); it != m_State.end(); ++it)
 		if ((*it)->m_time > ftime)
@@ -276,10 +486,18 @@ void FEPostModel::AddState(float ftime)
 // delete a state
 void FEPostModel::DeleteState(int n)
 {
+	CancelPrefetch();
 	vector<FEState*>::iterator it = m_State.begin();
 	int N = m_State.size();
 	assert((n>=0) && (n<N));
 	for (int i=0; i<n; ++i) ++it;
+	std::list<FEState*>::iterator il = std::find(m_loadedStates.begin(), m_loadedStates.end(), *it);
+	if (il != m_loadedStates.end())
+	{
+		size_t mem = StateMemory(*it);
+		m_stateMem = (mem < m_stateMem ? m_stateMem - mem : 0);
+		m_loadedStates.erase(il);
+	}
 	m_State.erase(it);
 
 	// reindex the states
@@ -290,6 +508,7 @@ void FEPostModel::DeleteState(int n)
 // insert a state a time f
 void FEPostModel::InsertState(FEState *ps, float f)
 {
+	CancelPrefetch();
 	vector<FEState*>::iterator it = m_State.begin();
 	for (it=m_State.begin(); it != m_State.end(); ++it)
 		if ((*it)->m_time > f) 
@@ -794,6 +1013,8 @@ std::string FEPostModel::getDataString(int ndata, Data_Tensor_Type ntype)
 // Delete a data field
 void FEPostModel::DeleteDataField(ModelDataField* pd)
 {
+	CancelPrefetch();
+
 	// find out which data field this is
 	FEDataFieldPtr it = m_pDM->FirstDataField();
 	int NDF = m_pDM->DataFields(), m = -1;
@@ -807,6 +1028,9 @@ void FEPostModel::DeleteDataField(ModelDataField* pd)
 	}
 	if (m == -1) { assert(false); return; }
 
+	// states that are not loaded don't have the data field
+	LoadAllStates();
+
 	// remove this field from all states
 	int NS = GetStates();
 	for (int i=0; i<NS; ++i)
@@ -824,6 +1048,11 @@ void FEPostModel::DeleteDataField(ModelDataField* pd)
 // Add a data field to all states of the model
 void FEPostModel::AddDataField(ModelDataField* pd, const std::string& name)
 {
+	CancelPrefetch();
+
+	// the new data cannot be reloaded, so we need all the states in memory
+	LoadAllStates();
+
 	// add the data field to the data manager
 	m_pDM->AddDataField(pd, name);
 
@@ -842,8 +1071,13 @@ void FEPostModel::AddDataField(ModelDataField* pd, const std::string& name)
 // Add an data field to all states of the model
 void FEPostModel::AddDataField(ModelDataField* pd, vector<int>& L)
 {
+	CancelPrefetch();
+
 	assert(pd->DataClass() == CLASS_FACE);
 
+	// the new data cannot be reloaded, so we need all the states in memory
+	LoadAllStates();
+
 	// add the data field to the data manager
 	m_pDM->AddDataField(pd);
 
@@ -991,6 +1225,8 @@ void FEPostModel::AddDependant(FEModelDependant* pc)
 //-----------------------------------------------------------------------------
 void FEPostModel::UpdateDependants()
 {
+	DataChanged();
+
 	int N = m_Dependants.size();
 	for (int i=0; i<N; ++i) m_Dependants[i]->Update(this);
 }
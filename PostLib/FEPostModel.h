@@ -33,10 +33,14 @@ SOFTWARE.*/
 #include "GLObject.h"
 #include <FSCore/box.h>
 #include <vector>
+#include <list>
+#include <mutex>
 //using namespace std;
 
 namespace Post {
 
+class FEStatePrefetcher;
+
 //-----------------------------------------------------------------------------
 class MetaData
 {
@@ -169,8 +173,36 @@ public:
 	//! get the nr of states
 	int GetStates() { return (int) m_State.size(); }
 
-	//! retrieve pointer to a state
-	FEState* GetState(int nstate) { return m_State[nstate]; }
+	//! retrieve pointer to a state without loading it (e.g. to pin it first)
+	FEState* StatePtr(int nstate) { return m_State[nstate]; }
+
+	//! retrieve pointer to a state (this will load the state if necessary)
+	//! Use an FEStatePin to keep the state loaded while other states are accessed.
+	//! If the state cannot be loaded, it is returned unloaded (see FEState::IsLoaded).
+	FEState* GetState(int nstate)
+	{
+		FEState* ps = m_State[nstate];
+		if (!ps->IsLoaded()) LoadState(nstate);
+		else if (m_loader)
+		{
+			// mark the state as used, so that the least recently used states are released first
+			unsigned int nuse = m_nload.load(std::memory_order_relaxed);
+			if (ps->m_nuse.load(std::memory_order_relaxed) != nuse) ps->m_nuse.store(nuse, std::memory_order_relaxed);
+		}
+		return ps;
+	}
+
+	// --- O N - D E M A N D   S T A T E   L O A D I N G ---
+	//! set the loader for states that are loaded on demand (the model takes ownership)
+	void SetStateLoader(FEStateLoader* loader);
+	FEStateLoader* GetStateLoader() { return m_loader; }
+
+	//! set the max memory (in bytes) that loaded states can use (0 = no limit)
+	void SetStateMemoryBudget(size_t bytes);
+	size_t GetStateMemoryBudget() const { return m_memBudget; }
+
+	//! make sure all states are loaded (this also removes the state loader)
+	void LoadAllStates();
 
 	//! Add a new data field
 	void AddDataField(ModelDataField* pd, const std::string& name = "");
@@ -226,16 +258,42 @@ public:
 	mat3f EvaluateElemTensor(int n, int ntime, int nten, int ntype = -1);
 
 	// displacement field
-	void SetDisplacementField(int ndisp) { m_ndisp = ndisp; }
+	void SetDisplacementField(int ndisp) { CancelPrefetch(); m_ndisp = ndisp; }
 	int GetDisplacementField() { return m_ndisp; }
 	vec3f NodePosition(int n, int ntime);
 	vec3f FaceNormal(FSFace& f, int ntime);
 
 	vec3f NodePosition(const vec3f& r, int ntime);
 
+	// update the nodal positions of a state from the displacement field
+	void UpdateNodePositions(int ntime);
+	void ResetNodePositions();
+
 	// checks if the field code is valid for the given state
 	bool IsValidFieldCode(int nfield, int nstate);
 
+	// checks if the data of the field can be evaluated by multiple threads
+	bool IsThreadSafeField(int nfield, int nstate);
+
+	// --- P R E F E T C H ---
+	// Evaluate field nfield for the nstates states following ntime (in steps of ninc)
+	// on a background thread. If bdisp is true, the nodal positions are evaluated as well.
+	// Only thread-safe data is prefetched. The states are taken from the range [nmin, nmax]
+	// (nmax = -1 is the last state). At the end of the range, the states wrap around if
+	// bloop is true, and if bbounce is also true, they continue in the other direction.
+	void PrefetchStates(int nfield, int ntime, int nstates, int ninc = 1, int nmin = 0, int nmax = -1, bool bloop = true, bool bbounce = false, bool bdisp = true);
+
+	// Stop prefetching. If nstate is not -1, this only waits for the prefetcher when it is
+	// evaluating state nstate. (Use this only before state nstate is evaluated.)
+	void CancelPrefetch(int nstate = -1);
+
+	// evaluate a state on the prefetch thread
+	bool PrefetchState(int ntime, int nfield, bool bdisp);
+
+	// The data revision is incremented when data fields are added, removed or changed.
+	unsigned int DataRevision() const { return m_dataRev; }
+	void DataChanged() { m_dataRev++; }
+
 public:
 	void AddDependant(FEModelDependant* pc);
 	void UpdateDependants();
@@ -277,6 +335,13 @@ protected:
 	void EvalNodeField(int ntime, int nfield);
 	void EvalFaceField(int ntime, int nfield);
 	void EvalElemField(int ntime, int nfield);
+	void EvalStateField(int ntime, int nfield, bool breset);
+	void EvalNodePositions(int ntime);
+
+	// load the data of a state, and release other states if the memory budget is exceeded
+	bool LoadState(int nstate);
+	void ReleaseStates(FEState* pkeep);
+	size_t StateMemory(FEState* ps);
 	
 protected:
 	string	m_name;		// name (as displayed in model viewer)
@@ -304,6 +369,17 @@ protected:
 	std::vector<FEState*>	m_State;	// array of pointers to FE-state structures
 	FEDataManager*		m_pDM;		// the Data Manager
 	int					m_ndisp;	// vector field defining the displacement
+	unsigned int		m_dataRev;	// incremented when the model data changes
+
+	// on-demand loading of states
+	FEStateLoader*		m_loader;		// loads the state data (can be null)
+	size_t				m_memBudget;	// max memory for loaded states (0 = no limit)
+	size_t				m_stateMem;		// memory used by states loaded on demand
+	std::list<FEState*>	m_loadedStates;	// states loaded on demand
+	std::atomic<unsigned int>	m_nload;	// incremented each time a state is loaded
+	std::mutex			m_loadMutex;	// serializes the loading of states
+
+	FEStatePrefetcher*	m_prefetch;		// evaluates states in the background
 
 	// dependants
 	std::vector<FEModelDependant*>	m_Dependants;
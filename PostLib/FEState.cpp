@@ -87,51 +87,11 @@ FERefState::FERefState(FEPostModel* fem)
 
 //-----------------------------------------------------------------------------
 // Constructor
-FEState::FEState(float time, FEPostModel* fem, Post::FEPostMesh* pmesh) : m_fem(fem), m_mesh(pmesh)
+FEState::FEState(float time, FEPostModel* fem, Post::FEPostMesh* pmesh, bool ballocate) : m_fem(fem), m_mesh(pmesh)
 {
 	m_id = -1;
 	m_ref = nullptr; // will be set by model
 
-	Post::FEPostMesh& mesh = *m_mesh;
-
-	int nodes = mesh.Nodes();
-	int edges = mesh.Edges();
-	int elems = mesh.Elements();
-	int faces = mesh.Faces();
-
-	// allocate storage
-	m_NODE.resize(nodes);
-	m_EDGE.resize(edges);
-	m_ELEM.resize(elems);
-	m_FACE.resize(faces);
-
-	// allocate element data
-	for (int i=0; i<elems; ++i)
-	{
-		FEElement_& el = mesh.ElementRef(i);
-		int ne = el.Nodes();
-		m_ElemData.append(ne);
-	}
-
-	// allocate face data
-	for (int i=0; i<faces; ++i)
-	{
-		FSFace& face = mesh.Face(i);
-		int nf = face.Nodes();
-		m_FaceData.append(nf);
-	}
-
-	// initialize data
-	for (int i=0; i<nodes; ++i) m_NODE[i].m_rt = to_vec3f(mesh.Node(i).r);
-	for (int i=0; i<elems; ++i)
-	{
-		m_ELEM[i].m_state = StatusFlags::VISIBLE;
-		m_ELEM[i].m_h[0] = 0.f;
-		m_ELEM[i].m_h[1] = 0.f;
-		m_ELEM[i].m_h[2] = 0.f;
-		m_ELEM[i].m_h[3] = 0.f;
-	}
-
 	int ptObjs = fem->PointObjects();
 	m_objPt.resize(ptObjs);
 	for (int i = 0; i < ptObjs; ++i)
@@ -191,12 +151,31 @@ FEState::FEState(float time, FEPostModel* fem, Post::FEPostMesh* pmesh) : m_fem(
 
 	m_time = time;
 	m_nField = -1;
+	m_nDispField = -1;
 	m_status = 0;
+	m_bloaded = false;
+	m_npin = 0;
+	m_nuse = 0;
+
+	// allocate the mesh data
+	if (ballocate)
+	{
+		AllocData();
+		m_bloaded = true;
+	}
+}
+
+//-----------------------------------------------------------------------------
+void FEState::AllocData()
+{
+	// allocate the node, edge, face and element data
+	RebuildData();
 
 	// get the data manager
-	FEDataManager* pdm = fem->GetDataManager();
+	FEDataManager* pdm = m_fem->GetDataManager();
 
 	// Nodal data
+	m_Data.clear();
 	int N = pdm->DataFields();
 	FEDataFieldPtr it = pdm->FirstDataField();
 	for (int i=0; i<N; ++i, ++it)
@@ -204,6 +183,29 @@ FEState::FEState(float time, FEPostModel* fem, Post::FEPostMesh* pmesh) : m_fem(
 		ModelDataField& d = *(*it);
 		m_Data.push_back(d.CreateData(this));
 	}
+
+	m_nField = -1;
+	m_nDispField = -1;
+}
+
+//-----------------------------------------------------------------------------
+// This releases all the memory that is allocated by AllocData. The object data
+// is small and is not released.
+void FEState::FreeData()
+{
+	m_Data.clear();
+
+	m_NODE.clear(); m_NODE.shrink_to_fit();
+	m_EDGE.clear(); m_EDGE.shrink_to_fit();
+	m_FACE.clear(); m_FACE.shrink_to_fit();
+	m_ELEM.clear(); m_ELEM.shrink_to_fit();
+
+	m_ElemData = ValArray();
+	m_FaceData = ValArray();
+
+	m_nField = -1;
+	m_nDispField = -1;
+	m_bloaded = false;
 }
 
 //-----------------------------------------------------------------------------
@@ -241,7 +243,11 @@ FEState::FEState(float time, FEPostModel* pfem, FEState* pstate) : m_fem(pfem)
 	m_id = -1;
 	m_time = time;
 	m_nField = -1;
+	m_nDispField = -1;
 	m_status = 0;
+	m_bloaded = true;
+	m_npin = 0;
+	m_nuse = 0;
 	m_mesh = pstate->m_mesh;
 
 	RebuildData();
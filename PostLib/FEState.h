@@ -28,6 +28,7 @@ SOFTWARE.*/
 #include "FEMeshData.h"
 #include <MeshLib/FEElement.h>
 #include <vector>
+#include <atomic>
 #include "ValArray.h"
 #include <FSCore/math3d.h>
 
@@ -136,7 +137,9 @@ public:
 class FEState
 {
 public:
-	FEState(float time, FEPostModel* fem, FEPostMesh* mesh);
+	// If ballocate is false, the state's data is not allocated and the state 
+	// must be loaded before it can be used (see FEPostModel::GetState).
+	FEState(float time, FEPostModel* fem, FEPostMesh* mesh, bool ballocate = true);
 	FEState(float time, FEPostModel* fem, FEState* state);
 
 	void SetID(int n);
@@ -152,12 +155,30 @@ public:
 
 	void RebuildData();
 
+public:
+	// returns true if the state's data is allocated and read
+	bool IsLoaded() const { return m_bloaded.load(); }
+
+	// allocate the state's data. This does not mark the state as loaded, since
+	// the data still needs to be read.
+	void AllocData();
+
+	// release the state's data
+	void FreeData();
+
+	// pinned states are not released by the model (see FEStatePin)
+	bool IsPinned() const { return (m_npin.load() > 0); }
+
 public:
 	float	m_time;		// time value
 	int		m_nField;	// the field whos values are contained in m_pval
+	int		m_nDispField;	// the displacement field used for the nodal positions (m_rt)
 	int		m_id;		// index in state array of FEPostModel
 	bool	m_bsmooth;
 	int		m_status;	// status flag
+	std::atomic<bool>	m_bloaded;	// is the state's data allocated?
+	std::atomic<int>	m_npin;		// nr of pins that keep the state loaded
+	std::atomic<unsigned int>	m_nuse;	// value of the model's load counter when the state was last used
 
 	std::vector<NODEDATA>	m_NODE;		// nodal data
 	std::vector<EDGEDATA>	m_EDGE;		// edge data
@@ -178,4 +199,39 @@ public:
 	FERefState*		m_ref;	//!< the reference state for this state
 	FEPostMesh*		m_mesh;	//!< The mesh this state uses
 };
+
+//-----------------------------------------------------------------------------
+// Keeps a state loaded while it is in scope. Use this when a reference to a
+// state's data is held while other states are accessed (and may be loaded).
+// Pin the state before it is retrieved with FEPostModel::GetState, so that it
+// cannot be released in between.
+class FEStatePin
+{
+public:
+	FEStatePin(FEState* ps) : m_ps(ps) { if (m_ps) m_ps->m_npin++; }
+	~FEStatePin() { if (m_ps) m_ps->m_npin--; }
+
+private:
+	FEStatePin(const FEStatePin&) = delete;
+	void operator = (const FEStatePin&) = delete;
+
+private:
+	FEState*	m_ps;
+};
+
+//-----------------------------------------------------------------------------
+// Interface for classes that can (re)load the data of a state on demand. 
+// This is used by the model to load states that were not loaded up front, or
+// that were released to keep the memory usage below the budget.
+class FEStateLoader
+{
+public:
+	virtual ~FEStateLoader() {}
+
+	// Load the data of the state. The state's data has been allocated.
+	virtual bool LoadState(FEState* ps) = 0;
+
+	// return the (approximate) size in bytes of the data that LoadState reads
+	virtual size_t StateSize(FEState* ps) { return 0; }
+};
 }
@@ -0,0 +1,116 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+#include "stdafx.h"
+#include "FEStatePrefetcher.h"
+#include "FEPostModel.h"
+#include <algorithm>
+#include <omp.h>
+using namespace Post;
+
+//-----------------------------------------------------------------------------
+FEStatePrefetcher::FEStatePrefetcher(FEPostModel* fem) : m_fem(fem)
+{
+	m_nfield = -1;
+	m_bdisp = false;
+	m_nstate = -1;
+	m_quit = false;
+	m_abort = false;
+}
+
+//-----------------------------------------------------------------------------
+FEStatePrefetcher::~FEStatePrefetcher()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_queue.clear();
+		m_quit = true;
+		m_abort = true;
+	}
+	m_cv.notify_all();
+	if (m_thread.joinable()) m_thread.join();
+}
+
+//-----------------------------------------------------------------------------
+void FEStatePrefetcher::Start(const std::vector<int>& states, int nfield, bool bdisp)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_nfield = nfield;
+		m_bdisp = bdisp;
+
+		// the worker takes states from the back of the queue
+		m_queue.assign(states.rbegin(), states.rend());
+	}
+	if (states.empty()) return;
+
+	// the thread is only created when it is needed
+	if (!m_thread.joinable()) m_thread = std::thread(&FEStatePrefetcher::Run, this);
+	m_cv.notify_all();
+}
+
+//-----------------------------------------------------------------------------
+void FEStatePrefetcher::Cancel(int nstate)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_queue.clear();
+	if ((m_nstate == -1) || ((nstate != -1) && (m_nstate != nstate))) return;
+
+	// ask the worker to stop early (the state's data is then evaluated again when needed)
+	m_abort = true;
+	m_cv.wait(lock, [this]() { return (m_nstate == -1); });
+	m_abort = false;
+}
+
+//-----------------------------------------------------------------------------
+void FEStatePrefetcher::Run()
+{
+	// The worker's parallel loops run next to the ones of the main thread,
+	// so it only uses a few threads.
+	omp_set_num_threads(std::max(1, omp_get_max_threads() / 4));
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true)
+	{
+		m_cv.wait(lock, [this]() { return m_quit || !m_queue.empty(); });
+		if (m_quit) break;
+
+		int nstate = m_queue.back();
+		m_queue.pop_back();
+		int nfield = m_nfield;
+		bool bdisp = m_bdisp;
+		m_nstate = nstate;
+
+		// The model is not modified while we're busy, since it cancels us first. 
+		// Other states can still be evaluated on the main thread.
+		lock.unlock();
+		m_fem->PrefetchState(nstate, nfield, bdisp);
+		lock.lock();
+
+		m_nstate = -1;
+		m_cv.notify_all();
+	}
+}
@@ -0,0 +1,77 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+namespace Post {
+
+class FEPostModel;
+
+//-----------------------------------------------------------------------------
+// Evaluates a data field for a list of states on a background thread, so that
+// the states are ready by the time they are needed (e.g. during animation playback).
+// The model cancels the prefetcher before it modifies its states.
+class FEStatePrefetcher
+{
+public:
+	FEStatePrefetcher(FEPostModel* fem);
+	~FEStatePrefetcher();
+
+	// start evaluating field nfield (and the nodal positions if bdisp is true) for
+	// the given states. This replaces any states that were not evaluated yet.
+	// This does not wait for the state that is being evaluated.
+	void Start(const std::vector<int>& states, int nfield, bool bdisp);
+
+	// Remove the remaining states and wait until the worker is idle. If nstate is not -1,
+	// this only waits when the worker is evaluating state nstate.
+	void Cancel(int nstate = -1);
+
+	// returns true when the worker should stop evaluating the current state
+	bool IsAborted() const { return m_abort; }
+
+private:
+	void Run();
+
+private:
+	FEPostModel*	m_fem;
+	std::thread		m_thread;
+	std::mutex		m_mutex;
+	std::condition_variable	m_cv;
+
+	std::vector<int>	m_queue;	// states that still need to be evaluated (in reverse order)
+	int		m_nfield;	// field that is evaluated
+	bool	m_bdisp;	// evaluate the nodal positions?
+	int		m_nstate;	// the state that is being evaluated (-1 if the worker is idle)
+	bool	m_quit;		// is the worker asked to stop?
+	std::atomic<bool>	m_abort;	// is the worker asked to stop evaluating the current state?
+};
+
+}
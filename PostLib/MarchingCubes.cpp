@@ -58,26 +58,58 @@ TriMesh::TriMesh()
 
 void TriMesh::Clear()
 {
+	m_Node.clear();
+	m_Norm.clear();
 	m_Face.clear();
 }
 
-void TriMesh::Reserve(size_t nsize)
+void TriMesh::Reserve(size_t nodes, size_t faces)
 {
-	m_Face.reserve(nsize);
+	m_Node.reserve(nodes);
+	m_Norm.reserve(nodes);
+	m_Face.reserve(3 * faces);
 }
 
-void TriMesh::Resize(size_t nsize)
+void TriMesh::Resize(size_t nodes, size_t faces)
 {
-	m_Face.resize(nsize);
+	m_Node.resize(nodes);
+	m_Norm.resize(nodes);
+	m_Face.resize(3 * faces);
 }
 
-void TriMesh::Merge(TriMesh& tri, int ncount)
+void TriMesh::Render(bool smooth)
 {
-	if (ncount < 0) ncount = tri.Faces();
-	int N = (int)m_Face.size();
-	m_Face.resize(m_Face.size() + ncount);
-	for (size_t i = 0; i < ncount; ++i)
-		m_Face[N + i] = tri.m_Face[i];
+	if (m_Face.empty()) return;
+
+	if (smooth)
+	{
+		glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+		glEnableClientState(GL_VERTEX_ARRAY);
+		glEnableClientState(GL_NORMAL_ARRAY);
+		glVertexPointer(3, GL_FLOAT, sizeof(vec3f), &m_Node[0]);
+		glNormalPointer(GL_FLOAT, sizeof(vec3f), &m_Norm[0]);
+		glDrawElements(GL_TRIANGLES, (GLsizei)m_Face.size(), GL_UNSIGNED_INT, &m_Face[0]);
+		glPopClientAttrib();
+	}
+	else
+	{
+		// shared vertices can't carry the face normals, so calculate them here
+		glBegin(GL_TRIANGLES);
+		for (int i = 0; i < Faces(); ++i)
+		{
+			const int* f = Face(i);
+			const vec3f& r0 = m_Node[f[0]];
+			const vec3f& r1 = m_Node[f[1]];
+			const vec3f& r2 = m_Node[f[2]];
+			vec3f n = (r1 - r0) ^ (r2 - r0);
+			n.Normalize();
+			glNormal3f(n.x, n.y, n.z);
+			glVertex3f(r0.x, r0.y, r0.z);
+			glVertex3f(r1.x, r1.y, r1.z);
+			glVertex3f(r2.x, r2.y, r2.z);
+		}
+		glEnd();
+	}
 }
 
 CMarchingCubes::CMarchingCubes(CImageModel* img) : CGLImageRenderer(img)
@@ -167,11 +199,32 @@ void CMarchingCubes::Create()
 	CreateSurface();
 }
 
+//-----------------------------------------------------------------------------
+// The iso-surface vertices lie on the edges of the voxel grid. Each z-layer of voxels
+// is processed independently and shares its vertices through a cache that is keyed
+// on the grid edge. Vertices on the planes between layers are matched when the layers
+// are merged, so the final mesh has no duplicate vertices.
+namespace {
+
+	// output of one layer of voxels
+	struct MC_LAYER
+	{
+		TriMesh				mesh;
+		std::vector<int>	bot;	// (key, vertex) pairs of vertices on the bottom plane
+		std::vector<int>	top;	// (key, vertex) pairs of vertices on the top plane
+		std::vector<int>	remap;	// global index of each vertex
+	};
+
+	// grid edge of a hex edge (corner offset and direction)
+	struct MC_EDGE { int di, dj, dk, dir; };
+}
+
 void CMarchingCubes::CreateSurface()
 {
 	m_oldVal = m_val;
 
 	m_mesh.Clear();
+	m_caps.Clear();
 
 	CImageModel& im = *GetImageModel();
 	if (im.Get3DImage() == nullptr) return;
@@ -194,18 +247,35 @@ void CMarchingCubes::CreateSurface()
 
 	C3DGradientMap grad(im3d, b);
 
+	// figure out which grid edge each hex edge lies on
+	const int HC[8][3] = { {0,0,0},{1,0,0},{1,1,0},{0,1,0},{0,0,1},{1,0,1},{1,1,1},{0,1,1} };
+	MC_EDGE edge[12];
+	for (int i = 0; i < 12; ++i)
+	{
+		const int* a = HC[ET_HEX[i][0]];
+		const int* c = HC[ET_HEX[i][1]];
+		edge[i].di = (a[0] < c[0] ? a[0] : c[0]);
+		edge[i].dj = (a[1] < c[1] ? a[1] : c[1]);
+		edge[i].dk = (a[2] < c[2] ? a[2] : c[2]);
+		edge[i].dir = (a[0] != c[0] ? 0 : (a[1] != c[1] ? 1 : 2));
+	}
+
+	// The cache has five planes of NX*NY entries: x- and y-edges on the bottom plane,
+	// x- and y-edges on the top plane, and the z-edges.
+	const int NXY = NX * NY;
+	std::vector<MC_LAYER> layer(NZ - 1);
+
 	#pragma omp parallel default(shared)
 	{
-		const int MAX_FACES = 1000000;
-		TriMesh temp;
-		temp.Resize(MAX_FACES);
-		int nfaces = 0;
+		std::vector<int> cache(5 * NXY, -1);
+		std::vector<int> used;
 		Byte val[8];
 		vec3f r[8], g[8];
 
 		#pragma omp for schedule(dynamic, 5)
 		for (int k = 0; k < NZ - 1; ++k)
 		{
+			TriMesh& mesh = layer[k].mesh;
 			for (int j = 0; j < NY - 1; ++j)
 			{
 				for (int i = 0; i < NX - 1; ++i)
@@ -281,43 +351,41 @@ void CMarchingCubes::CreateSurface()
 						{
 							if (*pf == -1) break;
 
-							// calculate nodal positions
-							TriMesh::TRI& tri = temp.Face(nfaces++);
+							int nf[3];
 							for (int m = 0; m < 3; m++)
 							{
-								int n1 = ET_HEX[pf[m]][0];
-								int n2 = ET_HEX[pf[m]][1];
-
-								float w = (fref - (float)val[n1]) / ((float)val[n2] - (float)val[n1]);
-								assert((w >= 0.f) && (w <= 1.f));
-
-								tri.m_node[m] = r[n1] * (1.f - w) + r[n2] * w;
-
-								if (m_bsmooth)
+								// see if this edge already has a vertex
+								const MC_EDGE& e = edge[pf[m]];
+								int plane = (e.dir == 2 ? 4 : 2 * e.dk + e.dir);
+								int key = plane * NXY + (i + e.di) + NX * (j + e.dj);
+								int nv = cache[key];
+								if (nv < 0)
 								{
-									vec3f normal = g[n1] * (1.f - w) + g[n2] * w;
-									normal.Normalize();
-									tri.m_norm[m] = (m_binvertSpace ? -normal : normal);
+									// calculate nodal position
+									int n1 = ET_HEX[pf[m]][0];
+									int n2 = ET_HEX[pf[m]][1];
+
+									float w = (fref - (float)val[n1]) / ((float)val[n2] - (float)val[n1]);
+									assert((w >= 0.f) && (w <= 1.f));
+
+									vec3f x = r[n1] * (1.f - w) + r[n2] * w;
+									vec3f normal(0.f, 0.f, 0.f);
+									if (m_bsmooth)
+									{
+										normal = g[n1] * (1.f - w) + g[n2] * w;
+										normal.Normalize();
+										if (m_binvertSpace) normal = -normal;
+									}
+
+									nv = mesh.AddNode(x, normal);
+									cache[key] = nv;
+									used.push_back(key);
 								}
+								nf[m] = nv;
 							}
-
-							if (m_bsmooth == false)
-							{
-								vec3f normal = (tri.m_node[1] - tri.m_node[0]) ^ (tri.m_node[2] - tri.m_node[0]);
-								normal.Normalize();
-								tri.m_norm[0] = normal;
-								tri.m_norm[1] = normal;
-								tri.m_norm[2] = normal;
-							}
+							mesh.AddFace(nf[0], nf[1], nf[2]);
 
 							pf += 3;
-
-							if (nfaces == MAX_FACES)
-							{
-								#pragma omp critical
-								m_mesh.Merge(temp, nfaces);
-								nfaces = 0;
-							}
 						}
 					}
 
@@ -328,102 +396,178 @@ void CMarchingCubes::CreateSurface()
 					val[7] = val[6];
 				}
 			}
-		}
 
-		#pragma omp critical
-		m_mesh.Merge(temp, nfaces);
+			// store the vertices on the planes between layers and reset the cache
+			for (int key : used)
+			{
+				int plane = key / NXY;
+				if (plane < 2) { layer[k].bot.push_back(key); layer[k].bot.push_back(cache[key]); }
+				else if (plane < 4) { layer[k].top.push_back(key - 2 * NXY); layer[k].top.push_back(cache[key]); }
+				cache[key] = -1;
+			}
+			used.clear();
+		}
 	}
 
-	// create surface meshes
-	if (m_bcloseSurface)
+	// match the vertices between layers and assign the global vertex numbers
+	std::vector<int> plane(2 * NXY, -1);
+	std::vector<int> node0(NZ, 0), face0(NZ, 0);
+	int nodes = 0, faces = 0;
+	for (int k = 0; k < NZ - 1; ++k)
 	{
-		Byte val[4];
-		vec3f r[4];
-
-		// X-planes
-		for (int i = 0; i <= NX - 1; i += NX - 1)
+		MC_LAYER& lk = layer[k];
+		lk.remap.assign(lk.mesh.Nodes(), -1);
+		for (size_t i = 0; i < lk.bot.size(); i += 2) lk.remap[lk.bot[i + 1]] = plane[lk.bot[i]];
+		if (k > 0)
 		{
-			vec3f faceNormal(1.f, 0.f, 0.f);
+			std::vector<int>& top = layer[k - 1].top;
+			for (size_t i = 0; i < top.size(); i += 2) plane[top[i]] = -1;
+		}
+
+		node0[k] = nodes;
+		for (int i = 0; i < lk.mesh.Nodes(); ++i)
+			if (lk.remap[i] < 0) lk.remap[i] = nodes++;
 
-			float x = (i == 0 ? b.x0 : b.x1);
+		for (size_t i = 0; i < lk.top.size(); i += 2) plane[lk.top[i]] = lk.remap[lk.top[i + 1]];
 
-			for (int k = 0; k < NZ - 1; k++)
+		face0[k] = faces;
+		faces += lk.mesh.Faces();
+	}
+
+	// copy the layers to the final mesh
+	m_mesh.Resize(nodes, faces);
+	#pragma omp parallel for schedule(dynamic)
+	for (int k = 0; k < NZ - 1; ++k)
+	{
+		MC_LAYER& lk = layer[k];
+		for (int i = 0; i < lk.mesh.Nodes(); ++i)
+		{
+			int n = lk.remap[i];
+			if (n >= node0[k])
 			{
-				for (int j = 0; j < NY - 1; ++j)
-				{
-					// get the pixel's values
-					val[0] = im3d.value(i, j, k);
-					val[1] = im3d.value(i, j + 1, k);
-					val[2] = im3d.value(i, j + 1, k + 1);
-					val[3] = im3d.value(i, j, k + 1);
-
-					// get the corners
-					r[0].x = x; r[0].y = b.y0 + j      *dyi; r[0].z = b.z0 + k*dzi;
-					r[1].x = x; r[1].y = b.y0 + (j + 1)*dyi; r[1].z = b.z0 + k*dzi;
-					r[2].x = x; r[2].y = b.y0 + (j + 1)*dyi; r[2].z = b.z0 + (k + 1)*dzi;
-					r[3].x = x; r[3].y = b.y0 + j      *dyi; r[3].z = b.z0 + (k + 1)*dzi;
-
-					// add the triangles
-					AddSurfaceTris(val, r, faceNormal);
-				}
+				m_mesh.Node(n) = lk.mesh.Node(i);
+				m_mesh.Normal(n) = lk.mesh.Normal(i);
 			}
 		}
 
-		// Y-planes
-		for (int j = 0; j <= NY - 1; j += NY - 1)
+		for (int i = 0; i < lk.mesh.Faces(); ++i)
 		{
-			vec3f faceNormal(0.f, -1.f, 0.f);
+			const int* fs = lk.mesh.Face(i);
+			int* fd = m_mesh.Face(face0[k] + i);
+			fd[0] = lk.remap[fs[0]];
+			fd[1] = lk.remap[fs[1]];
+			fd[2] = lk.remap[fs[2]];
+		}
 
-			float y = (j == 0 ? b.y0 : b.y1);
+		// release memory as we go
+		lk.mesh.Clear();
+	}
 
-			for (int k = 0; k < NZ - 1; k++)
+	// create surface meshes
+	if (m_bcloseSurface) CreateCaps();
+}
+
+void CMarchingCubes::CreateCaps()
+{
+	CImageModel& im = *GetImageModel();
+	C3DImage& im3d = *im.Get3DImage();
+
+	BOX b = im.GetBoundingBox();
+
+	int NX = im3d.Width();
+	int NY = im3d.Height();
+	int NZ = im3d.Depth();
+
+	float dxi = (b.x1 - b.x0) / (NX - 1);
+	float dyi = (b.y1 - b.y0) / (NY - 1);
+	float dzi = (b.z1 - b.z0) / (NZ - 1);
+
+	Byte val[4];
+	vec3f r[4];
+
+	// X-planes
+	for (int i = 0; i <= NX - 1; i += NX - 1)
+	{
+		vec3f faceNormal(1.f, 0.f, 0.f);
+
+		float x = (i == 0 ? b.x0 : b.x1);
+
+		for (int k = 0; k < NZ - 1; k++)
+		{
+			for (int j = 0; j < NY - 1; ++j)
 			{
-				for (int i = 0; i < NX - 1; ++i)
-				{
-					// get the pixel's values
-					val[0] = im3d.value(i  , j, k);
-					val[1] = im3d.value(i+1, j, k);
-					val[2] = im3d.value(i+1, j, k + 1);
-					val[3] = im3d.value(i  , j, k + 1);
-
-					// get the corners
-					r[0].x = b.x0 + i    *dxi; r[0].y = y; r[0].z = b.z0 + k*dzi;
-					r[1].x = b.x0 + (i+1)*dxi; r[1].y = y; r[1].z = b.z0 + k*dzi;
-					r[2].x = b.x0 + (i+1)*dxi; r[2].y = y; r[2].z = b.z0 + (k + 1)*dzi;
-					r[3].x = b.x0 + i    *dxi; r[3].y = y; r[3].z = b.z0 + (k + 1)*dzi;
-
-					// add the triangles
-					AddSurfaceTris(val, r, faceNormal);
-				}
+				// get the pixel's values
+				val[0] = im3d.value(i, j, k);
+				val[1] = im3d.value(i, j + 1, k);
+				val[2] = im3d.value(i, j + 1, k + 1);
+				val[3] = im3d.value(i, j, k + 1);
+
+				// get the corners
+				r[0].x = x; r[0].y = b.y0 + j      *dyi; r[0].z = b.z0 + k*dzi;
+				r[1].x = x; r[1].y = b.y0 + (j + 1)*dyi; r[1].z = b.z0 + k*dzi;
+				r[2].x = x; r[2].y = b.y0 + (j + 1)*dyi; r[2].z = b.z0 + (k + 1)*dzi;
+				r[3].x = x; r[3].y = b.y0 + j      *dyi; r[3].z = b.z0 + (k + 1)*dzi;
+
+				// add the triangles
+				AddSurfaceTris(val, r, faceNormal);
 			}
 		}
+	}
 
-		// Z-planes
-		for (int k = 0; k <= NZ - 1; k += NZ - 1)
-		{
-			vec3f faceNormal(0.f, 0.f, 1.f);
+	// Y-planes
+	for (int j = 0; j <= NY - 1; j += NY - 1)
+	{
+		vec3f faceNormal(0.f, -1.f, 0.f);
 
-			float z = (k == 0 ? b.z0 : b.z1);
+		float y = (j == 0 ? b.y0 : b.y1);
 
-			for (int j = 0; j < NY - 1; ++j)
+		for (int k = 0; k < NZ - 1; k++)
+		{
+			for (int i = 0; i < NX - 1; ++i)
 			{
-				for (int i = 0; i < NX - 1; ++i)
-				{
-					// get the pixel's values
-					val[0] = im3d.value(i    , j    , k);
-					val[1] = im3d.value(i + 1, j    , k);
-					val[2] = im3d.value(i + 1, j + 1, k);
-					val[3] = im3d.value(i    , j + 1, k);
+				// get the pixel's values
+				val[0] = im3d.value(i  , j, k);
+				val[1] = im3d.value(i+1, j, k);
+				val[2] = im3d.value(i+1, j, k + 1);
+				val[3] = im3d.value(i  , j, k + 1);
+
+				// get the corners
+				r[0].x = b.x0 + i    *dxi; r[0].y = y; r[0].z = b.z0 + k*dzi;
+				r[1].x = b.x0 + (i+1)*dxi; r[1].y = y; r[1].z = b.z0 + k*dzi;
+				r[2].x = b.x0 + (i+1)*dxi; r[2].y = y; r[2].z = b.z0 + (k + 1)*dzi;
+				r[3].x = b.x0 + i    *dxi; r[3].y = y; r[3].z = b.z0 + (k + 1)*dzi;
+
+				// add the triangles
+				AddSurfaceTris(val, r, faceNormal);
+			}
+		}
+	}
 
-					// get the corners
-					r[0].x = b.x0 + i      *dxi; r[0].y = b.y0 + j      *dyi; r[0].z = z;
-					r[1].x = b.x0 + (i + 1)*dxi; r[1].y = b.y0 + j      *dyi; r[1].z = z;
-					r[2].x = b.x0 + (i + 1)*dxi; r[2].y = b.y0 + (j + 1)*dyi; r[2].z = z;
-					r[3].x = b.x0 + i      *dxi; r[3].y = b.y0 + (j + 1)*dyi; r[3].z = z;
+	// Z-planes
+	for (int k = 0; k <= NZ - 1; k += NZ - 1)
+	{
+		vec3f faceNormal(0.f, 0.f, 1.f);
 
-					// add the triangles
-					AddSurfaceTris(val, r, faceNormal);
-				}
+		float z = (k == 0 ? b.z0 : b.z1);
+
+		for (int j = 0; j < NY - 1; ++j)
+		{
+			for (int i = 0; i < NX - 1; ++i)
+			{
+				// get the pixel's values
+				val[0] = im3d.value(i    , j    , k);
+				val[1] = im3d.value(i + 1, j    , k);
+				val[2] = im3d.value(i + 1, j + 1, k);
+				val[3] = im3d.value(i    , j + 1, k);
+
+				// get the corners
+				r[0].x = b.x0 + i      *dxi; r[0].y = b.y0 + j      *dyi; r[0].z = z;
+				r[1].x = b.x0 + (i + 1)*dxi; r[1].y = b.y0 + j      *dyi; r[1].z = z;
+				r[2].x = b.x0 + (i + 1)*dxi; r[2].y = b.y0 + (j + 1)*dyi; r[2].z = z;
+				r[3].x = b.x0 + i      *dxi; r[3].y = b.y0 + (j + 1)*dyi; r[3].z = z;
+
+				// add the triangles
+				AddSurfaceTris(val, r, faceNormal);
 			}
 		}
 	}
@@ -457,13 +601,14 @@ void CMarchingCubes::AddSurfaceTris(Byte val[4], vec3f r[4], const vec3f& faceNo
 		if (*pf == -1) break;
 
 		// calculate nodal positions
-		TriMesh::TRI tri;
+		int nf[3];
 		for (int m = 0; m < 3; m++)
 		{
 			int node = pf[m];
+			vec3f x;
 			if (node < 4)
 			{
-				tri.m_node[m] = r[node];
+				x = r[node];
 			}
 			else
 			{
@@ -471,13 +616,13 @@ void CMarchingCubes::AddSurfaceTris(Byte val[4], vec3f r[4], const vec3f& faceNo
 				int n2 = ET2D[node - 4][1];
 
 				float w = (fref - (float)val[n1]) / ((float)val[n2] - (float)val[n1]);
-				tri.m_node[m] = r[n1] * (1.f - w) + r[n2] * w;
+				x = r[n1] * (1.f - w) + r[n2] * w;
 			}
 
-			tri.m_norm[m] = faceNormal;
+			nf[m] = m_caps.AddNode(x, faceNormal);
 		}
 
-		m_mesh.AddFace(tri);
+		m_caps.AddFace(nf[0], nf[1], nf[2]);
 
 		pf += 3;
 	}
@@ -491,16 +636,6 @@ void CMarchingCubes::SetIsoValue(float v)
 void CMarchingCubes::Render(CGLContext& rc)
 {
 	glColor3ub(m_col.r, m_col.g, m_col.b);
-	glBegin(GL_TRIANGLES);
-	for (int i = 0; i < m_mesh.Faces(); ++i)
-	{
-		TriMesh::TRI& face = m_mesh.Face(i);
-		glNormal3f(face.m_norm[0].x, face.m_norm[0].y, face.m_norm[0].z);
-		glVertex3f(face.m_node[0].x, face.m_node[0].y, face.m_node[0].z);
-		glNormal3f(face.m_norm[1].x, face.m_norm[1].y, face.m_norm[1].z);
-		glVertex3f(face.m_node[1].x, face.m_node[1].y, face.m_node[1].z);
-		glNormal3f(face.m_norm[2].x, face.m_norm[2].y, face.m_norm[2].z);
-		glVertex3f(face.m_node[2].x, face.m_node[2].y, face.m_node[2].z);
-	}
-	glEnd();
+	m_mesh.Render(m_bsmooth);
+	m_caps.Render(true);
 }
@@ -34,33 +34,38 @@ namespace Post {
 
 class CImageModel;
 
+// Indexed triangle mesh. Vertices can be shared between triangles.
 class TriMesh
 {
-public:
-	struct TRI
-	{
-		vec3f	m_node[3];
-		vec3f	m_norm[3];
-	};
-
 public:
 	TriMesh();
 
 	void Clear();
 
-	void Merge(TriMesh& tri, int ncount = -1);
+	void Reserve(size_t nodes, size_t faces);
+
+	void Resize(size_t nodes, size_t faces);
 
-	void Reserve(size_t nsize);
+	int Nodes() const { return (int)m_Node.size(); }
+	int Faces() const { return (int)m_Face.size() / 3; }
 
-	void Resize(size_t nsize);
+	vec3f& Node(int i) { return m_Node[i]; }
+	vec3f& Normal(int i) { return m_Norm[i]; }
 
-	TRI& Face(int i) { return m_Face[i]; }
-	int Faces() const { return (int)m_Face.size(); }
+	int* Face(int i) { return &m_Face[3 * i]; }
+	const int* Face(int i) const { return &m_Face[3 * i]; }
 
-	void AddFace(TRI& tri) { m_Face.push_back(tri); }
+	int AddNode(const vec3f& r, const vec3f& n) { m_Node.push_back(r); m_Norm.push_back(n); return (int)m_Node.size() - 1; }
+
+	void AddFace(int n0, int n1, int n2) { m_Face.push_back(n0); m_Face.push_back(n1); m_Face.push_back(n2); }
+
+	// render the mesh using vertex arrays. If smooth is false, face normals are used.
+	void Render(bool smooth);
 
 protected:
-	std::vector<TRI>	m_Face;
+	std::vector<vec3f>	m_Node;		// vertex positions
+	std::vector<vec3f>	m_Norm;		// vertex normals
+	std::vector<int>	m_Face;		// vertex indices (3 per triangle)
 };
 
 class CMarchingCubes : public CGLImageRenderer
@@ -99,13 +104,16 @@ private:
 
 	void CreateSurface();
 
+	void CreateCaps();
+
 private:
 	float	m_val, m_oldVal;		// iso-surface value
 	bool	m_bsmooth;
 	bool	m_bcloseSurface;
 	bool	m_binvertSpace;
 	GLColor	m_col;
-	TriMesh	m_mesh;
+	TriMesh	m_mesh;	// iso-surface
+	TriMesh	m_caps;	// triangles that close the surface at the image boundary
 
 	Byte m_ref;
 };
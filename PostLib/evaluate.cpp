@@ -27,6 +27,7 @@ SOFTWARE.*/
 #include "FEPostModel.h"
 #include "constants.h"
 #include "FEMeshData_T.h"
+#include "FEStatePrefetcher.h"
 #include <MeshLib/MeshMetrics.h>
 #include <MeshLib/MeshTools.h>
 using namespace Post;
@@ -165,6 +166,186 @@ float component(const tens4fs& m, int n)
 	return g;
 }
 
+//-----------------------------------------------------------------------------
+// (this allows scalar data to be handled like the other data types)
+inline float component(float v, int n) { return v; }
+
+//-----------------------------------------------------------------------------
+// returns the data of a field if it can be evaluated by multiple threads
+static Post::FEMeshData* threadSafeData(FEState& state, int nfield)
+{
+	int ndata = FIELD_CODE(nfield);
+	if ((ndata < 0) || (ndata >= state.m_Data.size())) return nullptr;
+	Post::FEMeshData& rd = state.m_Data[ndata];
+	return (rd.IsThreadSafe() ? &rd : nullptr);
+}
+
+//-----------------------------------------------------------------------------
+// same as threadSafeData, but this also prepares the data for the evaluation.
+// Call this once before the data is evaluated in a parallel loop.
+static Post::FEMeshData* prepareThreadSafeData(FEState& state, int nfield)
+{
+	Post::FEMeshData* pd = threadSafeData(state, nfield);
+	if (pd) pd->Prepare();
+	return pd;
+}
+
+//-----------------------------------------------------------------------------
+// Evaluate node data of type T at all nodes. Data that is stored in an array
+// is read directly.
+template <typename T> void evalNodeData_T(Post::FEMeshData& rd, FEState& state, int ncomp)
+{
+	FEPostMesh& mesh = *state.GetFEMesh();
+	FENodeData_T<T>& df = dynamic_cast<FENodeData_T<T>&>(rd);
+	Post::FENodeData<T>* pd = dynamic_cast<Post::FENodeData<T>*>(&df);
+
+	int NN = mesh.Nodes();
+#pragma omp parallel for
+	for (int i = 0; i < NN; ++i)
+	{
+		NODEDATA& d = state.m_NODE[i];
+		d.m_val = 0.f;
+		d.m_ntag = 0;
+		if (mesh.Node(i).IsEnabled())
+		{
+			T v;
+			if (pd) v = (*pd)[i]; else df.eval(i, &v);
+			d.m_val = component(v, ncomp);
+			d.m_ntag = 1;
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Evaluate the node values of a node field in parallel. Returns false if 
+// the data cannot be evaluated this way.
+static bool evalNodeData(FEState& state, int nfield)
+{
+	Post::FEMeshData* pd = prepareThreadSafeData(state, nfield);
+	if (pd == nullptr) return false;
+
+	Post::FEMeshData& rd = *pd;
+	int ncomp = FIELD_COMP(nfield);
+	switch (rd.GetType())
+	{
+	case DATA_FLOAT  : evalNodeData_T<float  >(rd, state, ncomp); break;
+	case DATA_VEC3F  : evalNodeData_T<vec3f  >(rd, state, ncomp); break;
+	case DATA_MAT3F  : evalNodeData_T<mat3f  >(rd, state, ncomp); break;
+	case DATA_MAT3D  : evalNodeData_T<mat3d  >(rd, state, ncomp); break;
+	case DATA_MAT3FS : evalNodeData_T<mat3fs >(rd, state, ncomp); break;
+	case DATA_MAT3FD : evalNodeData_T<mat3fd >(rd, state, ncomp); break;
+	case DATA_TENS4FS: evalNodeData_T<tens4fs>(rd, state, ncomp); break;
+	case DATA_ARRAY:
+	{
+		FEPostMesh& mesh = *state.GetFEMesh();
+		FENodeArrayData& dm = dynamic_cast<FENodeArrayData&>(rd);
+		int NN = mesh.Nodes();
+#pragma omp parallel for
+		for (int i = 0; i < NN; ++i)
+		{
+			NODEDATA& d = state.m_NODE[i];
+			d.m_val = 0.f;
+			d.m_ntag = 0;
+			if (mesh.Node(i).IsEnabled())
+			{
+				d.m_val = dm.eval(i, ncomp);
+				d.m_ntag = 1;
+			}
+		}
+	}
+	break;
+	default:
+		return false;
+	}
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Evaluate element data of type T and format fmt at all elements. 
+template <typename T, Data_Format fmt> void evalElemData_T(Post::FEMeshData& rd, FEState& state, int ncomp)
+{
+	FEPostMesh& mesh = *state.GetFEMesh();
+	FEElemData_T<T, fmt>& df = dynamic_cast<FEElemData_T<T, fmt>&>(rd);
+	ValArray& elemData = state.m_ElemData;
+
+	int NE = mesh.Elements();
+#pragma omp parallel for
+	for (int i = 0; i < NE; ++i)
+	{
+		FEElement_& el = mesh.ElementRef(i);
+		ELEMDATA& d = state.m_ELEM[i];
+		d.m_val = 0.f;
+		d.m_state &= ~StatusFlags::ACTIVE;
+		if (el.IsEnabled() && (d.m_state & StatusFlags::VISIBLE) && df.active(i))
+		{
+			int ne = el.Nodes();
+			float val = 0.f;
+			if ((fmt == DATA_ITEM) || (fmt == DATA_REGION))
+			{
+				T v;
+				df.eval(i, &v);
+				val = component(v, ncomp);
+				for (int j = 0; j < ne; ++j) elemData.value(i, j) = val;
+			}
+			else
+			{
+				T v[FSElement::MAX_NODES] = {};
+				df.eval(i, v);
+				for (int j = 0; j < ne; ++j)
+				{
+					float vj = component(v[j], ncomp);
+					elemData.value(i, j) = vj;
+					val += vj;
+				}
+				val /= (float)ne;
+			}
+
+			d.m_state |= StatusFlags::ACTIVE;
+			d.m_val = val;
+		}
+	}
+}
+
+template <typename T> bool evalElemData_T(Post::FEMeshData& rd, FEState& state, int ncomp)
+{
+	switch (rd.GetFormat())
+	{
+	case DATA_ITEM  : evalElemData_T<T, DATA_ITEM  >(rd, state, ncomp); break;
+	case DATA_NODE  : evalElemData_T<T, DATA_NODE  >(rd, state, ncomp); break;
+	case DATA_COMP  : evalElemData_T<T, DATA_COMP  >(rd, state, ncomp); break;
+	case DATA_REGION: evalElemData_T<T, DATA_REGION>(rd, state, ncomp); break;
+	default:
+		return false;
+	}
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Evaluate the element values of an element field in parallel. Returns false if 
+// the data cannot be evaluated this way.
+static bool evalElemData(FEState& state, int nfield)
+{
+	Post::FEMeshData* pd = prepareThreadSafeData(state, nfield);
+	if (pd == nullptr) return false;
+
+	Post::FEMeshData& rd = *pd;
+	int ncomp = FIELD_COMP(nfield);
+	switch (rd.GetType())
+	{
+	case DATA_FLOAT  : return evalElemData_T<float  >(rd, state, ncomp);
+	case DATA_VEC3F  : return evalElemData_T<vec3f  >(rd, state, ncomp);
+	case DATA_MAT3F  : return evalElemData_T<mat3f  >(rd, state, ncomp);
+	case DATA_MAT3D  : return evalElemData_T<mat3d  >(rd, state, ncomp);
+	case DATA_MAT3FS : return evalElemData_T<mat3fs >(rd, state, ncomp);
+	case DATA_MAT3FD : return evalElemData_T<mat3fd >(rd, state, ncomp);
+	case DATA_TENS4FS: return evalElemData_T<tens4fs>(rd, state, ncomp);
+	}
+
+	// the array data is handled by EvaluateElement
+	return false;
+}
+
 //-----------------------------------------------------------------------------
 bool FEPostModel::IsValidFieldCode(int nfield, int nstate)
 {
@@ -172,7 +353,7 @@ bool FEPostModel::IsValidFieldCode(int nfield, int nstate)
 	if ((nstate < 0) || (nstate >= GetStates())) return false;
 
 	// get the state info
-	FEState& state = *m_State[nstate];
+	FEState& state = *GetState(nstate);
 
 	// get the data field
 	int ndata = FIELD_CODE(nfield);
@@ -185,15 +366,52 @@ bool FEPostModel::IsValidFieldCode(int nfield, int nstate)
 	return true;
 }
 
+//-----------------------------------------------------------------------------
+bool FEPostModel::IsThreadSafeField(int nfield, int nstate)
+{
+	if ((nstate < 0) || (nstate >= GetStates())) return false;
+	return (threadSafeData(*GetState(nstate), nfield) != nullptr);
+}
+
 //-----------------------------------------------------------------------------
 // Evaluate a data field at a particular time
 bool FEPostModel::Evaluate(int nfield, int ntime, bool breset)
 {
-	// get the state data 
-	FEState& state = *m_State[ntime];
+	// the prefetcher should not touch this state while we evaluate it
+	CancelPrefetch(ntime);
+
+	// get the state data. The evaluation can load other states (e.g. the
+	// reference state of a strain), so make sure this one stays loaded.
+	FEStatePin pin(m_State[ntime]);
+	FEState& state = *GetState(ntime);
+	if (!state.IsLoaded()) return false;
 	FEPostMesh* mesh = state.GetFEMesh();
 	if (mesh->Nodes() == 0) return false;
 
+	EvalStateField(ntime, nfield, breset);
+
+	// The evaluation only sets the state's element status, since it can also
+	// run on the prefetch thread. Copy it to the mesh elements.
+	if (IS_NODE_FIELD(nfield) || IS_ELEM_FIELD(nfield) || IS_FACE_FIELD(nfield))
+	{
+		int NE = mesh->Elements();
+		for (int i = 0; i < NE; ++i)
+		{
+			FEElement_& el = mesh->ElementRef(i);
+			if (state.m_ELEM[i].m_state & StatusFlags::ACTIVE) el.Activate();
+			else el.Deactivate();
+		}
+	}
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Evaluate a data field for a state, without touching the mesh
+void FEPostModel::EvalStateField(int ntime, int nfield, bool breset)
+{
+	FEState& state = *GetState(ntime);
+
 	// make sure that we have to reevaluate
 	if ((state.m_nField != nfield) || breset)
 	{
@@ -205,6 +423,68 @@ bool FEPostModel::Evaluate(int nfield, int ntime, bool breset)
 		else if (IS_FACE_FIELD(nfield)) EvalFaceField(ntime, nfield);
 //		else assert(false);
 	}
+}
+
+//-----------------------------------------------------------------------------
+// Update the nodal positions (m_rt) of a state from the displacement field.
+void FEPostModel::UpdateNodePositions(int ntime)
+{
+	CancelPrefetch(ntime);
+	EvalNodePositions(ntime);
+}
+
+//-----------------------------------------------------------------------------
+// Force the nodal positions of all states to be reevaluated
+void FEPostModel::ResetNodePositions()
+{
+	CancelPrefetch();
+	for (int i = 0; i < (int)m_State.size(); ++i) m_State[i]->m_nDispField = -1;
+}
+
+//-----------------------------------------------------------------------------
+void FEPostModel::EvalNodePositions(int ntime)
+{
+	FEStatePin pin(m_State[ntime]);
+	FEState& s = *GetState(ntime);
+	int ndisp = m_ndisp;
+	if (!s.IsLoaded() || (ndisp < 0) || (s.m_nDispField == ndisp)) return;
+	s.m_nDispField = ndisp;
+
+	// get the reference state
+	Post::FERefState& ref = *s.m_ref;
+
+	// the actual nodal position is stored in the state
+	// this is the field that will be used for strain calculations
+	FEPostMesh* mesh = s.GetFEMesh();
+	int NN = mesh->Nodes();
+	bool bparallel = (prepareThreadSafeData(s, ndisp) != nullptr);
+#pragma omp parallel for if (bparallel)
+	for (int i = 0; i < NN; ++i)
+	{
+		vec3f dr = EvaluateNodeVector(i, ntime, ndisp);
+		s.m_NODE[i].m_rt = ref.m_Node[i].m_rt + dr;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Evaluate the nodal positions and the data field of a state. This is called
+// from the prefetch thread, so it only evaluates data that is thread safe.
+bool FEPostModel::PrefetchState(int ntime, int nfield, bool bdisp)
+{
+	if ((ntime < 0) || (ntime >= (int)m_State.size())) return false;
+	FEState& state = *m_State[ntime];
+	FEStatePin pin(&state);
+	if (!state.IsLoaded()) return false;
+	if (state.GetFEMesh()->Nodes() == 0) return false;
+
+	if (bdisp && (m_ndisp >= 0) && (threadSafeData(state, m_ndisp) == nullptr)) return false;
+	if (threadSafeData(state, nfield) == nullptr) return false;
+
+	if (bdisp) EvalNodePositions(ntime);
+
+	// stop early when the prefetcher is canceled
+	if (m_prefetch->IsAborted()) return false;
+	EvalStateField(ntime, nfield, false);
 
 	return true;
 }
@@ -216,23 +496,27 @@ void FEPostModel::EvalNodeField(int ntime, int nfield)
 	assert(IS_NODE_FIELD(nfield));
 
 	// get the state data 
-	FEState& state = *m_State[ntime];
+	FEState& state = *GetState(ntime);
 	FEPostMesh* mesh = state.GetFEMesh();
 
 	// first, we evaluate all the nodes
-	int i, j;
-	for (i=0; i<mesh->Nodes(); ++i)
+	if (evalNodeData(state, nfield) == false)
 	{
-		FSNode& node = mesh->Node(i);
-		NODEDATA& d = state.m_NODE[i];
-		d.m_val = 0;
-		d.m_ntag = 0;
-		if (node.IsEnabled()) EvaluateNode(i, ntime, nfield, d);
+		for (int i=0; i<mesh->Nodes(); ++i)
+		{
+			FSNode& node = mesh->Node(i);
+			NODEDATA& d = state.m_NODE[i];
+			d.m_val = 0;
+			d.m_ntag = 0;
+			if (node.IsEnabled()) EvaluateNode(i, ntime, nfield, d);
+		}
 	}
 
 	// Next, we project the nodal data onto the faces
 	ValArray& faceData = state.m_FaceData;
-	for (i=0; i<mesh->Faces(); ++i)
+	int NF = mesh->Faces();
+#pragma omp parallel for
+	for (int i=0; i<NF; ++i)
 	{
 		FSFace& f = mesh->Face(i);
 		FACEDATA& d = state.m_FACE[i];
@@ -241,25 +525,25 @@ void FEPostModel::EvalNodeField(int ntime, int nfield)
 		if (f.IsEnabled())
 		{
 			d.m_ntag = 1;
-			for (j=0; j<f.Nodes(); ++j) { float val = state.m_NODE[f.n[j]].m_val; faceData.value(i, j) = val; d.m_val += val; }
+			for (int j=0; j<f.Nodes(); ++j) { float val = state.m_NODE[f.n[j]].m_val; faceData.value(i, j) = val; d.m_val += val; }
 			d.m_val /= (float) f.Nodes();
 		}
 	}
 
 	// Finally, we project the nodal data onto the elements
 	ValArray& elemData = state.m_ElemData;
-	for (i=0; i<mesh->Elements(); ++i)
+	int NE = mesh->Elements();
+#pragma omp parallel for
+	for (int i=0; i<NE; ++i)
 	{
 		FEElement_& e = mesh->ElementRef(i);
 		ELEMDATA& d = state.m_ELEM[i];
 		d.m_val = 0.f;
 		d.m_state &= ~StatusFlags::ACTIVE;
-		e.Deactivate();
 		if (e.IsEnabled())
 		{
 			d.m_state |= StatusFlags::ACTIVE;
-			e.Activate();
-			for (j=0; j<e.Nodes(); ++j) { float val = state.m_NODE[e.m_node[j]].m_val; elemData.value(i,j) = val; d.m_val += val; }
+			for (int j=0; j<e.Nodes(); ++j) { float val = state.m_NODE[e.m_node[j]].m_val; elemData.value(i,j) = val; d.m_val += val; }
 			d.m_val /= (float) e.Nodes();
 		}
 	}
@@ -272,7 +556,7 @@ void FEPostModel::EvalFaceField(int ntime, int nfield)
 	assert(IS_FACE_FIELD(nfield));
 
 	// get the state data 
-	FEState& state = *m_State[ntime];
+	FEState& state = *GetState(ntime);
 	FEPostMesh* mesh = state.GetFEMesh();
 
 	// get the data ID
@@ -284,6 +568,7 @@ void FEPostModel::EvalFaceField(int ntime, int nfield)
 
 	FEMeshData& rd = state.m_Data[ndata];
 	Data_Format fmt = rd.GetFormat();
+	if (rd.IsThreadSafe()) rd.Prepare();
 
 	// for float/node face data we evaluate the nodal values directly.
 	if ((rd.GetType() == DATA_FLOAT) && (fmt == DATA_NODE))
@@ -298,24 +583,23 @@ void FEPostModel::EvalFaceField(int ntime, int nfield)
 		// get the data field
 		FEFaceData_T<float, DATA_NODE>& df = dynamic_cast<FEFaceData_T<float, DATA_NODE>&>(rd);
 
-		// evaluate nodes and faces
-		float tmp[FSElement::MAX_NODES] = {0.f};
-		for (int i=0; i<mesh->Faces(); ++i)
+		// evaluate faces
+		int NF = mesh->Faces();
+#pragma omp parallel for if (rd.IsThreadSafe())
+		for (int i=0; i<NF; ++i)
 		{
 			FSFace& face = mesh->Face(i);
 			state.m_FACE[i].m_val = 0.f;
 			state.m_FACE[i].m_ntag = 0;
 			if (df.active(i))
 			{
+				float tmp[FSElement::MAX_NODES] = { 0.f };
 				df.eval(i, tmp);
 
 				float avg = 0.f;
 				for (int j = 0; j<face.Nodes(); ++j)
 				{
 					avg += tmp[j];
-					state.m_NODE[face.n[j]].m_val = tmp[j];
-					state.m_NODE[face.n[j]].m_ntag = 1;
-
 					state.m_FaceData.value(i, j) = tmp[j];
 				}
 
@@ -323,19 +607,35 @@ void FEPostModel::EvalFaceField(int ntime, int nfield)
 				state.m_FACE[i].m_ntag = 1;
 			}
 		}
+
+		// copy face values to the nodes
+		// (in face order, since the last face determines the node value)
+		for (int i = 0; i < NF; ++i)
+		{
+			FSFace& face = mesh->Face(i);
+			if (state.m_FACE[i].m_ntag == 1)
+			{
+				for (int j = 0; j < face.Nodes(); ++j)
+				{
+					state.m_NODE[face.n[j]].m_val = state.m_FaceData.value(i, j);
+					state.m_NODE[face.n[j]].m_ntag = 1;
+				}
+			}
+		}
 	}
 	else
 	{
 		// first evaluate all faces
-		float data[FSFace::MAX_NODES], val;
-		int i, j;
-		for (i=0; i<mesh->Faces(); ++i)
+		int NF = mesh->Faces();
+#pragma omp parallel for if (rd.IsThreadSafe())
+		for (int i=0; i<NF; ++i)
 		{
 			FSFace& f = mesh->Face(i);
 			state.m_FACE[i].m_val = 0.f;
 			state.m_FACE[i].m_ntag = 0;
 			if (f.IsEnabled()) 
 			{
+				float data[FSFace::MAX_NODES], val;
 				if (EvaluateFace(i, ntime, nfield, data, val))
 				{
 					state.m_FACE[i].m_ntag = 1;
@@ -347,14 +647,16 @@ void FEPostModel::EvalFaceField(int ntime, int nfield)
 
 		// now evaluate the nodes
 		ValArray& faceData = state.m_FaceData;
-		for (i=0; i<mesh->Nodes(); ++i)
+		int NN = mesh->Nodes();
+#pragma omp parallel for
+		for (int i=0; i<NN; ++i)
 		{
 			NODEDATA& node = state.m_NODE[i];
 			const vector<NodeFaceRef>& nfl = mesh->NodeFaceList(i);
 			node.m_val = 0.f; 
 			node.m_ntag = 0;
 			int n = 0;
-			for (j=0; j<(int) nfl.size(); ++j)
+			for (int j=0; j<(int) nfl.size(); ++j)
 			{
 				FACEDATA& f = state.m_FACE[nfl[j].fid];
 				if (f.m_ntag > 0)
@@ -373,10 +675,10 @@ void FEPostModel::EvalFaceField(int ntime, int nfield)
 
 	// evaluate the elements (to zero)
 	// Face data is not projected onto the elements
-	for (int i=0; i<mesh->Elements(); ++i) 
+	int NE = mesh->Elements();
+#pragma omp parallel for
+	for (int i=0; i<NE; ++i) 
 	{
-		FEElement_& el = mesh->ElementRef(i);
-		el.Deactivate();
 		state.m_ELEM[i].m_val = 0.f;
 		state.m_ELEM[i].m_state &= ~StatusFlags::ACTIVE;
 	}
@@ -389,41 +691,48 @@ void FEPostModel::EvalElemField(int ntime, int nfield)
 	assert(IS_ELEM_FIELD(nfield));
 
 	// get the state data 
-	FEState& state = *m_State[ntime];
+	FEState& state = *GetState(ntime);
 	FEPostMesh* mesh = state.GetFEMesh();
 
 	// first evaluate all elements
-	float data[FSElement::MAX_NODES] = {0.f};
-	float val;
-	for (int i=0; i<mesh->Elements(); ++i)
+	if (evalElemData(state, nfield) == false)
 	{
-		FEElement_& el = mesh->ElementRef(i);
-		state.m_ELEM[i].m_val = 0.f;
-		state.m_ELEM[i].m_state &= ~StatusFlags::ACTIVE;
-		el.Deactivate();
-		if (el.IsEnabled()) 
+		// this also handles array data
+		bool bparallel = (prepareThreadSafeData(state, nfield) != nullptr);
+		int NE = mesh->Elements();
+#pragma omp parallel for if (bparallel)
+		for (int i=0; i<NE; ++i)
 		{
-			if (EvaluateElement(i, ntime, nfield, data, val))
+			FEElement_& el = mesh->ElementRef(i);
+			state.m_ELEM[i].m_val = 0.f;
+			state.m_ELEM[i].m_state &= ~StatusFlags::ACTIVE;
+			if (el.IsEnabled()) 
 			{
-				state.m_ELEM[i].m_state |= StatusFlags::ACTIVE;
-				state.m_ELEM[i].m_val = val;
-				el.Activate();
-				int ne = el.Nodes();
-				for (int j=0; j<ne; ++j) state.m_ElemData.value(i, j) = data[j];
+				float data[FSElement::MAX_NODES] = {0.f};
+				float val;
+				if (EvaluateElement(i, ntime, nfield, data, val))
+				{
+					state.m_ELEM[i].m_state |= StatusFlags::ACTIVE;
+					state.m_ELEM[i].m_val = val;
+					int ne = el.Nodes();
+					for (int j=0; j<ne; ++j) state.m_ElemData.value(i, j) = data[j];
+				}
 			}
 		}
 	}
 
 	// now evaluate the nodes
 	ValArray& elemData = state.m_ElemData;
-	for (int i=0; i<mesh->Nodes(); ++i)
+	int NN = mesh->Nodes();
+#pragma omp parallel for
+	for (int i=0; i<NN; ++i)
 	{
 		FSNode& node = mesh->Node(i);
 		state.m_NODE[i].m_val = 0.f;
 		state.m_NODE[i].m_ntag = 0;
 		if (node.IsEnabled())
 		{
-			const vector<NodeElemRef>& nel = mesh->NodeElemList(i);
+			NodeElemRange nel = mesh->NodeElemList(i);
 			int m = (int) nel.size(), n=0;
 			float val = 0.f;
 			for (int j=0; j<m; ++j)
@@ -445,7 +754,9 @@ void FEPostModel::EvalElemField(int ntime, int nfield)
 
 	// evaluate faces
 	ValArray& fd = state.m_FaceData;
-	for (int i=0; i<mesh->Faces(); ++i)
+	int NF = mesh->Faces();
+#pragma omp parallel for
+	for (int i=0; i<NF; ++i)
 	{
 		FSFace& f = mesh->Face(i);
 		FACEDATA& d = state.m_FACE[i];
@@ -838,7 +1149,7 @@ void FEPostModel::EvaluateNode(int n, int ntime, int nfield, NODEDATA& d)
 	else if (IS_ELEM_FIELD(nfield))
 	{
 		// we take the average of the elements that contain this element
-		const vector<NodeElemRef>& nel = mesh->NodeElemList(n);
+		NodeElemRange nel = mesh->NodeElemList(n);
 		float data[FSElement::MAX_NODES] = {0.f}, val;
 		int ne = (int)nel.size(), n = 0;
 		if (!nel.empty())
@@ -905,7 +1216,7 @@ bool FEPostModel::EvaluateFace(int n, int ntime, int nfield, float* data, float&
 	int ntag = 0;
 
 	// get the state
-	FEState& s = *m_State[ntime];
+	FEState& s = *GetState(ntime);
 
 
 	if (IS_FACE_FIELD(nfield))
@@ -1603,7 +1914,7 @@ bool FEPostModel::EvaluateElement(int n, int ntime, int nfield, float* data, flo
 	int ne = el.Nodes();
 
 	// make sure the element is not eroded
-	if (el.IsEroded()) return false;
+	if ((state.m_ELEM[n].m_state & StatusFlags::VISIBLE) == 0) return false;
 
 	// the return value
 	val = 0.f;
@@ -2181,7 +2492,7 @@ vec3f FEPostModel::EvaluateNodeVector(int n, int ntime, int nvec)
 	else if (IS_ELEM_FIELD(nvec))
 	{
 		// we take the average of the elements that contain this element
-		const vector<NodeElemRef>& nel = mesh->NodeElemList(n);
+		NodeElemRange nel = mesh->NodeElemList(n);
 		if (!nel.empty())
 		{
 			int n = 0;
@@ -2504,7 +2815,7 @@ mat3f FEPostModel::EvaluateNodeTensor(int n, int ntime, int nten, int ntype)
 	else 
 	{
 		// we take the average of the elements that contain this element
-		const vector<NodeElemRef>& nel = mesh->NodeElemList(n);
+		NodeElemRange nel = mesh->NodeElemList(n);
 		if (!nel.empty())
 		{
 			for (int i=0; i<(int) nel.size(); ++i) m += EvaluateElemTensor(nel[i].eid, ntime, nten, ntype);
@@ -0,0 +1,135 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+// Tests that the compact element store (FSElementStore) gives back the elements it was built from.
+#include <MeshLib/FEElementStore.h>
+#include <MeshLib/FEElementLibrary.h>
+#include "TestMeshes.h"
+#include "TestTools.h"
+
+//-----------------------------------------------------------------------------
+static void testRoundTrip()
+{
+	FSMesh mesh;
+	buildMixedMesh(mesh);
+
+	FSElementStore store;
+	store.Build(mesh);
+	CHECK(store.Elements() == mesh.Elements());
+
+	FSMesh copy;
+	copy.Create(mesh.Nodes(), 0);
+	store.Restore(copy);
+	CHECK(sameElements(mesh, copy));
+
+	// the views see the same data
+	for (int i = 0; i < mesh.Elements(); ++i)
+	{
+		const FSElement& el = mesh.Element(i);
+		FSElementStore::View v = store.Element(i);
+		CHECK(v.Type() == el.Type());
+		CHECK(v.Nodes() == el.Nodes());
+		CHECK(v.Node(v.Nodes() - 1) == el.m_node[el.Nodes() - 1]);
+		CHECK(v.MatID() == el.m_MatID);
+		CHECK(v.HasThickness() == el.IsShell());
+		if (el.IsShell()) CHECK(v.Thickness(1) == el.m_h[1]);
+		CHECK(v.HasFiber() == (el.m_fiber.x != 0.0));
+		CHECK(v.HasAxes() == el.m_Qactive);
+		CHECK(sameMatrix(v.Axes(), el.m_Q));
+		CHECK(v.CrossSection() == el.m_a0);
+	}
+
+	// building the store again from the restored mesh gives the same result
+	FSElementStore store2;
+	store2.Build(copy);
+	CHECK(store2.MemoryUsage() == store.MemoryUsage());
+}
+
+//-----------------------------------------------------------------------------
+// The local IDs are not stored when they are all zero or all equal to the index
+static void testLocalIDs()
+{
+	FSMesh mesh;
+	buildMixedMesh(mesh);
+	FSElementStore store;
+	store.Build(mesh);
+	size_t memMixed = store.MemoryUsage();
+
+	for (int lid = 0; lid < 2; ++lid)
+	{
+		for (int i = 0; i < mesh.Elements(); ++i) mesh.Element(i).m_lid = (lid == 0 ? 0 : i);
+		store.Build(mesh);
+		CHECK(store.MemoryUsage() < memMixed);
+
+		FSMesh copy;
+		copy.Create(mesh.Nodes(), 0);
+		store.Restore(copy);
+		CHECK(sameElements(mesh, copy));
+	}
+}
+
+//-----------------------------------------------------------------------------
+// The optional data is not allocated when no element uses it
+static void testPlainMesh()
+{
+	FSMesh mesh;
+	mesh.Create(8, 2);
+	for (int i = 0; i < 2; ++i)
+	{
+		FSElement& el = mesh.Element(i);
+		el.SetType(FE_TET4);
+		for (int j = 0; j < 4; ++j) el.m_node[j] = 4 * i + j;
+		el.m_lid = i;
+	}
+
+	FSElementStore store;
+	store.Build(mesh);
+	FSElementStore::View v = store.Element(1);
+	CHECK(v.HasThickness() == false);
+	CHECK(v.HasFiber() == false);
+	CHECK(v.HasAxes() == false);
+
+	FSMesh copy;
+	copy.Create(mesh.Nodes(), 0);
+	store.Restore(copy);
+	CHECK(sameElements(mesh, copy));
+
+	// an empty mesh gives an empty store
+	FSMesh empty;
+	store.Build(empty);
+	CHECK(store.Elements() == 0);
+}
+
+//-----------------------------------------------------------------------------
+int main()
+{
+	FSElementLibrary::InitLibrary();
+
+	testRoundTrip();
+	testLocalIDs();
+	testPlainMesh();
+	return TEST_RESULT();
+}
@@ -0,0 +1,142 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+// Tests the vertex arrays of the domain surfaces (GLFaceBuffer) without a GL context.
+#include <GLLib/GLFaceBuffer.h>
+#include <MeshLib/FEMesh.h>
+#include "TestTools.h"
+
+//-----------------------------------------------------------------------------
+// a strip of a triangle, a quad and a triangle
+static void buildMesh(FSMesh& mesh)
+{
+	mesh.Create(6, 0, 3);
+	const double r[6][2] = { {0,0}, {1,0}, {0,1}, {2,0}, {1,1}, {2,1} };
+	for (int i = 0; i < 6; ++i) mesh.Node(i).r = vec3d(r[i][0], r[i][1], 0);
+
+	const int tri0[3] = { 0, 1, 2 };
+	const int quad[4] = { 1, 3, 4, 2 };
+	const int tri1[3] = { 3, 5, 4 };
+
+	FSFace& f0 = mesh.Face(0); f0.SetType(FE_FACE_TRI3);  for (int i = 0; i < 3; ++i) f0.n[i] = tri0[i];
+	FSFace& f1 = mesh.Face(1); f1.SetType(FE_FACE_QUAD4); for (int i = 0; i < 4; ++i) f1.n[i] = quad[i];
+	FSFace& f2 = mesh.Face(2); f2.SetType(FE_FACE_TRI3);  for (int i = 0; i < 3; ++i) f2.n[i] = tri1[i];
+}
+
+//-----------------------------------------------------------------------------
+static bool isRange(const GLFaceBuffer::DrawRange& r, int ntag, int first, int count)
+{
+	return (r.ntag == ntag) && (r.first == first) && (r.count == count);
+}
+
+//-----------------------------------------------------------------------------
+static bool hasPosition(const GLFaceBuffer& buf, int vert, const vec3d& r)
+{
+	const float* p = &buf.Positions()[3 * vert];
+	return (p[0] == (float)r.x) && (p[1] == (float)r.y) && (p[2] == (float)r.z);
+}
+
+//-----------------------------------------------------------------------------
+int main()
+{
+	FSMesh mesh;
+	buildMesh(mesh);
+	mesh.Face(0).m_ntag = 1;
+	mesh.Face(1).m_ntag = 1;
+	mesh.Face(2).m_ntag = 2;
+
+	std::vector<int> faceList = { 0, 1, 2 };
+	GLFaceBuffer buf;
+	CHECK(buf.IsValid(&mesh, 7) == false);
+	CHECK(buf.Create(&mesh, faceList, 7));
+
+	// the buffer is identified by the face list revision
+	CHECK(buf.IsValid(&mesh, 7));
+	CHECK(buf.IsValid(&mesh, 8) == false);
+	CHECK(buf.IsValid(nullptr, 7) == false);
+
+	// one triangle for the triangles, and two for the quad
+	CHECK(buf.Vertices() == 12);
+
+	// the vertices follow the face triangulation
+	CHECK(hasPosition(buf, 0, mesh.Node(0).r));
+	CHECK(hasPosition(buf, 1, mesh.Node(1).r));
+	CHECK(hasPosition(buf, 2, mesh.Node(2).r));
+	CHECK(hasPosition(buf, 3, mesh.Node(1).r));
+	CHECK(hasPosition(buf, 6, mesh.Node(4).r));
+
+	// consecutive faces with the same tag are drawn with one call
+	const std::vector<GLFaceBuffer::DrawRange>& range = buf.DrawRanges();
+	CHECK(range.size() == 2);
+	if (range.size() == 2)
+	{
+		CHECK(isRange(range[0], 1, 0, 9));
+		CHECK(isRange(range[1], 2, 9, 3));
+	}
+
+	// the draw ranges are only updated when asked for
+	mesh.Face(1).m_ntag = 0;
+	CHECK(buf.DrawRanges().size() == 2);
+	buf.UpdateTags();
+	CHECK(range.size() == 3);
+	if (range.size() == 3)
+	{
+		CHECK(isRange(range[0], 1, 0, 3));
+		CHECK(isRange(range[1], 0, 3, 6));
+		CHECK(isRange(range[2], 2, 9, 3));
+	}
+
+	// the positions are copied when the mesh moves
+	mesh.Node(4).r = vec3d(1, 2, 3);
+	CHECK(hasPosition(buf, 6, vec3d(1, 1, 0)));
+	buf.Update();
+	CHECK(hasPosition(buf, 6, vec3d(1, 2, 3)));
+
+	// the vertices of a list of faces follow the order of the list (e.g. for z-sorting)
+	std::vector<unsigned int> vl;
+	buf.FaceVertices({ 2, 0 }, vl);
+	CHECK(vl.size() == 6);
+	if (vl.size() == 6) CHECK((vl[0] == 9) && (vl[2] == 11) && (vl[3] == 0) && (vl[5] == 2));
+
+	// moving the buffer keeps the data
+	GLFaceBuffer buf2(std::move(buf));
+	CHECK(buf2.IsValid(&mesh, 7));
+	CHECK(buf2.Vertices() == 12);
+	CHECK(buf.IsValid(&mesh, 7) == false);
+	CHECK(buf.Vertices() == 0);
+	buf = std::move(buf2);
+	CHECK(buf.IsValid(&mesh, 7));
+
+	// faces that cannot be rendered from the buffer
+	FSFace& f2 = mesh.Face(2);
+	f2.m_type = -1;
+	CHECK(GLFaceBuffer::IsSupported(f2) == false);
+	CHECK(buf.Create(&mesh, faceList, 9) == false);
+	CHECK(buf.IsValid(&mesh, 9) == false);
+	CHECK(buf.Vertices() == 0);
+
+	return TEST_RESULT();
+}
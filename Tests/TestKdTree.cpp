@@ -0,0 +1,95 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+
+
+// Tests the closest point queries of the kd-tree against a linear search, and that
+// the point registration handles empty point sets.
+#include <MeshTools/KdTree.h>
+#include <MeshTools/ICPRegistration.h>
+#include <stdlib.h>
+#include <vector>
+#include "TestTools.h"
+
+//-----------------------------------------------------------------------------
+static vec3d randomPoint()
+{
+	return vec3d(rand() / (double)RAND_MAX, rand() / (double)RAND_MAX, rand() / (double)RAND_MAX);
+}
+
+//-----------------------------------------------------------------------------
+static void testNearest()
+{
+	srand(1);
+	std::vector<vec3d> pts(1000);
+	for (vec3d& r : pts) r = randomPoint();
+
+	KdTree tree;
+	tree.Build(pts);
+	CHECK(tree.Points() == (int)pts.size());
+
+	int nwrong = 0;
+	for (int i = 0; i < 200; ++i)
+	{
+		vec3d x = randomPoint();
+		double d2 = -1.0;
+		int n = tree.FindNearest(x, &d2);
+
+		double d2min = 1e99;
+		for (const vec3d& r : pts) { double d = (r - x).SqrLength(); if (d < d2min) d2min = d; }
+		if ((n < 0) || (n >= (int)pts.size()) || ((pts[n] - x).SqrLength() != d2min) || (d2 != d2min)) nwrong++;
+	}
+	CHECK(nwrong == 0);
+}
+
+//-----------------------------------------------------------------------------
+static void testEmpty()
+{
+	KdTree tree;
+	tree.Build(std::vector<vec3d>());
+	CHECK(tree.Points() == 0);
+	CHECK(tree.FindNearest(vec3d(0, 0, 0)) == -1);
+
+	// the registration of an empty point set is the identity
+	std::vector<vec3d> pts(10);
+	for (vec3d& r : pts) r = randomPoint();
+
+	GICPRegistration icp;
+	Transform Q = icp.Register(std::vector<vec3d>(), pts);
+	CHECK(icp.Iterations() == 0);
+	CHECK((Q.GetPosition()).Length() == 0.0);
+
+	Q = icp.Register(pts, std::vector<vec3d>());
+	CHECK(icp.Iterations() == 0);
+}
+
+//-----------------------------------------------------------------------------
+int main()
+{
+	testNearest();
+	testEmpty();
+	return TEST_RESULT();
+}
@@ -0,0 +1,84 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+
+
+// Tests that the ray queries of the mesh BVH find the nearest primitive, also when
+// the ray direction is not a unit vector.
+#include <MeshLib/FEMeshBVH.h>
+#include <vector>
+#include "TestTools.h"
+
+//-----------------------------------------------------------------------------
+// Returns the primitive that is hit first by the ray. The primitives are boxes
+// around the points on the x-axis at x = 1, 2, ..., so the hit distance is the
+// distance to the box. The number of visited primitives is returned in nvisits.
+static int firstHit(const FSMeshBVH& bvh, const std::vector<BOX>& boxes, const vec3d& o, const vec3d& d, int& nvisits)
+{
+	int nmin = -1;
+	nvisits = 0;
+	bvh.Intersect(o, d, 1e99, [&](int i, double& tmax) {
+		nvisits++;
+		double t = boxes[i].x0 - o.x;
+		if ((t > 0.0) && (t < tmax)) { tmax = t; nmin = i; }
+	});
+	return nmin;
+}
+
+//-----------------------------------------------------------------------------
+static void testRayLength()
+{
+	std::vector<BOX> boxes;
+	for (int i = 0; i < 100; ++i)
+	{
+		double x = 1.0 + i;
+		boxes.push_back(BOX(x - 0.1, -0.1, -0.1, x + 0.1, 0.1, 0.1));
+	}
+
+	FSMeshBVH bvh;
+	bvh.Build(boxes);
+
+	// the first box is found, and the search is pruned the same way, for any
+	// length of the direction
+	vec3d o(0, 0, 0);
+	int n1 = 0, n2 = 0, n3 = 0;
+	CHECK(firstHit(bvh, boxes, o, vec3d(1, 0, 0), n1) == 0);
+	CHECK(firstHit(bvh, boxes, o, vec3d(0.01, 0, 0), n2) == 0);
+	CHECK(firstHit(bvh, boxes, o, vec3d(100, 0, 0), n3) == 0);
+	CHECK(n1 < (int)boxes.size());
+	CHECK(n2 == n1);
+	CHECK(n3 == n1);
+
+	// a zero direction hits nothing
+	CHECK(firstHit(bvh, boxes, o, vec3d(0, 0, 0), n1) == -1);
+}
+
+//-----------------------------------------------------------------------------
+int main()
+{
+	testRayLength();
+	return TEST_RESULT();
+}
@@ -0,0 +1,274 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+
+// Tests that a mesh that is compacted and expanded again (as the undo stack does
+// with the meshes it keeps) gives back the same elements.
+#include <MeshLib/FEMeshBuilder.h>
+#include <MeshLib/FEElementLibrary.h>
+#include "TestMeshes.h"
+#include "TestTools.h"
+
+//-----------------------------------------------------------------------------
+// checks that the node-element list matches the (expanded) elements
+static bool validNodeElementList(const FSMesh& mesh)
+{
+	const FSNodeElementList& NEL = mesh.NodeElementList();
+	if (NEL.Elements() != mesh.Elements()) return false;
+	for (int i = 0; i < mesh.Elements(); ++i)
+	{
+		const FSElement& el = mesh.Element(i);
+		for (int j = 0; j < el.Nodes(); ++j)
+			if (NEL.HasElement(el.m_node[j], i) == false) return false;
+	}
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+static void testRoundTrip()
+{
+	// (the copy constructor does not copy all element data, so the reference is built the same way)
+	FSMesh mesh, ref;
+	buildMixedMesh(mesh);
+	buildMixedMesh(ref);
+	mesh.NodeElementList();
+
+	size_t mem = mesh.MemoryUsage();
+	mesh.Compact();
+	CHECK(mesh.IsCompact());
+	CHECK(mesh.Elements() == ref.Elements());
+	CHECK(mesh.MemoryUsage() < mem);
+
+	// compacting twice does nothing
+	mesh.Compact();
+	CHECK(mesh.IsCompact());
+
+	mesh.Expand();
+	CHECK(mesh.IsCompact() == false);
+	CHECK(sameElements(ref, mesh));
+	CHECK(validNodeElementList(mesh));
+}
+
+//-----------------------------------------------------------------------------
+// A compacted mesh can still be used: the views read from the store and the
+// element accessors expand the mesh.
+static void testLiveAccess()
+{
+	FSMesh mesh, ref;
+	buildMixedMesh(mesh);
+	buildMixedMesh(ref);
+	mesh.Compact();
+
+	for (int i = 0; i < ref.Elements(); ++i)
+	{
+		const FSElement& el = ref.Element(i);
+		FSElementStore::View v = mesh.ElementView(i);
+		CHECK(v.Type() == el.Type());
+		CHECK(v.IsShell() == el.IsShell());
+		CHECK(v.Faces() == el.Faces());
+		CHECK(v.MatID() == el.m_MatID);
+		CHECK(v.IsSelected() == el.IsSelected());
+		for (int j = 0; j < el.Nodes(); ++j) CHECK(v.Node(j) == el.m_node[j]);
+	}
+
+	// the bounding volume hierarchy is built from the store
+	CHECK(mesh.ElementBVH().Primitives() == ref.Elements());
+	CHECK(mesh.IsCompact());
+
+	// the first element access expands the mesh
+	const FSMesh& cmesh = mesh;
+	CHECK(cmesh.Element(0).Type() == ref.Element(0).Type());
+	CHECK(mesh.IsCompact() == false);
+	CHECK(sameElements(ref, mesh));
+
+	// views also work on expanded meshes
+	FSElementStore::View v = mesh.ElementView(1);
+	CHECK(v.Type() == ref.Element(1).Type());
+	CHECK(v.Node(0) == ref.Element(1).m_node[0]);
+}
+
+//-----------------------------------------------------------------------------
+// Builds a row of hex elements with its faces and edges
+static void buildHexRow(FSMesh& mesh, int nel)
+{
+	int NN = 4 * (nel + 1);
+	mesh.Create(NN, nel);
+	for (int i = 0; i <= nel; ++i)
+	{
+		mesh.Node(4 * i    ).r = vec3d(i, 0, 0);
+		mesh.Node(4 * i + 1).r = vec3d(i, 1, 0);
+		mesh.Node(4 * i + 2).r = vec3d(i, 1, 1);
+		mesh.Node(4 * i + 3).r = vec3d(i, 0, 1);
+	}
+	for (int i = 0; i < nel; ++i)
+	{
+		FSElement& el = mesh.Element(i);
+		el.SetType(FE_HEX8);
+		el.m_gid = 0;
+		int n[8] = { 0, 4, 5, 1, 3, 7, 6, 2 };
+		for (int j = 0; j < 8; ++j) el.m_node[j] = 4 * i + n[j];
+	}
+	mesh.RebuildMesh();
+
+	// the texture coordinates are not initialized by the mesh
+	for (int i = 0; i < mesh.Faces(); ++i)
+	{
+		FSFace& f = mesh.Face(i);
+		for (int j = 0; j < FSFace::MAX_NODES; ++j) f.m_tex[j] = (i == 3 ? 0.5f * j : 0.f);
+		f.m_texe = 0.f;
+	}
+	mesh.Node(2).Select();
+	mesh.Face(1).m_ntag = 7;
+}
+
+//-----------------------------------------------------------------------------
+static bool sameItem(const MeshItem& a, const MeshItem& b)
+{
+	return (a.m_nid == b.m_nid) && (a.m_gid == b.m_gid) && (a.m_ntag == b.m_ntag) && (a.GetFEState() == b.GetFEState());
+}
+
+//-----------------------------------------------------------------------------
+// Compares the nodes, edges, and faces of two meshes
+static bool sameItems(const FSMesh& a, const FSMesh& b)
+{
+	if ((a.Nodes() != b.Nodes()) || (a.Edges() != b.Edges()) || (a.Faces() != b.Faces())) return false;
+	for (int i = 0; i < a.Nodes(); ++i)
+	{
+		const FSNode& na = a.Node(i), &nb = b.Node(i);
+		if (!sameItem(na, nb) || (na.r.x != nb.r.x) || (na.r.y != nb.r.y) || (na.r.z != nb.r.z)) return false;
+	}
+	for (int i = 0; i < a.Edges(); ++i)
+	{
+		const FSEdge& ea = a.Edge(i), &eb = b.Edge(i);
+		if (!sameItem(ea, eb) || (ea.Type() != eb.Type()) || (ea.m_elem != eb.m_elem)) return false;
+		for (int j = 0; j < ea.Nodes(); ++j) if (ea.n[j] != eb.n[j]) return false;
+		for (int j = 0; j < 2; ++j) if ((ea.m_nbr[j] != eb.m_nbr[j]) || (ea.m_face[j] != eb.m_face[j])) return false;
+	}
+	for (int i = 0; i < a.Faces(); ++i)
+	{
+		const FSFace& fa = a.Face(i), &fb = b.Face(i);
+		if (!sameItem(fa, fb) || (fa.Type() != fb.Type()) || (fa.m_sid != fb.m_sid) || (fa.m_texe != fb.m_texe)) return false;
+		if ((fa.m_fn.x != fb.m_fn.x) || (fa.m_fn.y != fb.m_fn.y) || (fa.m_fn.z != fb.m_fn.z)) return false;
+		for (int j = 0; j < fa.Nodes(); ++j)
+		{
+			if ((fa.n[j] != fb.n[j]) || (fa.m_tex[j] != fb.m_tex[j])) return false;
+			if ((fa.m_nn[j].x != fb.m_nn[j].x) || (fa.m_nn[j].y != fb.m_nn[j].y) || (fa.m_nn[j].z != fb.m_nn[j].z)) return false;
+		}
+		for (int j = 0; j < fa.Edges(); ++j) if ((fa.m_nbr[j] != fb.m_nbr[j]) || (fa.m_edge[j] != fb.m_edge[j])) return false;
+		for (int j = 0; j < 3; ++j) if ((fa.m_elem[j].eid != fb.m_elem[j].eid) || (fa.m_elem[j].lid != fb.m_elem[j].lid)) return false;
+	}
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Packing also moves the nodes, edges and faces into a compact store
+static void testPack()
+{
+	FSMesh mesh, ref;
+	buildHexRow(mesh, 5);
+	buildHexRow(ref, 5);
+	CHECK(mesh.Faces() > 0);
+	CHECK(mesh.Edges() > 0);
+
+	// the node-element list is part of the memory usage
+	size_t mem = mesh.MemoryUsage();
+	size_t nel = mesh.NodeElementList().MemoryUsage();
+	CHECK(nel > 0);
+	CHECK(mem >= nel + mesh.Elements() * sizeof(FSElement) + mesh.Faces() * sizeof(FSFace));
+
+	mesh.Pack();
+	CHECK(mesh.IsPacked());
+	CHECK(mesh.IsCompact());
+	CHECK(mesh.Nodes() == 0);
+	CHECK(mesh.Faces() == 0);
+	CHECK(2 * mesh.MemoryUsage() < mem);
+
+	mesh.Unpack();
+	CHECK(mesh.IsPacked() == false);
+	CHECK(mesh.IsCompact() == false);
+	CHECK(sameItems(ref, mesh));
+	CHECK(sameElements(ref, mesh));
+	CHECK(validNodeElementList(mesh));
+
+	// the node-face list is rebuilt
+	CHECK(mesh.NodeFaceList(0).size() == ref.NodeFaceList(0).size());
+	CHECK(mesh.NodeFaceList(0)[0].pf == mesh.FacePtr(mesh.NodeFaceList(0)[0].fid));
+}
+
+//-----------------------------------------------------------------------------
+// This does what the mesh commands do: the mesh that is not in use is compacted,
+// and expanded again when it is swapped back in.
+static void testUndoRedo()
+{
+	FSMesh* pold = new FSMesh;
+	buildMixedMesh(*pold);
+	FSMesh refOld;
+	buildMixedMesh(refOld);
+
+	FSMesh* pnew = new FSMesh(*pold);
+	FEMeshBuilder(*pnew).DeleteSelectedElements();
+	FSMesh refNew(refOld);
+	FEMeshBuilder(refNew).DeleteSelectedElements();
+	CHECK(refNew.Elements() == refOld.Elements() - 1);
+
+	// execute
+	pnew->Expand();
+	pold->Compact();
+	CHECK(sameElements(refNew, *pnew));
+
+	for (int i = 0; i < 3; ++i)
+	{
+		// undo
+		pold->Expand();
+		pnew->Compact();
+		CHECK(sameElements(refOld, *pold));
+		CHECK(validNodeElementList(*pold));
+
+		// redo
+		if (i < 2)
+		{
+			pnew->Expand();
+			pold->Compact();
+			CHECK(sameElements(refNew, *pnew));
+			CHECK(validNodeElementList(*pnew));
+		}
+	}
+
+	delete pnew;
+	delete pold;
+}
+
+//-----------------------------------------------------------------------------
+int main()
+{
+	FSElementLibrary::InitLibrary();
+
+	testRoundTrip();
+	testLiveAccess();
+	testPack();
+	testUndoRedo();
+	return TEST_RESULT();
+}
@@ -0,0 +1,123 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+#pragma once
+#include <MeshLib/FEMesh.h>
+#include <MeshLib/FEItem.h>
+
+//-----------------------------------------------------------------------------
+// Builds a small mesh with all the element data that the element store keeps:
+// solids of different types, shells with thicknesses, a beam with a
+// cross-section, fibers, active and inactive local axes, tags, local IDs,
+// texture coordinates and state flags.
+inline void buildMixedMesh(FSMesh& mesh)
+{
+	const int types[] = { FE_HEX8, FE_TET4, FE_PENTA6, FE_QUAD4, FE_TRI3, FE_TET10, FE_QUAD8, FE_BEAM2 };
+	const int NE = sizeof(types) / sizeof(int);
+	const int NN = 40;
+
+	mesh.Create(NN, NE);
+	for (int i = 0; i < NN; ++i) mesh.Node(i).r = vec3d(i, 2 * i, 3 * i);
+
+	for (int i = 0; i < NE; ++i)
+	{
+		FSElement& el = mesh.Element(i);
+		el.SetType(types[i]);
+		el.m_MatID = i % 3;
+		el.m_gid = i % 2;
+		el.m_nid = 100 + i;
+		el.m_lid = (i % 2 ? i : 0);
+		el.m_ntag = (i % 3 ? -i : 0);
+		el.m_tex = 0.25f * i;
+
+		for (int j = 0; j < el.Nodes(); ++j) el.m_node[j] = (i + 3 * j) % NN;
+
+		// solids store one neighbor per face, the other elements store six
+		int nf = (el.IsSolid() ? el.Faces() : 6);
+		for (int j = 0; j < nf; ++j) { el.m_nbr[j] = (i + j) % NE; el.m_face[j] = 10 * i + j; }
+
+		if (el.IsShell()) for (int j = 0; j < el.Nodes(); ++j) el.m_h[j] = 0.1 * (j + 1);
+		if (el.IsBeam()) el.m_a0 = 2.5;
+		if (i % 2 == 0) el.m_fiber = vec3d(1, i, 0);
+
+		if (i % 3 == 1)
+		{
+			mat3d Q; Q.zero();
+			Q[0][1] = 1.0; Q[1][0] = -1.0; Q[2][2] = i;
+			el.m_Q = Q;
+			el.m_Qactive = (i != 4);
+		}
+
+		if (i == 2) el.Select();
+		if (i == 5) el.Hide();
+	}
+}
+
+//-----------------------------------------------------------------------------
+inline bool sameMatrix(const mat3d& A, const mat3d& B)
+{
+	for (int i = 0; i < 3; ++i)
+		for (int j = 0; j < 3; ++j)
+			if (A[i][j] != B[i][j]) return false;
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Compares all the data of two elements
+inline bool sameElement(const FSElement& a, const FSElement& b)
+{
+	if (a.Type() != b.Type()) return false;
+	if ((a.m_MatID != b.m_MatID) || (a.m_gid != b.m_gid) || (a.m_nid != b.m_nid)) return false;
+	if ((a.m_lid != b.m_lid) || (a.m_ntag != b.m_ntag)) return false;
+	if (a.GetFEState() != b.GetFEState()) return false;
+	if (a.m_tex != b.m_tex) return false;
+
+	for (int j = 0; j < a.Nodes(); ++j) if (a.m_node[j] != b.m_node[j]) return false;
+	for (int j = 0; j < 6; ++j)
+	{
+		if (a.m_nbr[j] != b.m_nbr[j]) return false;
+		if (a.m_face[j] != b.m_face[j]) return false;
+	}
+	if (a.IsShell()) for (int j = 0; j < a.Nodes(); ++j) if (a.m_h[j] != b.m_h[j]) return false;
+
+	if ((a.m_fiber.x != b.m_fiber.x) || (a.m_fiber.y != b.m_fiber.y) || (a.m_fiber.z != b.m_fiber.z)) return false;
+	if ((a.m_Qactive != b.m_Qactive) || !sameMatrix(a.m_Q, b.m_Q)) return false;
+	if (a.m_a0 != b.m_a0) return false;
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Compares the elements of two meshes
+inline bool sameElements(const FSMesh& a, const FSMesh& b)
+{
+	if (a.Elements() != b.Elements()) return false;
+	for (int i = 0; i < a.Elements(); ++i)
+	{
+		if (sameElement(a.Element(i), b.Element(i)) == false) return false;
+	}
+	return true;
+}
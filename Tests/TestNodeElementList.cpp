@@ -0,0 +1,97 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+
+// Tests that the node-element list of a mesh is built once, also when it is requested
+// from several threads at once, and rebuilt when the mesh changes.
+#include <MeshLib/FEElementLibrary.h>
+#include "TestMeshes.h"
+#include "TestTools.h"
+
+//-----------------------------------------------------------------------------
+// returns the number of element nodes that cannot be found in the list
+static int missingRefs(const FSMesh& mesh, const FSNodeElementList& NEL)
+{
+	int nmissing = 0;
+	for (int i = 0; i < mesh.Elements(); ++i)
+	{
+		const FSElement& el = mesh.Element(i);
+		for (int j = 0; j < el.Nodes(); ++j)
+			if (NEL.HasElement(el.m_node[j], i) == false) nmissing++;
+	}
+	return nmissing;
+}
+
+//-----------------------------------------------------------------------------
+static void testParallelBuild()
+{
+	FSMesh mesh;
+	buildMixedMesh(mesh);
+
+	// the list is not built yet, so all threads ask for it at the same time
+	int nthreads = 0, nmissing = 0;
+	#pragma omp parallel num_threads(8) reduction(+:nthreads, nmissing)
+	{
+		const FSNodeElementList& NEL = mesh.NodeElementList();
+		nthreads++;
+		nmissing += missingRefs(mesh, NEL);
+	}
+	CHECK(nthreads > 0);
+	CHECK(nmissing == 0);
+	CHECK(mesh.NodeElementList().Elements() == mesh.Elements());
+}
+
+//-----------------------------------------------------------------------------
+static void testRebuild()
+{
+	FSMesh mesh;
+	buildMixedMesh(mesh);
+	CHECK(missingRefs(mesh, mesh.NodeElementList()) == 0);
+
+	// changing the connectivity and rebuilding the mesh gives a new list
+	FSElement& el = mesh.Element(0);
+	int n0 = el.m_node[0];
+	el.m_node[0] = mesh.Nodes() - 1;
+	mesh.BuildMesh();
+	const FSNodeElementList& NEL = mesh.NodeElementList();
+	CHECK(missingRefs(mesh, NEL) == 0);
+	CHECK(NEL.HasElement(n0, 0) == false);
+
+	// removing elements gives a new list
+	mesh.ResizeElems(mesh.Elements() - 1);
+	CHECK(mesh.NodeElementList().Elements() == mesh.Elements());
+	CHECK(missingRefs(mesh, mesh.NodeElementList()) == 0);
+}
+
+//-----------------------------------------------------------------------------
+int main()
+{
+	FSElementLibrary::InitLibrary();
+
+	testParallelBuild();
+	testRebuild();
+	return TEST_RESULT();
+}
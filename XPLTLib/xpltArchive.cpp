@@ -32,16 +32,10 @@ SOFTWARE.*/
 #include <zlib.h>
 #endif
 
-#ifdef WIN32
-typedef __int64 off_type;
-#endif
-
-#ifdef LINUX // same for Linux and Mac OS X
-typedef off_t off_type;
-#endif
-
-#ifdef __APPLE__ // same for Linux and Mac OS X
-typedef off_t off_type;
+#if defined(LINUX) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define XPLT_USE_MMAP
 #endif
 
 #ifdef WIN32
@@ -75,10 +69,17 @@ public:
 	unsigned int	m_nversion;	// stores the version nr of the file being loaded
 
 	// read data
-	stack<CHUNK*>	m_Chunk;
+	enum { MAX_CHUNK_DEPTH = 32 };
+	CHUNK	m_Chunk[MAX_CHUNK_DEPTH];	// chunk stack
+	int		m_nchunk;					// nr of chunks on the stack
+
+	// memory-mapped file (only used for uncompressed files)
+	char*		m_map;		// start of the mapped file
+	off_type	m_mapSize;	// size of the mapped region
 
 #ifdef HAVE_ZLIB
 	z_stream		strm;
+	unsigned char	m_zin[16384];	// input buffer for decompression
 #endif
 	char* m_buf;		// data buffer
 	void* m_pdata;	// data pointer
@@ -101,9 +102,91 @@ public:
 		m_pRoot = 0;
 		m_pChunk = 0;
 		m_bSaving = true;
+		m_nchunk = 0;
+		m_map = 0;
+		m_mapSize = 0;
 	}
+
+	// push a new chunk on the stack
+	CHUNK* PushChunk()
+	{
+		if (m_nchunk >= MAX_CHUNK_DEPTH) { assert(false); return 0; }
+		return &m_Chunk[m_nchunk++];
+	}
+
+	CHUNK* TopChunk() { assert(m_nchunk > 0); return &m_Chunk[m_nchunk - 1]; }
+
+	void MapFile();
+	void UnmapFile();
+	bool MapChunk(unsigned int& id, unsigned int& nsize);
 };
 
+// Map the file into memory. If this fails, the file is read as usual. 
+void xpltArchive::Imp::MapFile()
+{
+	UnmapFile();
+#ifdef XPLT_USE_MMAP
+	FILE* fp = m_fp->FilePtr();
+	if (fp == 0) return;
+
+	int fd = fileno(fp);
+	struct stat st;
+	if ((fstat(fd, &st) != 0) || (st.st_size <= 0)) return;
+
+	void* p = mmap(0, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (p == MAP_FAILED) return;
+
+	m_map = (char*)p;
+	m_mapSize = (off_type)st.st_size;
+#endif
+}
+
+void xpltArchive::Imp::UnmapFile()
+{
+#ifdef XPLT_USE_MMAP
+	if (m_map) munmap(m_map, (size_t)m_mapSize);
+#endif
+	m_map = 0;
+	m_mapSize = 0;
+}
+
+// Sets the data pointer to the top-level chunk at the current file position 
+// in the mapped file. Returns false if the chunk is not (entirely) mapped, 
+// in which case the file position is not changed. 
+bool xpltArchive::Imp::MapChunk(unsigned int& id, unsigned int& nsize)
+{
+#ifdef XPLT_USE_MMAP
+	if (m_map == 0) return false;
+
+	FILE* fp = m_fp->FilePtr();
+	off_type pos = ftell64(fp);
+	const off_type hsize = 2 * sizeof(unsigned int);
+	if ((pos < 0) || (pos + hsize > m_mapSize)) return false;
+
+	const char* p = m_map + pos;
+	memcpy(&id, p, sizeof(unsigned int)); if (m_bswap) bswap(id);
+	memcpy(&nsize, p + sizeof(unsigned int), sizeof(unsigned int)); if (m_bswap) bswap(nsize);
+
+	// the file may have grown since it was mapped
+	off_type end = pos + hsize + (off_type)nsize;
+	if (end > m_mapSize) return false;
+
+	// make sure the file wasn't truncated since it was mapped
+	struct stat st;
+	if ((fstat(fileno(fp), &st) != 0) || ((off_type)st.st_size < end)) return false;
+
+	// move the file pointer past the chunk, so that Tell and the file progress are correct
+	if (fseek64(fp, end, SEEK_SET) != 0) return false;
+
+	// the chunk's data is read directly from the mapped file
+	m_bufsize = nsize;
+	m_pdata = (void*)(p + hsize);
+	return true;
+#else
+	return false;
+#endif
+}
+
 xpltArchive::xpltArchive() : im(*new xpltArchive::Imp)
 {
 }
@@ -111,6 +194,7 @@ xpltArchive::xpltArchive() : im(*new xpltArchive::Imp)
 xpltArchive::~xpltArchive()
 {
 	Close();
+	delete &im;
 }
 
 void xpltArchive::AddChild(OChunk* c)
@@ -131,15 +215,12 @@ void xpltArchive::Close()
 	{
 		if (im.m_pRoot) Flush();
 	}
-	else {
-		// clear the stack
-		while (im.m_Chunk.empty() == false)
-		{
-			// pop the last chunk
-			CHUNK* pc = im.m_Chunk.top(); im.m_Chunk.pop();
-			delete pc;
-		}
-	}
+
+	// clear the stack
+	im.m_nchunk = 0;
+
+	// release the mapped file
+	im.UnmapFile();
 
 	// close the file pointer
 	im.m_fp = 0;
@@ -246,6 +327,9 @@ bool xpltArchive::Open(FileStream* fp)
 	// set the end flag to false
 	im.m_bend = false;
 
+	// map the file, so that uncompressed chunks can be read without copying
+	im.MapFile();
+
 	// initialize decompression stream
 #ifdef HAVE_ZLIB
 	im.strm.zalloc = Z_NULL;
@@ -265,70 +349,81 @@ bool xpltArchive::DecompressChunk(unsigned int& nid, unsigned int& nsize)
 	const int CHUNK = 16384;
 	nsize = -1;
 
-	int ret;
-	unsigned have;
-	static unsigned char in[CHUNK];
-	static unsigned char out[CHUNK];
+	// Note that the input buffer cannot be shared between archives since it
+	// can contain data of the next chunk when this function returns. 
+	unsigned char* in = im.m_zin;
 
 	/* allocate inflate state */
-	ret = inflateInit(&im.strm);
-	if (ret != Z_OK) return ret;
+	if (inflateInit(&im.strm) != Z_OK) return false;
+
+	// We first inflate the chunk's header (id and size), so that we know how large
+	// the buffer needs to be. The rest is then inflated directly into the buffer.
+	unsigned int hdr[2] = { 0, 0 };
+	im.strm.next_out = (Bytef*)hdr;
+	im.strm.avail_out = sizeof(hdr);
 
-	// the uncompressed buffer
-	IOMemBuffer buf;
+	char* buf = 0;
+	unsigned int bufsize = 0;
 
 	/* decompress until deflate stream ends or end of file */
+	int ret = Z_OK;
 	do {
 		if (im.strm.avail_in == 0)
 		{
 			im.strm.avail_in = im.m_fp->read(in, 1, CHUNK);
-			if (ferror(im.m_fp->FilePtr())) {
-				(void)inflateEnd(&im.strm);
-				return Z_ERRNO;
-			}
+			if (ferror(im.m_fp->FilePtr())) break;
 			if (im.strm.avail_in == 0) break;
 			im.strm.next_in = in;
 		}
 
-		/* run inflate() on input until output buffer not full */
-		do {
-			im.strm.avail_out = CHUNK;
-			im.strm.next_out = out;
-			ret = inflate(&im.strm, Z_NO_FLUSH);
-			assert(ret != Z_STREAM_ERROR);  /* state not clobbered */
-			switch (ret) {
-			case Z_NEED_DICT:
-				ret = Z_DATA_ERROR;     /* and fall through */
-			case Z_DATA_ERROR:
-			case Z_MEM_ERROR:
-				(void)inflateEnd(&im.strm);
-				return ret;
-			}
-			have = CHUNK - im.strm.avail_out;
-
-			buf.append(out, have);
+		ret = inflate(&im.strm, Z_NO_FLUSH);
+		assert(ret != Z_STREAM_ERROR);  /* state not clobbered */
+		if ((ret == Z_NEED_DICT) || (ret == Z_DATA_ERROR) || (ret == Z_MEM_ERROR)) break;
 
-		} while (im.strm.avail_out == 0);
+		if (im.strm.avail_out == 0)
+		{
+			if (buf == 0)
+			{
+				// we have the header, so we can allocate the buffer
+				nid = hdr[0]; if (im.m_bswap) bswap(nid);
+				nsize = hdr[1]; if (im.m_bswap) bswap(nsize);
+
+				bufsize = nsize;
+				buf = new char[bufsize > 0 ? bufsize : 1];
+				im.strm.next_out = (Bytef*)buf;
+				im.strm.avail_out = bufsize;
+			}
+			else if (ret != Z_STREAM_END)
+			{
+				// there is more data than the chunk size indicates
+				unsigned int newsize = 2 * bufsize + CHUNK;
+				char* tmp = new char[newsize];
+				memcpy(tmp, buf, bufsize);
+				delete[] buf;
+				buf = tmp;
+				im.strm.next_out = (Bytef*)(buf + bufsize);
+				im.strm.avail_out = newsize - bufsize;
+				bufsize = newsize;
+			}
+		}
 
 		/* done when inflate() says it's done */
 	} while (ret != Z_STREAM_END);
 
-	char* pbuf = buf.data();
-	if (pbuf)
-	{
-		memcpy(&nid, pbuf, sizeof(int)); pbuf += sizeof(int); if (im.m_bswap) bswap(nid);
-		memcpy(&nsize, pbuf, sizeof(int)); pbuf += sizeof(int); if (im.m_bswap) bswap(nsize);
+	/* clean up and return */
+	(void)inflateEnd(&im.strm);
 
-		im.m_bufsize = buf.size() - 2 * sizeof(int);
-		im.m_buf = new char[im.m_bufsize];
-		memcpy(im.m_buf, pbuf, im.m_bufsize);
-		im.m_pdata = im.m_buf;
+	if ((ret != Z_STREAM_END) || (buf == 0))
+	{
+		delete[] buf;
+		return false;
 	}
 
-	/* clean up and return */
-	(void)inflateEnd(&im.strm);
-//	return (ret == Z_STREAM_END ? Z_OK : Z_DATA_ERROR;
-	return (ret == Z_STREAM_END ? true : false);
+	im.m_buf = buf;
+	im.m_bufsize = bufsize - im.strm.avail_out;
+	im.m_pdata = im.m_buf;
+
+	return true;
 #endif
 	return false;
 }
@@ -354,8 +449,8 @@ int xpltArchive::OpenChunk()
 		return IO_END;
 	}
 
-	// see if we have a buffer allocated
-	if (im.m_buf == 0)
+	// see if this is a top-level chunk
+	if (im.m_nchunk == 0)
 	{
 		unsigned int id, nsize;
 		if (im.m_ncompress == 0)
@@ -363,30 +458,35 @@ int xpltArchive::OpenChunk()
 			// see if we have reached the end of the file
 			if (feof(im.m_fp->FilePtr()) || ferror(im.m_fp->FilePtr())) return IO_ERROR;
 
-			// get the master chunk id and size
-			int nret = im.m_fp->read(&id, sizeof(unsigned int), 1); if (nret != 1) return IO_ERROR;
-			if (im.m_bswap) bswap(id);
-			nret = im.m_fp->read(&nsize, sizeof(unsigned int), 1); if (nret != 1) return IO_ERROR;
-			if (im.m_bswap) bswap(nsize);
+			// if the file is mapped we can read the chunk directly from memory
+			if (im.MapChunk(id, nsize) == false)
+			{
+				// get the master chunk id and size
+				int nret = im.m_fp->read(&id, sizeof(unsigned int), 1); if (nret != 1) return IO_ERROR;
+				if (im.m_bswap) bswap(id);
+				nret = im.m_fp->read(&nsize, sizeof(unsigned int), 1); if (nret != 1) return IO_ERROR;
+				if (im.m_bswap) bswap(nsize);
+
+				if (nsize > 0)
+				{
+					// allocate the buffer
+					im.m_bufsize = nsize;
+					im.m_buf = new char[im.m_bufsize];
+
+					// read the buffer from file
+					int nread = im.m_fp->read(im.m_buf, sizeof(char), nsize);
+					if (nread != nsize) return IO_ERROR;
+
+					// set the data pointer
+					im.m_pdata = im.m_buf;
+				}
+			}
 
 			if (nsize == 0)
 			{
 				im.m_bend = true;
 				return IO_END;
 			}
-			else
-			{
-				// allocate the buffer
-				im.m_bufsize = nsize;
-				im.m_buf = new char[im.m_bufsize];
-
-				// read the buffer from file
-				int nread = im.m_fp->read(im.m_buf, sizeof(char), nsize);
-				if (nread != nsize) return IO_ERROR;
-
-				// set the data pointer
-				im.m_pdata = im.m_buf;
-			}
 		}
 		else
 		{
@@ -394,18 +494,18 @@ int xpltArchive::OpenChunk()
 			if (DecompressChunk(id, nsize) == false) return IO_ERROR;
 		}
 
-		// create a new chunk
-		CHUNK* pc = new CHUNK;
+		// add a new chunk to the stack
+		CHUNK* pc = im.PushChunk();
+		if (pc == 0) return IO_ERROR;
 		pc->id = id;
 		pc->nsize = nsize;
 		pc->pdata = im.m_pdata;
-		// add it to the stack
-		im.m_Chunk.push(pc);
 	}
 	else
 	{
-		// create a new chunk
-		CHUNK* pc = new CHUNK;
+		// add a new chunk to the stack
+		CHUNK* pc = im.PushChunk();
+		if (pc == 0) return IO_ERROR;
 
 		// read the chunk ID
 		if (read(pc->id) == IO_ERROR) return IO_ERROR;
@@ -416,18 +516,132 @@ int xpltArchive::OpenChunk()
 
 		// store the data pointer
 		pc->pdata = im.m_pdata;
+	}
+
+	return IO_OK;
+}
+
+int xpltArchive::PeekChunk(unsigned int nid, unsigned int nmax)
+{
+	// this only works for uncompressed top-level chunks
+	// (If the file is mapped, reading the chunk doesn't cost anything.)
+	if ((im.m_ncompress != 0) || (im.m_nchunk != 0) || im.m_map) return OpenChunk();
+
+	// see if the end flag was set
+	if (im.m_bend)
+	{
+		im.m_bend = false;
+		return IO_END;
+	}
 
-		// add it to the stack
-		im.m_Chunk.push(pc);
+	FILE* fp = im.m_fp->FilePtr();
+	if (feof(fp) || ferror(fp)) return IO_ERROR;
+
+	// get the master chunk id and size
+	unsigned int id, nsize;
+	int nret = im.m_fp->read(&id, sizeof(unsigned int), 1); if (nret != 1) return IO_ERROR;
+	if (im.m_bswap) bswap(id);
+	nret = im.m_fp->read(&nsize, sizeof(unsigned int), 1); if (nret != 1) return IO_ERROR;
+	if (im.m_bswap) bswap(nsize);
+
+	if (nsize == 0)
+	{
+		im.m_bend = true;
+		return IO_END;
 	}
 
+	// only read the first part of the chunk (if it's the chunk we're looking for)
+	unsigned int nread = nsize;
+	if ((id == nid) && (nmax < nsize)) nread = nmax;
+	im.m_bufsize = nread;
+	im.m_buf = new char[im.m_bufsize];
+	if (im.m_fp->read(im.m_buf, sizeof(char), nread) != nread) return IO_ERROR;
+	im.m_pdata = im.m_buf;
+
+	// skip the rest
+	if (nread < nsize)
+	{
+		if (fseek64(fp, (off_type)(nsize - nread), SEEK_CUR) != 0) return IO_ERROR;
+	}
+
+	// add a new chunk to the stack
+	CHUNK* pc = im.PushChunk();
+	if (pc == 0) return IO_ERROR;
+	pc->id = id;
+	pc->nsize = nsize;
+	pc->pdata = im.m_pdata;
+
 	return IO_OK;
 }
 
+off_type xpltArchive::Tell()
+{
+	off_type pos = ftell64(im.m_fp->FilePtr());
+#ifdef HAVE_ZLIB
+	// the decompression buffer may already contain data of the next chunk
+	if (im.m_ncompress != 0) pos -= (off_type) im.strm.avail_in;
+#endif
+	return pos;
+}
+
+bool xpltArchive::Seek(off_type pos)
+{
+	// clear the chunk stack
+	im.m_nchunk = 0;
+
+	// delete the buffer
+	if (im.m_buf) delete[] im.m_buf;
+	im.m_buf = 0;
+	im.m_pdata = 0;
+	im.m_bufsize = 0;
+	im.m_bend = false;
+
+#ifdef HAVE_ZLIB
+	// discard any data in the decompression buffer
+	im.strm.avail_in = 0;
+	im.strm.next_in = Z_NULL;
+#endif
+
+	FILE* fp = im.m_fp->FilePtr();
+	clearerr(fp);
+	return (fseek64(fp, pos, SEEK_SET) == 0);
+}
+
+bool xpltArchive::MoveChunk(xpltArchive& ar)
+{
+	// only a top-level chunk that was just opened can be moved
+	if ((im.m_nchunk != 1) || (&ar == this)) return false;
+
+	// clear the destination
+	Imp& dst = ar.im;
+	if (dst.m_buf) delete[] dst.m_buf;
+	dst.m_bswap = im.m_bswap;
+	dst.m_nversion = im.m_nversion;
+	dst.m_ncompress = im.m_ncompress;
+
+	// move the chunk and its data
+	dst.m_buf = im.m_buf;
+	dst.m_pdata = im.m_pdata;
+	dst.m_bufsize = im.m_bufsize;
+	dst.m_Chunk[0] = im.m_Chunk[0];
+	dst.m_nchunk = 1;
+	dst.m_bend = false;
+
+	// the chunk is now closed in this archive
+	im.m_buf = 0;
+	im.m_pdata = 0;
+	im.m_bufsize = 0;
+	im.m_nchunk = 0;
+	im.m_bend = true;
+
+	return true;
+}
+
 void xpltArchive::CloseChunk()
 {
 	// pop the last chunk
-	CHUNK* pc = im.m_Chunk.top(); im.m_Chunk.pop();
+	if (im.m_nchunk == 0) { assert(false); return; }
+	CHUNK* pc = &im.m_Chunk[--im.m_nchunk];
 
 	// calculate the offset to the end of the chunk
 	off_type noff = pc->nsize - ((char*)im.m_pdata - (char*)pc->pdata);
@@ -436,11 +650,8 @@ void xpltArchive::CloseChunk()
 	// I wonder if this can really happen
 	if (noff != 0) im.m_pdata = (char*)im.m_pdata + noff;
 
-	// delete this chunk
-	delete pc;
-
 	// take a peek at the parent
-	if (im.m_Chunk.empty())
+	if (im.m_nchunk == 0)
 	{
 		// we just deleted the master chunk
 		im.m_bend = true;
@@ -453,7 +664,7 @@ void xpltArchive::CloseChunk()
 	}
 	else
 	{
-		pc = im.m_Chunk.top();
+		pc = im.TopChunk();
 		off_type noff = pc->nsize - ((char*)im.m_pdata - (char*)pc->pdata);
 		if (noff == 0) im.m_bend = true;
 	}
@@ -461,16 +672,12 @@ void xpltArchive::CloseChunk()
 
 unsigned int xpltArchive::GetChunkID()
 {
-	CHUNK* pc = im.m_Chunk.top();
-	assert(pc);
-	return pc->id;
+	return im.TopChunk()->id;
 }
 
 unsigned int xpltArchive::GetChunkSize()
 {
-	CHUNK* pc = im.m_Chunk.top();
-	assert(pc);
-	return pc->nsize;
+	return im.TopChunk()->nsize;
 }
 
 xpltArchive::IOResult xpltArchive::read(char& c) { mread(&c, sizeof(char), 1, &im.m_pdata); return IO_OK; }
@@ -30,6 +30,19 @@ SOFTWARE.*/
 #include <vector>
 #include <FSCore/math3d.h>
 #include <FSCore/Archive.h>
+#include <sys/types.h>
+
+#ifdef WIN32
+typedef __int64 off_type;
+#endif
+
+#ifdef LINUX // same for Linux and Mac OS X
+typedef off_t off_type;
+#endif
+
+#ifdef __APPLE__ // same for Linux and Mac OS X
+typedef off_t off_type;
+#endif
 
 //-----------------------------------------------------------------------------
 // Input archive
@@ -111,6 +124,24 @@ public: // reading
 	// Open a chunk
 	int OpenChunk();
 
+	// Open a top-level chunk, but if its ID is nid, only read (at most) the first 
+	// nmax bytes of it and skip the rest. Reading past the first nmax bytes is 
+	// not allowed. For compressed files, the entire chunk is always read. 
+	int PeekChunk(unsigned int nid, unsigned int nmax);
+
+	// Move the top-level chunk that was just opened to another archive, which can 
+	// then be used to read the chunk (e.g. on another thread). The chunk is closed
+	// in this archive. For memory-mapped files, the data still refers to the mapped
+	// file, so this archive must not be closed until the chunk is read. 
+	bool MoveChunk(xpltArchive& ar);
+
+	// Get the file position of the next top-level chunk
+	off_type Tell();
+
+	// Move the file position to the start of a top-level chunk
+	// (The position must have been obtained by Tell.)
+	bool Seek(off_type pos);
+
 	// Get the current chunk ID
 	unsigned int GetChunkID();
 
@@ -146,6 +177,12 @@ public: // reading
 	IOResult read(tens4fs& a) { return read(&(a.d[0]), 21); }
 	IOResult read(mat3f&   a) { return read(&(a.d[0][0]), 9); }
 
+	IOResult read(vec3f*   pv, int n) { return read(&(pv[0].x), 3*n); }
+	IOResult read(mat3fs*  pv, int n) { return read(&(pv[0].x), 6*n); }
+	IOResult read(mat3fd*  pv, int n) { return read(&(pv[0].x), 3*n); }
+	IOResult read(tens4fs* pv, int n) { return read(&(pv[0].d[0]), 21*n); }
+	IOResult read(mat3f*   pv, int n) { return read(&(pv[0].d[0][0]), 9*n); }
+
 	IOResult read(std::vector<int    >& a) { return read(&a[0], (int) a.size()); }
 	IOResult read(std::vector<float  >& a) { return read(&a[0], (int) a.size()); }
 	IOResult read(std::vector<vec3f  >& a) { return read(&(a[0].x), 3*(int) a.size()); }
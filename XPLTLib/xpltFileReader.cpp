@@ -35,13 +35,22 @@ xpltParser::xpltParser(xpltFileReader* xplt) : m_xplt(xplt), m_ar(xplt->GetArchi
 {
 }
 
+// parser that reads from a different archive than the file reader's
+xpltParser::xpltParser(xpltFileReader* xplt, xpltArchive& ar) : m_xplt(xplt), m_ar(ar)
+{
+}
+
 xpltParser::~xpltParser()
 {
 }
 
 bool xpltParser::errf(const char* szerr)
 {
-	return m_xplt->errf(szerr);
+	// parsers can run on multiple threads when reading states
+	bool b = false;
+#pragma omp critical (xplt_errf)
+	b = m_xplt->errf(szerr);
+	return b;
 }
 
 void xpltParser::addWarning(int n)
@@ -51,24 +60,63 @@ void xpltParser::addWarning(int n)
 	m_wrng.push_back(n); 
 }
 
+//-----------------------------------------------------------------------------
+// The state loader owns a reader that keeps the file open, so that the state
+// data can be read when the model needs it. 
+class xpltStateLoader : public Post::FEStateLoader
+{
+public:
+	xpltStateLoader(Post::FEPostModel* fem) : m_reader(fem) {}
+
+	bool LoadState(Post::FEState* ps) override { return m_reader.LoadState(ps); }
+
+	size_t StateSize(Post::FEState* ps) override { return m_reader.StateSize(ps); }
+
+	xpltFileReader& GetReader() { return m_reader; }
+
+private:
+	xpltFileReader	m_reader;
+};
+
+//-----------------------------------------------------------------------------
 xpltFileReader::xpltFileReader(Post::FEPostModel* fem) : FEFileReader(fem)
 {
 	m_xplt = 0;
+	m_fs = 0;
 	m_read_state_flag = XPLT_READ_ALL_STATES;
+	m_blazy = false;
+	m_memBudget = 0;
+	m_bindex = false;
+	m_indexReader = nullptr;
 }
 
 xpltFileReader::~xpltFileReader()
 {
+	m_ar.Close();
+	delete m_fs;
+	delete m_xplt;
+}
+
+float xpltFileReader::GetFileProgress() const
+{
+	if (m_indexReader) return m_indexReader->GetFileProgress();
+	return FEFileReader::GetFileProgress();
 }
 
 bool xpltFileReader::Load(const char* szfile)
 {
+	// For on-demand loading, the file is read by the reader of a state loader
+	// which stays alive as long as the model needs it.
+	if (m_blazy && !m_bindex && (m_read_state_flag == XPLT_READ_ALL_STATES))
+		return LoadStateIndex(szfile);
+
 	// open the file
 	if (Open(szfile, "rb") == false) return errf("Failed opening file.");
 
 	// attach the file to the archive
-	FileStream fs(m_fp, false);
-	if (m_ar.Open(&fs) == false) return errf("This is not a valid XPLT file.");
+	if (m_fs) { m_ar.Close(); delete m_fs; }
+	m_fs = new FileStream(m_fp, false);
+	if (m_ar.Open(m_fs) == false) return errf("This is not a valid XPLT file.");
 
 	// open the root chunk (no compression for this sectio)
 	m_ar.SetCompression(0);
@@ -103,9 +151,13 @@ bool xpltFileReader::Load(const char* szfile)
 	// load the rest of the file
 	bool bret = m_xplt->Load(*m_fem);
 
-	// clean up
-	m_ar.Close();
-	Close();
+	// clean up (unless we need the file for loading states)
+	if ((m_bindex == false) || (bret == false) || (m_xplt->HasStateIndex() == false))
+	{
+		m_ar.Close();
+		delete m_fs; m_fs = 0;
+		Close();
+	}
 
 	if (m_xplt->warnings() > 0)
 	{
@@ -126,6 +178,47 @@ bool xpltFileReader::Load(const char* szfile)
 }
 
 
+//-----------------------------------------------------------------------------
+// Reads the mesh and builds an index of the states. If the file does not support
+// this, the states are read as usual.
+bool xpltFileReader::LoadStateIndex(const char* szfile)
+{
+	SetFileName(szfile);
+
+	xpltStateLoader* loader = new xpltStateLoader(m_fem);
+	xpltFileReader& reader = loader->GetReader();
+	reader.m_bindex = true;
+
+	m_indexReader = &reader;
+	bool bret = reader.Load(szfile);
+	m_indexReader = nullptr;
+
+	m_hdr = reader.m_hdr;
+	if (reader.Errors() > 0) errf("%s", reader.GetErrorMessage().c_str());
+
+	if (bret && reader.m_xplt && reader.m_xplt->HasStateIndex())
+	{
+		m_fem->SetStateLoader(loader);
+		m_fem->SetStateMemoryBudget(m_memBudget);
+	}
+	else delete loader;
+
+	return bret;
+}
+
+//-----------------------------------------------------------------------------
+bool xpltFileReader::LoadState(Post::FEState* ps)
+{
+	if ((m_xplt == nullptr) || (m_fs == nullptr)) return false;
+	return m_xplt->LoadState(*m_fem, ps);
+}
+
+//-----------------------------------------------------------------------------
+size_t xpltFileReader::StateSize(Post::FEState* ps)
+{
+	return (m_xplt ? m_xplt->StateSize(ps) : 0);
+}
+
 //-----------------------------------------------------------------------------
 bool xpltFileReader::ReadHeader()
 {
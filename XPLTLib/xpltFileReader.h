@@ -40,6 +40,10 @@ enum XPLT_READ_WARNING {
 	XPLT_READ_DUPLICATE_FACES			// warning issued when surface values are overwritten
 };
 
+namespace Post {
+	class FEState;
+}
+
 class xpltParser;
 
 class xpltFileReader;
@@ -48,10 +52,17 @@ class xpltParser
 {
 public:
 	xpltParser(xpltFileReader* xplt);
+	xpltParser(xpltFileReader* xplt, xpltArchive& ar);
 	virtual ~xpltParser();
 
 	virtual bool Load(Post::FEPostModel& fem) = 0;
 
+	// on-demand loading of states. This is only supported by parsers that can
+	// build a state index (i.e. when HasStateIndex returns true).
+	virtual bool HasStateIndex() const { return false; }
+	virtual bool LoadState(Post::FEPostModel& fem, Post::FEState* ps) { return false; }
+	virtual size_t StateSize(Post::FEState* ps) { return 0; }
+
 	bool errf(const char* sz);
 
 	void addWarning(int n);
@@ -108,6 +119,24 @@ public:
 	int GetReadStateFlag() const { return m_read_state_flag; }
 	std::vector<int> GetReadStates() const { return m_state_list; }
 
+	// When set, only an index of the states is built when the file is read and
+	// the state data is loaded when the state is needed. This is only supported
+	// for XPLT 3.0 files and when all states are read. 
+	void SetLazyStateLoading(bool b) { m_blazy = b; }
+	bool GetLazyStateLoading() const { return m_blazy; }
+
+	// set the max memory (in bytes) the states can use when loaded on demand (0 = no limit)
+	void SetStateMemoryBudget(size_t bytes) { m_memBudget = bytes; }
+
+	float GetFileProgress() const override;
+
+public:
+	// load the data of a state from the state index
+	bool LoadState(Post::FEState* ps);
+
+	// size of the state's data in the file
+	size_t StateSize(Post::FEState* ps);
+
 public:
 	xpltArchive& GetArchive() { return m_ar; }
 
@@ -115,14 +144,25 @@ public:
 
 	const char* GetUnits() const { return (m_hdr.units[0] ? m_hdr.units : nullptr); }
 
+	// see if the parser only needs to build an index of the states
+	bool IsIndexingStates() const { return m_bindex; }
+
 protected:
 	bool ReadHeader();
 
+	bool LoadStateIndex(const char* szfile);
+
 private:
 	xpltParser*		m_xplt;
 	xpltArchive		m_ar;
+	FileStream*		m_fs;
 	HEADER			m_hdr;
 
+	bool			m_blazy;		//!< load states on demand
+	size_t			m_memBudget;	//!< memory budget for states loaded on demand
+	bool			m_bindex;		//!< only build the state index and keep the file open
+	xpltFileReader*	m_indexReader;	//!< the reader that builds the state index (only while loading)
+
 	// Options
 	int			m_read_state_flag;	//!< flag setting option for reading states
 	std::vector<int>	m_state_list;		//!< list of states to read (only when m_read_state_flag == XPLT_READ_STATES_FROM_LIST)
@@ -32,6 +32,10 @@ SOFTWARE.*/
 #include <PostLib/FEPostMesh.h>
 #include <PostLib/FEPostModel.h>
 #include <PostLib/FEMeshData_T.h>
+#include <algorithm>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 using namespace Post;
 using namespace std;
@@ -126,6 +130,28 @@ XpltReader3::XpltReader3(xpltFileReader* xplt) : xpltParser(xplt)
 {
 	m_pstate = 0;
 	m_mesh = 0;
+	m_nxmesh = -1;
+}
+
+//-----------------------------------------------------------------------------
+// Creates a parser that reads state sections from the archive ar, using the 
+// dictionary and mesh of the parser p. (Used for reading states in parallel.)
+XpltReader3::XpltReader3(XpltReader3* p, xpltArchive& ar) : xpltParser(p->m_xplt, ar)
+{
+	m_dic = p->m_dic;
+	m_xmesh = p->m_xmesh;
+	m_nxmesh = -1;
+
+	m_bHasDispl = p->m_bHasDispl;
+	m_bHasStress = p->m_bHasStress;
+	m_bHasNodalStress = p->m_bHasNodalStress;
+	m_bHasShellThickness = p->m_bHasShellThickness;
+	m_bHasFluidPressure = p->m_bHasFluidPressure;
+	m_bHasElasticity = p->m_bHasElasticity;
+	m_nel = p->m_nel;
+
+	m_pstate = 0;
+	m_mesh = p->m_mesh;
 }
 
 XpltReader3::~XpltReader3()
@@ -145,6 +171,9 @@ void XpltReader3::Clear()
 	m_bHasElasticity = false;
 	m_nel = 0;
 	m_pstate = 0;
+	m_stateIndex.clear();
+	m_xmeshList.clear();
+	m_nxmesh = -1;
 }
 
 //-----------------------------------------------------------------------------
@@ -167,12 +196,16 @@ bool XpltReader3::Load(FEPostModel& fem)
 	// clear the state data
 	fem.ClearStates();
 
+	// see if we only need to build a state index
+	bool bindex = m_xplt->IsIndexingStates();
+
 	// read the first Mesh section
 	if (m_ar.OpenChunk() == xpltArchive::IO_OK)
 	{
 		if (m_ar.GetChunkID() != PLT_MESH) return errf("Error while reading mesh section");
 		if (ReadMesh(fem) == false) return false;
 		m_ar.CloseChunk();
+		if (bindex) { m_xmeshList.push_back(m_xmesh); m_nxmesh = 0; }
 	}
 	else return errf("Error while reading mesh section");
 
@@ -183,13 +216,30 @@ bool XpltReader3::Load(FEPostModel& fem)
 	const xpltFileReader::HEADER& hdr = m_xplt->GetHeader();
 	m_ar.SetCompression(hdr.ncompression);
 	int read_state_flag = m_xplt->GetReadStateFlag();
+
+	// see if we can decode the states in parallel
+	if (!bindex && (hdr.ncompression != 0) && (read_state_flag != XPLT_READ_LAST_STATE_ONLY) && CanReadStatesParallel())
+	{
+		bool bret = ReadStatesParallel(fem);
+		Clear();
+		return bret;
+	}
+
 	int nstate = 0;
 	try{
 		while (true)
 		{
-			if (m_ar.OpenChunk() != xpltArchive::IO_OK) break;
+			// When building the index, we don't need to read the state data
+			// (For compressed files, the state needs to be decompressed anyway.)
+			off_type pos = m_ar.Tell();
+			int nret = (bindex ? m_ar.PeekChunk(PLT_STATE, STATE_PEEK_SIZE) : m_ar.OpenChunk());
+			if (nret != xpltArchive::IO_OK) break;
 
-			if (m_ar.GetChunkID() == PLT_STATE)
+			if (bindex && (m_ar.GetChunkID() == PLT_STATE))
+			{
+				if (IndexStateSection(fem, pos) == false) break;
+			}
+			else if (m_ar.GetChunkID() == PLT_STATE)
 			{
 				if (m_pstate) { delete m_pstate; m_pstate = 0; }
 				if (ReadStateSection(fem) == false) break;
@@ -220,6 +270,7 @@ bool XpltReader3::Load(FEPostModel& fem)
 			else if (m_ar.GetChunkID() == PLT_MESH)
 			{
 				if (ReadMesh(fem) == false) return errf("Error while reading mesh section.");
+				if (bindex) { m_xmeshList.push_back(m_xmesh); m_nxmesh = (int)m_xmeshList.size() - 1; }
 			}
 			else errf("Error while reading state data.");
 			m_ar.CloseChunk();
@@ -240,11 +291,296 @@ bool XpltReader3::Load(FEPostModel& fem)
 		errf("An unknown exception has occurred.\nNot all data was read in.");
 	}
 
-	Clear();
+	// we need to hang on to the dictionary and mesh data if states need to be loaded later
+	if (bindex && HasStateIndex())
+	{
+		// if there is only one mesh, we don't need the list
+		if (m_xmeshList.size() == 1) m_xmeshList.clear();
+	}
+	else Clear();
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+bool XpltReader3::CanReadStatesParallel() const
+{
+#ifdef _OPENMP
+	return (omp_get_max_threads() > 1);
+#else
+	return false;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// Compressed states have to be decompressed one after another, since the file 
+// does not store the compressed size of a state. However, the decompressed states
+// can be decoded in parallel. The states are read in batches: the states of a batch
+// are decompressed first, then decoded in parallel, and then added to the model in 
+// the order they appear in the file.
+bool XpltReader3::ReadStatesParallel(FEPostModel& fem)
+{
+#ifdef _OPENMP
+	int nthreads = omp_get_max_threads();
+	int batchSize = 2 * nthreads;
+
+	// each thread needs its own parser and archive
+	vector<xpltArchive*> threadAr(nthreads);
+	vector<XpltReader3*> parsers(nthreads);
+	for (int i = 0; i < nthreads; ++i)
+	{
+		threadAr[i] = new xpltArchive;
+		parsers[i] = new XpltReader3(this, *threadAr[i]);
+	}
+
+	// archives holding the (decompressed) states of a batch
+	vector<xpltArchive*> batch(batchSize);
+	vector<int> stateIndex(batchSize, -1);
+	for (int i = 0; i < batchSize; ++i) batch[i] = new xpltArchive;
+
+	bool bret = true;
+	bool bok = true;
+	int nstate = 0;
+	int nslots = 0;
+	try {
+		while (bok)
+		{
+			if (m_ar.OpenChunk() != xpltArchive::IO_OK) break;
+
+			if (m_ar.GetChunkID() == PLT_STATE)
+			{
+				// move the state's data, so it can be decoded later
+				stateIndex[nslots] = nstate;
+				m_ar.MoveChunk(*batch[nslots++]);
+				if (nslots == batchSize)
+				{
+					bok = DecodeStateBatch(fem, batch, stateIndex, nslots, parsers);
+					nslots = 0;
+				}
+			}
+			else if (m_ar.GetChunkID() == PLT_MESH)
+			{
+				// the states that refer to the previous mesh must be added first
+				if (nslots > 0)
+				{
+					bok = DecodeStateBatch(fem, batch, stateIndex, nslots, parsers);
+					nslots = 0;
+				}
+
+				if (ReadMesh(fem) == false) { bret = errf("Error while reading mesh section."); break; }
+				for (int i = 0; i < nthreads; ++i)
+				{
+					parsers[i]->m_xmesh = m_xmesh;
+					parsers[i]->m_mesh = m_mesh;
+				}
+				m_ar.CloseChunk();
+			}
+			else
+			{
+				errf("Error while reading state data.");
+				m_ar.CloseChunk();
+			}
+
+			// clear end-flag
+			if (m_ar.OpenChunk() != xpltArchive::IO_END) break;
+
+			++nstate;
+		}
+
+		// decode the remaining states
+		if (bok && (nslots > 0)) DecodeStateBatch(fem, batch, stateIndex, nslots, parsers);
+	}
+	catch (...)
+	{
+		errf("An unknown exception has occurred.\nNot all data was read in.");
+	}
+
+	// collect the warnings
+	for (int i = 0; i < nthreads; ++i)
+	{
+		XpltReader3* p = parsers[i];
+		for (int j = 0; j < p->warnings(); ++j) addWarning(p->warning(j));
+	}
+
+	// clean up
+	for (int i = 0; i < nthreads; ++i) { delete parsers[i]; delete threadAr[i]; }
+	for (int i = 0; i < batchSize; ++i) delete batch[i];
+
+	return bret;
+#else
+	return false;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// Decode the states of a batch in parallel and add them to the model. Returns 
+// false if a state could not be read, in which case this state and all the states
+// after it are not added. 
+bool XpltReader3::DecodeStateBatch(FEPostModel& fem, vector<xpltArchive*>& batch, vector<int>& stateIndex, int nstates, vector<XpltReader3*>& parsers)
+{
+	vector<FEState*> states(nstates, nullptr);
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+	for (int i = 0; i < nstates; ++i)
+	{
+		XpltReader3* p = parsers[omp_get_thread_num()];
+		batch[i]->MoveChunk(p->m_ar);
+		states[i] = p->DecodeState(fem);
+	}
+#endif
+
+	// add the states in order
+	bool bok = true;
+	for (int i = 0; i < nstates; ++i)
+	{
+		FEState* ps = states[i];
+		if (ps == nullptr) bok = false;
+
+		if (bok && AcceptState(ps, stateIndex[i])) fem.AddState(ps);
+		else delete ps;
+	}
+
+	return bok;
+}
+
+//-----------------------------------------------------------------------------
+// Read the state section that was moved to this parser's archive
+FEState* XpltReader3::DecodeState(FEPostModel& fem)
+{
+	FEState* ps = nullptr;
+	try {
+		if (ReadStateSection(fem))
+		{
+			ps = m_pstate;
+			m_ar.CloseChunk();
+		}
+		else delete m_pstate;
+	}
+	catch (...)
+	{
+		delete m_pstate;
+		ps = nullptr;
+		errf("An unknown exception has occurred.\nNot all data was read in.");
+	}
+	m_pstate = 0;
+	return ps;
+}
+
+//-----------------------------------------------------------------------------
+// see if a state needs to be added to the model
+bool XpltReader3::AcceptState(FEState* ps, int nstate)
+{
+	switch (m_xplt->GetReadStateFlag())
+	{
+	case XPLT_READ_ALL_STATES: return true;
+	case XPLT_READ_ALL_CONVERGED_STATES: return (ps->m_status == 0);
+	case XPLT_READ_STATES_FROM_LIST:
+	{
+		vector<int> state_list = m_xplt->GetReadStates();
+		return (std::find(state_list.begin(), state_list.end(), nstate) != state_list.end());
+	}
+	}
+	return false;
+}
+
+//-----------------------------------------------------------------------------
+// Add a state to the model, but only read the state's header. The data is 
+// read later by LoadState.
+bool XpltReader3::IndexStateSection(FEPostModel& fem, off_type pos)
+{
+	FEState* ps = nullptr;
+	try
+	{
+		ps = new FEState(0.f, &fem, GetCurrentMesh(), false);
+	}
+	catch (...)
+	{
+		return errf("Error allocating memory for state data");
+	}
+
+	if (ReadStateHeader(ps) == false)
+	{
+		delete ps;
+		return false;
+	}
+
+	STATE_INDEX si;
+	si.pos = pos;
+	si.nsize = m_ar.GetChunkSize();
+	si.nmesh = m_nxmesh;
+	m_stateIndex[ps] = si;
+
+	fem.AddState(ps);
 
 	return true;
 }
 
+//-----------------------------------------------------------------------------
+// Read the state header, which must be the first chunk of the state section.
+bool XpltReader3::ReadStateHeader(FEState* ps)
+{
+	if (m_ar.OpenChunk() != xpltArchive::IO_OK) return errf("Error while reading state header");
+	if (m_ar.GetChunkID() != PLT_STATE_HEADER) return errf("Error while reading state header");
+
+	// for uncompressed files, only part of the state section was read
+	if ((m_ar.GetCompression() == 0) && (m_ar.GetChunkSize() + 16 > STATE_PEEK_SIZE)) return errf("Error while reading state header");
+
+	while (m_ar.OpenChunk() == xpltArchive::IO_OK)
+	{
+		int nid = m_ar.GetChunkID();
+		if (nid == PLT_STATE_HDR_TIME) m_ar.read(ps->m_time);
+		if (nid == PLT_STATE_STATUS  ) m_ar.read(ps->m_status);
+		m_ar.CloseChunk();
+	}
+	m_ar.CloseChunk();
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Read the data of a state that was indexed.
+bool XpltReader3::LoadState(FEPostModel& fem, FEState* ps)
+{
+	std::map<FEState*, STATE_INDEX>::iterator it = m_stateIndex.find(ps);
+	if (it == m_stateIndex.end()) return false;
+	const STATE_INDEX& si = it->second;
+
+	// make sure we read the data for the mesh of this state
+	m_mesh = ps->GetFEMesh();
+	if (si.nmesh != m_nxmesh)
+	{
+		m_xmesh = m_xmeshList[si.nmesh];
+		m_nxmesh = si.nmesh;
+	}
+
+	// find the state section
+	if (m_ar.Seek(si.pos) == false) return errf("Failed reading state data");
+	if (m_ar.OpenChunk() != xpltArchive::IO_OK) return errf("Failed reading state data");
+	if (m_ar.GetChunkID() != PLT_STATE) return errf("Failed reading state data");
+
+	bool bret = false;
+	try {
+		m_pstate = ps;
+		bret = ReadStateData(fem, ps);
+		if (bret) m_ar.CloseChunk();
+	}
+	catch (...)
+	{
+		errf("An unknown exception has occurred.\nNot all data was read in.");
+	}
+	m_pstate = 0;
+
+	return bret;
+}
+
+//-----------------------------------------------------------------------------
+size_t XpltReader3::StateSize(FEState* ps)
+{
+	std::map<FEState*, STATE_INDEX>::iterator it = m_stateIndex.find(ps);
+	return (it != m_stateIndex.end() ? (size_t) it->second.nsize : 0);
+}
+
 //-----------------------------------------------------------------------------
 bool XpltReader3::ReadRootSection(FEPostModel& fem)
 {
@@ -1343,6 +1679,15 @@ bool XpltReader3::ReadStateSection(FEPostModel& fem)
 		return errf("Error allocating memory for state data");
 	}
 
+	return ReadStateData(fem, ps);
+}
+
+//-----------------------------------------------------------------------------
+bool XpltReader3::ReadStateData(FEPostModel& fem, FEState* ps)
+{
+	// get the mesh
+	Post::FEPostMesh& mesh = *GetCurrentMesh();
+
 	while (m_ar.OpenChunk() == xpltArchive::IO_OK)
 	{
 		int nid = m_ar.GetChunkID();
@@ -1459,7 +1804,7 @@ bool XpltReader3::ReadStateSection(FEPostModel& fem)
 
 								assert((nv >= 0) && (nv < po->m_data.size()));
 
-								ObjectData* pd = m_pstate->m_objPt[objId].data;
+								ObjectData* pd = ps->m_objPt[objId].data;
 
 								switch (po->m_data[nv]->Type())
 								{
@@ -1518,7 +1863,7 @@ bool XpltReader3::ReadStateSection(FEPostModel& fem)
 
 								assert((nv >= 0) && (nv < po->m_data.size()));
 
-								ObjectData* pd = m_pstate->m_objLn[objId].data;
+								ObjectData* pd = ps->m_objLn[objId].data;
 
 								switch (po->m_data[nv]->Type())
 								{
@@ -1604,42 +1949,31 @@ bool XpltReader3::ReadNodeData(FEPostModel& fem, FEState* pstate)
 						int ns = m_ar.GetChunkID();
 						assert(ns == 0);
 
+						// the data is read directly into the node data
 						if (it.ntype == FLOAT)
 						{
-							vector<float> a(NN);
-							m_ar.read(a);
-
 							Post::FENodeData<float>& df = dynamic_cast<Post::FENodeData<float>&>(pstate->m_Data[nfield]);
-							for (int j=0; j<NN; ++j) df[j] = a[j];
+							if (NN > 0) m_ar.read(&df[0], NN);
 						}
 						else if (it.ntype == VEC3F)
 						{
-							vector<vec3f> a(NN);
-							m_ar.read(a);
-
 							Post::FENodeData<vec3f>& dv = dynamic_cast<Post::FENodeData<vec3f>&>(pstate->m_Data[nfield]);
-							for (int j=0; j<NN; ++j) dv[j] = a[j];
+							if (NN > 0) m_ar.read(&dv[0], NN);
 						}
 						else if (it.ntype == MAT3FS)
 						{
-							vector<mat3fs> a(NN);
-							m_ar.read(a);
 							Post::FENodeData<mat3fs>& dv = dynamic_cast<Post::FENodeData<mat3fs>&>(pstate->m_Data[nfield]);
-							for (int j=0; j<NN; ++j) dv[j] = a[j];
+							if (NN > 0) m_ar.read(&dv[0], NN);
 						}
 						else if (it.ntype == TENS4FS)
 						{
-							vector<tens4fs> a(NN);
-							m_ar.read(a);
 							Post::FENodeData<tens4fs>& dv = dynamic_cast<Post::FENodeData<tens4fs>&>(pstate->m_Data[nfield]);
-							for (int j=0; j<NN; ++j) dv[j] = a[j];
+							if (NN > 0) m_ar.read(&dv[0], NN);
 						}
 						else if (it.ntype == MAT3F)
 						{
-							vector<mat3f> a(NN);
-							m_ar.read(a);
 							Post::FENodeData<mat3f>& dv = dynamic_cast<Post::FENodeData<mat3f>&>(pstate->m_Data[nfield]);
-							for (int j=0; j<NN; ++j) dv[j] = a[j];
+							if (NN > 0) m_ar.read(&dv[0], NN);
 						}
 						else if (it.ntype == ARRAY)
 						{
@@ -1782,15 +2116,16 @@ bool XpltReader3::ReadElemData_NODE(Post::FEPostMesh& m, XpltReader3::Domain &d,
 	int i, j;
 
 	// set nodal tags to local node number
+	// (we don't use the mesh' node tags, since states can be read in parallel)
 	int NN = m.Nodes();
-	for (i=0; i<NN; ++i) m.Node(i).m_ntag = -1;
+	vector<int> tag(NN, -1);
 
 	int n = 0;
 	for (i=0; i<d.ne; ++i)
 	{
 		ELEM& e = d.elem[i];
 		for (j=0; j<ne; ++j)
-			if (m.Node(e.node[j]).m_ntag == -1) m.Node(e.node[j]).m_ntag = n++;
+			if (tag[e.node[j]] == -1) tag[e.node[j]] = n++;
 	}
 
 	// create the element list
@@ -1802,7 +2137,7 @@ bool XpltReader3::ReadElemData_NODE(Post::FEPostMesh& m, XpltReader3::Domain &d,
 	for (i=0; i<d.ne; ++i)
 	{
 		ELEM& e = d.elem[i];
-		for (j=0; j<ne; ++j) l[ne*i+j] = m.Node(e.node[j]).m_ntag;
+		for (j=0; j<ne; ++j) l[ne*i+j] = tag[e.node[j]];
 	}
 
 	// get the data
@@ -2316,8 +2651,9 @@ bool XpltReader3::ReadFaceData_ITEM(XpltReader3::Surface &s, Post::FEMeshData &d
 bool XpltReader3::ReadFaceData_NODE(Post::FEPostMesh& m, XpltReader3::Surface &s, Post::FEMeshData &data, int ntype)
 {
 	// set nodal tags to local node number
+	// (we don't use the mesh' node tags, since states can be read in parallel)
 	int NN = m.Nodes();
-	for (int i = 0; i<NN; ++i) m.Node(i).m_ntag = -1;
+	vector<int> tag(NN, -1);
 
 	int n = 0;
 	for (int i = 0; i<s.nfaces; ++i)
@@ -2325,7 +2661,7 @@ bool XpltReader3::ReadFaceData_NODE(Post::FEPostMesh& m, XpltReader3::Surface &s
 		FACE& f = s.face[i];
 		int nf = f.nn;
 		for (int j = 0; j<nf; ++j)
-		if (m.Node(f.node[j]).m_ntag == -1) m.Node(f.node[j]).m_ntag = n++;
+		if (tag[f.node[j]] == -1) tag[f.node[j]] = n++;
 	}
 
 	// create the face list
@@ -2344,7 +2680,7 @@ bool XpltReader3::ReadFaceData_NODE(Post::FEPostMesh& m, XpltReader3::Surface &s
 		int nn = f.Nodes();
 		for (int j = 0; j<nn; ++j)
 		{
-			int n = m.Node(f.n[j]).m_ntag; assert(n >= 0);
+			int n = tag[f.n[j]]; assert(n >= 0);
 			l.push_back(n);
 		}
 	}
@@ -27,6 +27,7 @@ SOFTWARE.*/
 #pragma once
 #include "xpltFileReader.h"
 #include <MeshLib/FEElement.h>
+#include <map>
 
 namespace Post {
 	class FEState;
@@ -172,6 +173,9 @@ public:
 	// size of name variables
 	enum { DI_NAME_SIZE = 64 };
 
+	// nr of bytes of a state section that are read when building the state index
+	enum { STATE_PEEK_SIZE = 1024 };
+
 public:
 	class DICT_ITEM
 	{
@@ -321,9 +325,25 @@ public:
 
 	bool Load(Post::FEPostModel& fem);
 
+	// on-demand loading of states (only when the state index was built)
+	bool HasStateIndex() const override { return (m_stateIndex.empty() == false); }
+	bool LoadState(Post::FEPostModel& fem, Post::FEState* ps) override;
+	size_t StateSize(Post::FEState* ps) override;
+
 protected:
 	bool ReadRootSection(Post::FEPostModel& fem);
 	bool ReadStateSection(Post::FEPostModel& fem);
+	bool ReadStateHeader(Post::FEState* ps);
+	bool ReadStateData(Post::FEPostModel& fem, Post::FEState* ps);
+	bool IndexStateSection(Post::FEPostModel& fem, off_type pos);
+
+	// reading states in parallel
+	XpltReader3(XpltReader3* parser, xpltArchive& ar);
+	bool CanReadStatesParallel() const;
+	bool ReadStatesParallel(Post::FEPostModel& fem);
+	bool DecodeStateBatch(Post::FEPostModel& fem, std::vector<xpltArchive*>& batch, std::vector<int>& stateIndex, int nstates, std::vector<XpltReader3*>& parsers);
+	Post::FEState* DecodeState(Post::FEPostModel& fem);
+	bool AcceptState(Post::FEState* ps, int nstate);
 
 	bool ReadDictionary(Post::FEPostModel& fem);
 	bool ReadMesh(Post::FEPostModel& fem);
@@ -367,10 +387,23 @@ protected:
 protected:
 	Post::FEPostMesh* GetCurrentMesh() { return m_mesh; }
 
+protected:
+	// file location of a state that is loaded on demand
+	struct STATE_INDEX
+	{
+		off_type		pos;	// file position of state section
+		unsigned int	nsize;	// size of the state section
+		int				nmesh;	// index into the mesh list
+	};
+
 protected:
 	Dictionary			m_dic;
 	XMesh				m_xmesh;
 
+	std::map<Post::FEState*, STATE_INDEX>	m_stateIndex;	//!< state index (only for on-demand loading)
+	std::vector<XMesh>	m_xmeshList;	//!< the meshes the indexed states refer to (only if there is more than one)
+	int					m_nxmesh;		//!< index of m_xmesh in m_xmeshList
+
 	bool	m_bHasDispl;			// has displacement field
 	bool	m_bHasStress;			// has stress field
 	bool	m_bHasNodalStress;		// has nodal stress field